@@ -1,6 +1,9 @@
 OPTIONS="$@"
 fan fmake core/fmake.props $OPTIONS
 fan fmake modules/fmake.props $OPTIONS
+fan fmake tools/packer/fmake.props $OPTIONS
+fan fmake tools/sceneconv/fmake.props $OPTIONS
+fan fmake test/fmake.props $OPTIONS
 
 fan fmake example/gltf/fmake.props $OPTIONS
 
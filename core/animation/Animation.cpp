@@ -8,11 +8,13 @@
 #include "base/Properties.h"
 #include "scene/Node.h"
 #include "scene/Scene.h"
+#include "scene/Model.h"
 
 #define ANIMATION_INDEFINITE_STR "INDEFINITE"
 #define ANIMATION_DEFAULT_CLIP 0
 #define ANIMATION_ROTATE_OFFSET 0
 #define ANIMATION_SRT_OFFSET 3
+#define ANIMATION_CHANNEL_COMPRESSED 0x80
 
 namespace mgp
 {
@@ -370,15 +372,20 @@ void Animation::write(Stream* file) {
         file->writeUInt16(c->_propertyId);
         file->writeUInt64(c->_duration);
 
+        if (c->_compressedCurve) {
+            // The compressed flag shares the byte of the component count in the uncompressed layout.
+            file->writeUInt32(c->_compressedCurve->getPointCount());
+            file->writeUInt8(c->_compressedCurve->getComponentCount() | ANIMATION_CHANNEL_COMPRESSED);
+            c->_compressedCurve->write(file);
+            continue;
+        }
+
         file->writeUInt32(c->_curve->getPointCount());
         file->writeUInt8(c->_curve->_componentCount);
         for (int i = 0; i < c->_curve->getPointCount(); i++) {
             file->writeUInt8(c->_curve->_points[i].type);
             file->writeFloat(c->_curve->_points[i].time);
-            
-            for (int j = 0; j < c->_curve->_componentCount; ++j) {
-                file->writeFloat(c->_curve->_points[i].value[j]);
-            }
+            file->writeFloatArray(c->_curve->_points[i].value, c->_curve->_componentCount);
         }
     }
 }
@@ -397,16 +404,25 @@ bool Animation::read(Stream* file) {
         
         int keyCount = file->readUInt32();
         int propertyComponentCount = file->readUInt8();
+        if (propertyComponentCount & ANIMATION_CHANNEL_COMPRESSED) {
+            UPtr<CompressedCurve> compressed = CompressedCurve::create();
+            if (!compressed->read(file)) {
+                delete c;
+                return false;
+            }
+            c->_compressedCurve = compressed.take();
+            a->_channels.push_back(c);
+            c->_animation = a;
+            a->addRef();
+            continue;
+        }
         Curve* curve = Curve::create(keyCount, propertyComponentCount).take();
         c->_curve = curve;
         float values[256];
         for (int i = 0; i < keyCount; i++) {
             int type = file->readUInt8();
             float time_ = file->readFloat();
-            
-            for (int j = 0; j < propertyComponentCount; ++j) {
-                values[j] = file->readFloat();
-            }
+            file->readFloatArray(values, propertyComponentCount);
             curve->setPoint(i, time_, values, (Curve::InterpolationType)type);
         }
         a->_channels.push_back(c);
@@ -416,15 +432,82 @@ bool Animation::read(Stream* file) {
     return true;
 }
 
+void Animation::compress(float tolerance) {
+    for (AnimationChannel* ac : _channels) {
+        if (KeyframeChannel* c = dynamic_cast<KeyframeChannel*>(ac)) {
+            c->compress(tolerance);
+        }
+    }
+}
+
+size_t Animation::getKeyframeMemorySize() const {
+    size_t size = 0;
+    for (AnimationChannel* ac : _channels) {
+        if (KeyframeChannel* c = dynamic_cast<KeyframeChannel*>(ac)) {
+            size += c->getKeyframeMemorySize();
+        }
+    }
+    return size;
+}
+
+static bool isAnimatedDrawable(Drawable* drawable, std::set<Node*>& targets) {
+    if (targets.find(drawable->getNode()) != targets.end())
+        return true;
+
+    Model* model = dynamic_cast<Model*>(drawable);
+    if (model && model->getSkin()) {
+        MeshSkin* skin = model->getSkin();
+        for (unsigned int i = 0; i < skin->getJointCount(); ++i) {
+            if (targets.find(skin->getJoint(i)->_node.get()) != targets.end())
+                return true;
+        }
+    }
+    return false;
+}
+
+static void collectLodDrawables(Node* node, std::set<Node*>& targets, Animation* animation) {
+    Drawable* drawable = node->getDrawable();
+    if (drawable && isAnimatedDrawable(drawable, targets)) {
+        animation->addLodDrawable(drawable);
+    }
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling()) {
+        collectLodDrawables(child, targets, animation);
+    }
+}
+
 void Animation::bindTarget(Node* root) {
     for (AnimationChannel* ac : this->_channels) {
         if (KeyframeChannel* c = dynamic_cast<KeyframeChannel*>(ac)) {
             c->_target = root->findNode(c->_targetId.c_str());
             c->_target->addChannel(c);
-            if (c->_target->_targetType == AnimationTarget::TRANSFORM)
+            c->_jointDepth = -1;
+            if (c->_curve && c->_target->_targetType == AnimationTarget::TRANSFORM)
                 setTransformRotationOffset(c->_curve, c->_propertyId);
         }
     }
+
+    findLodDrawables(root);
+}
+
+void Animation::findLodDrawables(Node* root) {
+    std::set<Node*> targets;
+    for (AnimationChannel* ac : this->_channels) {
+        if (Node* node = dynamic_cast<Node*>(ac->getTarget())) {
+            targets.insert(node);
+        }
+    }
+
+    clearLodDrawables();
+    collectLodDrawables(root, targets, this);
+}
+
+void Animation::addLodDrawable(Drawable* drawable) {
+    GP_ASSERT(drawable);
+    _lodDrawables.push_back(WeakPtr<Drawable>(drawable));
+}
+
+void Animation::clearLodDrawables() {
+    _lodDrawables.clear();
 }
 
 void Animation::update(float percentComplete, unsigned int clipStart, unsigned int clipEnd, unsigned int loopBlendTime, float blendWeight) {
@@ -440,6 +523,32 @@ void Animation::update(float percentComplete, unsigned int clipStart, unsigned i
     }
 }
 
+void Animation::updateLod(float percentComplete, float nextPercentComplete, unsigned int clipStart, unsigned int clipEnd, unsigned int loopBlendTime, float blendWeight, int maxJointDepth) {
+    size_t channelCount = _channels.size();
+    float percentageStart = (float)clipStart / (float)_duration;
+    float percentageEnd = (float)clipEnd / (float)_duration;
+    float percentageBlend = (float)loopBlendTime / (float)_duration;
+
+    for (size_t i = 0; i < channelCount; i++)
+    {
+        AnimationChannel* channel = _channels[i];
+        if (maxJointDepth >= 0 && channel->getJointDepth() > maxJointDepth)
+            continue;
+        channel->updateLod(percentComplete, nextPercentComplete, percentageStart, percentageEnd, percentageBlend, blendWeight);
+    }
+}
+
+void Animation::updateLodFrame(float s, float blendWeight, int maxJointDepth) {
+    size_t channelCount = _channels.size();
+    for (size_t i = 0; i < channelCount; i++)
+    {
+        AnimationChannel* channel = _channels[i];
+        if (maxJointDepth >= 0 && channel->getJointDepth() > maxJointDepth)
+            continue;
+        channel->updateLodFrame(s, blendWeight);
+    }
+}
+
 AnimationChannel* Animation::createChannel(AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, unsigned int type)
 {
     GP_ASSERT(target);
@@ -528,13 +637,13 @@ AnimationChannel* Animation::createChannel(AnimationTarget* target, int property
 
 
 KeyframeChannel::KeyframeChannel()
-    : _animation(NULL), _target(NULL), _propertyId(0), _curve(NULL), _duration(0), _value(NULL)
+    : _animation(NULL), _target(NULL), _propertyId(0), _curve(NULL), _compressedCurve(NULL), _duration(0), _value(NULL), _nextValue(NULL), _lodValue(NULL), _jointDepth(-1)
 {
 
 }
 
 KeyframeChannel::KeyframeChannel(Animation* animation, AnimationTarget* target, int propertyId, Curve* curve, unsigned long duration)
-    : _animation(animation), _target(target), _propertyId(propertyId), _curve(curve), _duration(duration), _value(NULL)
+    : _animation(animation), _target(target), _propertyId(propertyId), _curve(curve), _compressedCurve(NULL), _duration(duration), _value(NULL), _nextValue(NULL), _lodValue(NULL), _jointDepth(-1)
 {
     GP_ASSERT(_animation);
     GP_ASSERT(_target);
@@ -552,13 +661,16 @@ KeyframeChannel::KeyframeChannel(Animation* animation, AnimationTarget* target,
 }
 
 KeyframeChannel::KeyframeChannel(const KeyframeChannel& copy, Animation* animation, AnimationTarget* target)
-    : _animation(animation), _target(target), _propertyId(copy._propertyId), _curve(copy._curve), _duration(copy._duration), _value(NULL)
+    : _animation(animation), _target(target), _propertyId(copy._propertyId), _curve(copy._curve), _compressedCurve(copy._compressedCurve), _duration(copy._duration), _value(NULL), _nextValue(NULL), _lodValue(NULL), _jointDepth(-1)
 {
-    GP_ASSERT(_curve);
+    GP_ASSERT(_curve || _compressedCurve);
     GP_ASSERT(_target);
     GP_ASSERT(_animation);
 
-    _curve->addRef();
+    if (_curve)
+        _curve->addRef();
+    if (_compressedCurve)
+        _compressedCurve->addRef();
     _target->addChannel(this);
     _animation->addRef();
 
@@ -568,8 +680,11 @@ KeyframeChannel::KeyframeChannel(const KeyframeChannel& copy, Animation* animati
 KeyframeChannel::~KeyframeChannel()
 {
     SAFE_RELEASE(_curve);
+    SAFE_RELEASE(_compressedCurve);
     SAFE_RELEASE(_animation);
     SAFE_DELETE(_value);
+    SAFE_DELETE(_nextValue);
+    SAFE_DELETE(_lodValue);
 }
 
 Curve* KeyframeChannel::getCurve() const
@@ -577,6 +692,41 @@ Curve* KeyframeChannel::getCurve() const
     return _curve;
 }
 
+unsigned int KeyframeChannel::getComponentCount() const
+{
+    return _compressedCurve ? _compressedCurve->getComponentCount() : _curve->getComponentCount();
+}
+
+void KeyframeChannel::evaluate(float percentComplete, float clipStart, float clipEnd, float loopBlendTime, Float* dst) const
+{
+    if (_compressedCurve)
+        _compressedCurve->evaluate(percentComplete, clipStart, clipEnd, loopBlendTime, dst);
+    else
+        _curve->evaluate(percentComplete, clipStart, clipEnd, loopBlendTime, dst);
+}
+
+void KeyframeChannel::compress(float tolerance)
+{
+    if (!_curve)
+        return;
+
+    UPtr<CompressedCurve> compressed = CompressedCurve::create(_curve, tolerance);
+    if (compressed.get())
+    {
+        _compressedCurve = compressed.take();
+        SAFE_RELEASE(_curve);
+    }
+}
+
+size_t KeyframeChannel::getKeyframeMemorySize() const
+{
+    if (_compressedCurve)
+        return _compressedCurve->getMemorySize();
+
+    unsigned int componentCount = _curve->getComponentCount();
+    return sizeof(Curve) + _curve->getPointCount() * (sizeof(Curve::Point) + componentCount * sizeof(float) * 3);
+}
+
 
 void KeyframeChannel::update(float percentComplete, float clipStart, float clipEnd, float loopBlendTime, float blendWeight) {
 
@@ -585,17 +735,81 @@ void KeyframeChannel::update(float percentComplete, float clipStart, float clipE
     GP_ASSERT(target);
 
     if (!_value) {
-        _value = new AnimationValue(getCurve()->getComponentCount());
+        _value = new AnimationValue(getComponentCount());
     }
 
     // Evaluate the point on Curve
-    GP_ASSERT(this->getCurve());
-    this->getCurve()->evaluate(percentComplete, clipStart, clipEnd, loopBlendTime, _value->_value);
+    GP_ASSERT(_curve || _compressedCurve);
+    evaluate(percentComplete, clipStart, clipEnd, loopBlendTime, _value->_value);
 
     // Set the animation value on the target property.
     target->setAnimationPropertyValue(this->_propertyId, _value, blendWeight);
 }
 
+void KeyframeChannel::updateLod(float percentComplete, float nextPercentComplete, float clipStart, float clipEnd, float loopBlendTime, float blendWeight) {
+    update(percentComplete, clipStart, clipEnd, loopBlendTime, blendWeight);
+
+    if (!_nextValue) {
+        _nextValue = new AnimationValue(getComponentCount());
+    }
+    evaluate(nextPercentComplete, clipStart, clipEnd, loopBlendTime, _nextValue->_value);
+}
+
+void KeyframeChannel::updateLodFrame(float s, float blendWeight) {
+    if (!_value || !_nextValue)
+        return;
+
+    unsigned int componentCount = getComponentCount();
+    if (!_lodValue) {
+        _lodValue = new AnimationValue(componentCount);
+    }
+
+    Float* from = _value->_value;
+    Float* to = _nextValue->_value;
+    Float* dst = _lodValue->_value;
+    for (unsigned int i = 0; i < componentCount; ++i) {
+        dst[i] = Curve::lerp(s, from[i], to[i]);
+    }
+
+    // Quaternion components are normalized lerped, the steps between LOD updates are short.
+    int quaternionOffset = -1;
+    if (_curve && _curve->_quaternionOffset)
+        quaternionOffset = *_curve->_quaternionOffset;
+    else if (_compressedCurve)
+        quaternionOffset = _compressedCurve->getQuaternionOffset();
+    if (quaternionOffset >= 0) {
+        Float* q0 = from + quaternionOffset;
+        Float* q1 = to + quaternionOffset;
+        Float* q = dst + quaternionOffset;
+        Float dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+        Float sign = dot < 0 ? -1.0 : 1.0;
+        Float length = 0;
+        for (int i = 0; i < 4; ++i) {
+            q[i] = q0[i] + (q1[i] * sign - q0[i]) * s;
+            length += q[i] * q[i];
+        }
+        if (length > 0) {
+            length = 1.0 / sqrt(length);
+            for (int i = 0; i < 4; ++i) q[i] *= length;
+        }
+    }
+
+    _target->setAnimationPropertyValue(this->_propertyId, _lodValue, blendWeight);
+}
+
+int KeyframeChannel::getJointDepth() {
+    if (_jointDepth < 0) {
+        // Count the animated ancestors, so the depth is relative to the skeleton root.
+        _jointDepth = 0;
+        Node* node = dynamic_cast<Node*>(_target);
+        while (node && node->getParent() && _animation->targets(node->getParent())) {
+            ++_jointDepth;
+            node = node->getParent();
+        }
+    }
+    return _jointDepth;
+}
+
 
 
 
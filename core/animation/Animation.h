@@ -5,6 +5,7 @@
 #include "base/Ptr.h"
 #include "base/Properties.h"
 #include "math/Curve.h"
+#include "math/CompressedCurve.h"
 #include "base/Resource.h"
 
 namespace mgp
@@ -16,6 +17,7 @@ class AnimationClip;
 class AnimationValue;
 class AnimationChannel;
 class Node;
+class Drawable;
 
 /**
  * Defines a generic property animation.
@@ -110,14 +112,69 @@ public:
     bool targets(AnimationTarget* target) const;
 
 
+    /**
+     * Compresses the keyframes of the channels that support it (LINEAR and STEP curves).
+     * Redundant keys within the tolerance are removed and the values are quantized.
+     * The compressed channels are decoded on the fly and are written compressed by write().
+     *
+     * @param tolerance The max error of the removed keys.
+     */
+    void compress(float tolerance = 0.0001f);
+
+    /**
+     * Gets the memory used by the keyframes of all channels, in bytes.
+     */
+    size_t getKeyframeMemorySize() const;
+
     void write(Stream* file);
     bool read(Stream* file);
 
 
     void update(float percentComplete, unsigned int clipStart, unsigned int clipEnd, unsigned int loopBlendTime, float blendWeight);
 
+    /**
+     * Evaluates the channels at percentComplete and caches the value at nextPercentComplete,
+     * so the frames skipped by animation LOD can be interpolated with updateLodFrame().
+     *
+     * @param maxJointDepth Channels targeting joints deeper than this are not evaluated. -1 for all.
+     */
+    void updateLod(float percentComplete, float nextPercentComplete, unsigned int clipStart, unsigned int clipEnd, unsigned int loopBlendTime, float blendWeight, int maxJointDepth);
+
+    /**
+     * Interpolates between the values cached by the last updateLod().
+     *
+     * @param s The interpolation factor in [0, 1].
+     */
+    void updateLodFrame(float s, float blendWeight, int maxJointDepth);
+
+    /**
+     * Adds a drawable whose visibility controls the update rate of this animation.
+     * An animation without LOD drawables always updates at full rate.
+     */
+    void addLodDrawable(Drawable* drawable);
+
+    /**
+     * Removes all LOD drawables.
+     */
+    void clearLodDrawables();
+
+    /**
+     * Replaces the LOD drawables with the drawables under root that are animated by this
+     * animation, including skinned models whose joints are animated.
+     */
+    void findLodDrawables(Node* root);
+
+    /**
+     * Gets the drawables used for animation LOD.
+     */
+    std::vector<WeakPtr<Drawable> >& getLodDrawables() { return _lodDrawables; }
+
 public:
 
+    /**
+     * Binds the channels to the nodes under root by name,
+     * and collects the drawables animated by them for animation LOD.
+     */
     void bindTarget(Node* root);
 
     /**
@@ -212,6 +269,7 @@ public:
     std::vector<AnimationChannel*> _channels;        // The channels within this Animation.
     AnimationClip* _defaultClip;            // The Animation's default clip.
     std::vector<AnimationClip*>* _clips;    // All the clips created from this Animation.
+    std::vector<WeakPtr<Drawable> > _lodDrawables; // The drawables whose visibility drives the animation LOD.
 
 };
 
@@ -230,6 +288,21 @@ public:
     virtual AnimationTarget* getTarget() = 0;
     virtual Animation* getAnimation() = 0;
     //virtual Curve* getCurve() const = 0;
+
+    /**
+     * Evaluates the channel and keeps the value at nextPercentComplete for updateLodFrame().
+     */
+    virtual void updateLod(float percentComplete, float nextPercentComplete, float clipStart, float clipEnd, float loopBlendTime, float blendWeight) { update(percentComplete, clipStart, clipEnd, loopBlendTime, blendWeight); }
+
+    /**
+     * Applies a value interpolated between the two values kept by updateLod().
+     */
+    virtual void updateLodFrame(float s, float blendWeight) {}
+
+    /**
+     * Gets the depth of the target in its node hierarchy, used for skipping distant bones.
+     */
+    virtual int getJointDepth() { return 0; }
 };
 
 /**
@@ -245,6 +318,9 @@ class KeyframeChannel : public AnimationChannel
     friend class AnimationTarget;
 public:
     virtual void update(float percentComplete, float clipStart, float clipEnd, float loopBlendTime, float blendWeight);
+    virtual void updateLod(float percentComplete, float nextPercentComplete, float clipStart, float clipEnd, float loopBlendTime, float blendWeight);
+    virtual void updateLodFrame(float s, float blendWeight);
+    virtual int getJointDepth();
 
 private:
 
@@ -256,6 +332,10 @@ private:
     ~KeyframeChannel();
     KeyframeChannel& operator=(const KeyframeChannel&); // Hidden copy assignment operator.
     Curve* getCurve() const;
+    unsigned int getComponentCount() const;
+    void evaluate(float percentComplete, float clipStart, float clipEnd, float loopBlendTime, Float* dst) const;
+    void compress(float tolerance);
+    size_t getKeyframeMemorySize() const;
     unsigned long getDuration() { return _duration; }
     AnimationTarget* getTarget() { return _target; }
     Animation* getAnimation() { return _animation; }
@@ -263,10 +343,14 @@ private:
     Animation* _animation;                // Reference to the animation this channel belongs to.
     AnimationTarget* _target;             // The target of this channel.
     int _propertyId;                      // The target property this channel targets.
-    Curve* _curve;                        // The curve used to represent the animation data.
+    Curve* _curve;                        // The curve used to represent the animation data. NULL if compressed.
+    CompressedCurve* _compressedCurve;    // The compressed animation data, if compressed.
     unsigned long _duration;              // The length of the animation (in milliseconds).
     std::string _targetId;
     AnimationValue *_value;
+    AnimationValue *_nextValue;           // The value at the next LOD update.
+    AnimationValue *_lodValue;            // The interpolated value of skipped LOD frames.
+    int _jointDepth;                      // The depth of target node. -1 if not computed.
 };
 
 }
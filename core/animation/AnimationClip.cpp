@@ -4,6 +4,7 @@
 #include "AnimationTarget.h"
 #include "platform/Toolkit.h"
 #include "math/Quaternion.h"
+#include "AnimationController.h"
 //#include "script/ScriptController.h"
 #include <algorithm>
 
@@ -16,7 +17,7 @@ AnimationClip::AnimationClip(const char* id, Animation* animation, unsigned long
     : _id(id), _animation(animation), _startTime(startTime), _endTime(endTime), _duration(_endTime - _startTime), 
       _stateBits(0x00), _repeatCount(1.0f), _loopBlendTime(0), _activeDuration(_duration * _repeatCount), _speed(1.0f), _timeStarted(0), 
       _elapsedTime(0), _crossFadeToClip(NULL), _crossFadeOutElapsed(0), _crossFadeOutDuration(0), _blendWeight(1.0f),
-      _beginListeners(NULL), _endListeners(NULL), _listeners(NULL), _listenerItr(NULL)
+      _beginListeners(NULL), _endListeners(NULL), _listeners(NULL), _listenerItr(NULL), _lodInterval(1), _lodFrame(0)
 {
 #ifdef GP_SCRIPT
     GP_REGISTER_SCRIPT_EVENTS();
@@ -415,7 +416,8 @@ bool AnimationClip::update(float elapsedTime)
         return true;
     }
 
-    if (!isClipStateBitSet(CLIP_IS_STARTED_BIT))
+    bool starting = !isClipStateBitSet(CLIP_IS_STARTED_BIT);
+    if (starting)
     {
         // Clip is just starting
         onBegin();
@@ -554,7 +556,7 @@ bool AnimationClip::update(float elapsedTime)
     }
     
     // Evaluate this clip.
-    _animation->update(percentComplete, _startTime, _endTime, _loopBlendTime, _blendWeight);
+    evaluate(percentComplete, elapsedTime, starting || !isClipStateBitSet(CLIP_IS_STARTED_BIT));
 
 
     // When ended. Probably should move to it's own method so we can call it when the clip is ended early.
@@ -567,6 +569,67 @@ bool AnimationClip::update(float elapsedTime)
     return false;
 }
 
+void AnimationClip::evaluate(float percentComplete, float elapsedTime, bool force)
+{
+    int maxJointDepth = -1;
+    int interval = 1;
+    AnimationController* controller = _animation->_controller;
+    if (controller && !force)
+        interval = controller->computeLodInterval(this, &maxJointDepth);
+
+    if (interval == 0)
+    {
+        // Not visible. Evaluate again as soon as it becomes visible.
+        _lodFrame = 0;
+        _lodInterval = 0;
+        return;
+    }
+
+    if (interval == 1)
+    {
+        _lodInterval = 1;
+        _animation->update(percentComplete, _startTime, _endTime, _loopBlendTime, _blendWeight);
+        return;
+    }
+
+    // Interpolate the frames skipped by LOD.
+    if (interval == _lodInterval && ++_lodFrame < _lodInterval)
+    {
+        _animation->updateLodFrame((float)_lodFrame / _lodInterval, _blendWeight, maxJointDepth);
+        return;
+    }
+
+    // Predict where the clip will be at the next LOD update. Stop at the loop end instead of wrapping around.
+    float nextPercentComplete = computePercentComplete(_elapsedTime + elapsedTime * _speed * interval);
+    if (_speed >= 0.0f && nextPercentComplete < percentComplete)
+        nextPercentComplete = (_duration == 0) ? 1.0f : (float)(_duration + _loopBlendTime) / _duration;
+    else if (_speed < 0.0f && nextPercentComplete > percentComplete)
+        nextPercentComplete = 0.0f;
+
+    _lodInterval = interval;
+    _lodFrame = 0;
+    _animation->updateLod(percentComplete, nextPercentComplete, _startTime, _endTime, _loopBlendTime, _blendWeight, maxJointDepth);
+}
+
+float AnimationClip::computePercentComplete(float elapsedTime) const
+{
+    if (_duration == 0)
+        return 1.0f;
+
+    float currentTime;
+    if (_repeatCount != REPEAT_INDEFINITE && elapsedTime >= _activeDuration)
+        currentTime = _duration;
+    else if (elapsedTime <= 0.0f)
+        currentTime = 0.0f;
+    else
+        currentTime = fmodf(elapsedTime, _duration + _loopBlendTime);
+
+    float percentComplete = currentTime / (float)_duration;
+    if (_loopBlendTime == 0.0f)
+        percentComplete = MATH_CLAMP(percentComplete, 0.0f, 1.0f);
+    return percentComplete;
+}
+
 void AnimationClip::onBegin()
 {
     this->addRef();
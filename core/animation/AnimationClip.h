@@ -359,6 +359,18 @@ private:
      */
     bool update(float elapsedTime);
 
+    /**
+     * Evaluates the animation, at a reduced rate if the AnimationController LOD asks for it.
+     *
+     * @param force true to evaluate at full rate regardless of LOD.
+     */
+    void evaluate(float percentComplete, float elapsedTime, bool force);
+
+    /**
+     * Computes the percentage complete of the current loop at the given elapsed time.
+     */
+    float computePercentComplete(float elapsedTime) const;
+
     /**
      * Handles when the AnimationClip begins.
      */
@@ -414,6 +426,8 @@ private:
     std::vector<Listener*>* _endListeners;              // Collection of end listeners on the clip.
     std::list<ListenerEvent*>* _listeners;              // Ordered collection of listeners on the clip.
     std::list<ListenerEvent*>::iterator* _listenerItr;  // Iterator that points to the next listener event to be triggered.
+    int _lodInterval;                                   // The LOD update interval in frames of the last evaluation. 0 if not visible.
+    int _lodFrame;                                      // Frames since the last LOD update.
 
 public:
     std::function<void()> onAnimEnd;
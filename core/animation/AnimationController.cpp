@@ -3,6 +3,7 @@
 #include "platform/Toolkit.h"
 #include "math/Curve.h"
 #include "scene/Transform.h"
+#include "scene/Drawable.h"
 
 namespace mgp
 {
@@ -10,9 +11,12 @@ namespace mgp
 static AnimationController* g_cur;
 
 AnimationController::AnimationController()
-    : _state(STOPPED)
+    : _state(STOPPED), _lodEnabled(false), _lodMaxJointDepth(-1), _lodVisibleTimeout(200)
 {
     g_cur = this;
+    _lodScreenSizes.push_back(0.1f);
+    _lodScreenSizes.push_back(0.05f);
+    _lodScreenSizes.push_back(0.02f);
 }
 
 AnimationController::~AnimationController()
@@ -36,6 +40,72 @@ void AnimationController::stopAllAnimations()
     }
 }
 
+void AnimationController::setLodEnabled(bool enabled)
+{
+    _lodEnabled = enabled;
+}
+
+bool AnimationController::isLodEnabled() const
+{
+    return _lodEnabled;
+}
+
+void AnimationController::setLodScreenSizes(const std::vector<float>& screenSizes)
+{
+    _lodScreenSizes = screenSizes;
+}
+
+void AnimationController::setLodMaxJointDepth(int depth)
+{
+    _lodMaxJointDepth = depth;
+}
+
+void AnimationController::setLodVisibleTimeout(float timeout)
+{
+    _lodVisibleTimeout = timeout;
+}
+
+int AnimationController::computeLodInterval(AnimationClip* clip, int* maxJointDepth) const
+{
+    *maxJointDepth = -1;
+    Animation* animation = clip->getAnimation();
+    if (!_lodEnabled || !animation || animation->_lodDrawables.empty())
+        return 1;
+
+    double now = Toolkit::cur()->getGameTime();
+    bool alive = false;
+    float screenSize = -1.0f;
+    for (WeakPtr<Drawable>& ref : animation->_lodDrawables)
+    {
+        SPtr<Drawable> drawable = ref.lock();
+        if (!drawable.get())
+            continue;
+        alive = true;
+        double lastVisibleTime = drawable->getLastVisibleTime();
+        if (lastVisibleTime >= 0 && now - lastVisibleTime <= _lodVisibleTimeout)
+            screenSize = std::max(screenSize, drawable->getScreenSize());
+    }
+
+    // The drawables are gone, there is nothing to measure.
+    if (!alive)
+        return 1;
+
+    if (screenSize < 0)
+        return 0;
+
+    int interval = 1;
+    size_t level = 0;
+    for (; level < _lodScreenSizes.size(); ++level)
+    {
+        if (screenSize >= _lodScreenSizes[level])
+            break;
+        interval *= 2;
+    }
+    if (level > 0 && level == _lodScreenSizes.size())
+        *maxJointDepth = _lodMaxJointDepth;
+    return interval;
+}
+
 AnimationController::State AnimationController::getState() const
 {
     return _state;
@@ -27,6 +27,45 @@ public:
     void stopAllAnimations();
 
     static AnimationController *cur();
+
+    /**
+     * Enables or disables animation LOD.
+     *
+     * When enabled, a clip whose animation has LOD drawables (see Animation::addLodDrawable)
+     * is not evaluated while none of them was visible in the last frames, and is evaluated
+     * at a reduced rate, interpolating the skipped frames, while they are small on screen.
+     *
+     * @param enabled true to enable animation LOD.
+     */
+    void setLodEnabled(bool enabled);
+
+    /**
+     * Returns true if animation LOD is enabled.
+     */
+    bool isLodEnabled() const;
+
+    /**
+     * Sets the screen size thresholds of the LOD levels, in descending order.
+     *
+     * The screen size is the projected bounding radius relative to half the viewport height.
+     * A clip smaller than the n-th threshold is evaluated every 2^(n+1) frames.
+     *
+     * @param screenSizes The thresholds. Defaults to 0.1, 0.05, 0.02.
+     */
+    void setLodScreenSizes(const std::vector<float>& screenSizes);
+
+    /**
+     * Sets the max joint depth (relative to the animated root) evaluated at the lowest LOD level.
+     *
+     * @param depth The max depth, or -1 to evaluate all joints.
+     */
+    void setLodMaxJointDepth(int depth);
+
+    /**
+     * Sets the time (in milliseconds) a drawable is still considered visible after the last
+     * culling pass found it visible.
+     */
+    void setLodVisibleTimeout(float timeout);
        
 private:
 
@@ -97,9 +136,18 @@ private:
      * Callback for when the controller receives a frame update event.
      */
     void update(float elapsedTime);
+
+    /**
+     * Computes the LOD interval of the clip: 0 if not visible, 1 for every frame, n for every n frames.
+     */
+    int computeLodInterval(AnimationClip* clip, int* maxJointDepth) const;
     
     State _state;                                 // The current state of the AnimationController.
     std::list<AnimationClip*> _runningClips;      // A list of running AnimationClips.
+    bool _lodEnabled;                             // Whether animation LOD is enabled.
+    std::vector<float> _lodScreenSizes;           // Screen size thresholds of the LOD levels.
+    int _lodMaxJointDepth;                        // Max joint depth of the lowest LOD level, -1 for all.
+    float _lodVisibleTimeout;                     // Time a drawable stays visible after being culled.
 };
 
 }
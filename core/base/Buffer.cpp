@@ -12,15 +12,18 @@
 using namespace mgp;
 
 Buffer::Buffer() :
-    data(nullptr), _pos(0), _size(0), owner(false) {
+    data(nullptr), _size(0), owner(false) {
+  setPosition(0);
 }
 
-Buffer::Buffer(size_t size) :  _pos(0), _size(size), owner(true) {
+Buffer::Buffer(size_t size) : _size(size), owner(true) {
   data = (uint8_t*)malloc(size);
+  setPosition(0);
 }
 
 Buffer::Buffer(uint8_t* data, size_t size, bool owner) :
-    data(data), _pos(0), _size(size), owner(owner) {
+    data(data), _size(size), owner(owner) {
+  setPosition(0);
 }
 
 Buffer::~Buffer() {
@@ -29,52 +32,60 @@ Buffer::~Buffer() {
   }
 }
 
+void Buffer::setPosition(size_t pos) {
+  _readNext = data + pos;
+  _readEnd = data + _size;
+}
 
 size_t Buffer::write(const void* ptr, size_t size, size_t count) {
+  if (size == 0) return 0;
+  size_t pos = position();
   size_t len = size * count;
-  if (len > _size - _pos) {
+  if (len > _size - pos) {
     if (owner) {
-      uint8_t *p = (uint8_t*)realloc(data, _pos+ len);
+      uint8_t *p = (uint8_t*)realloc(data, pos + len);
       if (p) {
         data = p;
-        _size = _pos + len;
+        _size = pos + len;
       }
-    } else {
-        len = _size - _pos;
+    }
+    if (len > _size - pos) {
+      count = (_size - pos) / size;
+      len = size * count;
     }
   }
-  memcpy(data + _pos, ptr, len);
-  _pos += len;
+  if (len) memcpy(data + pos, ptr, len);
+  setPosition(pos + len);
   return count;
 }
 
 size_t Buffer::read(void* ptr, size_t size, size_t count) {
-  if (size > remaining()) {
-    size = remaining();
+  if (size == 0) return 0;
+  if (count > remaining() / size) {
+    count = remaining() / size;
   }
   size_t len = size * count;
-  memcpy(ptr, data + _pos, len);
-  _pos += len;
+  if (len) memcpy(ptr, _readNext, len);
+  _readNext += len;
   return count;
 }
 
 unsigned char * Buffer::readDirect(int len) {
-  unsigned char *p = data+_pos;
-  if (_pos <= _size - len) {
-    _pos += len;
-    return p;
+  unsigned char *p = (unsigned char*)_readNext;
+  if ((size_t)len <= remaining()) {
+    _readNext += len;
   }
   else {
-    _pos = _size;
-    return p;
+    _readNext = _readEnd;
   }
+  return p;
 }
 
 void Buffer::readSlice(Buffer &out, bool copy) {
-    out._pos = 0;
     size_t size = readUInt16();
-    out._size = size;
-    if (_pos + size >= _size) {
+    if (size > remaining()) {
+        out._size = 0;
+        out.setPosition(0);
         return;
     }
     uint8_t *data = readDirect((int)size);
@@ -86,12 +97,21 @@ void Buffer::readSlice(Buffer &out, bool copy) {
         out.data = data;
         out.owner = false;
     }
+    out._size = size;
+    out.setPosition(0);
 }
 
-bool Buffer::seek(long int pos, int origin) {
-    if (pos <= _size) {
-        this->_pos = pos;
-        return true;
+bool Buffer::seek(long int offset, int origin) {
+    long int pos = offset;
+    if (origin == SEEK_CUR) {
+        pos += position();
+    }
+    else if (origin == SEEK_END) {
+        pos += (long int)_size;
+    }
+    if (pos < 0 || (size_t)pos > _size) {
+        return false;
     }
-    return false;
+    setPosition(pos);
+    return true;
 }
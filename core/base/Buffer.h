@@ -7,8 +7,8 @@
  * History:
  *   2012-12-23  Jed Young  Creation
  */
-#ifndef FILESTREAM_H_
-#define FILESTREAM_H_
+#ifndef BUFFER_H_
+#define BUFFER_H_
 
 #include "Stream.h"
 
@@ -17,14 +17,17 @@ namespace mgp
 
 /**
  * ByteArray is memory buffer
+ *
+ * The position is the read window of Stream, the typed reads copy from the data directly.
  */
 class Buffer : public Stream {
 private:
   uint8_t* data;
-  size_t _pos;
   size_t _size;
   bool owner;
-  
+
+  void setPosition(size_t pos);
+
 public:
     Buffer();
     Buffer(size_t size);
@@ -40,12 +43,12 @@ public:
     unsigned char * readDirect(int len);
     unsigned char *getData() { return data; }
 
-    size_t remaining() { return _size - _pos; }
+    size_t remaining() { return _readEnd - _readNext; }
 
     virtual size_t read(void* ptr, size_t size, size_t count);
     virtual size_t write(const void* ptr, size_t size, size_t count);
     virtual size_t length() { return _size; }
-    virtual long int position() { return _pos; }
+    virtual long int position() { return (long int)(_readNext - data); }
     virtual bool seek(long int offset, int origin = SEEK_SET);
 };
 
@@ -0,0 +1,190 @@
+#include "Base.h"
+#include "BufferedStream.h"
+
+#include <algorithm>
+
+namespace mgp
+{
+
+BufferedStream::BufferedStream(Stream* stream, size_t bufferSize)
+    : _stream(stream), _buffer(NULL), _bufferSize(bufferSize), _bufferPosition(0), _writeSize(0)
+{
+    GP_ASSERT(stream);
+    GP_ASSERT(bufferSize > 0);
+    _buffer = new uint8_t[bufferSize];
+    _readNext = _readEnd = _buffer;
+    endian = stream->endian;
+    if (stream->canSeek())
+        _bufferPosition = stream->position();
+}
+
+BufferedStream::~BufferedStream()
+{
+    flushWrite();
+    SAFE_DELETE(_stream);
+    SAFE_DELETE_ARRAY(_buffer);
+}
+
+bool BufferedStream::canRead()
+{
+    return _stream->canRead();
+}
+
+bool BufferedStream::canWrite()
+{
+    return _stream->canWrite();
+}
+
+bool BufferedStream::canSeek()
+{
+    return _stream->canSeek();
+}
+
+bool BufferedStream::flushWrite()
+{
+    if (_writeSize == 0)
+        return true;
+    size_t written = _stream->write(_buffer, 1, _writeSize);
+    bool result = written == _writeSize;
+    _bufferPosition += (long int)written;
+    _writeSize = 0;
+    return result;
+}
+
+void BufferedStream::dropRead()
+{
+    if (_readNext != _readEnd)
+    {
+        // the stream is at the end of the bytes read ahead
+        long int pos = position();
+        _stream->seek(pos, SEEK_SET);
+        _bufferPosition = pos;
+    }
+    else
+    {
+        _bufferPosition += (long int)(_readEnd - _buffer);
+    }
+    _readNext = _readEnd = _buffer;
+}
+
+size_t BufferedStream::read(void* ptr, size_t size, size_t count)
+{
+    size_t len = size * count;
+    if (len == 0)
+        return 0;
+    flushWrite();
+
+    uint8_t* out = (uint8_t*)ptr;
+    size_t available = _readEnd - _readNext;
+    if (available >= len)
+    {
+        memcpy(out, _readNext, len);
+        _readNext += len;
+        return count;
+    }
+    memcpy(out, _readNext, available);
+    size_t total = available;
+    _bufferPosition += (long int)(_readEnd - _buffer);
+    _readNext = _readEnd = _buffer;
+
+    if (len - total >= _bufferSize)
+    {
+        // too large to be worth the copy
+        size_t n = _stream->read(out + total, 1, len - total);
+        _bufferPosition += (long int)n;
+        total += n;
+    }
+    else
+    {
+        size_t n = _stream->read(_buffer, 1, _bufferSize);
+        _readEnd = _buffer + n;
+        size_t copied = std::min(n, len - total);
+        memcpy(out + total, _buffer, copied);
+        _readNext += copied;
+        total += copied;
+    }
+    return total / size;
+}
+
+size_t BufferedStream::write(const void* ptr, size_t size, size_t count)
+{
+    size_t len = size * count;
+    if (len == 0)
+        return 0;
+    dropRead();
+
+    if (_writeSize + len > _bufferSize)
+    {
+        if (!flushWrite())
+            return 0;
+        if (len >= _bufferSize)
+        {
+            size_t n = _stream->write(ptr, 1, len);
+            _bufferPosition += (long int)n;
+            return n / size;
+        }
+    }
+    memcpy(_buffer + _writeSize, ptr, len);
+    _writeSize += len;
+    return count;
+}
+
+bool BufferedStream::eof()
+{
+    if (_readNext != _readEnd)
+        return false;
+    flushWrite();
+    return _stream->eof();
+}
+
+size_t BufferedStream::length()
+{
+    flushWrite();
+    return _stream->length();
+}
+
+long int BufferedStream::position()
+{
+    return _bufferPosition + (long int)(_readNext - _buffer) + (long int)_writeSize;
+}
+
+bool BufferedStream::seek(long int offset, int origin)
+{
+    long int pos = offset;
+    if (origin == SEEK_CUR)
+        pos += position();
+    else if (origin == SEEK_END)
+        pos += (long int)length();
+
+    // inside the bytes read ahead
+    if (_writeSize == 0 && pos >= _bufferPosition && pos <= _bufferPosition + (long int)(_readEnd - _buffer))
+    {
+        _readNext = _buffer + (pos - _bufferPosition);
+        return true;
+    }
+
+    flushWrite();
+    _readNext = _readEnd = _buffer;
+    if (!_stream->seek(pos, SEEK_SET))
+    {
+        _bufferPosition = _stream->position();
+        return false;
+    }
+    _bufferPosition = pos;
+    return true;
+}
+
+void BufferedStream::flush()
+{
+    flushWrite();
+    _stream->flush();
+}
+
+void BufferedStream::close()
+{
+    flushWrite();
+    _readNext = _readEnd = _buffer;
+    _stream->close();
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef BUFFEREDSTREAM_H_
+#define BUFFEREDSTREAM_H_
+
+#include "Stream.h"
+
+namespace mgp
+{
+
+/**
+ * Defines a stream buffering the reads and writes of another stream.
+ *
+ * The reads fill the buffer with one read of the other stream, the typed reads then copy
+ * from it without a virtual call. Seeking inside the buffer only moves the position.
+ * The writes are kept in the buffer until it is full, the stream is flushed or seeked,
+ * or something is read.
+ *
+ * Use FileSystem::open() with FileSystem::BUFFERED to buffer a file.
+ *
+ * @script{ignore}
+ */
+class BufferedStream : public Stream
+{
+public:
+
+    /**
+     * Creates a stream buffering the given stream, which is owned and deleted with it.
+     *
+     * @param stream The stream to buffer.
+     * @param bufferSize The size of the buffer in bytes.
+     */
+    BufferedStream(Stream* stream, size_t bufferSize = 64 * 1024);
+
+    /**
+     * Destructor, writes the buffered bytes and deletes the stream.
+     */
+    ~BufferedStream();
+
+    /**
+     * Gets the buffered stream.
+     */
+    Stream* getStream() const { return _stream; }
+
+    virtual bool canRead();
+    virtual bool canWrite();
+    virtual bool canSeek();
+    virtual size_t read(void* ptr, size_t size, size_t count);
+    virtual size_t write(const void* ptr, size_t size, size_t count);
+    virtual bool eof();
+    virtual size_t length();
+    virtual long int position();
+    virtual bool seek(long int offset, int origin = SEEK_SET);
+    virtual void flush();
+    virtual void close();
+
+private:
+
+    BufferedStream(const BufferedStream&);
+    BufferedStream& operator=(const BufferedStream&);
+
+    /**
+     * Writes the buffered bytes to the stream.
+     */
+    bool flushWrite();
+
+    /**
+     * Drops the bytes read ahead, moving the stream back to the position.
+     */
+    void dropRead();
+
+    Stream* _stream;
+    uint8_t* _buffer;
+    size_t _bufferSize;
+    long int _bufferPosition;       // The position in the stream of the start of the buffer.
+    size_t _writeSize;              // The bytes written in the buffer, 0 when reading.
+};
+
+}
+
+#endif
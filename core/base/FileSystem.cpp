@@ -27,6 +27,9 @@
 #include "base/Properties.h"
 #include "Stream.h"
 #include "FileStream.h"
+#include "BufferedStream.h"
+#include "MappedFile.h"
+#include "PackFile.h"
 
 #include <algorithm>
 #include <assert.h>
@@ -61,6 +64,15 @@ static std::string __assetPath("");
 static std::map<std::string, std::string> __aliases;
 static std::mutex __fileLock;
 
+struct MountedPack
+{
+    std::string path;
+    std::string mountPoint;     // Normalized, with a trailing separator.
+    SPtr<PackFile> pack;
+};
+static std::vector<MountedPack> __packs;
+static std::mutex __packLock;
+
 /**
  * Gets the fully resolved path.
  * If the path is relative then it will be prefixed with the resource path.
@@ -82,6 +94,30 @@ void getFullPath(const char* path, std::string& fullPath)
     }
 }
 
+/**
+ * Finds the mounted pack holding a file.
+ *
+ * @param path The path to the file.
+ * @param entryPath Set to the path of the file in the pack.
+ */
+static SPtr<PackFile> findPack(const char* path, std::string& entryPath)
+{
+    std::lock_guard<std::mutex> guard(__packLock);
+    if (__packs.empty())
+        return SPtr<PackFile>();
+
+    std::string name = PackFile::normalizePath(FileSystem::resolvePath(path));
+    for (auto it = __packs.rbegin(); it != __packs.rend(); ++it)
+    {
+        if (name.compare(0, it->mountPoint.size(), it->mountPoint) != 0)
+            continue;
+        entryPath = name.substr(it->mountPoint.size());
+        if (it->pack->contains(entryPath.c_str()))
+            return it->pack;
+    }
+    return SPtr<PackFile>();
+}
+
 /////////////////////////////
 
 FileSystem::FileSystem()
@@ -296,6 +332,10 @@ bool FileSystem::fileExists(const char* filePath)
     GP_ASSERT(filePath);
 
     std::string fullPath;
+    if (findPack(filePath, fullPath).get())
+    {
+        return true;
+    }
 
 #ifdef __ANDROID__
     fullPath = __assetPath;
@@ -316,9 +356,18 @@ bool FileSystem::fileExists(const char* filePath)
 
 UPtr<Stream> FileSystem::open(const char* path, size_t streamMode)
 {
+    if ((streamMode & WRITE) == 0)
+    {
+        std::string entryPath;
+        SPtr<PackFile> pack = findPack(path, entryPath);
+        if (pack.get())
+            return pack->openEntry(entryPath.c_str());
+    }
+
     char modeStr[] = "rb";
     if ((streamMode & WRITE) != 0)
         modeStr[0] = 'w';
+    UPtr<Stream> stream;
 #ifdef __ANDROID__
     std::string fullPath(__resourcePath);
     fullPath += resolvePath(path);
@@ -334,12 +383,12 @@ UPtr<Stream> FileSystem::open(const char* path, size_t streamMode)
             if (stat(directoryPath.c_str(), &s) != 0)
                 mkdirs(directoryPath);
         }
-        return FileStream::create(fullPath.c_str(), modeStr);
+        stream = FileStream::create(fullPath.c_str(), modeStr).dynamicCastTo<Stream>();
     }
     else
     {
         // First try the SD card
-        UPtr<Stream> stream = FileStream::create(fullPath.c_str(), modeStr).dynamicCastTo<Stream>();
+        stream = FileStream::create(fullPath.c_str(), modeStr).dynamicCastTo<Stream>();
 
         if (!stream)
         {
@@ -349,15 +398,15 @@ UPtr<Stream> FileSystem::open(const char* path, size_t streamMode)
 
             stream = FileStreamAndroid::create(fullPath.c_str(), modeStr);
         }
-
-        return stream;
     }
 #else
     std::string fullPath;
     getFullPath(path, fullPath);
-    UPtr<Stream> stream = FileStream::create(fullPath.c_str(), modeStr).dynamicCastTo<Stream>();
-    return stream;
+    stream = FileStream::create(fullPath.c_str(), modeStr).dynamicCastTo<Stream>();
 #endif
+    if ((streamMode & BUFFERED) != 0 && !stream.isNull())
+        stream = UPtr<Stream>(new BufferedStream(stream.take()));
+    return stream;
 }
 
 FILE* FileSystem::openFile(const char* filePath, const char* mode)
@@ -407,6 +456,66 @@ char* FileSystem::readAll(const char* filePath, int* fileSize)
     return buffer;
 }
 
+UPtr<MappedFile> FileSystem::map(const char* filePath)
+{
+    GP_ASSERT(filePath);
+
+    std::string entryPath;
+    SPtr<PackFile> pack = findPack(filePath, entryPath);
+    if (pack.get())
+        return pack->mapEntry(entryPath.c_str());
+
+#ifndef __ANDROID__
+    std::string fullPath;
+    getFullPath(filePath, fullPath);
+    UPtr<MappedFile> mappedFile = MappedFile::create(fullPath.c_str());
+    if (mappedFile.get())
+        return mappedFile;
+#endif
+
+    int size = 0;
+    char* data = readAll(filePath, &size);
+    if (data == NULL)
+        return UPtr<MappedFile>(NULL);
+    return MappedFile::create(data, size);
+}
+
+bool FileSystem::mount(const char* packPath, const char* mountPoint)
+{
+    GP_ASSERT(packPath);
+    GP_ASSERT(mountPoint);
+
+    UPtr<PackFile> pack = PackFile::open(packPath);
+    if (pack.isNull())
+        return false;
+
+    MountedPack mounted;
+    mounted.path = packPath;
+    mounted.mountPoint = PackFile::normalizePath(mountPoint);
+    if (!mounted.mountPoint.empty() && mounted.mountPoint.back() != '/')
+        mounted.mountPoint += '/';
+    mounted.pack = pack.get();
+
+    std::lock_guard<std::mutex> guard(__packLock);
+    __packs.push_back(mounted);
+    return true;
+}
+
+void FileSystem::unmount(const char* packPath)
+{
+    GP_ASSERT(packPath);
+
+    std::lock_guard<std::mutex> guard(__packLock);
+    for (auto it = __packs.begin(); it != __packs.end(); ++it)
+    {
+        if (it->path == packPath)
+        {
+            __packs.erase(it);
+            return;
+        }
+    }
+}
+
 std::string FileSystem::readAllStr(const char* filePath) {
     GP_ASSERT(filePath);
     std::string result;
@@ -9,6 +9,7 @@ namespace mgp
 {
 
 class Properties;
+class MappedFile;
 
 /**
  * Defines a set of functions for interacting with the device file system.
@@ -25,7 +26,8 @@ public:
     enum StreamMode
     {
         READ = 1,
-        WRITE = 2
+        WRITE = 2,
+        BUFFERED = 4            // Buffers the reads and writes of a file, see BufferedStream.
     };
 
     /**
@@ -185,6 +187,44 @@ public:
     static char* readAll(const char* filePath, int* fileSize = NULL);
     static std::string readAllStr(const char* filePath);
 
+    /**
+     * Maps the specified file in memory.
+     *
+     * The pages are read from the file when they are first accessed, instead of copying the
+     * whole file. Where files cannot be mapped, the file is read in memory instead.
+     *
+     * @param filePath The path to the file to be mapped.
+     *
+     * @return The mapped file, or NULL if the file could not be read.
+     *
+     * @script{ignore}
+     */
+    static UPtr<MappedFile> map(const char* filePath);
+
+    /**
+     * Mounts a pack built with PackFile::build().
+     *
+     * The files in the pack are read as if the packed directory was at the mount point, they are
+     * found in the packs mounted last first and then in the file system.
+     *
+     * @param packPath The path to the pack.
+     * @param mountPoint The directory the files of the pack are read from, relative to the resource path.
+     *
+     * @return True if the pack was mounted.
+     *
+     * @script{ignore}
+     */
+    static bool mount(const char* packPath, const char* mountPoint = "");
+
+    /**
+     * Unmounts a pack mounted with mount().
+     *
+     * @param packPath The path the pack was mounted from.
+     *
+     * @script{ignore}
+     */
+    static void unmount(const char* packPath);
+
     /**
      * Determines if the file path is an absolute path for the current platform.
      * 
@@ -0,0 +1,133 @@
+#include "Base.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#elif !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    #define MAPPEDFILE_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace mgp
+{
+
+MappedFile::MappedFile() : _data(NULL), _size(0), _mapped(false), _parent(NULL)
+#ifdef _WIN32
+    , _mapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if (_parent)
+    {
+        SAFE_RELEASE(_parent);
+        return;
+    }
+    if (!_mapped)
+    {
+        SAFE_DELETE_ARRAY(_data);
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(_data);
+    CloseHandle((HANDLE)_mapping);
+#elif defined(MAPPEDFILE_MMAP)
+    munmap(_data, _size);
+#endif
+    _data = NULL;
+}
+
+UPtr<MappedFile> MappedFile::create(const char* fullPath)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(fullPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return UPtr<MappedFile>(NULL);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return UPtr<MappedFile>(NULL);
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return UPtr<MappedFile>(NULL);
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        return UPtr<MappedFile>(NULL);
+    }
+    MappedFile* mappedFile = new MappedFile();
+    mappedFile->_data = (char*)data;
+    mappedFile->_size = (size_t)size.QuadPart;
+    mappedFile->_mapped = true;
+    mappedFile->_mapping = mapping;
+    return UPtr<MappedFile>(mappedFile);
+#elif defined(MAPPEDFILE_MMAP)
+    int fd = open(fullPath, O_RDONLY);
+    if (fd < 0)
+        return UPtr<MappedFile>(NULL);
+    struct stat s;
+    if (fstat(fd, &s) != 0 || s.st_size == 0)
+    {
+        close(fd);
+        return UPtr<MappedFile>(NULL);
+    }
+    // The mapping stays valid after the file is closed.
+    void* data = mmap(NULL, (size_t)s.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return UPtr<MappedFile>(NULL);
+    MappedFile* mappedFile = new MappedFile();
+    mappedFile->_data = (char*)data;
+    mappedFile->_size = (size_t)s.st_size;
+    mappedFile->_mapped = true;
+    return UPtr<MappedFile>(mappedFile);
+#else
+    return UPtr<MappedFile>(NULL);
+#endif
+}
+
+UPtr<MappedFile> MappedFile::create(char* data, size_t size)
+{
+    MappedFile* mappedFile = new MappedFile();
+    mappedFile->_data = data;
+    mappedFile->_size = size;
+    return UPtr<MappedFile>(mappedFile);
+}
+
+UPtr<MappedFile> MappedFile::create(MappedFile* parent, char* data, size_t size)
+{
+    GP_ASSERT(parent);
+    MappedFile* mappedFile = new MappedFile();
+    mappedFile->_data = data;
+    mappedFile->_size = size;
+    mappedFile->_mapped = parent->_mapped;
+    mappedFile->_parent = parent;
+    parent->addRef();
+    return UPtr<MappedFile>(mappedFile);
+}
+
+char* MappedFile::getData() const
+{
+    return _data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return _size;
+}
+
+bool MappedFile::isMapped() const
+{
+    return _mapped;
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include "Base.h"
+#include "Ref.h"
+#include "Ptr.h"
+
+namespace mgp
+{
+
+/**
+ * Defines the contents of a file mapped in memory.
+ *
+ * The pages are mapped copy-on-write, the data can be modified without changing the file.
+ * Where files cannot be mapped, the contents are read in memory instead.
+ *
+ * Use FileSystem::map() to map a file.
+ *
+ * @script{ignore}
+ */
+class MappedFile : public Refable
+{
+    friend class FileSystem;
+    friend class PackFile;
+public:
+
+    /**
+     * Destructor, unmaps the file.
+     */
+    ~MappedFile();
+
+    /**
+     * Gets the contents of the file.
+     */
+    char* getData() const;
+
+    /**
+     * Gets the size of the file in bytes.
+     */
+    size_t getSize() const;
+
+    /**
+     * Returns true if the file is mapped, false if its contents were read in memory.
+     */
+    bool isMapped() const;
+
+private:
+
+    MappedFile();
+
+    MappedFile(const MappedFile& copy);
+
+    MappedFile& operator=(const MappedFile&);
+
+    /**
+     * Maps the file at the given full path, NULL if it cannot be mapped.
+     */
+    static UPtr<MappedFile> create(const char* fullPath);
+
+    /**
+     * Takes the contents of a file read in memory, allocated with new[].
+     */
+    static UPtr<MappedFile> create(char* data, size_t size);
+
+    /**
+     * Creates a view of a part of another mapped file, which is kept while the view is.
+     */
+    static UPtr<MappedFile> create(MappedFile* parent, char* data, size_t size);
+
+    char* _data;
+    size_t _size;
+    bool _mapped;
+    MappedFile* _parent;            // The file this is a view of, NULL if the data is not shared.
+#ifdef _WIN32
+    void* _mapping;                 // Handle of the file mapping.
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,19 @@
+#include "Base.h"
+#include "MappedStream.h"
+#include "MappedFile.h"
+
+namespace mgp
+{
+
+MappedStream::MappedStream(MappedFile* file)
+    : Buffer((uint8_t*)file->getData(), file->getSize(), false), _file(file)
+{
+    _file->addRef();
+}
+
+MappedStream::~MappedStream()
+{
+    SAFE_RELEASE(_file);
+}
+
+}
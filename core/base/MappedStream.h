@@ -0,0 +1,49 @@
+#ifndef MAPPEDSTREAM_H_
+#define MAPPEDSTREAM_H_
+
+#include "Buffer.h"
+
+namespace mgp
+{
+
+class MappedFile;
+
+/**
+ * Defines a read-only stream over a file mapped in memory.
+ *
+ * The reads copy from the mapping, with no system call, and the file is kept mapped while
+ * the stream is open. Data read with readDirect() points into the mapping.
+ *
+ * Use FileSystem::map() to map a file.
+ *
+ * @script{ignore}
+ */
+class MappedStream : public Buffer
+{
+public:
+
+    /**
+     * Creates a stream reading the given mapped file.
+     */
+    MappedStream(MappedFile* file);
+
+    /**
+     * Destructor, releases the mapped file.
+     */
+    ~MappedStream();
+
+    /**
+     * Gets the mapped file.
+     */
+    MappedFile* getFile() const { return _file; }
+
+    bool canWrite() override { return false; }
+
+private:
+
+    MappedFile* _file;
+};
+
+}
+
+#endif
@@ -0,0 +1,509 @@
+#include "Base.h"
+#include "PackFile.h"
+#include "FileSystem.h"
+#include "MappedFile.h"
+#include "Buffer.h"
+#include "MappedStream.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+// "MGPK" read as a little endian integer.
+#define PACK_MAGIC 0x4B50474D
+#define PACK_VERSION 1
+
+// Alignment of the entries in the pack, mapped entries keep the alignment of their data.
+#define PACK_ENTRY_ALIGNMENT 16
+
+// Entries are stored compressed only when the compression saves an eighth of their size.
+#define PACK_MIN_SAVING 8
+
+// Size of the header: magic, version, entry count, names size, table offset.
+#define PACK_HEADER_SIZE 24
+
+// Bits of the hash table of the LZ4 compressor.
+#define LZ4_HASH_BITS 16
+#define LZ4_MIN_MATCH 4
+// The last literals and the last match of a block, as the LZ4 block format requires.
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_LIMIT 12
+
+namespace mgp
+{
+
+static inline uint32_t lz4Read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline bool lz4WriteLength(uint8_t* dst, int& op, int capacity, int len)
+{
+    while (len >= 255)
+    {
+        if (op >= capacity)
+            return false;
+        dst[op++] = 255;
+        len -= 255;
+    }
+    if (op >= capacity)
+        return false;
+    dst[op++] = (uint8_t)len;
+    return true;
+}
+
+static bool lz4WriteSequence(uint8_t* dst, int& op, int capacity, const uint8_t* literals, int literalLength, int offset, int matchLength)
+{
+    if (op + 1 + literalLength > capacity)
+        return false;
+    uint8_t* token = dst + op++;
+    *token = (uint8_t)(std::min(literalLength, 15) << 4);
+    if (literalLength >= 15 && !lz4WriteLength(dst, op, capacity, literalLength - 15))
+        return false;
+    if (op + literalLength > capacity)
+        return false;
+    memcpy(dst + op, literals, literalLength);
+    op += literalLength;
+    if (offset == 0)
+        return true;
+
+    if (op + 2 > capacity)
+        return false;
+    dst[op++] = (uint8_t)(offset & 0xff);
+    dst[op++] = (uint8_t)(offset >> 8);
+    matchLength -= LZ4_MIN_MATCH;
+    *token |= (uint8_t)std::min(matchLength, 15);
+    if (matchLength >= 15 && !lz4WriteLength(dst, op, capacity, matchLength - 15))
+        return false;
+    return true;
+}
+
+/**
+ * Compresses to the LZ4 block format, returns the compressed size or 0 if it exceeds the capacity.
+ */
+static int lz4Compress(const uint8_t* src, int srcSize, uint8_t* dst, int capacity)
+{
+    std::vector<int> table(1 << LZ4_HASH_BITS, -1);
+    int op = 0;
+    int anchor = 0;
+    int ip = 0;
+    while (ip <= srcSize - LZ4_MATCH_LIMIT)
+    {
+        uint32_t sequence = lz4Read32(src + ip);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+        int ref = table[hash];
+        table[hash] = ip;
+        if (ref < 0 || ip - ref > 65535 || lz4Read32(src + ref) != sequence)
+        {
+            ++ip;
+            continue;
+        }
+
+        int matchEnd = ip + LZ4_MIN_MATCH;
+        while (matchEnd < srcSize - LZ4_LAST_LITERALS && src[matchEnd] == src[ref + matchEnd - ip])
+            ++matchEnd;
+        while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+        {
+            --ip;
+            --ref;
+        }
+
+        if (!lz4WriteSequence(dst, op, capacity, src + anchor, ip - anchor, ip - ref, matchEnd - ip))
+            return 0;
+        ip = matchEnd;
+        anchor = ip;
+    }
+    if (!lz4WriteSequence(dst, op, capacity, src + anchor, srcSize - anchor, 0, 0))
+        return 0;
+    return op;
+}
+
+/**
+ * Decompresses the LZ4 block format, returns false if the data is corrupted.
+ */
+static bool lz4Decompress(const uint8_t* src, int srcSize, uint8_t* dst, int dstSize)
+{
+    int ip = 0;
+    int op = 0;
+    while (ip < srcSize)
+    {
+        int token = src[ip++];
+        int literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            int b;
+            do
+            {
+                if (ip >= srcSize)
+                    return false;
+                b = src[ip++];
+                literalLength += b;
+            } while (b == 255);
+        }
+        if (ip + literalLength > srcSize || op + literalLength > dstSize)
+            return false;
+        memcpy(dst + op, src + ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == srcSize)
+            break;
+
+        if (ip + 2 > srcSize)
+            return false;
+        int offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return false;
+        int matchLength = token & 15;
+        if (matchLength == 15)
+        {
+            int b;
+            do
+            {
+                if (ip >= srcSize)
+                    return false;
+                b = src[ip++];
+                matchLength += b;
+            } while (b == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (op + matchLength > dstSize)
+            return false;
+        if (offset >= matchLength)
+        {
+            memcpy(dst + op, dst + op - offset, matchLength);
+        }
+        else
+        {
+            // Overlapping match, repeats the last bytes.
+            for (int i = 0; i < matchLength; ++i)
+                dst[op + i] = dst[op - offset + i];
+        }
+        op += matchLength;
+    }
+    return op == dstSize;
+}
+
+std::string PackFile::normalizePath(const char* path)
+{
+    std::string result;
+    result.reserve(strlen(path));
+    for (const char* c = path; *c; ++c)
+    {
+        char ch = *c == '\\' ? '/' : *c;
+        if (ch == '/' && !result.empty() && result.back() == '/')
+            continue;
+        result.push_back(ch);
+        if (result.size() == 2 && result[0] == '.' && result[1] == '/')
+            result.clear();
+    }
+    return result;
+}
+
+/**
+ * Lists the files of a directory and its subdirectories, with paths relative to the directory.
+ */
+static void listFilesRecursive(const std::string& root, const std::string& dir, std::vector<std::string>& files)
+{
+    std::string path = dir.empty() ? root : root + "/" + dir;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((path + "/*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        std::string name = data.cFileName;
+        if (name == "." || name == "..")
+            continue;
+        std::string child = dir.empty() ? name : dir + "/" + name;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            listFilesRecursive(root, child, files);
+        else
+            files.push_back(child);
+    } while (FindNextFileA(find, &data) != 0);
+    FindClose(find);
+#else
+    DIR* d = opendir(path.c_str());
+    if (d == NULL)
+        return;
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL)
+    {
+        std::string name = e->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string child = dir.empty() ? name : dir + "/" + name;
+        struct stat s;
+        if (stat((root + "/" + child).c_str(), &s) != 0)
+            continue;
+        if (S_ISDIR(s.st_mode))
+            listFilesRecursive(root, child, files);
+        else
+            files.push_back(child);
+    }
+    closedir(d);
+#endif
+}
+
+PackFile::PackFile() : _file(NULL)
+{
+}
+
+PackFile::~PackFile()
+{
+    SAFE_RELEASE(_file);
+}
+
+uint64_t PackFile::hashPath(const char* path, size_t len)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= (uint8_t)path[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+UPtr<PackFile> PackFile::open(const char* path)
+{
+    UPtr<MappedFile> file = FileSystem::map(path);
+    if (file.isNull())
+        return UPtr<PackFile>(NULL);
+
+    Buffer header((uint8_t*)file->getData(), file->getSize(), false);
+    if (file->getSize() < PACK_HEADER_SIZE || header.readUInt32() != PACK_MAGIC)
+    {
+        GP_WARN("Not a pack file: %s", path);
+        return UPtr<PackFile>(NULL);
+    }
+    uint32_t version = header.readUInt32();
+    if (version != PACK_VERSION)
+    {
+        GP_WARN("Unsupported pack version %u: %s", version, path);
+        return UPtr<PackFile>(NULL);
+    }
+    uint32_t entryCount = header.readUInt32();
+    uint32_t namesSize = header.readUInt32();
+    uint64_t tocOffset = header.readUInt64();
+    if (tocOffset + (uint64_t)entryCount * 32 + namesSize > file->getSize())
+    {
+        GP_WARN("Truncated pack file: %s", path);
+        return UPtr<PackFile>(NULL);
+    }
+
+    PackFile* pack = new PackFile();
+    pack->_entries.resize(entryCount);
+    header.seek((long int)tocOffset);
+    for (uint32_t i = 0; i < entryCount; ++i)
+    {
+        Entry& entry = pack->_entries[i];
+        entry.hash = header.readUInt64();
+        entry.offset = header.readUInt64();
+        entry.size = header.readUInt32();
+        entry.storedSize = header.readUInt32();
+        entry.nameOffset = header.readUInt32();
+        entry.nameLength = header.readUInt32();
+        if (entry.offset + entry.storedSize > tocOffset || (uint64_t)entry.nameOffset + entry.nameLength > namesSize)
+        {
+            GP_WARN("Corrupted pack file: %s", path);
+            SAFE_RELEASE(pack);
+            return UPtr<PackFile>(NULL);
+        }
+    }
+    pack->_names.assign(file->getData() + header.position(), namesSize);
+    pack->_file = file.take();
+    return UPtr<PackFile>(pack);
+}
+
+const PackFile::Entry* PackFile::findEntry(const char* path) const
+{
+    std::string name = normalizePath(path);
+    uint64_t hash = hashPath(name.c_str(), name.size());
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), hash, [](const Entry& entry, uint64_t hash) {
+        return entry.hash < hash;
+    });
+    for (; it != _entries.end() && it->hash == hash; ++it)
+    {
+        if (it->nameLength == name.size() && _names.compare(it->nameOffset, it->nameLength, name) == 0)
+            return &(*it);
+    }
+    return NULL;
+}
+
+unsigned int PackFile::getEntryCount() const
+{
+    return (unsigned int)_entries.size();
+}
+
+std::string PackFile::getEntryPath(unsigned int index) const
+{
+    GP_ASSERT(index < _entries.size());
+    const Entry& entry = _entries[index];
+    return _names.substr(entry.nameOffset, entry.nameLength);
+}
+
+bool PackFile::contains(const char* path) const
+{
+    return findEntry(path) != NULL;
+}
+
+bool PackFile::readEntry(const Entry* entry, char* data)
+{
+    const uint8_t* src = (const uint8_t*)_file->getData() + entry->offset;
+    if (entry->storedSize == entry->size)
+    {
+        memcpy(data, src, entry->size);
+        return true;
+    }
+    if (!lz4Decompress(src, entry->storedSize, (uint8_t*)data, entry->size))
+    {
+        GP_WARN("Corrupted pack entry: %s", _names.substr(entry->nameOffset, entry->nameLength).c_str());
+        return false;
+    }
+    return true;
+}
+
+UPtr<Stream> PackFile::openEntry(const char* path)
+{
+    const Entry* entry = findEntry(path);
+    if (entry == NULL)
+        return UPtr<Stream>(NULL);
+    if (entry->storedSize == entry->size)
+    {
+        // read in place, the view keeps the pack mapped while the stream is open
+        UPtr<MappedFile> view = MappedFile::create(_file, _file->getData() + entry->offset, entry->size);
+        return UPtr<Stream>(new MappedStream(view.get()));
+    }
+
+    char* data = (char*)malloc(entry->size);
+    if (!readEntry(entry, data))
+    {
+        free(data);
+        return UPtr<Stream>(NULL);
+    }
+    return UPtr<Stream>(new Buffer((uint8_t*)data, entry->size, true));
+}
+
+UPtr<MappedFile> PackFile::mapEntry(const char* path)
+{
+    const Entry* entry = findEntry(path);
+    if (entry == NULL)
+        return UPtr<MappedFile>(NULL);
+    if (entry->storedSize == entry->size)
+        return MappedFile::create(_file, _file->getData() + entry->offset, entry->size);
+
+    // NULL-terminated like FileSystem::readAll.
+    char* data = new char[entry->size + 1];
+    data[entry->size] = '\0';
+    if (!readEntry(entry, data))
+    {
+        SAFE_DELETE_ARRAY(data);
+        return UPtr<MappedFile>(NULL);
+    }
+    return MappedFile::create(data, entry->size);
+}
+
+bool PackFile::build(const char* dirPath, const char* packPath, bool compress)
+{
+    GP_ASSERT(dirPath);
+    GP_ASSERT(packPath);
+
+    std::string root = normalizePath(dirPath);
+    std::vector<std::string> files;
+    std::string fullRoot = FileSystem::isAbsolutePath(dirPath) ? root : std::string(FileSystem::getResourcePath()) + root;
+    listFilesRecursive(fullRoot, "", files);
+    std::sort(files.begin(), files.end());
+
+    UPtr<Stream> out = FileSystem::open(packPath, FileSystem::WRITE);
+    if (out.isNull())
+    {
+        GP_WARN("Failed to write pack file: %s", packPath);
+        return false;
+    }
+
+    // Header, written again with the table offset at the end.
+    out->writeUInt32(PACK_MAGIC);
+    out->writeUInt32(PACK_VERSION);
+    out->writeUInt32(0);
+    out->writeUInt32(0);
+    out->writeUInt64(0);
+
+    static const char zeros[PACK_ENTRY_ALIGNMENT] = { 0 };
+    std::vector<Entry> entries;
+    std::string names;
+    std::vector<uint8_t> compressed;
+    for (const std::string& file : files)
+    {
+        int size = 0;
+        char* data = FileSystem::readAll((root + "/" + file).c_str(), &size);
+        if (data == NULL)
+            continue;
+
+        long int padding = (PACK_ENTRY_ALIGNMENT - out->position() % PACK_ENTRY_ALIGNMENT) % PACK_ENTRY_ALIGNMENT;
+        out->write(zeros, padding);
+
+        Entry entry;
+        entry.hash = hashPath(file.c_str(), file.size());
+        entry.offset = out->position();
+        entry.size = size;
+        entry.storedSize = size;
+        entry.nameOffset = (uint32_t)names.size();
+        entry.nameLength = (uint32_t)file.size();
+        names += file;
+
+        int compressedSize = 0;
+        if (compress && size > 0)
+        {
+            int capacity = size - size / PACK_MIN_SAVING;
+            compressed.resize(capacity);
+            compressedSize = lz4Compress((const uint8_t*)data, size, compressed.data(), capacity);
+        }
+        if (compressedSize > 0)
+        {
+            entry.storedSize = compressedSize;
+            out->write((const char*)compressed.data(), compressedSize);
+        }
+        else
+        {
+            out->write(data, size);
+        }
+        SAFE_DELETE_ARRAY(data);
+        entries.push_back(entry);
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.hash < b.hash;
+    });
+    uint64_t tocOffset = out->position();
+    for (const Entry& entry : entries)
+    {
+        out->writeUInt64(entry.hash);
+        out->writeUInt64(entry.offset);
+        out->writeUInt32(entry.size);
+        out->writeUInt32(entry.storedSize);
+        out->writeUInt32(entry.nameOffset);
+        out->writeUInt32(entry.nameLength);
+    }
+    out->write(names.c_str(), names.size());
+
+    out->seek(0);
+    out->writeUInt32(PACK_MAGIC);
+    out->writeUInt32(PACK_VERSION);
+    out->writeUInt32((uint32_t)entries.size());
+    out->writeUInt32((uint32_t)names.size());
+    out->writeUInt64(tocOffset);
+    out->close();
+    return true;
+}
+
+}
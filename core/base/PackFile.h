@@ -0,0 +1,120 @@
+#ifndef PACKFILE_H_
+#define PACKFILE_H_
+
+#include "Base.h"
+#include "Ref.h"
+#include "Ptr.h"
+#include "Stream.h"
+
+namespace mgp
+{
+
+class MappedFile;
+
+/**
+ * Defines a read-only archive packing the files of a directory in one file.
+ *
+ * The pack is mapped in memory, and its table of contents is sorted by the hash of the
+ * entry paths, so an entry is found without a system call. The entries are aligned for
+ * mapping, and each one is compressed with LZ4 when it saves space. Entries stored
+ * uncompressed are read in place, compressed ones are decompressed in memory.
+ *
+ * Mount a pack with FileSystem::mount(), the files in it are then opened from the pack.
+ *
+ * @script{ignore}
+ */
+class PackFile : public Refable
+{
+public:
+
+    /**
+     * Destructor.
+     */
+    ~PackFile();
+
+    /**
+     * Opens a pack.
+     *
+     * @param path The path to the pack.
+     *
+     * @return The pack, or NULL if the file is not a pack.
+     */
+    static UPtr<PackFile> open(const char* path);
+
+    /**
+     * Packs the files of a directory and its subdirectories.
+     *
+     * @param dirPath The directory to pack, the entry paths are relative to it.
+     * @param packPath The path of the pack to write.
+     * @param compress True to compress the entries that get smaller.
+     *
+     * @return True if the pack was written.
+     */
+    static bool build(const char* dirPath, const char* packPath, bool compress = true);
+
+    /**
+     * Normalizes the separators of a path, the paths in a pack are relative with '/' separators.
+     */
+    static std::string normalizePath(const char* path);
+
+    /**
+     * Gets the number of entries.
+     */
+    unsigned int getEntryCount() const;
+
+    /**
+     * Gets the path of the entry at the given index.
+     */
+    std::string getEntryPath(unsigned int index) const;
+
+    /**
+     * Returns true if the pack has an entry with the given path.
+     */
+    bool contains(const char* path) const;
+
+    /**
+     * Opens a stream reading an entry.
+     *
+     * @return The stream, or NULL if the pack has no entry with the given path.
+     */
+    UPtr<Stream> openEntry(const char* path);
+
+    /**
+     * Maps an entry, in place if it is stored uncompressed.
+     *
+     * @return The entry data, or NULL if the pack has no entry with the given path.
+     */
+    UPtr<MappedFile> mapEntry(const char* path);
+
+private:
+
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t offset;
+        uint32_t size;
+        uint32_t storedSize;            // Size in the pack, smaller than size if compressed.
+        uint32_t nameOffset;
+        uint32_t nameLength;
+    };
+
+    PackFile();
+
+    PackFile(const PackFile& copy);
+
+    PackFile& operator=(const PackFile&);
+
+    static uint64_t hashPath(const char* path, size_t len);
+
+    const Entry* findEntry(const char* path) const;
+
+    bool readEntry(const Entry* entry, char* data);
+
+    MappedFile* _file;
+    std::vector<Entry> _entries;        // Sorted by hash.
+    std::string _names;
+};
+
+}
+
+#endif
@@ -18,8 +18,11 @@ Serializer::Serializer(Type type, Stream* stream, uint32_t versionMajor, uint32_
 
 Serializer::~Serializer()
 {
-    _stream->close();
-    SAFE_DELETE(_stream);
+    if (_stream)
+    {
+        _stream->close();
+        SAFE_DELETE(_stream);
+    }
 }
 
 UPtr<Serializer> Serializer::createReader(const std::string& path, bool isHiml)
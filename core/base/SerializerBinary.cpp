@@ -9,27 +9,49 @@
 #include "math/Vector4.h"
 #include "math/Matrix.h"
 
+extern "C" {
+#include "3rd/base64.h"
+}
+
+// Version of the record layout, after the engine version in the header.
+#define BINARY_FORMAT_VERSION 8
+
+// Size of the header: magic number, engine version, layout version.
+#define BINARY_HEADER_SIZE 12
+
+// Name of the records of lists, and of the root object.
+#define BINARY_NO_NAME 0xFFFFFFFF
+
+// Alignment of the records and of the data of arrays in the file.
+#define BINARY_ALIGNMENT 16
+
+// Size of the window of the file kept in memory, larger reads go straight to the stream.
+#define BINARY_BUFFER_SIZE (64 * 1024)
+#define BINARY_DIRECT_READ_SIZE (16 * 1024)
 
 namespace mgp
 {
 
-unsigned char SerializerBinary::BIT_NULL = 0x00;
-unsigned char SerializerBinary::BIT_VALUE = 0x01;
-unsigned char SerializerBinary::BIT_XREF = 0x02;
-unsigned char SerializerBinary::BIT_DEFAULT = 0x04;
+static size_t alignOffset(size_t offset)
+{
+    return (offset + BINARY_ALIGNMENT - 1) & ~(size_t)(BINARY_ALIGNMENT - 1);
+}
 
 SerializerBinary::SerializerBinary(Type type,
                                    Stream* stream,
                                    uint32_t versionMajor,
-                                   uint32_t versionMinor) : 
-    Serializer(type, stream, versionMajor, versionMinor)
+                                   uint32_t versionMinor) :
+    Serializer(type, stream, versionMajor, versionMinor),
+    _finished(false), _buffer(nullptr), _bufferOffset(0), _bufferSize(0),
+    _length(0), _rootOffset(0), _failed(false)
 {
 }
-    
+
 SerializerBinary::~SerializerBinary()
 {
+    SAFE_DELETE_ARRAY(_buffer);
 }
-    
+
 UPtr<Serializer> SerializerBinary::create(Stream* stream)
 {
     // Read the binary file header info.
@@ -38,14 +60,53 @@ UPtr<Serializer> SerializerBinary::create(Stream* stream)
     if (stream->read(header, sizeof(char), 9) != 9 || memcmp(header, magicNumber, 9) != 0)
         return UPtr<Serializer>();
 
-    // Read the file version.
-    unsigned char version[2];
-    if (stream->read(version, sizeof(unsigned char), 2) != 2)
+    // Read the file version and the version of the layout.
+    unsigned char version[3];
+    if (stream->read(version, sizeof(unsigned char), 3) != 3)
     {
         GP_WARN("Failed to read version from binary file");
         return UPtr<Serializer>();
     }
-    Serializer* serializer = new SerializerBinary(Type::eReader, stream, version[0], version[1]);
+    if (version[2] != BINARY_FORMAT_VERSION)
+    {
+        GP_WARN("Unsupported binary file layout: %d", (int)version[2]);
+        return UPtr<Serializer>();
+    }
+    if (!stream->canSeek())
+    {
+        GP_WARN("Binary files are read from seekable streams");
+        return UPtr<Serializer>();
+    }
+
+    SerializerBinary* serializer = new SerializerBinary(Type::eReader, stream, version[0], version[1]);
+    serializer->_buffer = new char[BINARY_BUFFER_SIZE];
+    serializer->_length = (long)stream->length();
+
+    // Read the string table.
+    long offset = BINARY_HEADER_SIZE;
+    uint32_t stringCount = serializer->readValue<uint32_t>(offset);
+    offset += 4;
+    serializer->_strings.resize(stringCount);
+    for (uint32_t i = 0; i < stringCount && !serializer->_failed; ++i)
+    {
+        uint32_t length = serializer->readValue<uint32_t>(offset);
+        offset += 4;
+        std::string& str = serializer->_strings[i];
+        str.resize(length);
+        if (length)
+            serializer->readData(offset, &str[0], length);
+        offset += length;
+        serializer->_stringIds[str] = i;
+    }
+    serializer->_rootOffset = (long)alignOffset(offset);
+
+    if (serializer->_failed)
+    {
+        // the stream stays with the caller
+        serializer->_stream = nullptr;
+        delete serializer;
+        return UPtr<Serializer>();
+    }
     return UPtr<Serializer>(serializer);
 }
 
@@ -55,541 +116,759 @@ UPtr<Serializer> SerializerBinary::createWriter(const std::string& path)
     if (stream == nullptr)
         return UPtr<Serializer>();
 
-    const char magicNumber[9] = GP_ENGINE_MAGIC_NUMBER;
-    const unsigned char version[2] = { GP_ENGINE_VERSION_MAJOR, GP_ENGINE_VERSION_MINOR};
-    // Write out the file identifier and version
-    if (stream->write(magicNumber, sizeof(char), 9) != 9)
-        GP_WARN("Unable to write binary file identifier.");
-    if (stream->write(version, sizeof(unsigned char), 2) != 2)
-        GP_WARN("Unable to write binary file version.");
-
-    Serializer* serializer = new SerializerBinary(Type::eWriter, stream, version[0], version[1]);
-
+    Serializer* serializer = new SerializerBinary(Type::eWriter, stream, GP_ENGINE_VERSION_MAJOR, GP_ENGINE_VERSION_MINOR);
     return UPtr<Serializer>(serializer);
 }
-    
+
 void SerializerBinary::close()
 {
     if (_stream)
+    {
+        flush();
         _stream->close();
+    }
 }
 
-void SerializerBinary::flush() {
+void SerializerBinary::flush()
+{
+    if (_type != Type::eWriter || _finished || !_stream)
+        return;
+    _finished = true;
+    if (_blocks.size())
+        GP_WARN("Binary file closed with %d collections not finished", (int)_blocks.size());
+
+    // Write out the file identifier and version
+    const char magicNumber[9] = GP_ENGINE_MAGIC_NUMBER;
+    const unsigned char version[3] = { GP_ENGINE_VERSION_MAJOR, GP_ENGINE_VERSION_MINOR, BINARY_FORMAT_VERSION };
+    if (_stream->write(magicNumber, sizeof(char), 9) != 9)
+        GP_WARN("Unable to write binary file identifier.");
+    if (_stream->write(version, sizeof(unsigned char), 3) != 3)
+        GP_WARN("Unable to write binary file version.");
+
+    // The string table, then the records aligned like the arrays in them.
+    std::vector<char> table;
+    uint32_t stringCount = (uint32_t)_strings.size();
+    table.insert(table.end(), (char*)&stringCount, (char*)&stringCount + 4);
+    for (const std::string& str : _strings)
+    {
+        uint32_t length = (uint32_t)str.size();
+        table.insert(table.end(), (char*)&length, (char*)&length + 4);
+        table.insert(table.end(), str.begin(), str.end());
+    }
+    table.resize(alignOffset(BINARY_HEADER_SIZE + table.size()) - BINARY_HEADER_SIZE, 0);
+    _stream->write(table.data(), sizeof(char), table.size());
+
+    if (_stream->write(_data.data(), sizeof(char), _data.size()) != _data.size())
+        GP_WARN("Unable to write binary file records.");
+    _stream->flush();
 
+    std::vector<char>().swap(_data);
+    _strings.clear();
+    _stringIds.clear();
 }
-    
+
 Serializer::Format SerializerBinary::getFormat() const
 {
     return Format::eBinary;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// writing
+
+uint32_t SerializerBinary::intern(const char* str)
+{
+    auto itr = _stringIds.find(str);
+    if (itr != _stringIds.end())
+        return itr->second;
+    uint32_t id = (uint32_t)_strings.size();
+    _strings.push_back(str);
+    _stringIds[_strings.back()] = id;
+    return id;
+}
+
+void SerializerBinary::writeData(const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    _data.insert(_data.end(), p, p + size);
+}
+
+void SerializerBinary::writeRecord(const char* propertyName, uint8_t type)
+{
+    GP_ASSERT(_type == Type::eWriter);
+
+    if (_blocks.size())
+        ++_blocks.back().count;
+
+    // the items of lists have no name
+    uint32_t name = propertyName ? intern(propertyName) : BINARY_NO_NAME;
+    writeData(&name, 4);
+    writeData(&type, 1);
+}
+
+void SerializerBinary::beginBlock(bool hasCount)
+{
+    Block block;
+    block.count = 0;
+    block.countOffset = 0;
+    if (hasCount)
+    {
+        block.countOffset = _data.size();
+        writeData(&block.count, 4);
+    }
+    block.lengthOffset = _data.size();
+    uint64_t length = 0;
+    writeData(&length, 8);
+    _blocks.push_back(block);
+}
+
+void SerializerBinary::endBlock()
+{
+    GP_ASSERT(_blocks.size());
+    Block block = _blocks.back();
+    _blocks.pop_back();
+
+    // the count is the one of the items written, null objects are not
+    uint64_t length = _data.size() - block.lengthOffset - 8;
+    memcpy(&_data[block.lengthOffset], &length, 8);
+    if (block.countOffset)
+        memcpy(&_data[block.countOffset], &block.count, 4);
+}
+
 void SerializerBinary::writeEnum(const char* propertyName, const char* enumName, int value, int defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(enumName);
-    
+
     writeInt(propertyName, value, defaultValue);
 }
-    
+
 void SerializerBinary::writeBool(const char* propertyName, bool value, bool defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    _stream->write(&value, sizeof(bool), 1);
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_BOOL);
+    uint8_t b = value ? 1 : 0;
+    writeData(&b, 1);
 }
 
 void SerializerBinary::writeInt(const char* propertyName, int value, int defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        _stream->write(&value, sizeof(int), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_INT);
+    int32_t v = value;
+    writeData(&v, 4);
 }
 
 void SerializerBinary::writeFloat(const char* propertyName, float value, float defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        _stream->write(&value, sizeof(float), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_FLOAT);
+    writeData(&value, 4);
 }
 
 void SerializerBinary::writeVector(const char* propertyName, const Vector2& value, const Vector2& defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        _stream->write(&value.x, sizeof(float), 1);
-        _stream->write(&value.y, sizeof(float), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_VECTOR2);
+    double v[2] = { value.x, value.y };
+    writeData(v, sizeof(v));
 }
 
 void SerializerBinary::writeVector(const char* propertyName, const Vector3& value, const Vector3& defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        _stream->write(&value.x, sizeof(float), 1);
-        _stream->write(&value.y, sizeof(float), 1);
-        _stream->write(&value.z, sizeof(float), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_VECTOR3);
+    double v[3] = { value.x, value.y, value.z };
+    writeData(v, sizeof(v));
 }
 
 void SerializerBinary::writeVector(const char* propertyName, const Vector4& value, const Vector4& defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        _stream->write(&value.x, sizeof(float), 1);
-        _stream->write(&value.y, sizeof(float), 1);
-        _stream->write(&value.z, sizeof(float), 1);
-        _stream->write(&value.w, sizeof(float), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_VECTOR4);
+    double v[4] = { value.x, value.y, value.z, value.w };
+    writeData(v, sizeof(v));
 }
 
 void SerializerBinary::writeColor(const char* propertyName, const Vector3& value, const Vector3& defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        uint32_t color = value.toColor();
-        _stream->write(&color, sizeof(uint32_t), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_COLOR);
+    uint32_t color = value.toColor();
+    writeData(&color, 4);
 }
 
 void SerializerBinary::writeColor(const char* propertyName, const Vector4& value, const Vector4& defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        uint32_t color = value.toColor();
-        _stream->write(&color, sizeof(uint32_t), 1);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_COLOR);
+    uint32_t color = value.toColor();
+    writeData(&color, 4);
 }
 
 void SerializerBinary::writeMatrix(const char* propertyName, const Matrix& value, const Matrix& defaultValue)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    if (value == defaultValue)
-    {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        _stream->write(value.m, sizeof(float), 16);
-    }
+    if (propertyName && value == defaultValue)
+        return;
+
+    writeRecord(propertyName, RECORD_MATRIX);
+    double m[16];
+    for (int i = 0; i < 16; ++i)
+        m[i] = value.m[i];
+    writeData(m, sizeof(m));
 }
 
 void SerializerBinary::writeString(const char* propertyName, const char* value, const char* defaultValue)
 {
-    //GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-
     if ((value == defaultValue) || (value && defaultValue && strcmp(value, defaultValue) == 0))
     {
-        _stream->write(&BIT_DEFAULT, sizeof(unsigned char), 1);
-    }
-    else
-    {
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
-        writeLengthPrefixedString(value);
+        if (propertyName)
+            return;
     }
+
+    writeRecord(propertyName, RECORD_STRING);
+    uint32_t id = intern(value ? value : "");
+    writeData(&id, 4);
 }
 
 void SerializerBinary::writeMap(const char* propertyName, std::vector<std::string> &keys)
 {
     GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
 
-    _stream->write(&keys, sizeof(size_t), 1);
-    for (int i=0; i<keys.size(); ++i) {
-        writeLengthPrefixedString(keys[i].c_str());
-    }
+    // the values are written after with the keys as names
+    writeRecord(propertyName, RECORD_MAP);
+    beginBlock(true);
 }
-    
+
 void SerializerBinary::writeObject(const char* propertyName, Serializable* value)
 {
-    GP_ASSERT(_type == Type::eWriter);
-    
     if (value == nullptr)
-    {
-        _stream->write(&BIT_NULL, sizeof(unsigned char), 1);
         return;
-    }
-    
-    bool writeValue = true;
-    if (value && dynamic_cast<Refable*>(value)->getRefCount() > 1)
+
+    uint64_t xrefAddress = 0;
+    Refable* refable = dynamic_cast<Refable*>(value);
+    if (refable && refable->getRefCount() > 1)
     {
-        _stream->write(&BIT_XREF, sizeof(unsigned char), 1);
-        unsigned long xrefAddress = reinterpret_cast<unsigned long>(value);
-        _stream->write(&xrefAddress, sizeof(unsigned long), 1);
-        
+        xrefAddress = reinterpret_cast<unsigned long>(value);
+
         // Check if already serialized from xref table
-        std::map<unsigned long, Serializable*>::const_iterator itr = _xrefs.find(xrefAddress);
-        if (itr == _xrefs.end())
+        if (_xrefs.find((unsigned long)xrefAddress) != _xrefs.end())
         {
-            writeValue = true;
-            _xrefs[xrefAddress] = value;
-        }
-        else
-        {
-            writeValue = false;
+            writeRecord(propertyName, RECORD_XREF);
+            writeData(&xrefAddress, 8);
+            return;
         }
+        _xrefs[(unsigned long)xrefAddress] = value;
     }
-    else
+
+    // Write out the objects class and its properties in a block
+    writeRecord(propertyName, RECORD_OBJECT);
+    uint32_t classId = intern(value->getClassName().c_str());
+    writeData(&classId, 4);
+    writeData(&xrefAddress, 8);
+    beginBlock(false);
+    value->onSerialize(this);
+    endBlock();
+}
+
+void SerializerBinary::writeList(const char* propertyName, size_t count)
+{
+    GP_ASSERT(propertyName);
+
+    writeRecord(propertyName, RECORD_LIST);
+    beginBlock(true);
+}
+
+void SerializerBinary::finishColloction()
+{
+    if (_type == Type::eWriter)
+        endBlock();
+    else if (_scopes.size())
+        _scopes.pop_back();
+}
+
+void SerializerBinary::writeArray(const char* propertyName, uint8_t type, const void* data, size_t size, size_t count)
+{
+    GP_ASSERT(propertyName);
+    if (!data || count == 0)
+        return;
+
+    // the data is aligned in the file, the records start aligned
+    writeRecord(propertyName, type);
+    uint64_t n = count;
+    writeData(&n, 8);
+    _data.resize(alignOffset(_data.size()), 0);
+    writeData(data, size * count);
+}
+
+void SerializerBinary::writeIntArray(const char* propertyName, const int* data, size_t count)
+{
+    writeArray(propertyName, RECORD_INT_ARRAY, data, sizeof(int), count);
+}
+
+void SerializerBinary::writeFloatArray(const char* propertyName, const float* data, size_t count)
+{
+    writeArray(propertyName, RECORD_FLOAT_ARRAY, data, sizeof(float), count);
+}
+
+void SerializerBinary::writeDFloatArray(const char* propertyName, const double* data, size_t count)
+{
+    writeArray(propertyName, RECORD_DOUBLE_ARRAY, data, sizeof(double), count);
+}
+
+void SerializerBinary::writeByteArray(const char* propertyName, const unsigned char* data, size_t count)
+{
+    writeArray(propertyName, RECORD_BYTE_ARRAY, data, sizeof(unsigned char), count);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// records
+
+void SerializerBinary::fail(const char* message)
+{
+    if (!_failed)
+        GP_WARN("Invalid binary file: %s", message);
+    _failed = true;
+}
+
+bool SerializerBinary::readData(long offset, void* data, size_t size)
+{
+    if (_failed || offset < 0 || offset + (long)size > _length)
+    {
+        fail("unexpected end of file");
+        memset(data, 0, size);
+        return false;
+    }
+
+    // large data goes from the stream to its destination
+    if (size >= BINARY_DIRECT_READ_SIZE)
     {
-        // Write out this is a object value
-        _stream->write(&BIT_VALUE, sizeof(unsigned char), 1);
+        _stream->seek(offset, SEEK_SET);
+        if (_stream->read(data, 1, size) != size)
+        {
+            fail("read error");
+            return false;
+        }
+        return true;
     }
-    
-    if (writeValue)
+
+    if (offset < _bufferOffset || offset + (long)size > _bufferOffset + (long)_bufferSize)
     {
-        // Write out the objects class
-        writeLengthPrefixedString(value->getClassName().c_str());
-        
-        // Serialize the object properties
-        value->onSerialize(this);
+        _stream->seek(offset, SEEK_SET);
+        _bufferOffset = offset;
+        _bufferSize = _stream->read(_buffer, 1, BINARY_BUFFER_SIZE);
+        if (_bufferSize < size)
+        {
+            fail("read error");
+            return false;
+        }
     }
+    memcpy(data, _buffer + (offset - _bufferOffset), size);
+    return true;
 }
 
-void SerializerBinary::writeList(const char* propertyName, size_t count)
+template<typename T> T SerializerBinary::readValue(long offset)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    _stream->write(&count, sizeof(size_t), 1);
+    T value;
+    readData(offset, &value, sizeof(T));
+    return value;
 }
 
-void SerializerBinary::finishColloction() {
+bool SerializerBinary::readRecord(long offset, Record& record)
+{
+    record.name = readValue<uint32_t>(offset);
+    record.type = readValue<uint8_t>(offset + 4);
+    record.offset = offset + 5;
+    return !_failed;
+}
 
+size_t SerializerBinary::getItemSize(uint8_t type)
+{
+    switch (type)
+    {
+    case RECORD_BOOL: return 1;
+    case RECORD_INT: return 4;
+    case RECORD_FLOAT: return 4;
+    case RECORD_DOUBLE: return 8;
+    case RECORD_VECTOR2: return 2 * 8;
+    case RECORD_VECTOR3: return 3 * 8;
+    case RECORD_VECTOR4: return 4 * 8;
+    case RECORD_COLOR: return 4;
+    case RECORD_MATRIX: return 16 * 8;
+    case RECORD_STRING: return 4;
+    case RECORD_XREF: return 8;
+    default: return 0;
+    }
 }
 
-void SerializerBinary::writeIntArray(const char* propertyName, const int* data, size_t count)
+long SerializerBinary::skipRecord(const Record& record)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    _stream->write(&count, sizeof(size_t), 1);
-    if (count > 0 && data )
+    switch (record.type)
+    {
+    case RECORD_NULL:
+        return record.offset;
+    case RECORD_OBJECT:
+        return record.offset + 20 + (long)readValue<uint64_t>(record.offset + 12);
+    case RECORD_LIST:
+    case RECORD_MAP:
+        return record.offset + 12 + (long)readValue<uint64_t>(record.offset + 4);
+    case RECORD_INT_ARRAY:
+    case RECORD_FLOAT_ARRAY:
+    case RECORD_DOUBLE_ARRAY:
+    case RECORD_BYTE_ARRAY:
+    {
+        static const size_t sizes[] = { 4, 4, 8, 1 };
+        uint64_t count = readValue<uint64_t>(record.offset);
+        return (long)alignOffset(record.offset + 8) + (long)(count * sizes[record.type - RECORD_INT_ARRAY]);
+    }
+    default:
     {
-        _stream->write(data, sizeof(int), count);
+        size_t size = getItemSize(record.type);
+        if (size == 0)
+            fail("unknown record type");
+        return record.offset + (long)size;
+    }
     }
 }
 
-void SerializerBinary::writeFloatArray(const char* propertyName, const float* data, size_t count)
+void SerializerBinary::beginScope(Scope& scope, long offset, long length)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    _stream->write(&count, sizeof(size_t), 1);
-    if (count > 0 && data )
+    // only the names and offsets are read, the values are skipped over
+    long end = offset + length;
+    if (end > _length)
+    {
+        fail("record out of the file");
+        return;
+    }
+    while (offset < end && !_failed)
     {
-        _stream->write(data, sizeof(float), count);
+        Record record;
+        readRecord(offset, record);
+        offset = skipRecord(record);
+        scope.records.push_back(record);
     }
 }
 
-void SerializerBinary::writeDFloatArray(const char* propertyName, const double* data, size_t count)
+bool SerializerBinary::seekElement(const char* propertyName, Record& record)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
+    if (_scopes.empty() || _failed)
+        return false;
+
+    Scope& scope = _scopes.back();
+    if (scope.isList)
+    {
+        if (scope.count == 0)
+            return false;
+        --scope.count;
+        if (scope.itemType != RECORD_NULL)
+        {
+            // an item of a numeric array
+            record.name = BINARY_NO_NAME;
+            record.type = scope.itemType;
+            record.offset = scope.next;
+            scope.next += (long)getItemSize(scope.itemType);
+            return true;
+        }
+        readRecord(scope.next, record);
+        scope.next = skipRecord(record);
+        return !_failed;
+    }
 
-    _stream->write(&count, sizeof(size_t), 1);
-    if (count > 0 && data)
+    if (!propertyName)
+        return false;
+    auto itr = _stringIds.find(propertyName);
+    if (itr == _stringIds.end())
+        return false;
+    for (const Record& r : scope.records)
     {
-        _stream->write(data, sizeof(double), count);
+        if (r.name == itr->second)
+        {
+            record = r;
+            return true;
+        }
     }
+    return false;
 }
 
-void SerializerBinary::writeByteArray(const char* propertyName, const unsigned char* data, size_t count)
+size_t SerializerBinary::readNumbers(const Record& record, double* values, size_t count)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eWriter);
-    
-    _stream->write(&count, sizeof(size_t), 1);
-    if (count > 0 && data )
+    // reads the numbers of a record of any numeric shape, returns how many it has
+    size_t size = 0;
+    switch (record.type)
+    {
+    case RECORD_BOOL:
+        if (count) values[0] = readValue<uint8_t>(record.offset);
+        return 1;
+    case RECORD_INT:
+        if (count) values[0] = readValue<int32_t>(record.offset);
+        return 1;
+    case RECORD_FLOAT:
+        if (count) values[0] = readValue<float>(record.offset);
+        return 1;
+    case RECORD_DOUBLE:
+    case RECORD_VECTOR2:
+    case RECORD_VECTOR3:
+    case RECORD_VECTOR4:
+    case RECORD_MATRIX:
+        size = getItemSize(record.type) / 8;
+        if (count)
+            readData(record.offset, values, std::min(size, count) * 8);
+        return size;
+    case RECORD_INT_ARRAY:
+    case RECORD_FLOAT_ARRAY:
+    case RECORD_DOUBLE_ARRAY:
+    case RECORD_BYTE_ARRAY:
+    {
+        size = (size_t)readValue<uint64_t>(record.offset);
+        long data = (long)alignOffset(record.offset + 8);
+        for (size_t i = 0; i < size && i < count; ++i)
+        {
+            switch (record.type)
+            {
+            case RECORD_INT_ARRAY: values[i] = readValue<int32_t>(data + (long)i * 4); break;
+            case RECORD_FLOAT_ARRAY: values[i] = readValue<float>(data + (long)i * 4); break;
+            case RECORD_DOUBLE_ARRAY: values[i] = readValue<double>(data + (long)i * 8); break;
+            default: values[i] = readValue<uint8_t>(data + (long)i); break;
+            }
+        }
+        return size;
+    }
+    case RECORD_LIST:
     {
-        _stream->write(data, sizeof(unsigned char), count);
+        size = readValue<uint32_t>(record.offset);
+        long offset = record.offset + 12;
+        for (size_t i = 0; i < size && i < count; ++i)
+        {
+            Record item;
+            readRecord(offset, item);
+            offset = skipRecord(item);
+            if (readNumbers(item, values + i, 1) != 1)
+                values[i] = 0;
+        }
+        return size;
+    }
+    default:
+        return 0;
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+// reading
+
 int SerializerBinary::readEnum(const char* propertyName, const char* enumName, int defaultValue)
 {
     GP_ASSERT(enumName);
-    
-    return readInt(propertyName, defaultValue);
+    GP_ASSERT(_type == Type::eReader);
+
+    Record record;
+    if (!seekElement(propertyName, record))
+        return defaultValue;
+
+    // enums converted from json are strings
+    if (record.type == RECORD_STRING)
+    {
+        uint32_t id = readValue<uint32_t>(record.offset);
+        if (id >= _strings.size() || _strings[id].empty())
+            return defaultValue;
+        return SerializerManager::getActivator()->enumParse(enumName, _strings[id]);
+    }
+    double value;
+    if (readNumbers(record, &value, 1) != 1)
+        return defaultValue;
+    return (int)value;
 }
 
 bool SerializerBinary::readBool(const char* propertyName, bool defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    bool value;
-    _stream->read(&value, sizeof(bool), 1);
-    return value;
+
+    Record record;
+    double value;
+    if (!seekElement(propertyName, record) || readNumbers(record, &value, 1) != 1)
+        return defaultValue;
+    return value != 0;
 }
 
 int SerializerBinary::readInt(const char* propertyName, int defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    if (!seekElement(propertyName, record))
         return defaultValue;
-    }
-    else
-    {
-        int value;
-        _stream->read(&value, sizeof(int), 1);
-        return value;
-    }
+    if (record.type == RECORD_INT)
+        return readValue<int32_t>(record.offset);
+
+    double value;
+    if (readNumbers(record, &value, 1) != 1)
+        return defaultValue;
+    return (int)value;
 }
 
 float SerializerBinary::readFloat(const char* propertyName, float defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    if (!seekElement(propertyName, record))
         return defaultValue;
-    }
-    else
-    {
-        float value;
-        _stream->read(&value, sizeof(float), 1);
-        return value;
-    }
+    if (record.type == RECORD_FLOAT)
+        return readValue<float>(record.offset);
+
+    double value;
+    if (readNumbers(record, &value, 1) != 1)
+        return defaultValue;
+    return (float)value;
 }
-    
+
 Vector2 SerializerBinary::readVector(const char* propertyName, const Vector2& defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    double v[2];
+    if (!seekElement(propertyName, record) || readNumbers(record, v, 2) < 2)
         return defaultValue;
-    }
-    else
-    {
-        Vector2 value;
-        _stream->read(&value.x, sizeof(float), 1);
-        _stream->read(&value.y, sizeof(float), 1);
-        return value;
-    }
+    return Vector2(v[0], v[1]);
 }
 
 Vector3 SerializerBinary::readVector(const char* propertyName, const Vector3& defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    double v[3];
+    if (!seekElement(propertyName, record) || readNumbers(record, v, 3) < 3)
         return defaultValue;
-    }
-    else
-    {
-        Vector3 value;
-        _stream->read(&value.x, sizeof(float), 1);
-        _stream->read(&value.y, sizeof(float), 1);
-        _stream->read(&value.z, sizeof(float), 1);
-        return value;
-    }
+    return Vector3(v[0], v[1], v[2]);
 }
 
 Vector4 SerializerBinary::readVector(const char* propertyName, const Vector4& defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    double v[4];
+    if (!seekElement(propertyName, record) || readNumbers(record, v, 4) < 4)
         return defaultValue;
-    }
-    else
-    {
-        Vector4 value;
-        _stream->read(&value.x, sizeof(float), 1);
-        _stream->read(&value.y, sizeof(float), 1);
-        _stream->read(&value.z, sizeof(float), 1);
-        _stream->read(&value.w, sizeof(float), 1);
-        return value;
-    }
+    return Vector4(v[0], v[1], v[2], v[3]);
 }
 
 Vector3 SerializerBinary::readColor(const char* propertyName, const Vector3& defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    if (!seekElement(propertyName, record))
         return defaultValue;
-    }
-    else
+    if (record.type == RECORD_COLOR)
+        return Vector3::fromColor(readValue<uint32_t>(record.offset));
+    if (record.type == RECORD_STRING)
     {
-        uint32_t color;
-        _stream->read(&color, sizeof(uint32_t), 1);
-        return Vector3::fromColor(color);
+        uint32_t id = readValue<uint32_t>(record.offset);
+        if (id < _strings.size())
+            return Vector3::fromColorString(_strings[id].c_str());
     }
+    return defaultValue;
 }
-    
+
 Vector4 SerializerBinary::readColor(const char* propertyName, const Vector4& defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    if (!seekElement(propertyName, record))
         return defaultValue;
-    }
-    else
+    if (record.type == RECORD_COLOR)
+        return Vector4::fromColor(readValue<uint32_t>(record.offset));
+    if (record.type == RECORD_STRING)
     {
-        uint32_t color;
-        _stream->read(&color, sizeof(uint32_t), 1);
-        return Vector4::fromColor(color);
+        uint32_t id = readValue<uint32_t>(record.offset);
+        if (id < _strings.size())
+            return Vector4::fromColorString(_strings[id].c_str());
     }
+    return defaultValue;
 }
 
 Matrix SerializerBinary::readMatrix(const char* propertyName, const Matrix& defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
-    {
+
+    Record record;
+    double m[16];
+    if (!seekElement(propertyName, record) || readNumbers(record, m, 16) < 16)
         return defaultValue;
-    }
-    else
-    {
-        Matrix value;
-        _stream->read(value.m, sizeof(float), 16);
-        return value;
-    }
+    Matrix value;
+    for (int i = 0; i < 16; ++i)
+        value.m[i] = m[i];
+    return value;
 }
 
-void SerializerBinary::readString(const char* propertyName, std::string& value,  const char* defaultValue)
+void SerializerBinary::readString(const char* propertyName, std::string& value, const char* defaultValue)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
 
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    if (bit == BIT_DEFAULT)
+    Record record;
+    if (seekElement(propertyName, record) && record.type == RECORD_STRING)
     {
-        std::strcpy(&value[0], defaultValue);
-    }
-    else
-    {
-        readLengthPrefixedString(value);
+        uint32_t id = readValue<uint32_t>(record.offset);
+        if (id < _strings.size())
+        {
+            value = _strings[id];
+            return;
+        }
+        fail("string out of the table");
     }
+    value = defaultValue ? defaultValue : "";
 }
 
 void SerializerBinary::readMap(const char* propertyName, std::vector<std::string> &keys)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
 
-    size_t count;
-    _stream->read(&count, sizeof(size_t), 1);
-
-    for (int i=0; i<count; ++i) {
-        std::string str;
-        readLengthPrefixedString(str);
-        keys.push_back(str);
+    Scope scope;
+    Record record;
+    if (seekElement(propertyName, record) && record.type == RECORD_MAP)
+    {
+        beginScope(scope, record.offset + 12, (long)readValue<uint64_t>(record.offset + 4));
+        for (const Record& r : scope.records)
+        {
+            if (r.name < _strings.size())
+                keys.push_back(_strings[r.name]);
+        }
     }
-
+    _scopes.push_back(std::move(scope));
 }
 
 UPtr<Serializable> SerializerBinary::readObject(const char* propertyName)
 {
     GP_ASSERT(_type == Type::eReader);
-    
-    unsigned char bit;
-    _stream->read(&bit, sizeof(unsigned char), 1);
-    
-    unsigned long xrefAddress = 0L;
-    if (bit == BIT_NULL)
+
+    Record record;
+    if (!seekElement(propertyName, record))
     {
-        return UPtr<Serializable>();
+        //read root
+        if (propertyName || _scopes.size() || !readRecord(_rootOffset, record))
+            return UPtr<Serializable>();
     }
-    else if (bit == BIT_XREF)
+
+    if (record.type == RECORD_XREF)
     {
-        _stream->read(&xrefAddress, sizeof(unsigned long), 1);
+        unsigned long xrefAddress = (unsigned long)readValue<uint64_t>(record.offset);
         std::map<unsigned long, Serializable*>::const_iterator itr = _xrefs.find(xrefAddress);
         if (itr != _xrefs.end())
         {
@@ -598,163 +877,158 @@ UPtr<Serializable> SerializerBinary::readObject(const char* propertyName)
             if (refable) refable->addRef();
             return UPtr<Serializable>(ref);
         }
+        GP_WARN("Unresolved xref:%lu for propertyName:%s", xrefAddress, propertyName);
+        return UPtr<Serializable>();
     }
-    
+    if (record.type != RECORD_OBJECT)
+        return UPtr<Serializable>();
+
     // The class name for the object being read
-    std::string className;
-    readLengthPrefixedString(className);
+    uint32_t classId = readValue<uint32_t>(record.offset);
+    unsigned long xrefAddress = (unsigned long)readValue<uint64_t>(record.offset + 4);
+    if (classId >= _strings.size())
+    {
+        fail("class out of the table");
+        return UPtr<Serializable>();
+    }
+    const std::string& className = _strings[classId];
 
     Serializable* value = (SerializerManager::getActivator()->createObject(className));
     if (value == nullptr)
     {
-        GP_ERROR("Failed to deserialize binary class: %s for propertyName:%s", className.c_str(), propertyName);
+        GP_WARN("Failed to deserialize binary object:%s for propertyName:%s", className.c_str(), propertyName);
         return UPtr<Serializable>();
     }
-    
+
     // Deserialize the properties
+    Scope scope;
+    beginScope(scope, record.offset + 20, (long)readValue<uint64_t>(record.offset + 12));
+    _scopes.push_back(std::move(scope));
     value->onDeserialize(this);
-    
+    _scopes.pop_back();
+
     if (xrefAddress != 0)
     {
         _xrefs[xrefAddress] = value;
     }
-    
+
     return UPtr<Serializable>(value);
 }
 
 size_t SerializerBinary::readList(const char* propertyName)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    size_t count;
-    _stream->read(&count, sizeof(size_t), 1);
-    return count;
-}
 
-size_t SerializerBinary::readIntArray(const char* propertyName, int** data)
-{
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eReader);
-
-    size_t count = 0;
-    _stream->read(&count, sizeof(size_t), 1);
-    int* buffer = nullptr;
-    if (count > 0)
+    Scope scope;
+    scope.isList = true;
+    Record record;
+    if (seekElement(propertyName, record))
     {
-        if (*data == nullptr)
+        if (record.type == RECORD_LIST)
         {
-            buffer = new int[count];
+            scope.count = readValue<uint32_t>(record.offset);
+            scope.next = record.offset + 12;
         }
-        else
+        else if (record.type >= RECORD_INT_ARRAY && record.type <= RECORD_DOUBLE_ARRAY)
         {
-            buffer = *data;
+            // a list of numbers converted from json
+            static const uint8_t itemTypes[] = { RECORD_INT, RECORD_FLOAT, RECORD_DOUBLE };
+            scope.itemType = itemTypes[record.type - RECORD_INT_ARRAY];
+            scope.count = (size_t)readValue<uint64_t>(record.offset);
+            scope.next = (long)alignOffset(record.offset + 8);
         }
-        _stream->read(buffer, sizeof(int), count);
     }
-    *data = buffer;
-    
-    return count;
+    _scopes.push_back(std::move(scope));
+    return _scopes.back().count;
 }
 
-size_t SerializerBinary::readFloatArray(const char* propertyName, float** data)
+template<typename T> size_t SerializerBinary::readArray(const Record& record, T** data, uint8_t type)
 {
-    GP_ASSERT(propertyName);
-    GP_ASSERT(_type == Type::eReader);
-    
-    size_t count = 0;
-    _stream->read(&count, sizeof(size_t), 1);
-    float* buffer = nullptr;
-    if (count > 0)
+    if (record.type == type)
     {
-        if (*data == nullptr)
-        {
-            buffer = new float[count];
-        }
-        else
+        // the data is read at once in the buffer
+        size_t count = (size_t)readValue<uint64_t>(record.offset);
+        long offset = (long)alignOffset(record.offset + 8);
+        if (offset + (long)(count * sizeof(T)) > _length)
         {
-            buffer = *data;
+            fail("array out of the file");
+            return 0;
         }
-        _stream->read(buffer, sizeof(float), count);
+        T* buffer = *data;
+        if (buffer == nullptr && count > 0)
+            buffer = new T[count];
+        if (count > 0)
+            readData(offset, buffer, count * sizeof(T));
+        *data = buffer;
+        return count;
     }
+
+    // other numeric arrays and lists are converted
+    size_t count = readNumbers(record, nullptr, 0);
+    if (count == 0)
+        return 0;
+    std::vector<double> values(count);
+    readNumbers(record, values.data(), count);
+    T* buffer = *data;
+    if (buffer == nullptr)
+        buffer = new T[count];
+    for (size_t i = 0; i < count; ++i)
+        buffer[i] = (T)values[i];
     *data = buffer;
-    
     return count;
 }
 
-size_t SerializerBinary::readDFloatArray(const char* propertyName, double** data)
+size_t SerializerBinary::readIntArray(const char* propertyName, int** data)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
 
-    size_t count = 0;
-    _stream->read(&count, sizeof(size_t), 1);
-    double* buffer = nullptr;
-    if (count > 0)
-    {
-        if (*data == nullptr)
-        {
-            buffer = new double[count];
-        }
-        else
-        {
-            buffer = *data;
-        }
-        _stream->read(buffer, sizeof(double), count);
-    }
-    *data = buffer;
-
-    return count;
+    Record record;
+    if (!seekElement(propertyName, record))
+        return 0;
+    return readArray<int>(record, data, RECORD_INT_ARRAY);
 }
 
-size_t SerializerBinary::readByteArray(const char* propertyName, unsigned char** data)
+size_t SerializerBinary::readFloatArray(const char* propertyName, float** data)
 {
-    GP_ASSERT(propertyName);
     GP_ASSERT(_type == Type::eReader);
-    
-    size_t count = 0;
-    _stream->read(&count, sizeof(size_t), 1);
-    unsigned char* buffer = nullptr;
-    if (count > 0)
-    {
-        if (*data == nullptr)
-        {
-            buffer = new unsigned char[count];
-        }
-        else
-        {
-            buffer = *data;
-        }
-        _stream->read(buffer, sizeof(unsigned char), count);
-    }
-    *data = buffer;
-    
-    return count;
+
+    Record record;
+    if (!seekElement(propertyName, record))
+        return 0;
+    return readArray<float>(record, data, RECORD_FLOAT_ARRAY);
 }
 
-void SerializerBinary::writeLengthPrefixedString(const char* str)
+size_t SerializerBinary::readDFloatArray(const char* propertyName, double** data)
 {
-    size_t length = strlen(str);
-    _stream->write(&length, sizeof(size_t), 1);
-    if (length > 0)
-    {
-        _stream->write(str, sizeof(char), length);
-    }
+    GP_ASSERT(_type == Type::eReader);
+
+    Record record;
+    if (!seekElement(propertyName, record))
+        return 0;
+    return readArray<double>(record, data, RECORD_DOUBLE_ARRAY);
 }
-    
-void SerializerBinary::readLengthPrefixedString(std::string& str)
+
+size_t SerializerBinary::readByteArray(const char* propertyName, unsigned char** data)
 {
-    size_t length;
-    _stream->read(&length, sizeof(size_t), 1);
-    if (length > 0)
-    {
-        str.resize(length);
-        _stream->read(&str[0], sizeof(char), length);
-    }
-    else
+    GP_ASSERT(_type == Type::eReader);
+
+    Record record;
+    if (!seekElement(propertyName, record))
+        return 0;
+    if (record.type == RECORD_STRING)
     {
-        str.clear();
+        // base64 strings converted from json
+        uint32_t id = readValue<uint32_t>(record.offset);
+        if (id >= _strings.size())
+            return 0;
+        const std::string& str = _strings[id];
+        unsigned char* out = *data;
+        if (out == nullptr)
+            out = new unsigned char[BASE64_DECODE_OUT_SIZE(str.size() + 3)];
+        *data = out;
+        return base64_decode(str.c_str(), (unsigned int)str.size(), out);
     }
+    return readArray<unsigned char>(record, data, RECORD_BYTE_ARRAY);
 }
 
 }
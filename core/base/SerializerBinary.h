@@ -2,12 +2,28 @@
 
 #include "Serializer.h"
 
+#include <vector>
+
 namespace mgp
 {
 
 /**
  * Defines a binary serializer.
  *
+ * The file starts with the engine magic number and version, the version of the layout and a
+ * table of the property names, class names and strings, each stored once. Then every value is
+ * a record of its interned property name, a type tag and its data:
+ *
+ * - Objects, lists and maps are prefixed with the byte length of their records, so the
+ *   records of an object are indexed by name when it is read and the values it does not read,
+ *   including whole child objects, are skipped without being parsed.
+ * - The data of int, float, double and byte arrays is aligned to 16 bytes in the file and is
+ *   read with a single read into the destination buffer.
+ *
+ * Values are in the byte order of the host, as the engine targets little endian platforms.
+ * Readers accept the json shapes of the values as well, a vector stored as a float array or
+ * an enum stored as a string, so files converted from json scenes read the same.
+ *
  * @see Serializer
  */
 class SerializerBinary : public Serializer
@@ -219,17 +235,105 @@ protected:
     
     SerializerBinary(Type type, Stream* stream, uint32_t versionMajor, uint32_t versionMinor);
     
-    void writeLengthPrefixedString(const char* str);
-    void readLengthPrefixedString(std::string& str);
-    
 private:
-    
-    static unsigned char BIT_NULL;
-    static unsigned char BIT_VALUE;
-    static unsigned char BIT_XREF;
-    static unsigned char BIT_DEFAULT;
 
-    std::map< unsigned long, Serializable*> _xrefs;
+    /**
+     * The type tags of the records.
+     */
+    enum RecordType
+    {
+        RECORD_NULL = 0,
+        RECORD_BOOL,
+        RECORD_INT,
+        RECORD_FLOAT,
+        RECORD_DOUBLE,
+        RECORD_VECTOR2,
+        RECORD_VECTOR3,
+        RECORD_VECTOR4,
+        RECORD_COLOR,
+        RECORD_MATRIX,
+        RECORD_STRING,
+        RECORD_OBJECT,
+        RECORD_XREF,
+        RECORD_LIST,
+        RECORD_MAP,
+        RECORD_INT_ARRAY,
+        RECORD_FLOAT_ARRAY,
+        RECORD_DOUBLE_ARRAY,
+        RECORD_BYTE_ARRAY
+    };
+
+    /**
+     * A record read from the file, the offset is the one of its data.
+     */
+    struct Record
+    {
+        uint32_t name;
+        uint8_t type;
+        long offset;
+    };
+
+    /**
+     * An object, map or list being read.
+     */
+    struct Scope
+    {
+        bool isList = false;
+        std::vector<Record> records;
+        // the offset of the next item of a list, and the items left
+        long next = 0;
+        size_t count = 0;
+        // the type of the items of a list read from a numeric array, RECORD_NULL for a list of records
+        uint8_t itemType = RECORD_NULL;
+    };
+
+    /**
+     * An object, map or list being written, with the offsets of its length and item count.
+     */
+    struct Block
+    {
+        size_t lengthOffset;
+        size_t countOffset;
+        uint32_t count;
+    };
+
+    // writing
+    uint32_t intern(const char* str);
+    void writeRecord(const char* propertyName, uint8_t type);
+    void writeData(const void* data, size_t size);
+    void beginBlock(bool hasCount);
+    void endBlock();
+    void writeArray(const char* propertyName, uint8_t type, const void* data, size_t size, size_t count);
+
+    // reading
+    bool readData(long offset, void* data, size_t size);
+    template<typename T> T readValue(long offset);
+    bool readRecord(long offset, Record& record);
+    long skipRecord(const Record& record);
+    static size_t getItemSize(uint8_t type);
+    void beginScope(Scope& scope, long offset, long length);
+    bool seekElement(const char* propertyName, Record& record);
+    size_t readNumbers(const Record& record, double* values, size_t count);
+    template<typename T> size_t readArray(const Record& record, T** data, uint8_t type);
+    void fail(const char* message);
+
+    std::map<unsigned long, Serializable*> _xrefs;
+
+    // the string table and the records, written on flush
+    std::vector<std::string> _strings;
+    std::unordered_map<std::string, uint32_t> _stringIds;
+    std::vector<char> _data;
+    std::vector<Block> _blocks;
+    bool _finished;
+
+    // a window of the file for the small records
+    char* _buffer;
+    long _bufferOffset;
+    size_t _bufferSize;
+    long _length;
+    long _rootOffset;
+    bool _failed;
+    std::vector<Scope> _scopes;
 };
 
 }
@@ -1,5 +1,6 @@
 #include "Base.h"
 #include "SerializerJson.h"
+#include "SerializerJsonStream.h"
 #include "SerializerManager.h"
 #include "Serializer.h"
 #include "FileSystem.h"
@@ -20,6 +21,9 @@ extern "C" {
 
 using namespace jc;
 
+// Json files from this size are read by SerializerJsonStream, without building a document.
+#define JSON_STREAM_READ_SIZE (8 * 1024 * 1024)
+
 namespace mgp
 {
 
@@ -52,6 +56,9 @@ SerializerJson::~SerializerJson()
 
 UPtr<Serializer> SerializerJson::create(Stream* stream, bool isHiml)
 {
+    if (!isHiml && stream->canSeek() && stream->length() >= JSON_STREAM_READ_SIZE)
+        return SerializerJsonStream::create(stream);
+
     jc::JsonAllocator allocator;
 
     size_t length = stream->length();
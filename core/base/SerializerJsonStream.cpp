@@ -0,0 +1,949 @@
+#include "Base.h"
+#include "SerializerJsonStream.h"
+#include "SerializerManager.h"
+#include "Stream.h"
+#include "math/Vector2.h"
+#include "math/Vector3.h"
+#include "math/Vector4.h"
+#include "math/Matrix.h"
+
+extern "C" {
+#include "3rd/base64.h"
+}
+
+// Size of the window of the stream kept in memory.
+#define JSON_STREAM_BUFFER_SIZE (64 * 1024)
+
+// Size of the base64 text decoded at once, a multiple of 4.
+#define JSON_BASE64_CHUNK_SIZE 4096
+
+// Longest number text parsed.
+#define JSON_NUMBER_SIZE 64
+
+namespace mgp
+{
+
+SerializerJsonStream::SerializerJsonStream(Stream* stream, uint32_t versionMajor, uint32_t versionMinor) :
+    SerializerJson(Type::eReader, stream, versionMajor, versionMinor, nullptr),
+    _buffer(new char[JSON_STREAM_BUFFER_SIZE]), _bufferOffset(0), _bufferSize(0),
+    _position(0), _length((long)stream->length()), _items(-1), _failed(false)
+{
+}
+
+SerializerJsonStream::~SerializerJsonStream()
+{
+    SAFE_DELETE_ARRAY(_buffer);
+}
+
+UPtr<Serializer> SerializerJsonStream::create(Stream* stream)
+{
+    SerializerJsonStream* serializer = new SerializerJsonStream(stream, GP_ENGINE_VERSION_MAJOR, GP_ENGINE_VERSION_MINOR);
+    serializer->_position = stream->position();
+
+    Scope root;
+    serializer->skipSpace();
+    if (serializer->peek() == '{')
+        serializer->beginObject(root);
+
+    bool hasVersion = false;
+    std::string version;
+    for (const Property& property : root.properties)
+    {
+        if (property.name == "version")
+        {
+            serializer->seek(property.offset);
+            serializer->skipSpace();
+            if (serializer->peek() == '"')
+            {
+                serializer->parseString(version);
+                hasVersion = true;
+            }
+            break;
+        }
+    }
+
+    if (!hasVersion || serializer->_failed)
+    {
+        // the stream stays with the caller
+        serializer->_stream = nullptr;
+        delete serializer;
+        return UPtr<Serializer>();
+    }
+
+    if (version.length() > 0)
+    {
+        std::string major = version.substr(0, 1);
+        serializer->_version[0] = std::stoi(major);
+    }
+    if (version.length() > 2)
+    {
+        std::string minor = version.substr(2, 1);
+        serializer->_version[1] = std::stoi(minor);
+    }
+    serializer->_scopes.push_back(std::move(root));
+    return UPtr<Serializer>(serializer);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// tokens
+
+int SerializerJsonStream::fill()
+{
+    if (_position >= _length)
+        return -1;
+    _stream->seek(_position, SEEK_SET);
+    _bufferOffset = _position;
+    _bufferSize = _stream->read(_buffer, sizeof(char), JSON_STREAM_BUFFER_SIZE);
+    if (_bufferSize == 0)
+        return -1;
+    return (unsigned char)_buffer[0];
+}
+
+inline int SerializerJsonStream::peek()
+{
+    size_t index = (size_t)(_position - _bufferOffset);
+    if (_position >= _bufferOffset && index < _bufferSize)
+        return (unsigned char)_buffer[index];
+    return fill();
+}
+
+int SerializerJsonStream::get()
+{
+    int c = peek();
+    if (c != -1)
+        ++_position;
+    return c;
+}
+
+void SerializerJsonStream::seek(long offset)
+{
+    _position = offset;
+}
+
+long SerializerJsonStream::tell() const
+{
+    return _position;
+}
+
+void SerializerJsonStream::fail(const char* message)
+{
+    if (!_failed)
+        GP_WARN("Invalid json at offset %ld: %s", _position, message);
+    _failed = true;
+    // everything after reads as the end of the stream
+    _position = _length;
+}
+
+void SerializerJsonStream::skipSpace()
+{
+    for (;;)
+    {
+        int c = peek();
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+            break;
+        ++_position;
+    }
+}
+
+void SerializerJsonStream::expect(char c)
+{
+    skipSpace();
+    if (get() != c)
+    {
+        char message[] = "expected ' '";
+        message[10] = c;
+        fail(message);
+    }
+}
+
+void SerializerJsonStream::skipString()
+{
+    // after the opening quote
+    for (;;)
+    {
+        int c = get();
+        if (c == '"')
+            return;
+        if (c == '\\')
+            c = get();
+        if (c == -1)
+        {
+            fail("unterminated string");
+            return;
+        }
+    }
+}
+
+void SerializerJsonStream::skipValue(long* items)
+{
+    skipSpace();
+    int c = peek();
+    if (items)
+        *items = c == '[' ? 0 : -1;
+    if (c != '"' && c != '{' && c != '[')
+    {
+        // numbers, true, false and null
+        long start = _position;
+        while (c != -1 && c != ',' && c != '}' && c != ']' && c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        {
+            ++_position;
+            c = peek();
+        }
+        if (_position == start)
+            fail("expected a value");
+        return;
+    }
+
+    // strings, objects and arrays are scanned in the window, the state is kept across refills
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    long commas = 0;
+    bool hasItems = false;
+    while (peek() != -1)
+    {
+        const char* begin = _buffer + (_position - _bufferOffset);
+        const char* end = _buffer + _bufferSize;
+        for (const char* p = begin; p < end; ++p)
+        {
+            char ch = *p;
+            if (inString)
+            {
+                if (escaped)
+                    escaped = false;
+                else if (ch == '\\')
+                    escaped = true;
+                else if (ch == '"')
+                {
+                    inString = false;
+                    if (depth == 0)
+                    {
+                        _position += (long)(p - begin) + 1;
+                        return;
+                    }
+                }
+                continue;
+            }
+
+            switch (ch)
+            {
+            case '"':
+                inString = true;
+                hasItems = true;
+                break;
+            case '{':
+            case '[':
+                if (depth > 0)
+                    hasItems = true;
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0)
+                {
+                    _position += (long)(p - begin) + 1;
+                    if (items && *items == 0)
+                        *items = hasItems ? commas + 1 : 0;
+                    return;
+                }
+                break;
+            case ',':
+                if (depth == 1)
+                    ++commas;
+                break;
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+            default:
+                hasItems = true;
+                break;
+            }
+        }
+        _position += (long)(end - begin);
+    }
+    fail("unterminated value");
+}
+
+bool SerializerJsonStream::isNumber()
+{
+    skipSpace();
+    int c = peek();
+    return c == '-' || (c >= '0' && c <= '9');
+}
+
+double SerializerJsonStream::parseNumber(bool* isInteger)
+{
+    skipSpace();
+    char text[JSON_NUMBER_SIZE];
+    int length = 0;
+    bool integer = true;
+    for (;;)
+    {
+        int c = peek();
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+')
+        {
+        }
+        else if (c == '.' || c == 'e' || c == 'E')
+        {
+            integer = false;
+        }
+        else
+        {
+            break;
+        }
+        if (length == JSON_NUMBER_SIZE - 1)
+        {
+            fail("number too long");
+            return 0;
+        }
+        text[length++] = (char)c;
+        ++_position;
+    }
+    text[length] = '\0';
+    if (isInteger)
+        *isInteger = integer;
+
+    char* end = NULL;
+    double value = strtod(text, &end);
+    if (length == 0 || end != text + length)
+    {
+        fail("expected a number");
+        return 0;
+    }
+    return value;
+}
+
+static void appendUtf8(std::string& value, unsigned int codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        value.push_back((char)codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        value.push_back((char)(0xC0 | (codepoint >> 6)));
+        value.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+    else if (codepoint < 0x10000)
+    {
+        value.push_back((char)(0xE0 | (codepoint >> 12)));
+        value.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        value.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+    else
+    {
+        value.push_back((char)(0xF0 | (codepoint >> 18)));
+        value.push_back((char)(0x80 | ((codepoint >> 12) & 0x3F)));
+        value.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        value.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+unsigned int SerializerJsonStream::parseHex4()
+{
+    unsigned int value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        int c = get();
+        unsigned int digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+        {
+            fail("invalid unicode escape");
+            return 0;
+        }
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+void SerializerJsonStream::parseString(std::string& value)
+{
+    value.clear();
+    expect('"');
+    while (!_failed)
+    {
+        int c = get();
+        if (c == '"')
+            break;
+        if (c == -1)
+        {
+            fail("unterminated string");
+            break;
+        }
+        if (c != '\\')
+        {
+            value.push_back((char)c);
+            continue;
+        }
+
+        c = get();
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            value.push_back((char)c);
+            break;
+        case 'b': value.push_back('\b'); break;
+        case 'f': value.push_back('\f'); break;
+        case 'n': value.push_back('\n'); break;
+        case 'r': value.push_back('\r'); break;
+        case 't': value.push_back('\t'); break;
+        case 'u':
+        {
+            unsigned int codepoint = parseHex4();
+            // the low surrogate follows as another escape
+            if (codepoint >= 0xD800 && codepoint < 0xDC00 && peek() == '\\')
+            {
+                long position = _position;
+                get();
+                unsigned int low = get() == 'u' ? parseHex4() : 0;
+                if (low >= 0xDC00 && low < 0xE000)
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                else
+                    _position = position;
+            }
+            appendUtf8(value, codepoint);
+            break;
+        }
+        default:
+            fail("invalid escape");
+            return;
+        }
+    }
+}
+
+bool SerializerJsonStream::parseBool()
+{
+    skipSpace();
+    char text[6];
+    int length = 0;
+    for (int c = peek(); c >= 'a' && c <= 'z' && length < 5; c = peek())
+    {
+        text[length++] = (char)c;
+        ++_position;
+    }
+    text[length] = '\0';
+    if (strcmp(text, "true") == 0)
+        return true;
+    if (strcmp(text, "false") != 0)
+        fail("expected a bool");
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// structure
+
+void SerializerJsonStream::beginObject(Scope& scope)
+{
+    skipSpace();
+    scope.isArray = false;
+    scope.offset = _position;
+    expect('{');
+    skipSpace();
+    if (peek() == '}')
+    {
+        get();
+        endItem(scope.offset);
+        return;
+    }
+    while (!_failed)
+    {
+        Property property;
+        parseString(property.name);
+        expect(':');
+        skipSpace();
+        property.offset = _position;
+        skipValue(&property.items);
+        scope.properties.push_back(std::move(property));
+
+        skipSpace();
+        int c = get();
+        if (c == '}')
+            break;
+        if (c != ',')
+            fail("expected ',' or '}'");
+    }
+    endItem(scope.offset);
+}
+
+size_t SerializerJsonStream::countItems()
+{
+    // the items of the properties were counted when their object was read
+    if (_items >= 0)
+        return (size_t)_items;
+
+    // at the opening bracket, which is restored
+    long start = _position;
+    long items = 0;
+    skipValue(&items);
+    if (!_failed)
+        _position = start;
+    return items > 0 ? (size_t)items : 0;
+}
+
+void SerializerJsonStream::endItem(long offset)
+{
+    if (_scopes.empty())
+        return;
+    Scope& scope = _scopes.back();
+    if (scope.isArray && scope.next < 0 && scope.item == offset)
+        scope.next = _position;
+}
+
+bool SerializerJsonStream::seekElement(const char* propertyName)
+{
+    _items = -1;
+    if (_scopes.empty())
+        return false;
+
+    Scope& scope = _scopes.back();
+    if (scope.isArray)
+    {
+        if (scope.count == 0)
+            return false;
+        // the end of the last item is found here if it was not read to its end
+        if (scope.next < 0)
+        {
+            seek(scope.item);
+            skipValue();
+            scope.next = _position;
+        }
+        seek(scope.next);
+        skipSpace();
+        if (peek() == ',')
+        {
+            get();
+            skipSpace();
+        }
+        scope.item = _position;
+        scope.next = -1;
+        --scope.count;
+        return true;
+    }
+
+    if (!propertyName)
+        return false;
+    for (const Property& property : scope.properties)
+    {
+        if (property.name == propertyName)
+        {
+            seek(property.offset);
+            _items = property.items;
+            return true;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// reading
+
+int SerializerJsonStream::readEnum(const char* propertyName, const char* enumName, int defaultValue)
+{
+    GP_ASSERT(enumName);
+
+    std::string str;
+    readString(propertyName, str, "");
+    if (str.size() == 0) {
+        return defaultValue;
+    }
+
+    return SerializerManager::getActivator()->enumParse(enumName, str.c_str());
+}
+
+bool SerializerJsonStream::readBool(const char* propertyName, bool defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (seekElement(propertyName))
+    {
+        skipSpace();
+        if (peek() != 't' && peek() != 'f')
+            GP_ERROR("Invalid json bool for propertyName:%s", propertyName);
+        return parseBool();
+    }
+    return defaultValue;
+}
+
+int SerializerJsonStream::readInt(const char* propertyName, int defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (seekElement(propertyName))
+    {
+        bool isInteger = false;
+        double value = isNumber() ? parseNumber(&isInteger) : 0;
+        if (!isInteger)
+            GP_ERROR("Invalid json int for propertyName:%s", propertyName);
+        return (int)value;
+    }
+    return defaultValue;
+}
+
+float SerializerJsonStream::readFloat(const char* propertyName, float defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (seekElement(propertyName))
+    {
+        if (!isNumber())
+            GP_ERROR("Invalid json float for propertyName:%s", propertyName);
+        return (float)parseNumber();
+    }
+    return defaultValue;
+}
+
+bool SerializerJsonStream::readFloats(const char* propertyName, float* values, int count)
+{
+    if (!seekElement(propertyName))
+        return false;
+
+    skipSpace();
+    if (get() != '[')
+        GP_ERROR("Invalid json array for propertyName:%s", propertyName);
+    for (int i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            skipSpace();
+            if (get() != ',')
+                GP_ERROR("Invalid json array of %d numbers for propertyName:%s", count, propertyName);
+        }
+        if (!isNumber())
+            GP_ERROR("Invalid json array of %d numbers for propertyName:%s", count, propertyName);
+        values[i] = (float)parseNumber();
+    }
+    return true;
+}
+
+Vector2 SerializerJsonStream::readVector(const char* propertyName, const Vector2& defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    float values[2];
+    if (readFloats(propertyName, values, 2))
+        return Vector2(values[0], values[1]);
+    return defaultValue;
+}
+
+Vector3 SerializerJsonStream::readVector(const char* propertyName, const Vector3& defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    float values[3];
+    if (readFloats(propertyName, values, 3))
+        return Vector3(values[0], values[1], values[2]);
+    return defaultValue;
+}
+
+Vector4 SerializerJsonStream::readVector(const char* propertyName, const Vector4& defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    float values[4];
+    if (readFloats(propertyName, values, 4))
+        return Vector4(values[0], values[1], values[2], values[3]);
+    return defaultValue;
+}
+
+Vector3 SerializerJsonStream::readColor(const char* propertyName, const Vector3& defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (seekElement(propertyName))
+    {
+        skipSpace();
+        if (peek() != '"')
+            GP_ERROR("Invalid json string from color for propertyName:%s", propertyName);
+        std::string str;
+        parseString(str);
+        return Vector3::fromColorString(str.c_str());
+    }
+    return defaultValue;
+}
+
+Vector4 SerializerJsonStream::readColor(const char* propertyName, const Vector4& defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (seekElement(propertyName))
+    {
+        skipSpace();
+        if (peek() != '"')
+            GP_ERROR("Invalid json string from color for propertyName:%s", propertyName);
+        std::string str;
+        parseString(str);
+        return Vector4::fromColorString(str.c_str());
+    }
+    return defaultValue;
+}
+
+Matrix SerializerJsonStream::readMatrix(const char* propertyName, const Matrix& defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    float values[16];
+    if (readFloats(propertyName, values, 16))
+    {
+        Matrix value;
+        for (int i = 0; i < 16; ++i)
+            value.m[i] = values[i];
+        return value;
+    }
+    return defaultValue;
+}
+
+void SerializerJsonStream::readString(const char* propertyName, std::string& value, const char* defaultValue)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (seekElement(propertyName))
+    {
+        skipSpace();
+        if (peek() != '"')
+            GP_ERROR("Invalid json string for propertyName:%s", propertyName);
+        parseString(value);
+    }
+    else
+    {
+        value = defaultValue;
+    }
+}
+
+UPtr<Serializable> SerializerJsonStream::readObject(const char* propertyName)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (!seekElement(propertyName))
+    {
+        //read root
+        if (propertyName || _scopes.empty() || _scopes.back().isArray)
+            return UPtr<Serializable>();
+        seek(_scopes.back().offset);
+    }
+
+    skipSpace();
+    if (peek() != '{')
+        GP_ERROR("Invalid json object for propertyName:%s", propertyName);
+    Scope scope;
+    beginObject(scope);
+
+    std::string className;
+    std::string url;
+    for (const Property& property : scope.properties)
+    {
+        if (property.name == "class")
+        {
+            seek(property.offset);
+            parseString(className);
+        }
+        else if (property.name == "xref")
+        {
+            seek(property.offset);
+            parseString(url);
+        }
+    }
+
+    // Look for xref's
+    unsigned long xrefAddress = 0L;
+    if (url.size())
+    {
+        std::string at = "@";
+        if (url.compare(0, at.length(), at) != 0)
+        {
+            // no @ sign. This is xref'ed by others
+            xrefAddress = std::strtol(url.c_str(), nullptr, 10);
+        }
+        else
+        {
+            // This needs to lookup the node from the xref address. So save it for lookup
+            std::string addressStr = url.substr(1, url.length());
+            xrefAddress = std::strtol(addressStr.c_str(), nullptr, 10);
+
+            std::map<unsigned long, Serializable*>::const_iterator itr = _xrefsRead.find(xrefAddress);
+            if (itr != _xrefsRead.end())
+            {
+                Serializable* ref = itr->second;
+                Refable* refable = dynamic_cast<Refable*>(ref);
+                if (refable) refable->addRef();
+                return UPtr<Serializable>(ref);
+            }
+            else
+            {
+                GP_WARN("Unresolved xref:%u for class:%s", xrefAddress, className.c_str());
+                return UPtr<Serializable>();
+            }
+        }
+    }
+
+    Serializable *value = (SerializerManager::getActivator()->createObject(className));
+    if (value == nullptr)
+    {
+        GP_WARN("Failed to deserialize json object:%s for class:", className.c_str());
+        return UPtr<Serializable>();
+    }
+
+    _scopes.push_back(std::move(scope));
+    value->onDeserialize(this);
+    _scopes.pop_back();
+
+    if (xrefAddress)
+        _xrefsRead[xrefAddress] = value;
+
+    return UPtr<Serializable>(value);
+}
+
+void SerializerJsonStream::readMap(const char* propertyName, std::vector<std::string> &keys)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    Scope scope;
+    if (seekElement(propertyName))
+    {
+        beginObject(scope);
+        for (const Property& property : scope.properties)
+            keys.push_back(property.name);
+    }
+    _scopes.push_back(std::move(scope));
+}
+
+size_t SerializerJsonStream::readList(const char* propertyName)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    Scope scope;
+    scope.isArray = true;
+    if (seekElement(propertyName))
+    {
+        skipSpace();
+        if (peek() != '[')
+            GP_ERROR("Invalid json array for propertyName:%s", propertyName);
+        scope.count = countItems();
+        get();
+        scope.next = _position;
+    }
+    _scopes.push_back(std::move(scope));
+    return _scopes.back().count;
+}
+
+void SerializerJsonStream::finishColloction()
+{
+    _scopes.pop_back();
+}
+
+template<typename T> size_t SerializerJsonStream::readArray(const char* propertyName, T** data)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (!seekElement(propertyName))
+        return 0;
+
+    skipSpace();
+    long start = _position;
+    if (peek() != '[')
+        GP_ERROR("Invalid json array for propertyName:%s", propertyName);
+
+    T* buffer = *data;
+    if (buffer == nullptr)
+        buffer = new T[countItems()];
+
+    // the numbers are parsed into the buffer as they are read
+    size_t count = 0;
+    get();
+    skipSpace();
+    if (peek() == ']')
+    {
+        get();
+    }
+    else
+    {
+        while (!_failed)
+        {
+            if (!isNumber())
+                GP_ERROR("Invalid json number in array for propertyName:%s", propertyName);
+            buffer[count++] = (T)parseNumber();
+            skipSpace();
+            int c = get();
+            if (c == ']')
+                break;
+            if (c != ',')
+                fail("expected ',' or ']'");
+        }
+    }
+    endItem(start);
+    *data = buffer;
+    return count;
+}
+
+size_t SerializerJsonStream::readIntArray(const char* propertyName, int** data)
+{
+    return readArray<int>(propertyName, data);
+}
+
+size_t SerializerJsonStream::readFloatArray(const char* propertyName, float** data)
+{
+    return readArray<float>(propertyName, data);
+}
+
+size_t SerializerJsonStream::readDFloatArray(const char* propertyName, double** data)
+{
+    return readArray<double>(propertyName, data);
+}
+
+size_t SerializerJsonStream::readByteArray(const char* propertyName, unsigned char** data)
+{
+    GP_ASSERT(_type == Type::eReader);
+
+    if (!seekElement(propertyName))
+        return 0;
+
+    skipSpace();
+    if (get() != '"')
+        GP_ERROR("Invalid json base64 string for propertyName:%s", propertyName);
+
+    unsigned char* out = *data;
+    if (out == nullptr)
+    {
+        long start = _position;
+        skipString();
+        size_t length = _position - start - 1;
+        _position = start;
+        out = new unsigned char[BASE64_DECODE_OUT_SIZE(length + 3)];
+    }
+
+    // decoded by chunks from the stream, only '/' may be escaped in base64
+    char chunk[JSON_BASE64_CHUNK_SIZE];
+    size_t size = 0;
+    bool end = false;
+    while (!end)
+    {
+        unsigned int length = 0;
+        while (length < JSON_BASE64_CHUNK_SIZE)
+        {
+            int c = get();
+            if (c == '"' || c == -1)
+            {
+                end = true;
+                break;
+            }
+            if (c == '\\')
+                c = get();
+            chunk[length++] = (char)c;
+        }
+        if (length)
+            size += base64_decode(chunk, length, out + size);
+    }
+    *data = out;
+    return size;
+}
+
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "SerializerJson.h"
+
+#include <vector>
+
+namespace mgp
+{
+
+/**
+ * Defines a json reader that deserializes from the stream without building a document.
+ *
+ * The reader keeps a small window of the stream. When an object is read, only the names
+ * of its properties and the offsets of their values are recorded; the values are parsed
+ * from the stream when they are read, and numeric arrays straight into their buffers.
+ * The extra memory is bounded by the properties of the objects being read, instead of
+ * a multiple of the file size.
+ *
+ * The stream must be seekable. Himl files are read by SerializerJson.
+ *
+ * @see SerializerJson
+ */
+class SerializerJsonStream : public SerializerJson
+{
+public:
+
+    /**
+     * Creates a streaming json reader from the current position of the stream.
+     *
+     * @param stream The stream to read, owned by the serializer.
+     * @return The new reader, or NULL if the stream is not a json document with a version.
+     */
+    static UPtr<Serializer> create(Stream* stream);
+
+    /**
+     * @see Serializer::readEnum
+     */
+    int readEnum(const char* propertyName, const char* enumName, int defaultValue);
+
+    /**
+     * @see Serializer::readBool
+     */
+    bool readBool(const char* propertyName, bool defaultValue);
+
+    /**
+     * @see Serializer::readInt
+     */
+    int readInt(const char* propertyName, int defaultValue);
+
+    /**
+     * @see Serializer::readFloat
+     */
+    float readFloat(const char* propertyName, float defaultValue);
+
+    /**
+     * @see Serializer::readVector
+     */
+    Vector2 readVector(const char* propertyName, const Vector2& defaultValue);
+
+    /**
+     * @see Serializer::readVector
+     */
+    Vector3 readVector(const char* propertyName, const Vector3& defaultValue);
+
+    /**
+     * @see Serializer::readVector
+     */
+    Vector4 readVector(const char* propertyName, const Vector4& defaultValue);
+
+    /**
+     * @see Serializer::readColor
+     */
+    Vector3 readColor(const char* propertyName, const Vector3& defaultValue);
+
+    /**
+     * @see Serializer::readColor
+     */
+    Vector4 readColor(const char* propertyName, const Vector4& defaultValue);
+
+    /**
+     * @see Serializer::readMatrix
+     */
+    Matrix4 readMatrix(const char* propertyName, const Matrix4& defaultValue);
+
+    /**
+     * @see Serializer::readString
+     */
+    void readString(const char* propertyName, std::string& value, const char* defaultValue);
+
+    /**
+     * @see Serializer::readMap
+     */
+    void readMap(const char* propertyName, std::vector<std::string> &keys);
+
+    /**
+     * @see Serializer::readObject
+     */
+    UPtr<Serializable> readObject(const char* propertyName);
+
+    /**
+     * @see Serializer::readList
+     */
+    size_t readList(const char* propertyName);
+
+    /**
+     * @see Serializer::finishColloction
+     */
+    void finishColloction();
+
+    /**
+     * @see Serializer::readIntArray
+     */
+    size_t readIntArray(const char* propertyName, int** data);
+
+    /**
+     * @see Serializer::readFloatArray
+     */
+    size_t readFloatArray(const char* propertyName, float** data);
+    size_t readDFloatArray(const char* propertyName, double** data);
+
+    /**
+     * @see Serializer::readByteArray
+     */
+    size_t readByteArray(const char* propertyName, unsigned char** data);
+
+    /**
+     * Destructor
+     */
+    ~SerializerJsonStream();
+
+private:
+
+    /**
+     * A property of an object being read.
+     */
+    struct Property
+    {
+        std::string name;
+        long offset;
+        // the number of items of a list, -1 for other values
+        long items;
+    };
+
+    /**
+     * An object or a list being read.
+     */
+    struct Scope
+    {
+        bool isArray = false;
+        // the offset of an object and its properties
+        long offset = 0;
+        std::vector<Property> properties;
+        // the offsets of the current and next items of a list, -1 if not known yet, and the items left
+        long item = 0;
+        long next = 0;
+        size_t count = 0;
+    };
+
+    SerializerJsonStream(Stream* stream, uint32_t versionMajor, uint32_t versionMinor);
+
+    /**
+     * Seeks to the value of a property of the current object, or to the next item of the current list.
+     *
+     * @return false if the property does not exist.
+     */
+    bool seekElement(const char* propertyName);
+
+    void beginObject(Scope& scope);
+    size_t countItems();
+    void endItem(long offset);
+    template<typename T> size_t readArray(const char* propertyName, T** data);
+    bool readFloats(const char* propertyName, float* values, int count);
+
+    int peek();
+    int fill();
+    int get();
+    void seek(long offset);
+    long tell() const;
+    void skipSpace();
+    void skipValue(long* items = NULL);
+    void skipString();
+    void expect(char c);
+    bool isNumber();
+    double parseNumber(bool* isInteger = NULL);
+    unsigned int parseHex4();
+    void parseString(std::string& value);
+    bool parseBool();
+    void fail(const char* message);
+
+    char* _buffer;
+    long _bufferOffset;
+    size_t _bufferSize;
+    long _position;
+    long _length;
+    // the number of items of the list sought by seekElement() if known, -1 otherwise
+    long _items;
+    bool _failed;
+    std::vector<Scope> _scopes;
+    std::map<unsigned long, Serializable*> _xrefsRead;
+};
+
+}
@@ -2,7 +2,49 @@
 
 using namespace mgp;
 
-Stream::Stream(): endian(Endian::Little) {
+// The elements byte swapped on the stack per write.
+#define STREAM_SWAP_BUFFER_SIZE 1024
+
+void Endian::swap16Array(void* data, size_t count) {
+    uint8_t* p = (uint8_t*)data;
+    for (size_t i = 0; i < count; ++i, p += 2) {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        v = (uint16_t)((v >> 8) | (v << 8));
+        memcpy(p, &v, 2);
+    }
+}
+
+void Endian::swap32Array(void* data, size_t count) {
+    uint8_t* p = (uint8_t*)data;
+    for (size_t i = 0; i < count; ++i, p += 4) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+        memcpy(p, &v, 4);
+    }
+}
+
+void Endian::swap64Array(void* data, size_t count) {
+    uint8_t* p = (uint8_t*)data;
+    for (size_t i = 0; i < count; ++i, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        v = ((v >> 56) & 0xffull) | ((v >> 40) & 0xff00ull) | ((v >> 24) & 0xff0000ull) | ((v >> 8) & 0xff000000ull)
+            | ((v << 8) & 0xff00000000ull) | ((v << 24) & 0xff0000000000ull) | ((v << 40) & 0xff000000000000ull) | (v << 56);
+        memcpy(p, &v, 8);
+    }
+}
+
+static void swapArray(void* data, size_t size, size_t count) {
+    switch (size) {
+    case 2: Endian::swap16Array(data, count); break;
+    case 4: Endian::swap32Array(data, count); break;
+    case 8: Endian::swap64Array(data, count); break;
+    }
+}
+
+Stream::Stream(): _readNext(NULL), _readEnd(NULL), endian(Endian::Little) {
 
 }
 
@@ -113,16 +155,14 @@ ssize_t Stream::writeUInt64(uint64_t out) {
 uint8_t Stream::readUInt8() {
     static const int size = 1;
     unsigned char data[size];
-    ssize_t s = this->read((char*)data, size);
-    if (s < size) return -1;
+    if (readFast(data, 1, size) < (size_t)size) return -1;
     return data[0];
 }
 
 uint16_t Stream::readUInt16() {
     static const int size = 2;
     unsigned char data[size];
-    ssize_t s = this->read((char*)data, size);
-    if (s < size) return -1;
+    if (readFast(data, 1, size) < (size_t)size) return -1;
     uint16_t byte1 = data[0];
     uint16_t byte2 = data[1];
 
@@ -137,8 +177,7 @@ uint16_t Stream::readUInt16() {
 uint32_t Stream::readUInt32() {
     static const int size = 4;
     unsigned char data[size];
-    ssize_t s = this->read((char*)data, size);
-    if (s < size) return -1;
+    if (readFast(data, 1, size) < (size_t)size) return -1;
 
     uint32_t byte1 = data[0];
     uint32_t byte2 = data[1];
@@ -156,8 +195,7 @@ uint32_t Stream::readUInt32() {
 uint64_t Stream::readUInt64() {
     static const int size = 8;
     unsigned char data[size];
-    ssize_t s = this->read((char*)data, size);
-    if (s < size) return -1;
+    if (readFast(data, 1, size) < (size_t)size) return -1;
 
     uint64_t byte1 = data[0];
     uint64_t byte2 = data[1];
@@ -236,6 +274,66 @@ double Stream::readDouble() {
 
 ///////////////////////////////////////////////////////////
 
+size_t Stream::readUInt16Array(uint16_t* data, size_t count) {
+    size_t n = readFast(data, sizeof(uint16_t), count);
+    if (endian != Endian::hostEndian()) Endian::swap16Array(data, n);
+    return n;
+}
+
+size_t Stream::readUInt32Array(uint32_t* data, size_t count) {
+    size_t n = readFast(data, sizeof(uint32_t), count);
+    if (endian != Endian::hostEndian()) Endian::swap32Array(data, n);
+    return n;
+}
+
+size_t Stream::readFloatArray(float* data, size_t count) {
+    size_t n = readFast(data, sizeof(float), count);
+    if (endian != Endian::hostEndian()) Endian::swap32Array(data, n);
+    return n;
+}
+
+size_t Stream::readDoubleArray(double* data, size_t count) {
+    size_t n = readFast(data, sizeof(double), count);
+    if (endian != Endian::hostEndian()) Endian::swap64Array(data, n);
+    return n;
+}
+
+size_t Stream::writeSwapped(const void* data, size_t size, size_t count) {
+    if (endian == Endian::hostEndian()) {
+        return this->write(data, size, count);
+    }
+    // the data is const, the swapped copies are written in chunks
+    uint64_t buffer[STREAM_SWAP_BUFFER_SIZE];
+    const uint8_t* p = (const uint8_t*)data;
+    size_t written = 0;
+    while (written < count) {
+        size_t n = count - written;
+        if (n > STREAM_SWAP_BUFFER_SIZE) n = STREAM_SWAP_BUFFER_SIZE;
+        memcpy(buffer, p + written * size, n * size);
+        swapArray(buffer, size, n);
+        size_t w = this->write(buffer, size, n);
+        written += w;
+        if (w < n) break;
+    }
+    return written;
+}
+
+size_t Stream::writeUInt16Array(const uint16_t* data, size_t count) {
+    return writeSwapped(data, sizeof(uint16_t), count);
+}
+
+size_t Stream::writeUInt32Array(const uint32_t* data, size_t count) {
+    return writeSwapped(data, sizeof(uint32_t), count);
+}
+
+size_t Stream::writeFloatArray(const float* data, size_t count) {
+    return writeSwapped(data, sizeof(float), count);
+}
+
+size_t Stream::writeDoubleArray(const double* data, size_t count) {
+    return writeSwapped(data, sizeof(double), count);
+}
+
 
 void Stream::writeStr(const std::string& buf) {
     size_t size = buf.size();
@@ -247,7 +345,7 @@ std::string Stream::readStr() {
     size_t size = readUInt32();
     std::string s;
     s.resize(size);
-    read((char*)s.data(), size);
+    if (size) readFast(&s[0], 1, size);
     return (s);
 }
 
@@ -319,5 +417,5 @@ bool Stream::rewind() {
 }
 
 bool Stream::eof() {
-    return position() >= length();
+    return (size_t)position() >= length();
 }
\ No newline at end of file
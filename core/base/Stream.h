@@ -54,6 +54,12 @@ namespace mgp
             p[3] = p[3] ^ p[4];
         }
 
+        /**
+         * Swaps the bytes of each element of an array, in loops the compiler can vectorize.
+         */
+        static void swap16Array(void* data, size_t count);
+        static void swap32Array(void* data, size_t count);
+        static void swap64Array(void* data, size_t count);
     };
 /**
  * Defines a stream for reading and writing a sequence of bytes.
@@ -203,6 +209,26 @@ public:
 
 protected:
     Stream();
+
+    /**
+     * Copies from the memory window when it holds the bytes, else reads them from the stream.
+     */
+    inline size_t readFast(void* ptr, size_t size, size_t count) {
+        size_t len = size * count;
+        if ((size_t)(_readEnd - _readNext) >= len) {
+            memcpy(ptr, _readNext, len);
+            _readNext += len;
+            return count;
+        }
+        return this->read(ptr, size, count);
+    }
+
+    /**
+     * The bytes of the stream in memory from the current position, set by the streams reading
+     * from memory. The typed reads copy from it without a virtual call.
+     */
+    const uint8_t* _readNext;
+    const uint8_t* _readEnd;
 private:
     Stream(const Stream&);            // Hidden copy constructor.
     Stream& operator=(const Stream&); // Hidden copy assignment operator.
@@ -248,8 +274,26 @@ public:
     float readFloat();
     double readDouble();
 
+    /**
+     * Reads or writes an array of numbers in the byte order of the stream,
+     * with one read or write and the bytes swapped only when it is not the host order.
+     *
+     * @return The number of elements read or written.
+     */
+    size_t readUInt16Array(uint16_t* data, size_t count);
+    size_t readUInt32Array(uint32_t* data, size_t count);
+    size_t readFloatArray(float* data, size_t count);
+    size_t readDoubleArray(double* data, size_t count);
+    size_t writeUInt16Array(const uint16_t* data, size_t count);
+    size_t writeUInt32Array(const uint32_t* data, size_t count);
+    size_t writeFloatArray(const float* data, size_t count);
+    size_t writeDoubleArray(const double* data, size_t count);
+
     void writeStr(const std::string& buf);
     std::string readStr();
+
+private:
+    size_t writeSwapped(const void* data, size_t size, size_t count);
 };
 
 
@@ -416,8 +416,18 @@ void MaterialParameter::setSamplerArray(const Texture** values, unsigned int cou
     GP_ASSERT(values);
     if (copy)
     {
-        if (_type == MaterialParameter::SAMPLER && _isArray && _count == count) {
-            //pass
+        if (_type == MaterialParameter::SAMPLER && _isArray && _count == count && _dynamicAlloc) {
+            //reuse the array, the new textures are retained before the old ones are released
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                const_cast<Texture*>(values[i])->addRef();
+            }
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                const_cast<Texture*>(_value.samplerArrayValue[i])->release();
+            }
+            memcpy(_value.samplerArrayValue, values, sizeof(Texture*) * count);
+            return;
         }
         else {
             clearValue();
@@ -57,33 +57,38 @@ bool Texture::load(const char* path) {
     return true;
 }
 
-UPtr<Texture> Texture::create(const char* path, bool generateMipmaps)
+Texture* Texture::findCached(const char* path, bool generateMipmaps)
 {
-    GP_ASSERT( path );
-
-    if (true) {
-        std::lock_guard<std::mutex> guard(__textureCacheMutex);
-        // Search texture cache first.
-        for (size_t i = 0, count = __textureCache.size(); i < count; ++i)
+    std::lock_guard<std::mutex> guard(__textureCacheMutex);
+    for (size_t i = 0, count = __textureCache.size(); i < count; ++i)
+    {
+        Texture* t = __textureCache[i];
+        GP_ASSERT(t);
+        if (t->_path == path)
         {
-            Texture* t = __textureCache[i];
-            GP_ASSERT(t);
-            if (t->_path == path)
+            // If 'generateMipmaps' is true, call Texture::generateMipamps() to force the
+            // texture to generate its mipmap chain if it hasn't already done so.
+            if (generateMipmaps)
             {
-                // If 'generateMipmaps' is true, call Texture::generateMipamps() to force the
-                // texture to generate its mipmap chain if it hasn't already done so.
-                if (generateMipmaps)
-                {
-                    t->_mipmapped = true;
-                }
-
-                // Found a match.
-                t->addRef();
-
-                return UPtr<Texture>(t);
+                t->_mipmapped = true;
             }
+
+            // Found a match.
+            t->addRef();
+            return t;
         }
     }
+    return NULL;
+}
+
+UPtr<Texture> Texture::create(const char* path, bool generateMipmaps)
+{
+    GP_ASSERT( path );
+
+    // Search texture cache first.
+    Texture* cached = findCached(path, generateMipmaps);
+    if (cached)
+        return UPtr<Texture>(cached);
 
     UPtr<Texture> texture;
 
@@ -135,6 +140,28 @@ UPtr<Texture> Texture::create(const char* path, bool generateMipmaps)
     return UPtr<Texture>(NULL);
 }
 
+UPtr<Texture> Texture::create(const char* path, UPtr<Image> image, bool generateMipmaps)
+{
+    GP_ASSERT(path);
+
+    Texture* cached = findCached(path, generateMipmaps);
+    if (cached)
+        return UPtr<Texture>(cached);
+
+    UPtr<Texture> texture = create(std::move(image), generateMipmaps);
+    if (texture.get())
+    {
+        texture->_path = path;
+        texture->_cached = true;
+
+        std::lock_guard<std::mutex> guard(__textureCacheMutex);
+        __textureCache.push_back(texture.get());
+
+        return texture;
+    }
+    return UPtr<Texture>(NULL);
+}
+
 UPtr<Texture> Texture::create(UPtr<Image> image, bool generateMipmaps)
 {
     Texture* texture = new Texture();
@@ -589,6 +616,26 @@ void Texture::copyFrom(Texture* that) {
     _datas = that->_datas;
 }
 
+void Texture::setSubData(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const unsigned char* data)
+{
+    GP_ASSERT(data);
+    GP_ASSERT(_type == TEXTURE_2D && x + width <= _width && y + height <= _height);
+
+    // Create the texture first if it was never uploaded.
+    upload();
+
+    // Keep the memory copy in sync.
+    Image* image = _datas.size() ? _datas.at(0).get() : NULL;
+    if (image && image->getData()) {
+        size_t bpp = Image::getFormatBPP(_format);
+        for (unsigned int j = 0; j < height; ++j) {
+            memcpy(image->getData() + ((y + j) * _width + x) * bpp, data + j * width * bpp, width * bpp);
+        }
+    }
+
+    Renderer::cur()->updateTextureRegion(this, x, y, width, height, data);
+}
+
 void Texture::setWrapMode(Wrap wrapS, Wrap wrapT, Wrap wrapR)
 {
     _wrapS = wrapS;
@@ -602,7 +649,7 @@ void Texture::setFilterMode(Filter minificationFilter, Filter magnificationFilte
     _magFilter = magnificationFilter;
 }
 
-void Texture::bind()
+void Texture::upload()
 {
     if (_dataDirty && _datas.size() > 0) {
         _dataDirty = false;
@@ -613,6 +660,11 @@ void Texture::bind()
             }
         }
     }
+}
+
+void Texture::bind()
+{
+    upload();
 
     if (!this->isMipmapped()) {
         if (_minFilter >= NEAREST_MIPMAP_NEAREST && _minFilter <= LINEAR_MIPMAP_LINEAR) {
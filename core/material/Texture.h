@@ -96,6 +96,18 @@ public:
      */
     static UPtr<Texture> create(UPtr<Image> image, bool generateMipmaps = false);
 
+    /**
+     * Creates a texture from an image already decoded from a file, shared with create(path)
+     * through the texture cache.
+     *
+     * @param path The image resource path.
+     * @param image The image decoded from the file, not used if the texture is in the cache.
+     * @param generateMipmaps True to generate a full mipmap chain, false otherwise.
+     *
+     * @return The new texture, or NULL if the image is not of a supported texture format.
+     */
+    static UPtr<Texture> create(const char* path, UPtr<Image> image, bool generateMipmaps = false);
+
     /**
      * Creates a texture from the given texture data.
      *
@@ -147,6 +159,15 @@ public:
      */
     void setData(const unsigned char* data, bool copyMem = false);
 
+    /**
+     * Replaces a rectangle of a 2D texture, uploaded right away.
+     *
+     * Cheaper than setData() when a small part changes. Must be called on the render thread.
+     *
+     * @param data Raw data of the rectangle, tightly packed.
+     */
+    void setSubData(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const unsigned char* data);
+
     /**
     * download data from GPU
     */
@@ -275,6 +296,13 @@ public:
      */
     void bind();
 
+    /**
+     * Uploads the image data changed since the last upload, done by bind() otherwise.
+     *
+     * Must be called on the render thread.
+     */
+    void upload();
+
     void setSize(unsigned int width, unsigned int height);
 
     void setKeepMemory(bool b);
@@ -301,6 +329,11 @@ private:
      */
     Texture& operator=(const Texture&) = delete;
 
+    /**
+     * Gets a texture of the cache with a reference added, NULL if none was loaded from the path.
+     */
+    static Texture* findCached(const char* path, bool generateMipmaps);
+
 private:
     std::string _path;
     
@@ -186,7 +186,8 @@ void VertexAttributeObject::init() {
             attri.enabled = true;
             attri.size = e.size;
             attri.type = e.dataType;//GL_FLOAT
-            attri.normalized = 0;
+            attri.normalized = e.normalized;
+            attri.integer = e.isInteger();
             attri.stride = e.stride;
             attri.location = attrib;
             attri.pointer = pointer;
@@ -99,6 +99,7 @@ public:
         int size;
         unsigned int type;
         bool normalized;
+        bool integer;                   // Read as integers by the shader, not converted to floats.
         unsigned int stride;
         void* pointer;
         unsigned int location;
@@ -0,0 +1,471 @@
+#include "base/Base.h"
+#include "CompressedCurve.h"
+#include "Quaternion.h"
+#include "base/Stream.h"
+
+#define QUATERNION_COMPONENT_MAX 0.70710678118654752440f
+#define QUATERNION_COMPONENT_BITS 15
+#define QUATERNION_COMPONENT_MASK 0x7FFF
+#define QUATERNION_WORDS 3
+
+namespace mgp
+{
+
+static uint16_t quantizeUnit(float v, unsigned int max)
+{
+    if (v <= 0.0f)
+        return 0;
+    if (v >= 1.0f)
+        return max;
+    return (uint16_t)(v * max + 0.5f);
+}
+
+/**
+ * Encodes a quaternion with the smallest three method: 2 bits for the index of the largest
+ * component and 15 bits for each of the other three. The largest is rebuilt from the unit length.
+ */
+static void encodeQuaternion(const float* q, uint16_t* dst)
+{
+    float length = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (length == 0.0f)
+        length = 1.0f;
+
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+    {
+        if (fabs(q[i]) > fabs(q[largest]))
+            largest = i;
+    }
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint64_t bits = (uint64_t)largest << (QUATERNION_COMPONENT_BITS * 3);
+    int shift = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float v = q[i] * sign / length / QUATERNION_COMPONENT_MAX;
+        bits |= (uint64_t)quantizeUnit(v * 0.5f + 0.5f, QUATERNION_COMPONENT_MASK) << shift;
+        shift += QUATERNION_COMPONENT_BITS;
+    }
+
+    dst[0] = (uint16_t)(bits & 0xFFFF);
+    dst[1] = (uint16_t)((bits >> 16) & 0xFFFF);
+    dst[2] = (uint16_t)((bits >> 32) & 0xFFFF);
+}
+
+static void decodeQuaternion(const uint16_t* src, Float* dst)
+{
+    uint64_t bits = (uint64_t)src[0] | ((uint64_t)src[1] << 16) | ((uint64_t)src[2] << 32);
+    int largest = (int)((bits >> (QUATERNION_COMPONENT_BITS * 3)) & 0x3);
+
+    Float sum = 0;
+    int shift = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        Float v = ((Float)((bits >> shift) & QUATERNION_COMPONENT_MASK) / QUATERNION_COMPONENT_MASK * 2.0 - 1.0) * QUATERNION_COMPONENT_MAX;
+        dst[i] = v;
+        sum += v * v;
+        shift += QUATERNION_COMPONENT_BITS;
+    }
+    dst[largest] = sum < 1.0 ? sqrt(1.0 - sum) : 0.0;
+}
+
+/**
+ * Gets the error of reproducing the value by interpolating between from and to.
+ */
+static float interpolationError(float s, const float* from, const float* to, const float* value, unsigned int componentCount, int quaternionOffset)
+{
+    float error = 0.0f;
+    for (unsigned int i = 0; i < componentCount; ++i)
+    {
+        if (quaternionOffset >= 0 && i == (unsigned int)quaternionOffset)
+        {
+            // Normalized lerp on the shorter arc. Close enough to slerp for error estimation.
+            const float* q0 = from + i;
+            const float* q1 = to + i;
+            float dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+            float sign = dot < 0.0f ? -1.0f : 1.0f;
+            float q[4];
+            float length = 0.0f;
+            for (int j = 0; j < 4; ++j)
+            {
+                q[j] = q0[j] + (q1[j] * sign - q0[j]) * s;
+                length += q[j] * q[j];
+            }
+            length = length > 0.0f ? sqrt(length) : 1.0f;
+            const float* v = value + i;
+            float vdot = (q[0] * v[0] + q[1] * v[1] + q[2] * v[2] + q[3] * v[3]) / length;
+            float vsign = vdot < 0.0f ? -1.0f : 1.0f;
+            for (int j = 0; j < 4; ++j)
+                error = std::max(error, (float)fabs(q[j] / length - v[j] * vsign));
+            i += 3;
+        }
+        else
+        {
+            float v = from[i] + (to[i] - from[i]) * s;
+            error = std::max(error, (float)fabs(v - value[i]));
+        }
+    }
+    return error;
+}
+
+bool CompressedCurve::canCompress(const Curve* curve)
+{
+    if (!curve || curve->_pointCount == 0 || curve->_componentCount > MAX_COMPONENT_COUNT)
+        return false;
+
+    for (unsigned int i = 0; i < curve->_pointCount; ++i)
+    {
+        Curve::InterpolationType type = curve->_points[i].type;
+        if (type != Curve::LINEAR && type != Curve::STEP)
+            return false;
+    }
+    return true;
+}
+
+CompressedCurve::CompressedCurve()
+    : _pointCount(0), _componentCount(0), _quaternionOffset(-1), _stride(0)
+{
+}
+
+UPtr<CompressedCurve> CompressedCurve::create()
+{
+    return UPtr<CompressedCurve>(new CompressedCurve());
+}
+
+UPtr<CompressedCurve> CompressedCurve::create(const Curve* curve, float tolerance)
+{
+    if (!canCompress(curve))
+        return UPtr<CompressedCurve>(NULL);
+
+    unsigned int pointCount = curve->_pointCount;
+    unsigned int componentCount = curve->_componentCount;
+    const Curve::Point* points = curve->_points;
+
+    CompressedCurve* compressed = new CompressedCurve();
+    compressed->_componentCount = componentCount;
+    compressed->_quaternionOffset = curve->_quaternionOffset ? (int)*curve->_quaternionOffset : -1;
+    compressed->_stride = compressed->_quaternionOffset >= 0 ? componentCount - 4 + QUATERNION_WORDS : componentCount;
+
+    // Remove the keys that can be interpolated from their kept neighbours.
+    std::vector<unsigned int> kept;
+    kept.push_back(0);
+    unsigned int merged = 0;
+    for (unsigned int i = 1; i < pointCount; ++i)
+    {
+        unsigned int last = kept.back();
+        uint16_t lastTime = quantizeUnit(points[last].time, 0xFFFF);
+        if (quantizeUnit(points[i].time, 0xFFFF) == lastTime)
+        {
+            // Closer than the time precision. A key with the same value is merged, a different one is
+            // kept as a discontinuity, of which only the first and the last keys can be evaluated.
+            if (interpolationError(0.0f, points[last].value, points[last].value, points[i].value, componentCount, compressed->_quaternionOffset) <= tolerance)
+                continue;
+            if (kept.size() > 1 && quantizeUnit(points[kept[kept.size() - 2]].time, 0xFFFF) == lastTime)
+            {
+                kept.back() = i;
+                ++merged;
+            }
+            else
+            {
+                kept.push_back(i);
+            }
+            continue;
+        }
+        if (i + 1 == pointCount)
+        {
+            kept.push_back(i);
+            break;
+        }
+
+        bool redundant = points[i].type == points[last].type;
+        const Curve::Point& next = points[i + 1];
+        for (unsigned int j = last + 1; redundant && j <= i; ++j)
+        {
+            float error;
+            if (points[last].type == Curve::STEP)
+            {
+                error = interpolationError(0.0f, points[last].value, next.value, points[j].value, componentCount, compressed->_quaternionOffset);
+            }
+            else
+            {
+                float s = (points[j].time - points[last].time) / (next.time - points[last].time);
+                error = interpolationError(s, points[last].value, next.value, points[j].value, componentCount, compressed->_quaternionOffset);
+            }
+            redundant = error <= tolerance;
+        }
+
+        if (!redundant)
+            kept.push_back(i);
+    }
+    if (merged > 0)
+        GP_WARN("Merged %u animation keys closer than the time precision of the compressed curve.", merged);
+
+    // Range of the scalar components.
+    compressed->_minValues.resize(componentCount, 0.0f);
+    compressed->_rangeValues.resize(componentCount, 0.0f);
+    for (unsigned int c = 0; c < componentCount; ++c)
+    {
+        float minValue = points[kept[0]].value[c];
+        float maxValue = minValue;
+        for (size_t k = 1; k < kept.size(); ++k)
+        {
+            float v = points[kept[k]].value[c];
+            minValue = std::min(minValue, v);
+            maxValue = std::max(maxValue, v);
+        }
+        compressed->_minValues[c] = minValue;
+        compressed->_rangeValues[c] = maxValue - minValue;
+    }
+
+    compressed->_pointCount = (unsigned int)kept.size();
+    compressed->_times.resize(kept.size());
+    compressed->_types.resize(kept.size());
+    compressed->_data.resize(kept.size() * compressed->_stride);
+    for (size_t k = 0; k < kept.size(); ++k)
+    {
+        const Curve::Point& point = points[kept[k]];
+        compressed->_times[k] = quantizeUnit(point.time, 0xFFFF);
+        compressed->_types[k] = (uint8_t)point.type;
+
+        uint16_t* dst = &compressed->_data[k * compressed->_stride];
+        for (unsigned int c = 0; c < componentCount; ++c)
+        {
+            if ((int)c == compressed->_quaternionOffset)
+            {
+                encodeQuaternion(point.value + c, dst);
+                dst += QUATERNION_WORDS;
+                c += 3;
+                continue;
+            }
+            float range = compressed->_rangeValues[c];
+            *dst = range > 0.0f ? quantizeUnit((point.value[c] - compressed->_minValues[c]) / range, 0xFFFF) : 0;
+            ++dst;
+        }
+    }
+
+    return UPtr<CompressedCurve>(compressed);
+}
+
+unsigned int CompressedCurve::getPointCount() const
+{
+    return _pointCount;
+}
+
+unsigned int CompressedCurve::getComponentCount() const
+{
+    return _componentCount;
+}
+
+int CompressedCurve::getQuaternionOffset() const
+{
+    return _quaternionOffset;
+}
+
+size_t CompressedCurve::getMemorySize() const
+{
+    return sizeof(CompressedCurve) + _times.size() * sizeof(uint16_t) + _types.size() + _data.size() * sizeof(uint16_t)
+        + (_minValues.size() + _rangeValues.size()) * sizeof(float);
+}
+
+Float CompressedCurve::getTime(unsigned int index) const
+{
+    return (Float)_times[index] / 0xFFFF;
+}
+
+void CompressedCurve::decodePoint(unsigned int index, Float* dst) const
+{
+    const uint16_t* src = &_data[index * _stride];
+    for (unsigned int c = 0; c < _componentCount; ++c)
+    {
+        if ((int)c == _quaternionOffset)
+        {
+            decodeQuaternion(src, dst + c);
+            src += QUATERNION_WORDS;
+            c += 3;
+            continue;
+        }
+        dst[c] = _minValues[c] + _rangeValues[c] * ((Float)*src / 0xFFFF);
+        ++src;
+    }
+}
+
+unsigned int CompressedCurve::determineIndex(Float time, unsigned int min, unsigned int max) const
+{
+    // Binary search for the last point not after the given time.
+    while (min < max)
+    {
+        unsigned int mid = (min + max + 1) >> 1;
+        if (getTime(mid) <= time)
+            min = mid;
+        else
+            max = mid - 1;
+    }
+    return min;
+}
+
+void CompressedCurve::interpolate(Float s, unsigned int from, unsigned int to, Float* dst) const
+{
+    if (_types[from] == Curve::STEP || from == to)
+    {
+        decodePoint(from, dst);
+        return;
+    }
+
+    Float toValue[MAX_COMPONENT_COUNT];
+    decodePoint(from, dst);
+    decodePoint(to, toValue);
+    for (unsigned int c = 0; c < _componentCount; ++c)
+    {
+        if ((int)c == _quaternionOffset)
+        {
+            Quaternion q;
+            Quaternion::slerp(Quaternion(dst[c], dst[c + 1], dst[c + 2], dst[c + 3]),
+                Quaternion(toValue[c], toValue[c + 1], toValue[c + 2], toValue[c + 3]), s, &q);
+            dst[c] = q.x;
+            dst[c + 1] = q.y;
+            dst[c + 2] = q.z;
+            dst[c + 3] = q.w;
+            c += 3;
+            continue;
+        }
+        dst[c] = Curve::lerp(s, dst[c], toValue[c]);
+    }
+}
+
+void CompressedCurve::evaluate(Float time, Float startTime, Float endTime, Float loopBlendTime, Float* dst) const
+{
+    GP_ASSERT(dst && startTime >= 0.0f && startTime <= endTime && endTime <= 1.0f && loopBlendTime >= 0.0f);
+    if (_pointCount == 0)
+        return;
+
+    if (_pointCount == 1)
+    {
+        decodePoint(0, dst);
+        return;
+    }
+
+    unsigned int min = 0;
+    unsigned int max = _pointCount - 1;
+    Float localTime = time;
+    if (startTime > 0.0f || endTime < 1.0f)
+    {
+        // Evaluating a sub section of the curve
+        min = determineIndex(startTime, 0, max);
+        max = determineIndex(endTime, min, max);
+
+        // Convert time to fall within the subregion
+        localTime = getTime(min) + (getTime(max) - getTime(min)) * time;
+    }
+
+    Float minTime = getTime(min);
+    Float maxTime = getTime(max);
+    if (loopBlendTime == 0.0f)
+    {
+        // If no loop blend time is specified, clamp time to end points
+        if (localTime < minTime)
+            localTime = minTime;
+        else if (localTime > maxTime)
+            localTime = maxTime;
+    }
+
+    if (localTime == minTime)
+    {
+        decodePoint(min, dst);
+        return;
+    }
+    if (localTime == maxTime)
+    {
+        decodePoint(max, dst);
+        return;
+    }
+
+    if (localTime > maxTime)
+    {
+        // Looping forward
+        interpolate((localTime - maxTime) / loopBlendTime, max, min, dst);
+    }
+    else if (localTime < minTime)
+    {
+        // Looping in reverse
+        interpolate((minTime - localTime) / loopBlendTime, min, max, dst);
+    }
+    else
+    {
+        unsigned int index = determineIndex(localTime, min, max);
+        unsigned int next = index == max ? index : index + 1;
+        Float scale = getTime(next) - getTime(index);
+        interpolate(scale > 0.0f ? (localTime - getTime(index)) / scale : 0.0f, index, next, dst);
+    }
+}
+
+UPtr<Curve> CompressedCurve::decompress() const
+{
+    UPtr<Curve> curve = Curve::create(_pointCount, _componentCount);
+    if (_quaternionOffset >= 0)
+        curve->setQuaternionOffset(_quaternionOffset);
+
+    Float value[MAX_COMPONENT_COUNT];
+    float fvalue[MAX_COMPONENT_COUNT];
+    for (unsigned int i = 0; i < _pointCount; ++i)
+    {
+        decodePoint(i, value);
+        for (unsigned int c = 0; c < _componentCount; ++c)
+            fvalue[c] = (float)value[c];
+        curve->setPoint(i, getTime(i), fvalue, (Curve::InterpolationType)_types[i]);
+    }
+    return curve;
+}
+
+void CompressedCurve::write(Stream* file)
+{
+    file->writeUInt32(_pointCount);
+    file->writeUInt8(_componentCount);
+    file->writeInt8(_quaternionOffset);
+    for (unsigned int c = 0; c < _componentCount; ++c)
+    {
+        file->writeFloat(_minValues[c]);
+        file->writeFloat(_rangeValues[c]);
+    }
+    file->writeUInt16Array(_times.data(), _times.size());
+    file->write((const char*)_types.data(), _types.size());
+    file->writeUInt16Array(_data.data(), _data.size());
+}
+
+bool CompressedCurve::read(Stream* file)
+{
+    _pointCount = file->readUInt32();
+    _componentCount = file->readUInt8();
+    _quaternionOffset = file->readInt8();
+    if (_componentCount > MAX_COMPONENT_COUNT || (_quaternionOffset >= 0 && _quaternionOffset + 4 > (int)_componentCount))
+    {
+        GP_WARN("Invalid compressed curve");
+        return false;
+    }
+    _stride = _quaternionOffset >= 0 ? _componentCount - 4 + QUATERNION_WORDS : _componentCount;
+
+    _minValues.resize(_componentCount);
+    _rangeValues.resize(_componentCount);
+    for (unsigned int c = 0; c < _componentCount; ++c)
+    {
+        _minValues[c] = file->readFloat();
+        _rangeValues[c] = file->readFloat();
+    }
+
+    _times.resize(_pointCount);
+    _types.resize(_pointCount);
+    _data.resize(_pointCount * _stride);
+    if (file->readUInt16Array(_times.data(), _times.size()) != _times.size()
+        || file->read(_types.data(), 1, _types.size()) != _types.size()
+        || file->readUInt16Array(_data.data(), _data.size()) != _data.size())
+    {
+        GP_WARN("Truncated compressed curve");
+        return false;
+    }
+    return true;
+}
+
+}
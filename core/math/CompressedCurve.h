@@ -0,0 +1,105 @@
+#ifndef COMPRESSEDCURVE_H_
+#define COMPRESSEDCURVE_H_
+
+#include "Curve.h"
+
+namespace mgp
+{
+class Stream;
+
+/**
+ * Defines a compact, read only copy of a Curve used for animation storage.
+ *
+ * Redundant keys are removed within an error tolerance, quaternions are quantized
+ * to 48 bits (smallest three) and the other components are range normalized to 16 bits.
+ * Key times are normalized to 16 bits. Points are decoded on the fly when evaluating.
+ *
+ * Only curves using LINEAR and STEP interpolation can be compressed.
+ */
+class CompressedCurve : public Refable
+{
+public:
+
+    /**
+     * The max component count of a compressed curve.
+     */
+    static const unsigned int MAX_COMPONENT_COUNT = 16;
+
+    /**
+     * Returns true if the curve can be compressed.
+     */
+    static bool canCompress(const Curve* curve);
+
+    /**
+     * Compresses the curve.
+     *
+     * @param curve The curve to compress.
+     * @param tolerance The max error of the removed keys.
+     *
+     * @return The compressed curve, or NULL if the curve can not be compressed.
+     */
+    static UPtr<CompressedCurve> create(const Curve* curve, float tolerance);
+
+    /**
+     * Creates an empty curve to read into.
+     */
+    static UPtr<CompressedCurve> create();
+
+    /**
+     * Gets the number of points kept after key reduction.
+     */
+    unsigned int getPointCount() const;
+
+    /**
+     * Gets the number of components per point.
+     */
+    unsigned int getComponentCount() const;
+
+    /**
+     * Gets the offset of the quaternion components, -1 if none.
+     */
+    int getQuaternionOffset() const;
+
+    /**
+     * Gets the memory used by the compressed data, in bytes.
+     */
+    size_t getMemorySize() const;
+
+    /**
+     * Evaluates the curve. Same as Curve::evaluate.
+     */
+    void evaluate(Float time, Float startTime, Float endTime, Float loopBlendTime, Float* dst) const;
+
+    /**
+     * Decodes the curve into a full precision Curve.
+     */
+    UPtr<Curve> decompress() const;
+
+    void write(Stream* file);
+    bool read(Stream* file);
+
+private:
+
+    CompressedCurve();
+    CompressedCurve(const CompressedCurve&);
+    CompressedCurve& operator=(const CompressedCurve&);
+
+    Float getTime(unsigned int index) const;
+    void decodePoint(unsigned int index, Float* dst) const;
+    unsigned int determineIndex(Float time, unsigned int min, unsigned int max) const;
+    void interpolate(Float s, unsigned int from, unsigned int to, Float* dst) const;
+
+    unsigned int _pointCount;           // Number of points kept.
+    unsigned int _componentCount;       // Number of components on the curve.
+    int _quaternionOffset;              // Offset of the quaternion components, -1 if none.
+    unsigned int _stride;               // Number of 16 bits words per point.
+    std::vector<uint16_t> _times;       // Normalized key times.
+    std::vector<uint8_t> _types;        // Interpolation type of each point.
+    std::vector<float> _minValues;      // Min value of each scalar component.
+    std::vector<float> _rangeValues;    // Value range of each scalar component.
+    std::vector<uint16_t> _data;        // Quantized points.
+};
+
+}
+
+#endif
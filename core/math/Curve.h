@@ -18,6 +18,8 @@ class Curve : public Refable
     friend class Animation;
     friend class AnimationClip;
     friend class AnimationController;
+    friend class KeyframeChannel;
+    friend class CompressedCurve;
     friend class MeshSkin;
 
 public:
@@ -9,6 +9,7 @@
 #include "base/Logger.h"
 #include "base/SerializerManager.h"
 #include "base/SerializerJson.h"
+#include "base/SerializerJsonStream.h"
 #include "base/SerializerBinary.h"
 #include "base/Serializable.h"
 #include "base/Cache.h"
@@ -16,6 +17,8 @@
 #include "base/StringUtil.h"
 #include "base/System.h"
 #include "base/Buffer.h"
+#include "base/BufferedStream.h"
+#include "base/MappedStream.h"
 #include "base/Ptr.h"
 #include "base/Ref.h"
 
@@ -39,6 +42,7 @@
 #include "material/Texture.h"
 #include "scene/Mesh.h"
 #include "scene/MeshFactory.h"
+#include "scene/MeshOptimizer.h"
 #include "material/ShaderProgram.h"
 #include "material/Material.h"
 #include "scene/VertexFormat.h"
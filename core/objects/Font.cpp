@@ -15,6 +15,8 @@
 #include <algorithm>
 #include "base/StringUtil.h"
 #include "scene/Renderer.h"
+#include "base/ThreadPool.h"
+#include "MultiSpriteBatch.h"
 
 extern "C" {
 #include "3rd/utf8.h"
@@ -55,6 +57,40 @@ namespace mgp
 {
 
 static std::vector<FontCache*> __fontCache;
+static unsigned int __fontCacheVersion = 0;
+// Versions of the laid out runs, never reused so a freed run cannot match a new one at the same address.
+static uint64_t __textRunVersion = 0;
+
+// Size of the atlas pages.
+#define FONT_TEXTURE_SIZE 512
+
+// Part of the page area kept by a compaction, so the next glyphs fit without compacting again.
+#define FONT_COMPACT_KEEP_RATIO 0.5
+
+// Number of worker threads rendering glyphs.
+#define FONT_THREAD_COUNT 2
+
+// Max number of glyphs rendered by one task, so the requests of a frame are shared by the workers.
+#define FONT_TASK_GLYPH_COUNT 16
+
+// Max number of text runs kept by a font when no layout uses them.
+#define FONT_TEXT_RUN_CACHE_SIZE 1024
+
+// Glyph keys are the character code and the bold strength.
+#define FONT_GLYPH_KEY(c, bold) ((((uint64_t)(c)) << 8) | (bold))
+
+class GlyphRenderTask : public Task
+{
+    FontCache* _cache;
+    std::vector<uint64_t> _keys;
+public:
+    GlyphRenderTask(FontCache* cache, std::vector<uint64_t>::const_iterator begin, std::vector<uint64_t>::const_iterator end)
+        : _cache(cache), _keys(begin, end) {}
+
+    void run() override {
+        _cache->renderGlyphs(_keys, this);
+    }
+};
 
 //static ShaderProgram* __fontEffect = NULL;
 
@@ -93,6 +129,24 @@ FontCache::~FontCache() {
         __fontCache.erase(itr);
     }
 
+    // Wait for the render tasks before releasing the faces.
+    if (_threadPool)
+    {
+        _threadPool->stop();
+        SAFE_DELETE(_threadPool);
+    }
+    for (size_t i = 0, count = _workerFaces.size(); i < count; ++i)
+    {
+        delete _workerFaces[i];
+    }
+    _workerFaces.clear();
+    _freeWorkerFaces.clear();
+    for (auto& it : _rendered)
+    {
+        free(it.second.imgData);
+    }
+    _rendered.clear();
+
     for (size_t i = 0, count = fontTextures.size(); i < count; ++i)
     {
         fontTextures[i]->release();
@@ -107,77 +161,324 @@ FontCache::~FontCache() {
 }
 
 FontCache::FontCache() :
-    _style(PLAIN), _size(25), textureWidth(512), textureHeight(512)
+    _style(PLAIN), _size(25), textureWidth(FONT_TEXTURE_SIZE), textureHeight(FONT_TEXTURE_SIZE),
+    _maxTextureCount(2), _frame(0), _generation(0), _compactPending(false),
+#ifdef __EMSCRIPTEN__
+    _async(false),
+#else
+    _async(true),
+#endif
+    _threadPool(NULL)
 {
 }
 
 bool FontCache::getGlyph(FontInfo& fontInfo, wchar_t c, Glyph& glyph) {
-    uint64_t key = ((uint64_t)c << 8) | (fontInfo.bold);
+    uint64_t key = FONT_GLYPH_KEY(c, fontInfo.bold);
     double fontSizeScale = fontInfo.size / (double)_size;
 
-    TextureAtlas* fontTexture = NULL;
-    int textureIndex = 0;
     auto itr = glyphCache.find(key);
     if (itr != glyphCache.end()) {
-        glyph = itr->second;
-        fontTexture = fontTextures[glyph.texture];
-        glyph.metrics.scaleMetrics(fontSizeScale);
+        itr->second.lastUsedFrame = _frame;
+        glyph = itr->second.glyph;
+    }
+    else if (_missingKeys.find(key) != _missingKeys.end()) {
+        return false;
+    }
+    else if (_async) {
+        //placeholder with the real advance until the worker renders it
+        glyph.code = c;
+        if (!fontFaces.at(0)->merics(c, fontInfo, glyph.metrics)) {
+            return false;
+        }
+        glyph.texture = -1;
+        glyph.imgData = NULL;
+        request(key);
+        return true;
     }
     else {
         //render char to image
         if (!fontFaces.at(0)->renderChar(c, fontInfo, _size, glyph)) {
             return false;
         }
-
-        //find free space
-        Rectangle rect;
-        int i = 0;
-        //if (c > 128) i = 1;
-        for (; i < fontTextures.size(); ++i) {
-            TextureAtlas* ft = fontTextures[i];
-            if (ft->addImageData(glyph.imgW, glyph.imgH, glyph.imgData, rect)) {
-                fontTexture = ft;
-                textureIndex = i;
-                break;
-            }
+        if (!addGlyph(key, glyph)) {
+            return false;
         }
+        //char name[256];
+        //snprintf(name, 256, "fontTexture_%p.png", this);
+        //stbi_write_png(name, textureWidth, textureHeight, 1, fontTexture->data, textureWidth * 1);
+    }
+    glyph.metrics.scaleMetrics(fontSizeScale);
+    return true;
+}
 
-        //new texture
-        if (fontTexture == NULL) {
-            fontTexture = new TextureAtlas(Image::Format::RED, textureWidth, textureHeight);
-            fontTexture->getTexture()->setFilterMode(Texture::LINEAR, Texture::LINEAR);
-            //fontTexture->getTexture()->setFilterMode(Texture::NEAREST, Texture::NEAREST);
-            textureIndex = fontTextures.size();
-            fontTextures.push_back(fontTexture);
+TextureAtlas* FontCache::addTexture() {
+    TextureAtlas* fontTexture = new TextureAtlas(Image::Format::RED, textureWidth, textureHeight);
+    fontTexture->getTexture()->setFilterMode(Texture::LINEAR, Texture::LINEAR);
+    //fontTexture->getTexture()->setFilterMode(Texture::NEAREST, Texture::NEAREST);
+    //uploaded once per frame by flush
+    fontTexture->setUploadOnAdd(false);
+    fontTextures.push_back(fontTexture);
+    return fontTexture;
+}
 
-            bool ok = fontTexture->addImageData(glyph.imgW, glyph.imgH, glyph.imgData, rect);
-            GP_ASSERT(ok);
+bool FontCache::addGlyph(uint64_t key, Glyph& glyph) {
+    //find free space
+    Rectangle rect;
+    int textureIndex = -1;
+    for (int i = 0; i < fontTextures.size(); ++i) {
+        if (fontTextures[i]->addImageData(glyph.imgW, glyph.imgH, glyph.imgData, rect)) {
+            textureIndex = i;
+            break;
         }
+    }
 
-        free(glyph.imgData);
-        glyph.imgData = NULL;
+    //new texture, over the page count until the next frame compacts them
+    if (textureIndex == -1) {
+        if (fontTextures.size() >= _maxTextureCount) {
+            _compactPending = true;
+        }
+        TextureAtlas* fontTexture = addTexture();
+        textureIndex = fontTextures.size() - 1;
+        if (!fontTexture->addImageData(glyph.imgW, glyph.imgH, glyph.imgData, rect)) {
+            GP_WARN("Glyph too large for the font texture: %d", glyph.code);
+            free(glyph.imgData);
+            glyph.imgData = NULL;
+            return false;
+        }
+    }
+
+    free(glyph.imgData);
+    glyph.imgData = NULL;
+
+    glyph.texture = textureIndex;
+    glyph.imgX = rect.x;
+    glyph.imgY = rect.y;
+
+    CachedGlyph& cached = glyphCache[key];
+    cached.glyph = glyph;
+    cached.lastUsedFrame = _frame;
+    return true;
+}
+
+void FontCache::compact() {
+    _compactPending = false;
+
+    //most recently used first
+    std::vector<std::pair<uint64_t, uint64_t> > order;
+    order.reserve(glyphCache.size());
+    for (auto& it : glyphCache) {
+        order.push_back(std::make_pair(it.second.lastUsedFrame, it.first));
+    }
+    std::sort(order.begin(), order.end(), [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) {
+        return a.first > b.first;
+    });
+
+    std::vector<TextureAtlas*> oldTextures;
+    oldTextures.swap(fontTextures);
 
+    int keepArea = _maxTextureCount * textureWidth * textureHeight * FONT_COMPACT_KEEP_RATIO;
+    int area = 0;
+    int evicted = 0;
+    for (auto& entry : order) {
+        auto itr = glyphCache.find(entry.second);
+        Glyph& glyph = itr->second.glyph;
+
+        //glyphs of the last frame are kept, they will be drawn again
+        bool recent = itr->second.lastUsedFrame + 1 >= _frame;
+        area += (glyph.imgW + 1) * (glyph.imgH + 1);
+        bool keep = recent || area <= keepArea;
+
+        Rectangle rect;
+        int textureIndex = -1;
+        if (keep) {
+            Rectangle srcRect(glyph.imgX, glyph.imgY, glyph.imgW, glyph.imgH);
+            TextureAtlas* src = oldTextures[glyph.texture];
+            for (int i = 0; i < fontTextures.size(); ++i) {
+                if (fontTextures[i]->addAtlasImage(src, srcRect, rect)) {
+                    textureIndex = i;
+                    break;
+                }
+            }
+            if (textureIndex == -1 && (fontTextures.size() < _maxTextureCount || recent)) {
+                TextureAtlas* fontTexture = addTexture();
+                if (fontTexture->addAtlasImage(src, srcRect, rect)) {
+                    textureIndex = fontTextures.size() - 1;
+                }
+            }
+        }
+
+        if (textureIndex == -1) {
+            glyphCache.erase(itr);
+            ++evicted;
+            continue;
+        }
         glyph.texture = textureIndex;
         glyph.imgX = rect.x;
         glyph.imgY = rect.y;
+    }
 
-        glyphCache[key] = glyph;
+    for (TextureAtlas* t : oldTextures) {
+        t->release();
+    }
+    ++_generation;
+    GP_DEBUG("Font cache compacted: %d glyphs evicted, %d pages.", evicted, (int)fontTextures.size());
+}
 
-        glyph.metrics.scaleMetrics(fontSizeScale);
-        //char name[256];
-        //snprintf(name, 256, "fontTexture_%p.png", this);
-        //stbi_write_png(name, textureWidth, textureHeight, 1, fontTexture->data, textureWidth * 1);
+void FontCache::request(uint64_t key) {
+    if (_pendingKeys.insert(key).second) {
+        _requests.push_back(key);
     }
-    return true;
 }
 
-Font::Font() : _spacing(0.0f), _isStarted(false), shaderProgram(NULL), _outline(0), _hasProjectionMatrix(false), _isOverlay(true)
+void FontCache::prewarm(const wchar_t* chars, int count, int bold) {
+    GP_ASSERT(chars);
+    if (count < 0) {
+        count = wcslen(chars);
+    }
+    for (int i = 0; i < count; ++i) {
+        uint64_t key = FONT_GLYPH_KEY(chars[i], bold);
+        if (glyphCache.find(key) != glyphCache.end() || _missingKeys.find(key) != _missingKeys.end()) {
+            continue;
+        }
+        request(key);
+    }
+    flush();
+}
+
+void FontCache::prewarm(const char* text, int bold) {
+    std::wstring utext;
+    utf8decode(text, -1, utext, NULL);
+    prewarm(utext.data(), utext.size(), bold);
+}
+
+FontFace* FontCache::acquireWorkerFace() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_freeWorkerFaces.empty()) {
+        //the main face is used by the render thread
+        FontFace* face = new FontFace();
+        face->load(_path.c_str());
+        _workerFaces.push_back(face);
+        return face;
+    }
+    FontFace* face = _freeWorkerFaces.back();
+    _freeWorkerFaces.pop_back();
+    return face;
+}
+
+void FontCache::releaseWorkerFace(FontFace* face) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _freeWorkerFaces.push_back(face);
+}
+
+void FontCache::renderGlyphs(const std::vector<uint64_t>& keys, Task* task) {
+    FontFace* face = task ? acquireWorkerFace() : fontFaces.at(0);
+    FontInfo fontInfo;
+    fontInfo.size = _size;
+
+    std::vector<std::pair<uint64_t, Glyph> > rendered;
+    rendered.reserve(keys.size());
+    size_t i = 0;
+    for (; i < keys.size(); ++i) {
+        if (task && task->isCanceled()) break;
+
+        uint64_t key = keys[i];
+        wchar_t c = (wchar_t)(key >> 8);
+        fontInfo.bold = key & 0xFF;
+        Glyph glyph;
+        if (!face->renderChar(c, fontInfo, _size, glyph)) {
+            glyph.imgData = NULL;
+        }
+        rendered.push_back(std::make_pair(key, glyph));
+    }
+
+    if (task) {
+        releaseWorkerFace(face);
+    }
+    std::lock_guard<std::mutex> guard(_mutex);
+    _rendered.insert(_rendered.end(), rendered.begin(), rendered.end());
+    _canceledKeys.insert(_canceledKeys.end(), keys.begin() + i, keys.end());
+}
+
+void FontCache::update() {
+    ++_frame;
+
+    std::vector<std::pair<uint64_t, Glyph> > rendered;
+    std::vector<uint64_t> canceled;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        rendered.swap(_rendered);
+        canceled.swap(_canceledKeys);
+    }
+    for (uint64_t key : canceled) {
+        _pendingKeys.erase(key);
+    }
+    if (rendered.size()) {
+        ++__fontCacheVersion;
+    }
+    for (auto& it : rendered) {
+        _pendingKeys.erase(it.first);
+        if (!it.second.imgData) {
+            _missingKeys.insert(it.first);
+            continue;
+        }
+        if (glyphCache.find(it.first) != glyphCache.end()) {
+            //rendered by a synchronous draw in the meantime
+            free(it.second.imgData);
+            continue;
+        }
+        addGlyph(it.first, it.second);
+    }
+
+    if (_compactPending) {
+        compact();
+        ++__fontCacheVersion;
+    }
+    flush();
+}
+
+void FontCache::flush() {
+    if (_requests.size()) {
+#ifdef __EMSCRIPTEN__
+        //no worker threads, render now and add at the next frame
+        renderGlyphs(_requests, NULL);
+#else
+        if (!_threadPool) {
+            _threadPool = new ThreadPool(FONT_THREAD_COUNT);
+            _threadPool->start();
+        }
+        for (size_t i = 0; i < _requests.size(); i += FONT_TASK_GLYPH_COUNT) {
+            size_t end = std::min(i + FONT_TASK_GLYPH_COUNT, _requests.size());
+            _threadPool->addTask(ThreadPool::TaskPtr(new GlyphRenderTask(this, _requests.begin() + i, _requests.begin() + end)));
+        }
+#endif
+        _requests.clear();
+    }
+
+    for (TextureAtlas* t : fontTextures) {
+        t->update();
+    }
+}
+
+void FontCache::beginFrame() {
+    for (FontCache* cache : __fontCache) {
+        cache->update();
+    }
+}
+
+unsigned int FontCache::getVersion() {
+    return __fontCacheVersion;
+}
+
+Font::Font() : _spacing(0.0f), _isStarted(false), shaderProgram(NULL), _outline(0), _hasProjectionMatrix(false), _isOverlay(true),
+    _cacheGeneration(0)
 {
     //shaderProgram = ShaderProgram::createFromFile(FONT_VSH, FONT_FSH);
 }
 
 Font::~Font()
 {
+    clearTextRuns();
+
     for (size_t i = 0, count = fontDrawers.size(); i < count; ++i) {
         SpriteBatch* _batch = fontDrawers[i];
         if (!_batch) continue;
@@ -243,8 +544,23 @@ void Font::lazyStart()
     }
 }
 
+void Font::syncDrawers()
+{
+    if (_cacheGeneration != _fontCache->_generation) {
+        for (size_t i = 0, count = fontDrawers.size(); i < count; ++i) {
+            SAFE_DELETE(fontDrawers[i]);
+        }
+        fontDrawers.clear();
+        _cacheGeneration = _fontCache->_generation;
+    }
+    if (fontDrawers.size() != _fontCache->fontTextures.size()) {
+        fontDrawers.resize(_fontCache->fontTextures.size(), NULL);
+    }
+}
+
 void Font::finish(RenderInfo* view)
 {
+    _fontCache->flush();
     for (size_t i = 0, count = fontDrawers.size(); i < count; ++i) {
         SpriteBatch* _batch = fontDrawers[i];
         if (!_batch) continue;
@@ -276,7 +592,25 @@ void Font::finish(RenderInfo* view)
     _isStarted = false;
 }
 
+bool Font::finishInto(MultiSpriteBatch* batch)
+{
+    if (_immediatelyDraw)
+        return false;
+
+    _fontCache->flush();
+    MultiSpriteBatch::Mode mode = _outline ? MultiSpriteBatch::DISTANCE_FIELD_OUTLINE : MultiSpriteBatch::DISTANCE_FIELD;
+    for (size_t i = 0, count = fontDrawers.size(); i < count; ++i) {
+        SpriteBatch* _batch = fontDrawers[i];
+        if (!_batch || !_batch->isStarted()) continue;
+        _batch->_batch->finish();
+        batch->add(_batch, mode);
+    }
+    _isStarted = false;
+    return true;
+}
+
 void Font::finalDraw(RenderInfo* view) {
+    _fontCache->flush();
     for (size_t i = 0, count = fontDrawers.size(); i < count; ++i) {
         SpriteBatch* _batch = fontDrawers[i];
         if (!_batch) continue;
@@ -323,20 +657,42 @@ bool Font::isStarted() const {
 }
 
 
-bool Font::drawChar(int c, FontInfo& fontInfo, Glyph& glyph, float x, float y, const Vector4& color, int previous, const Rectangle* clip) {
+bool Font::getGlyphQuad(int c, FontInfo& fontInfo, Glyph& glyph, float x, float y, int previous, TextRun::Quad& quad) {
 
     if (!_fontCache->getGlyph(fontInfo, c, glyph)) {
         return false;
     }
 
+    //being rendered, leave its space blank
+    quad.page = glyph.texture;
+    if (glyph.texture < 0) {
+        return true;
+    }
+
     double fontSizeScale = fontInfo.size / (double)_fontCache->_size;
 
-    if (fontDrawers.size() != _fontCache->fontTextures.size()) {
-        fontDrawers.resize(_fontCache->fontTextures.size(), NULL);
+    if (previous > 0 && previous < 128 && c < 128) {
+        float kerning = _fontCache->fontFaces.at(0)->getKerning(fontInfo, previous, c);
+        x += kerning;
     }
-    SpriteBatch* _batch = fontDrawers[glyph.texture];
+
+    quad.x = x + (glyph.metrics.horiBearingX) - glyph.imgPadding / glyph.imgScale;
+    quad.y = y - (glyph.metrics.horiBearingY - fontInfo.size) - glyph.imgPadding / glyph.imgScale;
+    quad.width = glyph.imgW / glyph.imgScale * fontSizeScale;
+    quad.height = glyph.imgH / glyph.imgScale * fontSizeScale;
+
+    quad.u1 = (glyph.imgX) / (float)_fontCache->textureWidth;
+    quad.v1 = (glyph.imgY) / (float)_fontCache->textureHeight;
+    quad.u2 = (glyph.imgX + glyph.imgW) / (float)_fontCache->textureWidth;
+    quad.v2 = (glyph.imgY + glyph.imgH) / (float)_fontCache->textureHeight;
+    return true;
+}
+
+SpriteBatch* Font::getDrawer(int page) {
+    syncDrawers();
+    SpriteBatch* _batch = fontDrawers[page];
     if (!_batch) {
-        TextureAtlas* fontTexture = _fontCache->fontTextures[glyph.texture];
+        TextureAtlas* fontTexture = _fontCache->fontTextures[page];
         _batch = SpriteBatch::create(fontTexture->getTexture(), shaderProgram).take();
         if (_isOverlay) {
             _batch->setRenderLayer(Drawable::Overlay);
@@ -347,26 +703,25 @@ bool Font::drawChar(int c, FontInfo& fontInfo, Glyph& glyph, float x, float y, c
             auto u_outline = _batch->getMaterial()->getParameter("u_outline");
             u_outline->setVector2(Vector2(0.45, 0.1));
         }
-        fontDrawers[glyph.texture] = _batch;
+        fontDrawers[page] = _batch;
         _batch->start();
     }
+    return _batch;
+}
 
-    if (previous > 0 && previous < 128 && c < 128) {
-        float kerning = _fontCache->fontFaces.at(0)->getKerning(fontInfo, previous, c);
-        x += kerning;
-    }
-
-    _batch->draw(
-            x + (glyph.metrics.horiBearingX) - glyph.imgPadding / glyph.imgScale,
-            y - (glyph.metrics.horiBearingY - fontInfo.size) - glyph.imgPadding / glyph.imgScale,
-            glyph.imgW / glyph.imgScale * fontSizeScale,
-            glyph.imgH / glyph.imgScale * fontSizeScale,
+bool Font::drawChar(int c, FontInfo& fontInfo, Glyph& glyph, float x, float y, const Vector4& color, int previous, const Rectangle* clip) {
 
-            (glyph.imgX) / (float)_fontCache->textureWidth,
-            (glyph.imgY) / (float)_fontCache->textureHeight,
-            (glyph.imgX + glyph.imgW) / (float)_fontCache->textureWidth,
-            (glyph.imgY + glyph.imgH) / (float)_fontCache->textureHeight,
+    TextRun::Quad quad;
+    if (!getGlyphQuad(c, fontInfo, glyph, x, y, previous, quad)) {
+        return false;
+    }
+    if (quad.page < 0) {
+        return true;
+    }
 
+    SpriteBatch* _batch = getDrawer(quad.page);
+    _batch->draw(quad.x, quad.y, quad.width, quad.height,
+            quad.u1, quad.v1, quad.u2, quad.v2,
             color, clip);
 
     return true;
@@ -378,11 +733,14 @@ bool Font::drawChar3D(int c, FontInfo& fontInfo, Glyph& glyph, const Vector3& ce
         return false;
     }
 
+    //being rendered, leave its space blank
+    if (glyph.texture < 0) {
+        return true;
+    }
+
     double fontSizeScale = fontInfo.size / (double)_fontCache->_size;
 
-    if (fontDrawers.size() != _fontCache->fontTextures.size()) {
-        fontDrawers.resize(_fontCache->fontTextures.size(), NULL);
-    }
+    syncDrawers();
     SpriteBatch* _batch = fontDrawers[glyph.texture];
     if (!_batch) {
         TextureAtlas* fontTexture = _fontCache->fontTextures[glyph.texture];
@@ -638,6 +996,130 @@ float Font::getCharacterSpacing() const
 void Font::setCharacterSpacing(float spacing)
 {
     _spacing = spacing;
+    clearTextRuns();
+}
+
+void Font::layoutRun(TextRun* run)
+{
+    if (run->laidOut && run->generation == _fontCache->_generation)
+    {
+        return;
+    }
+
+    float fontSize = run->fontSize;
+    if (fontSize == 0)
+    {
+        fontSize = _fontCache->_size;
+    }
+
+    float spacing = (fontSize * _spacing);
+
+    FontInfo fontInfo;
+    fontInfo.bold = 0;
+    fontInfo.size = fontSize;
+    GlyphMetrics metrics;
+    _fontCache->fontFaces.at(0)->merics(0, fontInfo, metrics);
+
+    run->quads.clear();
+    run->laidOut = true;
+
+    // Same placement as drawText, one line after the other.
+    int lineTop = 0;
+    for (size_t l = 0; l < run->lines.size(); ++l)
+    {
+        const TextRun::Line& line = run->lines[l];
+        const wchar_t* utext = run->unicode.data() + line.pos;
+        float xPos = 0, yPos = lineTop;
+
+        wchar_t previous = 0;
+        for (int i = 0; i < line.len; i++)
+        {
+            uint32_t c = utext[i];
+
+            switch (c)
+            {
+            case ' ':
+                xPos += fontSize / 3.0;
+                break;
+            case '\r':
+                break;
+            case '\n':
+                yPos += metrics.height;
+                xPos = 0;
+                break;
+            case '\t':
+                xPos += fontSize * 2;
+                break;
+            default: {
+                Glyph glyph;
+                TextRun::Quad quad;
+                if (getGlyphQuad(c, fontInfo, glyph, xPos, yPos, previous, quad)) {
+                    if (quad.page >= 0) {
+                        quad.line = l;
+                        run->quads.push_back(quad);
+                    }
+                    else {
+                        run->laidOut = false;
+                    }
+                    xPos += glyph.metrics.horiAdvance + spacing;
+                }
+                else {
+                    xPos += fontSize;
+                }
+            }
+            }
+
+            previous = c;
+        }
+
+        lineTop += (int)(yPos + metrics.height - lineTop);
+    }
+
+    run->generation = _fontCache->_generation;
+    run->version = ++__textRunVersion;
+}
+
+TextRun* Font::findTextRun(const std::string& key)
+{
+    auto itr = _textRuns.find(key);
+    if (itr == _textRuns.end())
+    {
+        return NULL;
+    }
+    return itr->second;
+}
+
+void Font::addTextRun(const std::string& key, TextRun* run)
+{
+    if (_textRuns.size() >= FONT_TEXT_RUN_CACHE_SIZE)
+    {
+        // Drop the runs that no layout uses anymore.
+        for (auto itr = _textRuns.begin(); itr != _textRuns.end();)
+        {
+            if (itr->second->getRefCount() == 1)
+            {
+                itr->second->release();
+                itr = _textRuns.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+    }
+    run->addRef();
+    _textRuns[key] = run;
+}
+
+void Font::clearTextRuns()
+{
+    for (auto& it : _textRuns)
+    {
+        // Layouts still using it will lay it out again.
+        it.second->laidOut = false;
+        it.second->release();
+    }
+    _textRuns.clear();
 }
 
 
@@ -854,32 +1336,97 @@ FontLayout::Justify FontLayout::getJustify(const char* justify)
 
 void FontLayout::update(Font* font, unsigned int fontSize, const char* text, int textLen, int wrapWidth)
 {
-    unicode.clear();
-    int utextSize = utf8decode(text, textLen, unicode, NULL);
+    if (textLen < 0)
+    {
+        textLen = strlen(text);
+    }
 
+    if (this->font == font && run.get() && run->fontSize == fontSize && run->wrapWidth == wrapWidth &&
+        run->text.size() == (size_t)textLen && memcmp(run->text.data(), text, textLen) == 0)
+    {
+        return;
+    }
     this->font = font;
-    this->fontSize = fontSize;
-    this->wrapWidth = wrapWidth;
-    this->lineHeight = font->getLineHeight(fontSize);
-    
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "%u:%d:", fontSize, wrapWidth);
+    std::string key = prefix;
+    key.append(text, textLen);
+
+    TextRun* cached = font->findTextRun(key);
+    if (cached)
+    {
+        run = cached;
+        return;
+    }
+
+    run = SPtr<TextRun>(new TextRun());
+    run->text.assign(text, textLen);
+    utf8decode(text, textLen, run->unicode, NULL);
+    run->fontSize = fontSize;
+    run->wrapWidth = wrapWidth;
+    run->lineHeight = font->getLineHeight(fontSize);
+
     if (wrapWidth == -1) {
-        lines.clear();
         Line line = { 0,0 };
         while (nextLine(line)) {
-            lines.push_back(line);
+            run->lines.push_back(line);
         }
     }
     else {
         doWrap();
     }
+
+    // Measured once, used for the alignment of every draw.
+    for (Line& line : run->lines) {
+        unsigned int w;
+        font->measureText(run->unicode.data() + line.pos, fontSize, &w, &run->measuredHeight, line.len);
+        run->lineWidths.push_back(w);
+    }
+
+    font->addTextRun(key, run.get());
+}
+
+static bool isSameRect(const Rectangle& a, const Rectangle& b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
 }
 
 void FontLayout::drawText(const Rectangle& area, const Vector4& color, Justify align, const Rectangle* clip)
 {
-    int yPos = area.y;
-    int xPos = area.x;
+    if (!font || !run.get()) return;
+
+    font->layoutRun(run.get());
+
+    if (vertexVersion != run->version || vertexAlign != align || vertexColor != color ||
+        !isSameRect(vertexArea, area) || vertexHasClip != (clip != NULL) || (clip && !isSameRect(vertexClip, *clip))) {
+        updateVertices(area, color, align, clip);
+    }
 
-    int textHeight = lineHeight * lines.size();
+    font->lazyStart();
+    for (size_t i = 0; i < pages.size(); ++i) {
+        PageVertices& page = pages[i];
+        if (page.vertices.empty()) continue;
+        font->getDrawer(i)->drawVertices(page.vertices.data(), page.vertices.size(), page.indices.data(), page.indices.size());
+    }
+}
+
+void FontLayout::updateVertices(const Rectangle& area, const Vector4& color, Justify align, const Rectangle* clip)
+{
+    vertexVersion = run->version;
+    vertexArea = area;
+    vertexColor = color;
+    vertexAlign = align;
+    vertexHasClip = clip != NULL;
+    if (clip) vertexClip = *clip;
+
+    for (PageVertices& page : pages) {
+        page.vertices.clear();
+        page.indices.clear();
+    }
+
+    int yPos = area.y;
+    int textHeight = run->lineHeight * run->lines.size();
     if (align & FontLayout::ALIGN_VCENTER) {
         yPos = area.y + ((area.height - textHeight) / 2.0);
     }
@@ -887,40 +1434,81 @@ void FontLayout::drawText(const Rectangle& area, const Vector4& color, Justify a
         yPos = area.y + (area.height - textHeight);
     }
 
-    for (Line& line : lines) {
-
+    std::vector<int> lineX(run->lines.size(), (int)area.x);
+    for (size_t i = 0; i < run->lines.size(); ++i) {
+        unsigned int w = run->lineWidths[i];
         if (align & FontLayout::ALIGN_HCENTER) {
-            unsigned int h;
-            unsigned int w;
-            font->measureText(unicode.data() + line.pos, fontSize, &w, &h, line.len);
-            xPos = area.x + ((area.width - w) / 2.0);
+            lineX[i] = area.x + ((area.width - w) / 2.0);
         }
         else if (align & FontLayout::ALIGN_RIGHT) {
-            unsigned int h;
-            unsigned int w;
-            font->measureText(unicode.data() + line.pos, fontSize, &w, &h, line.len);
-            xPos = area.x + (area.width - w);
+            lineX[i] = area.x + (area.width - w);
+        }
+    }
+
+    for (const TextRun::Quad& quad : run->quads) {
+        float x = lineX[quad.line] + quad.x;
+        float y = yPos + quad.y;
+        float width = quad.width;
+        float height = quad.height;
+        float u1 = quad.u1, v1 = quad.v1, u2 = quad.u2, v2 = quad.v2;
+        if (clip && !font->getDrawer(quad.page)->clipSprite(*clip, x, y, width, height, u1, v1, u2, v2)) {
+            continue;
         }
 
-        yPos += font->drawText(unicode.data() + line.pos, xPos, yPos, color, fontSize, line.len, clip);
+        if (pages.size() <= (size_t)quad.page) {
+            pages.resize(quad.page + 1);
+        }
+        PageVertices& page = pages[quad.page];
+        unsigned int base = page.vertices.size();
+        if (base + 4 > 0xFFFF) {
+            continue;
+        }
+
+        // Separate strips joined by degenerate triangles, as MeshBatch does.
+        if (base > 0) {
+            page.indices.push_back(base - 1);
+            page.indices.push_back(base);
+        }
+
+        const float x2 = x + width;
+        const float y2 = y + height;
+        const float pos[4][4] = {
+            { x, y, u1, v1 },
+            { x, y2, u1, v2 },
+            { x2, y, u2, v1 },
+            { x2, y2, u2, v2 },
+        };
+        for (int i = 0; i < 4; ++i) {
+            SpriteBatch::SpriteVertex vtx;
+            vtx.x = pos[i][0]; vtx.y = pos[i][1]; vtx.z = 0;
+            vtx.u = pos[i][2]; vtx.v = pos[i][3];
+            vtx.r = color.x; vtx.g = color.y; vtx.b = color.z; vtx.a = color.w;
+            page.vertices.push_back(vtx);
+            page.indices.push_back(base + i);
+        }
     }
 }
 
 void FontLayout::measureText(unsigned int* widthOut, unsigned int* heightOut)
 {
     unsigned maxWidth = 0;
+    unsigned int lineCount = 0;
     unsigned int h = 0;
-    for (Line& line : lines) {
-        unsigned int w;
-        font->measureText(unicode.data() + line.pos, fontSize, &w, &h, line.len);
-        if (w > maxWidth) maxWidth = w;
+    if (run.get()) {
+        for (unsigned int w : run->lineWidths) {
+            if (w > maxWidth) maxWidth = w;
+        }
+        lineCount = run->lines.size();
+        h = run->measuredHeight;
     }
     *widthOut = maxWidth;
-    *heightOut = h * lines.size();
+    *heightOut = h * lineCount;
 }
 
 Vector2 FontLayout::positionAtIndex(int index)
 {
+    if (!run.get()) return Vector2(0, 0);
+    std::vector<Line>& lines = run->lines;
     int row = 0;
     int x = 0;
     for (int i = 0; i < lines.size(); ++i) {
@@ -933,28 +1521,30 @@ Vector2 FontLayout::positionAtIndex(int index)
             row = i;
             unsigned int w;
             unsigned int h;
-            font->measureText(unicode.data() + line.pos, fontSize, &w, &h, index - line.pos);
+            font->measureText(run->unicode.data() + line.pos, run->fontSize, &w, &h, index - line.pos);
             x = w;
         }
     }
-    return Vector2(x, row * lineHeight);
+    return Vector2(x, row * run->lineHeight);
 }
 
 int FontLayout::indexAtPosition(Vector2& pos)
 {
-    int row = pos.y / lineHeight;
+    if (!run.get()) return 0;
+    int row = pos.y / run->lineHeight;
     if (row < 0) row = 0;
-    if (row >= lines.size()) {
-        return unicode.size();
+    if (row >= run->lines.size()) {
+        return run->unicode.size();
     }
 
-    Line line = lines[row];
-    int len = font->indexAtCoord(unicode.data() + line.pos, fontSize, true, line.len, pos.x);
+    Line line = run->lines[row];
+    int len = font->indexAtCoord(run->unicode.data() + line.pos, run->fontSize, true, line.len, pos.x);
     return line.pos + len;
 }
 
 bool FontLayout::nextLine(Line& line)
 {
+    std::wstring& unicode = run->unicode;
     if (line.pos + line.len >= unicode.size()) return false;
     line.pos += line.len;
     line.len = 0;
@@ -976,6 +1566,7 @@ bool FontLayout::nextLine(Line& line)
 
 void FontLayout::doWrap()
 {
+    std::vector<Line>& lines = run->lines;
     lines.clear();
     Line line = { 0,0 };
     while (nextLine(line)) {
@@ -996,10 +1587,10 @@ void FontLayout::doWrap()
 
 int FontLayout::lenAtWrap(Line line)
 {
-    int len = font->indexAtCoord(unicode.data()+line.pos, fontSize, true, line.len, wrapWidth);
+    int len = font->indexAtCoord(run->unicode.data()+line.pos, run->fontSize, true, line.len, run->wrapWidth);
     if (len == line.len) return len;
     for (int i = len; i > 0; --i) {
-        if (unicode[line.pos + i] == L' ') {
+        if (run->unicode[line.pos + i] == L' ') {
             return i;
         }
     }
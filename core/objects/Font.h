@@ -12,12 +12,32 @@
 #include "TextureAtlas.h"
 #include "FontEngine.h"
 
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace mgp
 {
 
+class ThreadPool;
+class Task;
+
+/**
+ * Caches the rendered glyphs of a font in atlas textures.
+ *
+ * Glyphs are rasterized and converted to distance fields by worker threads. A glyph
+ * drawn for the first time is requested and skipped, with its real advance, until it
+ * is ready a frame or two later, so new text never stalls the render thread.
+ *
+ * The number of atlas pages is bounded. When they are full, a page is added until the
+ * next frame, then the least recently used glyphs are evicted and the rest are packed
+ * again into the bounded pages. Glyphs only move in beginFrame(), before any text is
+ * drawn, so the text batched during a frame stays valid.
+ */
 class FontCache : public Refable
 {
     friend class Font;
+    friend class GlyphRenderTask;
 public:
 
     /**
@@ -33,11 +53,112 @@ public:
 
     static SPtr<FontCache> create(const char* path, int fontSize = 30);
 
+    /**
+     * Gets a glyph, scaled to the font info size.
+     *
+     * If the glyph is being rendered, only the metrics are set and the texture is -1.
+     *
+     * @return false if the font has no glyph for the character.
+     */
     bool getGlyph(FontInfo& fontInfo, wchar_t ch, Glyph& glyph);
+
+    /**
+     * Renders characters on the worker threads, so that they are in the atlas before they are drawn.
+     *
+     * Typically called at startup with the common characters of a language.
+     *
+     * @param chars The characters to render.
+     * @param count The number of characters, -1 if chars is null terminated.
+     * @param bold The bold strength.
+     */
+    void prewarm(const wchar_t* chars, int count = -1, int bold = 0);
+
+    /**
+     * Renders the characters of an UTF-8 string on the worker threads.
+     */
+    void prewarm(const char* text, int bold = 0);
+
+    /**
+     * Sets whether glyphs are rendered by worker threads (default true).
+     *
+     * When false, getGlyph() renders missing glyphs right away.
+     */
+    void setAsync(bool async) { _async = async; }
+
+    /**
+     * Sets the max number of atlas pages (default 2).
+     */
+    void setMaxTextureCount(int count) { _maxTextureCount = count < 1 ? 1 : count; }
+
+    int getTextureCount() const { return fontTextures.size(); }
+
+    int getGlyphCount() const { return glyphCache.size(); }
+
+    /**
+     * Gets the number of glyphs being rendered.
+     */
+    int getPendingCount() const { return _pendingKeys.size(); }
+
+    /**
+     * Sends the glyphs requested since the last call to the worker threads,
+     * and uploads the glyphs added to the atlases.
+     */
+    void flush();
+
+    /**
+     * Starts a new frame for all the font caches.
+     *
+     * Adds the glyphs rendered by the worker threads, and compacts the caches that went
+     * over their page count. Called by the Application before drawing.
+     */
+    static void beginFrame();
+
+    /**
+     * Gets a counter incremented when glyphs rendered by the worker threads are added,
+     * or when pages are rebuilt, by any font cache.
+     *
+     * Text drawn with an older version may miss glyphs or use stale texture coordinates.
+     */
+    static unsigned int getVersion();
+
 private:
+    struct CachedGlyph
+    {
+        Glyph glyph;
+        uint64_t lastUsedFrame;
+    };
+
     FontCache();
     ~FontCache();
 
+    void update();
+
+    /**
+     * Queues a glyph for the worker threads.
+     */
+    void request(uint64_t key);
+
+    /**
+     * Packs a rendered glyph into an atlas and frees its image.
+     */
+    bool addGlyph(uint64_t key, Glyph& glyph);
+
+    TextureAtlas* addTexture();
+
+    /**
+     * Evicts the least recently used glyphs and packs the others into new pages.
+     */
+    void compact();
+
+    /**
+     * Renders requested glyphs, called on a worker thread.
+     */
+    void renderGlyphs(const std::vector<uint64_t>& keys, Task* task);
+
+    FontFace* acquireWorkerFace();
+
+    void releaseWorkerFace(FontFace* face);
+
     std::string _path;
     Style _style;
     unsigned int _size;
@@ -49,7 +170,78 @@ private:
 
     std::vector<FontFace*> fontFaces;
 
-    std::map<uint64_t, Glyph> glyphCache;
+    std::unordered_map<uint64_t, CachedGlyph> glyphCache;
+
+    int _maxTextureCount;
+    uint64_t _frame;
+    unsigned int _generation;       // Incremented when the pages are rebuilt.
+    bool _compactPending;
+    bool _async;
+
+    std::vector<uint64_t> _requests;                // Glyphs to send to the workers at the next flush.
+    std::unordered_set<uint64_t> _pendingKeys;      // Glyphs being rendered.
+    std::unordered_set<uint64_t> _missingKeys;      // Characters the font does not have.
+
+    ThreadPool* _threadPool;
+    std::mutex _mutex;
+    std::vector<FontFace*> _workerFaces;            // Faces are not thread safe, one per busy worker.
+    std::vector<FontFace*> _freeWorkerFaces;        // Guarded by _mutex.
+    std::vector<std::pair<uint64_t, Glyph> > _rendered; // Rendered glyphs, imgData is NULL if missing. Guarded by _mutex.
+    std::vector<uint64_t> _canceledKeys;            // Glyphs dropped by a canceled task, requested again if needed. Guarded by _mutex.
+};
+
+/**
+ * A text laid out with a font, shared by the FontLayouts showing the same text.
+ *
+ * Holds the wrapped lines and the position and texture coordinates of every glyph, so
+ * drawing a static text does not walk the string nor query the font cache again. The
+ * glyphs are laid out again when the font cache pages are rebuilt, or while some of
+ * them are still being rendered.
+ */
+class TextRun : public Refable
+{
+    friend class Font;
+    friend class FontLayout;
+public:
+    struct Line
+    {
+        int pos;
+        int len;
+    };
+
+    /**
+     * A glyph quad, relative to the top left of the text.
+     */
+    struct Quad
+    {
+        float x;
+        float y;
+        float width;
+        float height;
+        float u1;
+        float v1;
+        float u2;
+        float v2;
+        int page;       // Font cache page.
+        int line;
+    };
+
+private:
+    std::string text;                   // Source UTF-8 text.
+    std::wstring unicode;
+    std::vector<Line> lines;
+    std::vector<unsigned int> lineWidths;
+    unsigned int measuredHeight;        // Height measured for the lines, without the line count.
+    unsigned int fontSize;
+    int wrapWidth;
+    unsigned int lineHeight;
+
+    std::vector<Quad> quads;
+    bool laidOut;                       // False if not laid out, or if some glyphs were being rendered.
+    unsigned int generation;            // Font cache generation of the quads.
+    uint64_t version;                   // Unique to each layout of any run, 0 before the first.
+
+    TextRun() : measuredHeight(0), fontSize(0), wrapWidth(-1), lineHeight(0), laidOut(false), generation(0), version(0) {}
 };
 
 /**
@@ -57,6 +249,7 @@ private:
  */
 class Font : public Refable, public BatchableLayer
 {
+    friend class FontLayout;
     //friend class Bundle;
     //friend class Text;
     //friend class TextBox;
@@ -109,6 +302,8 @@ public:
     /**
      * Draws the specified text in a solid color, with a scaling factor.
      *
+     * The text is laid out again at each call, use a FontLayout for text drawn every frame.
+     *
      * @param text The text to draw.
      * @param x The viewport x position to draw text at.
      * @param y The viewport y position to draw text at.
@@ -129,6 +324,11 @@ public:
     void finish(RenderInfo* view);
     void finalDraw(RenderInfo* view);
 
+    /**
+     * @see BatchableLayer::finishInto
+     */
+    bool finishInto(MultiSpriteBatch* batch);
+
     virtual void setProjectionMatrix(const Matrix& matrix);
     virtual bool isStarted() const;
 
@@ -201,12 +401,43 @@ private:
     Font& operator=(const Font&);
 
     bool drawChar(int c, FontInfo &fontInfo, Glyph &glyph, float x, float y, const Vector4& color, int previous, const Rectangle* clip);
+
+    /**
+     * Gets the quad of a glyph drawn at the given position.
+     *
+     * The page of the quad is -1 if the glyph is being rendered.
+     */
+    bool getGlyphQuad(int c, FontInfo& fontInfo, Glyph& glyph, float x, float y, int previous, TextRun::Quad& quad);
+
+    /**
+     * Gets the batch of a font cache page, for 2D text.
+     */
+    SpriteBatch* getDrawer(int page);
+
+    /**
+     * Lays out the glyphs of a text run, if they were not laid out or the font cache pages were rebuilt.
+     */
+    void layoutRun(TextRun* run);
+
+    /**
+     * Finds a text run laid out with the same parameters.
+     */
+    TextRun* findTextRun(const std::string& key);
+
+    void addTextRun(const std::string& key, TextRun* run);
+
+    void clearTextRuns();
     bool drawChar3D(int c, FontInfo& fontInfo, Glyph& glyph, const Vector3& centerPosition, const Vector3& right, const Vector3& forward, const float scale,
         const Vector4& color, int previous);
 
 
     void lazyStart();
 
+    /**
+     * Drops the batches of the font cache pages that were rebuilt.
+     */
+    void syncDrawers();
+
     bool _isStarted;
     float _spacing;
     int _outline;
@@ -215,11 +446,21 @@ private:
 
     std::vector<SpriteBatch*> fontDrawers;
     SPtr<FontCache> _fontCache;
+    unsigned int _cacheGeneration;
+
+    std::unordered_map<std::string, TextRun*> _textRuns;
 
     ShaderProgram* shaderProgram;
 };
 
 
+/**
+ * Lays out a text in lines, optionally wrapped at a width.
+ *
+ * The layout is a TextRun shared through the font with the other layouts of the same
+ * text, and the vertices of the last draw are kept, so a text that does not change is
+ * drawn by copying them into the font batches.
+ */
 class FontLayout {
 
 public:
@@ -246,20 +487,24 @@ public:
     };
 
 private:
-    std::wstring unicode;
+    typedef TextRun::Line Line;
 
-    struct Line {
-        int pos;
-        int len;
+    struct PageVertices {
+        std::vector<SpriteBatch::SpriteVertex> vertices;
+        std::vector<unsigned short> indices;
     };
 
-    std::vector<Line> lines;
-
-    int wrapWidth = -1;
-
     Font* font = NULL;
-    unsigned int fontSize = 0;
-    unsigned int lineHeight = 0;
+    SPtr<TextRun> run;
+
+    // Vertices of the last draw, reused while the run and the draw parameters are the same.
+    std::vector<PageVertices> pages;
+    uint64_t vertexVersion = 0;
+    Rectangle vertexArea;
+    Vector4 vertexColor;
+    Rectangle vertexClip;
+    bool vertexHasClip = false;
+    int vertexAlign = 0;
 
 public:
     static std::string enumToString(const std::string& enumName, int value);
@@ -279,6 +524,7 @@ private:
     bool nextLine(Line& line);
     void doWrap();
     int lenAtWrap(Line line);
+    void updateVertices(const Rectangle& area, const Vector4& color, Justify align, const Rectangle* clip);
 };
 
 }
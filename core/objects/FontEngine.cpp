@@ -8,102 +8,121 @@
 #include "FontEngine.h"
 #include "platform/Toolkit.h"
 
-extern "C" {
-#include "3rd/edtaa3func.h"
-}
-
 using namespace mgp;
 
-unsigned char* createDistanceFields(unsigned char* _img, unsigned int _width, unsigned int _height)
+// Squared distance of the pixels with no known distance yet.
+#define SDF_INF 1e20f
+
+/**
+ * One dimensional squared Euclidean distance transform (Felzenszwalb and Huttenlocher).
+ * Transforms f in place, v, z and d are scratch buffers of n, n+1 and n elements.
+ */
+static void edt1d(float* f, int offset, int stride, int n, int* v, float* z, float* d)
 {
-    int16_t* xdist = (int16_t*)malloc(_width * _height * sizeof(int16_t));
-    int16_t* ydist = (int16_t*)malloc(_width * _height * sizeof(int16_t));
-    double* gx = (double*)calloc(_width * _height, sizeof(double));
-    double* gy = (double*)calloc(_width * _height, sizeof(double));
-    double* data = (double*)calloc(_width * _height, sizeof(double));
-    double* outside = (double*)calloc(_width * _height, sizeof(double));
-    double* inside = (double*)calloc(_width * _height, sizeof(double));
-    uint32_t ii;
-
-    // Convert img into double (data)
-    double img_min = 255, img_max = -255;
-    for (ii = 0; ii < _width * _height; ++ii)
+    v[0] = 0;
+    z[0] = -SDF_INF;
+    z[1] = SDF_INF;
+    for (int q = 1, k = 0; q < n; ++q)
     {
-        double v = _img[ii];
-        data[ii] = v;
-        if (v > img_max)
-        {
-            img_max = v;
-        }
-
-        if (v < img_min)
+        float fq = f[offset + q * stride];
+        float s;
+        do
         {
-            img_min = v;
-        }
+            int r = v[k];
+            s = (fq - f[offset + r * stride] + (float)q * q - (float)r * r) / (2.0f * (q - r));
+        } while (s <= z[k] && --k >= 0);
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_INF;
     }
-
-    // Rescale image levels between 0 and 1
-    for (ii = 0; ii < _width * _height; ++ii)
+    for (int q = 0, k = 0; q < n; ++q)
     {
-        data[ii] = (_img[ii] - img_min) / (img_max - img_min);
+        while (z[k + 1] < q)
+            ++k;
+        int r = v[k];
+        d[q] = f[offset + r * stride] + (float)(q - r) * (q - r);
     }
-
-    // Compute outside = edtaa3(bitmap); % Transform background (0's)
-    computegradient(data, _width, _height, gx, gy);
-    edtaa3(data, gx, gy, _width, _height, xdist, ydist, outside);
-    for (ii = 0; ii < _width * _height; ++ii)
+    for (int q = 0; q < n; ++q)
     {
-        if (outside[ii] < 0)
-        {
-            outside[ii] = 0.0;
-        }
+        f[offset + q * stride] = d[q];
     }
+}
 
-    // Compute inside = edtaa3(1-bitmap); % Transform foreground (1's)
-    memset(gx, 0, sizeof(double) * _width * _height);
-    memset(gy, 0, sizeof(double) * _width * _height);
-    for (ii = 0; ii < _width * _height; ++ii)
+/**
+ * Two dimensional squared distance transform, as a column pass then a row pass.
+ */
+static void edt2d(float* grid, int width, int height, int* v, float* z, float* d)
+{
+    for (int x = 0; x < width; ++x)
+    {
+        edt1d(grid, x, width, height, v, z, d);
+    }
+    for (int y = 0; y < height; ++y)
     {
-        data[ii] = 1.0 - data[ii];
+        edt1d(grid, y * width, 1, width, v, z, d);
     }
+}
 
-    computegradient(data, _width, _height, gx, gy);
-    edtaa3(data, gx, gy, _width, _height, xdist, ydist, inside);
-    for (ii = 0; ii < _width * _height; ++ii)
+unsigned char* createDistanceFields(unsigned char* _img, unsigned int _width, unsigned int _height)
+{
+    unsigned int size = _width * _height;
+    unsigned int maxSide = _width > _height ? _width : _height;
+    float* outside = (float*)malloc(size * sizeof(float));
+    float* inside = (float*)malloc(size * sizeof(float));
+    int* v = (int*)malloc(maxSide * sizeof(int));
+    float* z = (float*)malloc((maxSide + 1) * sizeof(float));
+    float* d = (float*)malloc(maxSide * sizeof(float));
+
+    // Seed the squared distances to the glyph (outside) and to the background (inside).
+    // Partially covered pixels give a sub-pixel distance to the edge.
+    for (unsigned int i = 0; i < size; ++i)
     {
-        if (inside[ii] < 0)
+        float a = _img[i] / 255.0f;
+        if (a <= 0.0f)
+        {
+            outside[i] = SDF_INF;
+            inside[i] = 0;
+        }
+        else if (a >= 1.0f)
         {
-            inside[ii] = 0.0;
+            outside[i] = 0;
+            inside[i] = SDF_INF;
+        }
+        else
+        {
+            float e = 0.5f - a;
+            outside[i] = e > 0 ? e * e : 0;
+            inside[i] = e < 0 ? e * e : 0;
         }
     }
 
-    // distmap = outside - inside; % Bipolar distance field
-    uint8_t* out = (uint8_t*)malloc(_width * _height * sizeof(uint8_t));
-    for (ii = 0; ii < _width * _height; ++ii)
-    {
-        outside[ii] -= inside[ii];
-        outside[ii] = 128 + outside[ii] * 16;
+    edt2d(outside, _width, _height, v, z, d);
+    edt2d(inside, _width, _height, v, z, d);
 
-        if (outside[ii] < 0)
+    // Bipolar distance field, same mapping as the shader cutoff expects
+    uint8_t* out = (uint8_t*)malloc(size * sizeof(uint8_t));
+    for (unsigned int i = 0; i < size; ++i)
+    {
+        float dist = sqrtf(outside[i]) - sqrtf(inside[i]);
+        float value = 128 + dist * 16;
+        if (value < 0)
         {
-            outside[ii] = 0;
+            value = 0;
         }
-
-        if (outside[ii] > 255)
+        if (value > 255)
         {
-            outside[ii] = 255;
+            value = 255;
         }
-
-        out[ii] = 255 - (uint8_t)outside[ii];
+        out[i] = 255 - (uint8_t)value;
     }
 
-    free(xdist);
-    free(ydist);
-    free(gx);
-    free(gy);
-    free(data);
     free(outside);
     free(inside);
+    free(v);
+    free(z);
+    free(d);
     return out;
 }
 
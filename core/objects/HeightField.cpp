@@ -3,11 +3,16 @@
 #include "material/Image.h"
 #include "base/FileSystem.h"
 
+#include <float.h>
+
+// Cells per side of the finest pyramid nodes.
+#define HEIGHTFIELD_PYRAMID_BLOCK 4
+
 namespace mgp
 {
 
 HeightField::HeightField(unsigned int columns, unsigned int rows)
-    : _array(NULL), _cols(columns), _rows(rows), _heightMin(0), _heightMax(1.0f)
+    : _array(NULL), _quantized(NULL), _cols(columns), _rows(rows), _heightMin(0), _heightMax(1.0f)
 {
     _array = new float[columns * rows];
 }
@@ -15,6 +20,7 @@ HeightField::HeightField(unsigned int columns, unsigned int rows)
 HeightField::~HeightField()
 {
     SAFE_DELETE_ARRAY(_array);
+    SAFE_DELETE_ARRAY(_quantized);
 }
 
 UPtr<HeightField> HeightField::create(unsigned int columns, unsigned int rows, float heightMin, float heightMax)
@@ -165,6 +171,13 @@ UPtr<HeightField> HeightField::create(const char* path, unsigned int width, unsi
 
 void HeightField::save(const char* path) {
     UPtr<Stream> stream = FileSystem::open(path, FileSystem::WRITE);
+    if (_quantized) {
+        for (unsigned int i = 0, n = _rows * _cols; i < n; ++i) {
+            stream->writeUInt16(_quantized[i]);
+        }
+        stream->close();
+        return;
+    }
     float* end = _array + (_rows * _cols);
     float* it = _array;
     float d = (1.0/(_heightMax - _heightMin)) * 65535.0;
@@ -199,15 +212,15 @@ float HeightField::getHeight(float column, float row) const
 
     if (x2 >= _cols && y2 >= _rows)
     {
-        return _array[x1 + y1 * _cols];
+        return getSample(x1, y1);
     }
     else if (x2 >= _cols)
     {
-        return _array[x1 + y1 * _cols] * yFactorI + _array[x1 + y2 * _cols] * yFactor;
+        return getSample(x1, y1) * yFactorI + getSample(x1, y2) * yFactor;
     }
     else if (y2 >= _rows)
     {
-        return _array[x1 + y1 * _cols] * xFactorI + _array[x2 + y1 * _cols] * xFactor;
+        return getSample(x1, y1) * xFactorI + getSample(x2, y1) * xFactor;
     }
     else
     {
@@ -215,9 +228,288 @@ float HeightField::getHeight(float column, float row) const
         float b = xFactorI * yFactor;
         float c = xFactor * yFactor;
         float d = xFactor * yFactorI;
-        return _array[x1 + y1 * _cols] * a + _array[x1 + y2 * _cols] * b +
-            _array[x2 + y2 * _cols] * c + _array[x2 + y1 * _cols] * d;
+        return getSample(x1, y1) * a + getSample(x1, y2) * b +
+            getSample(x2, y2) * c + getSample(x2, y1) * d;
+    }
+}
+
+float HeightField::getSample(unsigned int column, unsigned int row) const
+{
+    unsigned int i = column + row * _cols;
+    if (_array)
+        return _array[i];
+    return _heightMin + _quantized[i] * ((_heightMax - _heightMin) / 65535.0f);
+}
+
+void HeightField::quantize()
+{
+    if (_quantized)
+        return;
+
+    unsigned int count = _cols * _rows;
+    float scale = _heightMax > _heightMin ? 65535.0f / (_heightMax - _heightMin) : 0;
+    _quantized = new uint16_t[count];
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float value = (_array[i] - _heightMin) * scale + 0.5f;
+        _quantized[i] = (uint16_t)(value < 0 ? 0 : (value > 65535.0f ? 65535.0f : value));
+    }
+    SAFE_DELETE_ARRAY(_array);
+
+    // Bounds changed by the rounding.
+    _pyramid.clear();
+}
+
+void HeightField::updatePyramid()
+{
+    _pyramid.clear();
+    if (_cols < 2 || _rows < 2)
+        return;
+
+    // Finest level, min/max of the samples of each block of cells.
+    PyramidLevel level;
+    level.width = (_cols - 1 + HEIGHTFIELD_PYRAMID_BLOCK - 1) / HEIGHTFIELD_PYRAMID_BLOCK;
+    level.height = (_rows - 1 + HEIGHTFIELD_PYRAMID_BLOCK - 1) / HEIGHTFIELD_PYRAMID_BLOCK;
+    level.minMax.resize(level.width * level.height * 2);
+    for (unsigned int bz = 0; bz < level.height; ++bz)
+    {
+        unsigned int z1 = bz * HEIGHTFIELD_PYRAMID_BLOCK;
+        unsigned int z2 = std::min(z1 + HEIGHTFIELD_PYRAMID_BLOCK, _rows - 1);
+        for (unsigned int bx = 0; bx < level.width; ++bx)
+        {
+            unsigned int x1 = bx * HEIGHTFIELD_PYRAMID_BLOCK;
+            unsigned int x2 = std::min(x1 + HEIGHTFIELD_PYRAMID_BLOCK, _cols - 1);
+            float minHeight = FLT_MAX;
+            float maxHeight = -FLT_MAX;
+            for (unsigned int z = z1; z <= z2; ++z)
+            {
+                for (unsigned int x = x1; x <= x2; ++x)
+                {
+                    float h = getSample(x, z);
+                    minHeight = std::min(minHeight, h);
+                    maxHeight = std::max(maxHeight, h);
+                }
+            }
+            level.minMax[(bz * level.width + bx) * 2] = minHeight;
+            level.minMax[(bz * level.width + bx) * 2 + 1] = maxHeight;
+        }
+    }
+    _pyramid.push_back(std::move(level));
+
+    // Coarser levels until a single node covers the heightfield.
+    while (_pyramid.back().width > 1 || _pyramid.back().height > 1)
+    {
+        const PyramidLevel& child = _pyramid.back();
+        PyramidLevel parent;
+        parent.width = (child.width + 1) / 2;
+        parent.height = (child.height + 1) / 2;
+        parent.minMax.resize(parent.width * parent.height * 2);
+        for (unsigned int z = 0; z < parent.height; ++z)
+        {
+            for (unsigned int x = 0; x < parent.width; ++x)
+            {
+                float minHeight = FLT_MAX;
+                float maxHeight = -FLT_MAX;
+                for (unsigned int j = z * 2; j < std::min(z * 2 + 2, child.height); ++j)
+                {
+                    for (unsigned int i = x * 2; i < std::min(x * 2 + 2, child.width); ++i)
+                    {
+                        minHeight = std::min(minHeight, child.minMax[(j * child.width + i) * 2]);
+                        maxHeight = std::max(maxHeight, child.minMax[(j * child.width + i) * 2 + 1]);
+                    }
+                }
+                parent.minMax[(z * parent.width + x) * 2] = minHeight;
+                parent.minMax[(z * parent.width + x) * 2 + 1] = maxHeight;
+            }
+        }
+        _pyramid.push_back(std::move(parent));
+    }
+}
+
+/**
+ * Clips the ray parameter range [t1, t2] to a slab.
+ *
+ * @script{ignore}
+ */
+static bool clipSlab(Float origin, Float direction, Float min, Float max, Float* t1, Float* t2)
+{
+    if (direction == 0)
+        return origin >= min && origin <= max;
+
+    Float a = (min - origin) / direction;
+    Float b = (max - origin) / direction;
+    if (a > b)
+        std::swap(a, b);
+    if (a > *t1)
+        *t1 = a;
+    if (b < *t2)
+        *t2 = b;
+    return *t1 <= *t2;
+}
+
+/**
+ * Two-sided ray triangle intersection.
+ *
+ * @script{ignore}
+ */
+static bool intersectTriangle(const Vector3& origin, const Vector3& direction, const Vector3& a, const Vector3& b, const Vector3& c, Float* t)
+{
+    Vector3 e1 = b - a;
+    Vector3 e2 = c - a;
+    Vector3 p;
+    Vector3::cross(direction, e2, &p);
+    Float det = e1.dot(p);
+    if (fabs(det) < 1e-12)
+        return false;
+
+    Float invDet = 1.0 / det;
+    Vector3 s = origin - a;
+    Float u = s.dot(p) * invDet;
+    if (u < 0 || u > 1)
+        return false;
+
+    Vector3 q;
+    Vector3::cross(s, e1, &q);
+    Float v = direction.dot(q) * invDet;
+    if (v < 0 || u + v > 1)
+        return false;
+
+    *t = e2.dot(q) * invDet;
+    return *t >= 0;
+}
+
+void HeightField::raycastNode(int level, unsigned int x, unsigned int z, RayState& ray) const
+{
+    const PyramidLevel& node = _pyramid[level];
+    unsigned int span = HEIGHTFIELD_PYRAMID_BLOCK << level;
+    unsigned int x1 = x * span;
+    unsigned int z1 = z * span;
+    unsigned int x2 = std::min(x1 + span, _cols - 1);
+    unsigned int z2 = std::min(z1 + span, _rows - 1);
+
+    Float t1 = 0;
+    Float t2 = ray.distance;
+    if (!clipSlab(ray.origin.x, ray.direction.x, x1, x2, &t1, &t2) ||
+        !clipSlab(ray.origin.z, ray.direction.z, z1, z2, &t1, &t2) ||
+        !clipSlab(ray.origin.y, ray.direction.y, node.minMax[(z * node.width + x) * 2], node.minMax[(z * node.width + x) * 2 + 1], &t1, &t2))
+    {
+        return;
+    }
+
+    if (level == 0)
+    {
+        raycastCells(x1, z1, x2, z2, ray);
+        return;
+    }
+
+    // Visit the children front to back, and stop once one is past the nearest hit.
+    const PyramidLevel& child = _pyramid[level - 1];
+    unsigned int childX[4];
+    unsigned int childZ[4];
+    Float childT[4];
+    int count = 0;
+    unsigned int childSpan = span / 2;
+    for (unsigned int j = z * 2; j < std::min(z * 2 + 2, child.height); ++j)
+    {
+        for (unsigned int i = x * 2; i < std::min(x * 2 + 2, child.width); ++i)
+        {
+            Float c1 = 0;
+            Float c2 = ray.distance;
+            if (!clipSlab(ray.origin.x, ray.direction.x, i * childSpan, std::min((i + 1) * childSpan, _cols - 1), &c1, &c2) ||
+                !clipSlab(ray.origin.z, ray.direction.z, j * childSpan, std::min((j + 1) * childSpan, _rows - 1), &c1, &c2))
+            {
+                continue;
+            }
+            int k = count++;
+            for (; k > 0 && childT[k - 1] > c1; --k)
+            {
+                childX[k] = childX[k - 1];
+                childZ[k] = childZ[k - 1];
+                childT[k] = childT[k - 1];
+            }
+            childX[k] = i;
+            childZ[k] = j;
+            childT[k] = c1;
+        }
+    }
+    for (int i = 0; i < count && childT[i] <= ray.distance; ++i)
+    {
+        raycastNode(level - 1, childX[i], childZ[i], ray);
+    }
+}
+
+void HeightField::raycastCells(unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2, RayState& ray) const
+{
+    for (unsigned int z = z1; z < z2; ++z)
+    {
+        for (unsigned int x = x1; x < x2; ++x)
+        {
+            Vector3 a(x, getSample(x, z), z);
+            Vector3 b(x + 1, getSample(x + 1, z), z);
+            Vector3 c(x + 1, getSample(x + 1, z + 1), z + 1);
+            Vector3 d(x, getSample(x, z + 1), z + 1);
+
+            // Both triangles are wound to face up.
+            Float t;
+            if (intersectTriangle(ray.origin, ray.direction, a, d, c, &t) && t <= ray.distance)
+            {
+                ray.distance = t;
+                ray.hit = true;
+                Vector3::cross(d - a, c - a, &ray.normal);
+            }
+            if (intersectTriangle(ray.origin, ray.direction, a, c, b, &t) && t <= ray.distance)
+            {
+                ray.distance = t;
+                ray.hit = true;
+                Vector3::cross(c - a, b - a, &ray.normal);
+            }
+        }
+    }
+}
+
+bool HeightField::raycast(const Vector3& origin, const Vector3& direction, float maxDistance, float* distance, Vector3* normal) const
+{
+    if (_pyramid.empty())
+    {
+        const_cast<HeightField*>(this)->updatePyramid();
+        if (_pyramid.empty())
+            return false;
+    }
+
+    RayState ray;
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.distance = maxDistance;
+    ray.hit = false;
+    raycastNode(_pyramid.size() - 1, 0, 0, ray);
+    if (!ray.hit)
+        return false;
+
+    if (distance)
+        *distance = ray.distance;
+    if (normal)
+    {
+        *normal = ray.normal;
+        normal->normalize();
+    }
+    return true;
+}
+
+unsigned int HeightField::raycast(unsigned int count, const Vector3* origins, const Vector3* directions, float maxDistance, float* distances) const
+{
+    GP_ASSERT(origins);
+    GP_ASSERT(directions);
+    GP_ASSERT(distances);
+
+    unsigned int hits = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (raycast(origins[i], directions[i], maxDistance, &distances[i]))
+            ++hits;
+        else
+            distances[i] = -1;
     }
+    return hits;
 }
 
 unsigned int HeightField::getColumnCount() const
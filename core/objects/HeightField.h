@@ -3,6 +3,7 @@
 
 #include "base/Ref.h"
 #include "base/Ptr.h"
+#include "math/Vector3.h"
 
 namespace mgp
 {
@@ -13,6 +14,9 @@ namespace mgp
      * Heightfields can be used to construct both Terrain objects as well as PhysicsCollisionShape
      * heightfield defintions, which are used in heightfield rigid body creation. Heightfields can
      * be populated manually, or loaded from images and RAW files.
+     *
+     * Ray queries use a min/max pyramid of the heights, built on the first query, so
+     * picking and line of sight tests stay fast on very large heightfields.
      */
     class HeightField : public Refable
     {
@@ -81,7 +85,7 @@ namespace mgp
          * The array is packed in row major order, meaning that the data is aligned in rows,
          * from top left to bottom right.
          *
-         * @return The underlying height array.
+         * @return The underlying height array, NULL if the heights are quantized.
          */
         float* getArray() const;
 
@@ -116,6 +120,60 @@ namespace mgp
          */
         unsigned int getColumnCount() const;
 
+        /**
+         * Intersects a ray with the heightfield surface.
+         *
+         * The ray is in heightfield space: x is the column, z is the row and y is the height.
+         * Each cell is split in two triangles along its (column, row) to (column+1, row+1) diagonal.
+         *
+         * The min/max pyramid skips the areas the ray passes above or below, so the cost
+         * grows with the log of the heightfield size instead of the number of cells crossed.
+         * For a line of sight test, pass the segment as the direction and a max distance of 1.
+         *
+         * @param origin The ray origin.
+         * @param direction The ray direction, it does not need to be normalized.
+         * @param maxDistance Intersections beyond origin + direction * maxDistance are ignored.
+         * @param distance Set to the ray parameter of the nearest intersection.
+         * @param normal Set to the normal of the intersected triangle, in heightfield space, if not NULL.
+         *
+         * @return true if the ray intersects the heightfield.
+         */
+        bool raycast(const Vector3& origin, const Vector3& direction, float maxDistance, float* distance, Vector3* normal = NULL) const;
+
+        /**
+         * Intersects a batch of rays with the heightfield, see raycast().
+         *
+         * @param count The number of rays.
+         * @param origins The ray origins.
+         * @param directions The ray directions.
+         * @param maxDistance Intersections beyond origin + direction * maxDistance are ignored.
+         * @param distances Receives the ray parameter of each intersection, or -1 if the ray does not intersect.
+         *
+         * @return The number of rays that intersect the heightfield.
+         */
+        unsigned int raycast(unsigned int count, const Vector3* origins, const Vector3* directions, float maxDistance, float* distances) const;
+
+        /**
+         * Rebuilds the min/max pyramid used by raycast().
+         *
+         * The pyramid is built by the first raycast, call this after modifying the heights
+         * through getArray(). Call it before querying from several threads.
+         */
+        void updatePyramid();
+
+        /**
+         * Stores the heights as 16-bit values between the min and max height, which halves the memory.
+         *
+         * getArray() returns NULL afterwards, so a quantized heightfield is only suitable
+         * for getHeight() and raycast() queries, not to create a Terrain or a physics shape.
+         */
+        void quantize();
+
+        /**
+         * Determines if the heights are stored as 16-bit values.
+         */
+        bool isQuantized() const { return _quantized != NULL; }
+
         float getHeightMin() const {
             return _heightMin;
         }
@@ -128,6 +186,25 @@ namespace mgp
         }
     private:
 
+        /**
+         * A level of the min/max pyramid.
+         */
+        struct PyramidLevel
+        {
+            unsigned int width;
+            unsigned int height;
+            std::vector<float> minMax;  // Min and max height of each node, interleaved.
+        };
+
+        struct RayState
+        {
+            Vector3 origin;
+            Vector3 direction;
+            float distance;             // Nearest intersection found so far.
+            Vector3 normal;
+            bool hit;
+        };
+
         /**
          * Hidden constructor.
          */
@@ -143,7 +220,16 @@ namespace mgp
          */
         static UPtr<HeightField> create(const char* path, unsigned int width, unsigned int height, float heightMin, float heightMax);
 
+        float getSample(unsigned int column, unsigned int row) const;
+
+        void raycastNode(int level, unsigned int x, unsigned int z, RayState& ray) const;
+
+        void raycastCells(unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2, RayState& ray) const;
+
         float* _array;
+        uint16_t* _quantized;
+        mutable std::vector<PyramidLevel> _pyramid;
+
         unsigned int _cols;
         unsigned int _rows;
         float _heightMin;
@@ -0,0 +1,241 @@
+#include "base/Base.h"
+#include "MultiSpriteBatch.h"
+#include "material/Material.h"
+#include "material/MaterialParameter.h"
+#include "scene/Renderer.h"
+
+// Default size of a draw call, in sprites
+#define MULTI_SPRITE_BATCH_DEFAULT_SIZE 1024
+
+// Multi texture sprite shaders
+#define MULTI_SPRITE_VSH "res/shaders/sprite_multi.vert"
+#define MULTI_SPRITE_FSH "res/shaders/sprite_multi.frag"
+
+// Index format of the draw calls
+#define MULTI_SPRITE_MAX_VERTEX_COUNT 0xFFFF
+
+namespace mgp
+{
+
+MultiSpriteBatch::MultiSpriteBatch()
+    : _effect(NULL), _initialCapacity(0), _current(-1), _open(false), _started(false), _view(NULL), _drawCallCount(0)
+{
+}
+
+MultiSpriteBatch::~MultiSpriteBatch()
+{
+    for (Segment& segment : _segments)
+    {
+        SAFE_RELEASE(segment.batch);
+    }
+    _segments.clear();
+    SAFE_RELEASE(_effect);
+}
+
+UPtr<MultiSpriteBatch> MultiSpriteBatch::create(unsigned int initialCapacity)
+{
+    char defines[32];
+    snprintf(defines, sizeof(defines), "SLOT_COUNT %d", SLOT_COUNT);
+    ShaderProgram* effect = ShaderProgram::createFromFile(MULTI_SPRITE_VSH, MULTI_SPRITE_FSH, defines);
+    if (effect == NULL)
+    {
+        GP_ERROR("Unable to load multi texture sprite effect.");
+        return UPtr<MultiSpriteBatch>(NULL);
+    }
+
+    MultiSpriteBatch* batch = new MultiSpriteBatch();
+    batch->_effect = effect;
+    batch->_initialCapacity = initialCapacity > 0 ? initialCapacity : MULTI_SPRITE_BATCH_DEFAULT_SIZE;
+
+    Renderer* game = Renderer::cur();
+    Matrix::createOrthographicOffCenter(0, game->getDpWidth(), game->getDpHeight(), 0, 0, 1, &batch->_projectionMatrix);
+    return UPtr<MultiSpriteBatch>(batch);
+}
+
+void MultiSpriteBatch::start(RenderInfo* view)
+{
+    _started = true;
+    _view = view;
+    _current = -1;
+    _open = false;
+    _drawCallCount = 0;
+}
+
+bool MultiSpriteBatch::isStarted() const
+{
+    return _started;
+}
+
+MultiSpriteBatch::Segment* MultiSpriteBatch::beginSegment()
+{
+    ++_current;
+    if (_current == (int)_segments.size())
+    {
+        UPtr<Material> material = Material::create(_effect);
+        material->getStateBlock()->setBlend(true);
+        material->getStateBlock()->setBlendSrc(StateBlock::BLEND_SRC_ALPHA);
+        material->getStateBlock()->setBlendDst(StateBlock::BLEND_ONE_MINUS_SRC_ALPHA);
+        material->getStateBlock()->setDepthTest(false);
+        material->getStateBlock()->setCullFace(false);
+
+        // Same as the Font batches
+        material->getParameter("u_cutoff")->setVector2(Vector2(0.50, 0.1));
+        material->getParameter("u_outline")->setVector2(Vector2(0.45, 0.1));
+        material->getParameter("u_projectionMatrix")->bindValue(this, &MultiSpriteBatch::getProjectionMatrix);
+
+        VertexFormat::Element vertexElements[] =
+        {
+            VertexFormat::Element(VertexFormat::POSITION, 3),
+            VertexFormat::Element(VertexFormat::TEXCOORD0, 2),
+            VertexFormat::Element(VertexFormat::COLOR, 4),
+            VertexFormat::Element(VertexFormat::TEXCOORD1, 2)
+        };
+        VertexFormat vertexFormat(vertexElements, 4);
+
+        Segment segment;
+        segment.batch = MeshBatch::create(vertexFormat, Mesh::TRIANGLE_STRIP, std::move(material), Mesh::INDEX16, _initialCapacity).take();
+        segment.batch->setRenderLayer(Drawable::Overlay);
+        _segments.push_back(segment);
+    }
+
+    Segment* segment = &_segments[_current];
+    segment->textures.clear();
+    segment->batch->start();
+    _open = true;
+    return segment;
+}
+
+int MultiSpriteBatch::bindTexture(Texture* texture)
+{
+    Segment* segment = _open ? &_segments[_current] : beginSegment();
+    for (size_t i = 0; i < segment->textures.size(); ++i)
+    {
+        if (segment->textures[i] == texture)
+            return (int)i;
+    }
+
+    if (segment->textures.size() == SLOT_COUNT)
+    {
+        flush();
+        segment = beginSegment();
+    }
+    segment->textures.push_back(texture);
+    return segment->textures.size() - 1;
+}
+
+void MultiSpriteBatch::add(SpriteBatch* sprites, Mode mode)
+{
+    GP_ASSERT(_started);
+    GP_ASSERT(sprites->_sampler);
+
+    Mesh* mesh = sprites->_batch->getMesh();
+    unsigned int vertexCount = mesh->getVertexCount();
+    unsigned int indexCount = mesh->getIndexCount();
+    if (vertexCount == 0 || indexCount == 0)
+        return;
+    if (vertexCount > MULTI_SPRITE_MAX_VERTEX_COUNT)
+    {
+        GP_WARN("Sprite batch too large to be merged: %u vertices.", vertexCount);
+        return;
+    }
+
+    int slot = bindTexture(sprites->_sampler);
+    Segment* segment = &_segments[_current];
+    if (segment->batch->getMesh()->getVertexCount() + vertexCount > MULTI_SPRITE_MAX_VERTEX_COUNT)
+    {
+        // Out of indices, continue in a new draw call with the same texture
+        flush();
+        segment = beginSegment();
+        segment->textures.push_back(sprites->_sampler);
+        slot = 0;
+    }
+
+    _vertices.resize(vertexCount);
+    const SpriteBatch::SpriteVertex* src = (const SpriteBatch::SpriteVertex*)mesh->getVertexBuffer()->_data;
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        Vertex& v = _vertices[i];
+        v.sprite = src[i];
+        v.slot = slot;
+        v.mode = mode;
+    }
+    segment->batch->add(_vertices.data(), vertexCount, mesh->getIndexBuffer()->_data, indexCount);
+}
+
+void MultiSpriteBatch::flush()
+{
+    if (!_open)
+        return;
+
+    Segment& segment = _segments[_current];
+    if (segment.batch->getBatchSize() == 0)
+    {
+        // Nothing to draw, keep filling it
+        return;
+    }
+    segment.batch->finish();
+    _open = false;
+
+    // Unused slots still need a valid texture
+    const Texture* textures[SLOT_COUNT];
+    for (int i = 0; i < SLOT_COUNT; ++i)
+    {
+        textures[i] = (size_t)i < segment.textures.size() ? segment.textures[i] : segment.textures[0];
+    }
+    segment.batch->getMaterial()->getParameter("u_textures")->setSamplerArray(textures, SLOT_COUNT, true);
+
+    drawSegment(segment, _view);
+    ++_drawCallCount;
+}
+
+void MultiSpriteBatch::drawSegment(Segment& segment, RenderInfo* view)
+{
+    size_t i = 0;
+    if (view) {
+        i = view->_drawList.size();
+    }
+
+    segment.batch->draw(view, NULL);
+
+    if (view) {
+        for (; i < view->_drawList.size(); ++i) {
+            view->_drawList[i]._renderLayer = segment.batch->getRenderLayer();
+        }
+    }
+}
+
+void MultiSpriteBatch::finish()
+{
+    flush();
+    if (_open)
+    {
+        _segments[_current].batch->finish();
+        _open = false;
+    }
+    _started = false;
+    _view = NULL;
+}
+
+unsigned int MultiSpriteBatch::replay(RenderInfo* view)
+{
+    GP_ASSERT(!_started);
+
+    // Segments are filled in order, the drawn ones are the first ones
+    for (unsigned int i = 0; i < _drawCallCount; ++i)
+    {
+        drawSegment(_segments[i], view);
+    }
+    return _drawCallCount;
+}
+
+void MultiSpriteBatch::setProjectionMatrix(const Matrix& matrix)
+{
+    _projectionMatrix = matrix;
+}
+
+const Matrix& MultiSpriteBatch::getProjectionMatrix() const
+{
+    return _projectionMatrix;
+}
+
+}
@@ -0,0 +1,137 @@
+#ifndef MULTISPRITEBATCH_H_
+#define MULTISPRITEBATCH_H_
+
+#include "SpriteBatch.h"
+
+namespace mgp
+{
+
+/**
+ * Draws the sprites of several SpriteBatches and fonts with as few draw calls as possible.
+ *
+ * Up to SLOT_COUNT textures are bound at once, and every vertex carries the slot of its
+ * texture and its draw mode, so image quads and distance field glyphs are merged into one
+ * stream. A new draw call is only started when the slots are full.
+ *
+ * Used by the Form to flush the batches of its controls.
+ */
+class MultiSpriteBatch
+{
+public:
+
+    /**
+     * Number of textures bound by a draw call.
+     */
+    static const int SLOT_COUNT = 8;
+
+    /**
+     * How the texture of a sprite is used.
+     */
+    enum Mode
+    {
+        IMAGE = 0,                      // Texture color multiplied by the vertex color.
+        DISTANCE_FIELD = 1,             // Distance field glyph.
+        DISTANCE_FIELD_OUTLINE = 2      // Distance field glyph with an outline.
+    };
+
+    /**
+     * Vertex structure of the batch.
+     */
+    struct Vertex
+    {
+        SpriteBatch::SpriteVertex sprite;
+        /** Texture slot */
+        float slot;
+        /** Draw mode */
+        float mode;
+    };
+
+    static UPtr<MultiSpriteBatch> create(unsigned int initialCapacity = 0);
+
+    ~MultiSpriteBatch();
+
+    /**
+     * Starts batching, the draw calls of the previous frame are reused.
+     *
+     * @param view The view the draw calls are added to, NULL to draw immediately.
+     */
+    void start(RenderInfo* view);
+
+    bool isStarted() const;
+
+    /**
+     * Appends the sprites of a finished SpriteBatch.
+     *
+     * @param batch The sprites, drawn with the batch texture.
+     * @param mode How the texture is used.
+     */
+    void add(SpriteBatch* batch, Mode mode);
+
+    /**
+     * Draws the sprites added since the last flush, later sprites use a new draw call.
+     *
+     * Called before drawing something else, to keep the order.
+     */
+    void flush();
+
+    /**
+     * Draws the remaining sprites.
+     */
+    void finish();
+
+    /**
+     * Draws again the draw calls of the last start()/finish(), without adding the sprites.
+     *
+     * Used to redraw a form that did not change. Only valid if nothing was drawn between
+     * the flushes of the last frame.
+     *
+     * @param view The view the draw calls are added to, NULL to draw immediately.
+     *
+     * @return The number of draw calls.
+     */
+    unsigned int replay(RenderInfo* view);
+
+    void setProjectionMatrix(const Matrix& matrix);
+
+    const Matrix& getProjectionMatrix() const;
+
+    /**
+     * Gets the number of draw calls since start().
+     */
+    unsigned int getDrawCallCount() const { return _drawCallCount; }
+
+private:
+
+    struct Segment
+    {
+        MeshBatch* batch;
+        std::vector<Texture*> textures;
+    };
+
+    MultiSpriteBatch();
+
+    MultiSpriteBatch(const MultiSpriteBatch& copy);
+
+    MultiSpriteBatch& operator=(const MultiSpriteBatch&);
+
+    Segment* beginSegment();
+
+    int bindTexture(Texture* texture);
+
+    void drawSegment(Segment& segment, RenderInfo* view);
+
+    ShaderProgram* _effect;
+    unsigned int _initialCapacity;
+    std::vector<Segment> _segments;     // Draw calls, kept from frame to frame.
+    int _current;                       // Last used segment, -1 if none.
+    bool _open;                         // Whether the current segment can take more sprites.
+    bool _started;
+    RenderInfo* _view;
+    unsigned int _drawCallCount;
+    std::vector<Vertex> _vertices;      // Conversion buffer.
+    mutable Matrix _projectionMatrix;
+};
+
+}
+
+#endif
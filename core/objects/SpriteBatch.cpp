@@ -4,6 +4,7 @@
 #include "material/Material.h"
 #include "material/MaterialParameter.h"
 #include "scene/Renderer.h"
+#include "MultiSpriteBatch.h"
 
 // Default size of a newly created sprite batch
 #define SPRITE_BATCH_DEFAULT_SIZE 128
@@ -440,6 +441,16 @@ void SpriteBatch::finish(RenderInfo* view)
     }
 }
 
+bool SpriteBatch::finishInto(MultiSpriteBatch* batch)
+{
+    if (_customEffect || !_sampler)
+        return false;
+
+    _batch->finish();
+    batch->add(this, MultiSpriteBatch::IMAGE);
+    return true;
+}
+
 StateBlock* SpriteBatch::getStateBlock() const
 {
     return _batch->getMaterial()->getStateBlock();
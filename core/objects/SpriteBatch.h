@@ -11,6 +11,9 @@
 
 namespace mgp
 {
+
+class MultiSpriteBatch;
+
 /**
 * use in Form for keep z order
 */
@@ -21,6 +24,14 @@ public:
     virtual void finish(RenderInfo* view) = 0;
     virtual void setProjectionMatrix(const Matrix& matrix) = 0;
     virtual bool isStarted() const = 0;
+
+    /**
+     * Finishes batching and adds the sprites to a multi texture batch instead of drawing them.
+     *
+     * @return false if the layer can not be merged, it must then be finished as usual.
+     */
+    virtual bool finishInto(MultiSpriteBatch* batch) { return false; }
+
     virtual ~BatchableLayer() {}
 };
 
@@ -38,6 +49,8 @@ class SpriteBatch : public BatchableLayer
 {
     friend class Bundle;
     friend class Font;
+    friend class FontLayout;
+    friend class MultiSpriteBatch;
     friend class Text;
 
 public:
@@ -229,6 +242,13 @@ public:
      */
     void finish(RenderInfo* view);
 
+    /**
+     * @see BatchableLayer::finishInto
+     *
+     * Only batches using the default effect are merged.
+     */
+    bool finishInto(MultiSpriteBatch* batch);
+
     /**
      * Gets the texture sampler. 
      *
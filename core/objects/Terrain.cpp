@@ -6,6 +6,10 @@
 #include "base/Resource.h"
 #include "scene/AssetManager.h"
 #include "base/StringUtil.h"
+#include "material/MaterialParameter.h"
+
+#include <sstream>
+#include <float.h>
 
 namespace mgp
 {
@@ -28,7 +32,7 @@ static const unsigned int DIRTY_FLAG_INVERSE_WORLD = 1;
 static float getDefaultHeight(unsigned int width, unsigned int height);
 
 Terrain::Terrain() : Drawable(),
-    _heightfield(NULL), _normalMap(NULL), _flags(FRUSTUM_CULLING | LEVEL_OF_DETAIL),
+    _heightfield(NULL), _quadtree(NULL), _normalMap(NULL), _flags(FRUSTUM_CULLING | LEVEL_OF_DETAIL),
     _dirtyFlags(DIRTY_FLAG_INVERSE_WORLD)
 {
     setLightMask(1);
@@ -40,6 +44,7 @@ Terrain::~Terrain()
     {
         SAFE_DELETE(_patches[i]);
     }
+    SAFE_DELETE(_quadtree);
     SAFE_RELEASE(_normalMap);
     //SAFE_RELEASE(_heightfield);
 
@@ -57,6 +62,16 @@ Terrain::~Terrain()
 }
 
 void Terrain::initPatchs() {
+    if (_tiledHeightfield.get())
+    {
+        // Streamed terrains have no patches, bound the whole heightfield.
+        float halfWidth = (_tiledHeightfield->getColumnCount() - 1) * 0.5f;
+        float halfHeight = (_tiledHeightfield->getRowCount() - 1) * 0.5f;
+        _boundingBox.set(-halfWidth * _localScale.x, _tiledHeightfield->getHeightMin() * _localScale.y, -halfHeight * _localScale.z,
+            halfWidth * _localScale.x, _tiledHeightfield->getHeightMax() * _localScale.y, halfHeight * _localScale.z);
+        return;
+    }
+
     Terrain* terrain = this;
     // Store reference to bounding box (it is calculated and updated from TerrainPatch)
     BoundingBox& bounds = terrain->_boundingBox;
@@ -98,6 +113,7 @@ UPtr<Terrain> Terrain::create(UPtr<HeightField> heightfield, const Vector3& scal
     const char* normalMapPath)
 {
     GP_ASSERT(heightfield.get());
+    GP_ASSERT(!heightfield->isQuantized());
 
     // Create the terrain object
     Terrain* terrain = new Terrain();
@@ -122,6 +138,30 @@ UPtr<Terrain> Terrain::create(UPtr<HeightField> heightfield, const Vector3& scal
     return UPtr<Terrain>(terrain);
 }
 
+UPtr<Terrain> Terrain::create(UPtr<TiledHeightField> heightfield, const Vector3& scale, const char* normalMapPath)
+{
+    GP_ASSERT(heightfield.get());
+
+    Terrain* terrain = new Terrain();
+    terrain->_tiledHeightfield = std::move(heightfield);
+    terrain->_localScale.set(scale);
+    terrain->_patchSize = terrain->_tiledHeightfield->getTileSize();
+    terrain->_detailLevels = terrain->_tiledHeightfield->getLevelCount();
+    terrain->_skirtScale = 0;
+    terrain->_flags |= QUADTREE;
+
+    if (normalMapPath)
+    {
+        terrain->_normalMap = Texture::create(normalMapPath, true).take();
+        terrain->_normalMap->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+        GP_ASSERT( terrain->_normalMap->getType() == Texture::TEXTURE_2D );
+    }
+
+    terrain->initPatchs();
+
+    return UPtr<Terrain>(terrain);
+}
+
 void Terrain::setNode(Node* node)
 {
 
@@ -140,6 +180,8 @@ void Terrain::setNode(Node* node)
         {
             _patches[i]->updateNodeBindings();
         }
+        if (_quadtree)
+            _quadtree->updateNodeBindings();
         _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD;
     }
 }
@@ -250,6 +292,8 @@ void Terrain::setFlag(Flags flag, bool on)
         {
             _patches[i]->setMaterialDirty();
         }
+        if (_quadtree)
+            _quadtree->setMaterialDirty();
     }
 }
 
@@ -258,6 +302,8 @@ void Terrain::setMaterialDirty() {
     {
         _patches[i]->setMaterialDirty();
     }
+    if (_quadtree)
+        _quadtree->setMaterialDirty();
 }
 
 unsigned int Terrain::getPatchCount() const
@@ -270,6 +316,13 @@ TerrainPatch* Terrain::getPatch(unsigned int index) const
     return _patches[index];
 }
 
+TerrainQuadtree* Terrain::getQuadtree()
+{
+    if (!_quadtree)
+        _quadtree = new TerrainQuadtree(this, _patchSize);
+    return _quadtree;
+}
+
 const BoundingBox& Terrain::getBoundingBox() const
 {
     return _boundingBox;
@@ -278,8 +331,8 @@ const BoundingBox& Terrain::getBoundingBox() const
 float Terrain::getHeight(float x, float z) const
 {
     // Calculate the correct x, z position relative to the heightfield data.
-    float cols = _heightfield->getColumnCount();
-    float rows = _heightfield->getRowCount();
+    float cols = _tiledHeightfield.get() ? _tiledHeightfield->getColumnCount() : _heightfield->getColumnCount();
+    float rows = _tiledHeightfield.get() ? _tiledHeightfield->getRowCount() : _heightfield->getRowCount();
 
     GP_ASSERT(cols > 0);
     GP_ASSERT(rows > 0);
@@ -291,8 +344,8 @@ float Terrain::getHeight(float x, float z) const
     x = v.x + (cols - 1) * 0.5f;
     z = v.z + (rows - 1) * 0.5f;
 
-    // Get the unscaled height value from the HeightField
-    float height = _heightfield->getHeight(x, z);
+    // Get the unscaled height value from the HeightField, or the finest resident tile
+    float height = _tiledHeightfield.get() ? _tiledHeightfield->getHeight(x, z) : _heightfield->getHeight(x, z);
 
     // Apply world scale to the height value
     if (_node)
@@ -308,8 +361,40 @@ float Terrain::getHeight(float x, float z) const
     return height;
 }
 
+bool Terrain::doRaycast(RayQuery& query)
+{
+    if (!_heightfield.get())
+        return false;
+
+    // From terrain local space, where the local scale is applied, to heightfield space.
+    Vector3 offset((_heightfield->getColumnCount() - 1) * 0.5f, 0, (_heightfield->getRowCount() - 1) * 0.5f);
+    const Vector3& origin = query.ray.getOrigin();
+    const Vector3& direction = query.ray.getDirection();
+    Vector3 localOrigin(origin.x / _localScale.x + offset.x, origin.y / _localScale.y, origin.z / _localScale.z + offset.z);
+    Vector3 localDirection(direction.x / _localScale.x, direction.y / _localScale.y, direction.z / _localScale.z);
+
+    // The direction keeps its length in local space, so the ray parameter is the local distance.
+    float maxDistance = query.minDistance == Ray::INTERSECTS_NONE ? FLT_MAX : (float)query.minDistance;
+    float distance;
+    Vector3 normal;
+    if (!_heightfield->raycast(localOrigin, localDirection, maxDistance, &distance, query.getNormal ? &normal : NULL))
+        return false;
+
+    query.minDistance = distance;
+    query.target = origin + direction * distance;
+    if (query.getNormal)
+    {
+        query.normal.set(normal.x / _localScale.x, normal.y / _localScale.y, normal.z / _localScale.z);
+        query.normal.normalize();
+    }
+    return true;
+}
+
 unsigned int Terrain::draw(RenderInfo* view)
 {
+    if (isFlagSet(QUADTREE) || _tiledHeightfield.get())
+        return getQuadtree()->draw(view);
+
     size_t visibleCount = 0;
     for (size_t i = 0, count = _patches.size(); i < count; ++i)
     {
@@ -319,6 +404,8 @@ unsigned int Terrain::draw(RenderInfo* view)
 }
 
 void Terrain::update(float elapsedTime) {
+    if (_tiledHeightfield.get())
+        _tiledHeightfield->update();
 
 }
 
@@ -327,6 +414,8 @@ void Terrain::resetMesh() {
     {
         _patches[i]->resetMesh();
     }
+    if (_quadtree)
+        _quadtree->resetMesh();
 }
 
 UPtr<Drawable> Terrain::clone(NodeCloneContext& context)
@@ -400,6 +489,54 @@ int Terrain::addSampler(Texture* texture)
     return (int)(_samplers.size() - 1);
 }
 
+std::string Terrain::getShaderDefines() const
+{
+    // Build preprocessor string to be passed to the terrain shader.
+    // NOTE: I make heavy use of preprocessor definitions, rather than passing in arrays and doing
+    // non-constant array access in the shader. This is due to the fact that non-constant array access
+    // in GLES is very slow on some hardware.
+    std::ostringstream defines;
+    defines << "NO_SPECULAR;";
+    defines << "LAYER_COUNT " << _layers.size();
+    defines << ";SAMPLER_COUNT " << _samplers.size();
+
+    if (_normalMap)
+        defines << ";NORMAL_MAP";
+
+    // Append texture and blend index constants to preprocessor definition.
+    // We need to do this since older versions of GLSL only allow sampler arrays
+    // to be indexed using constant expressions (otherwise we could simply pass an
+    // array of indices to use for sampler lookup).
+    int layerIndex = 0;
+    for (auto itr = _layers.begin(); itr != _layers.end(); ++itr, ++layerIndex)
+    {
+        Terrain::Layer* layer = *itr;
+
+        defines << ";TEXTURE_INDEX_" << layerIndex << " " << layer->textureIndex;
+        defines << ";TEXTURE_REPEAT_" << layerIndex << " vec2(" << layer->textureRepeat.x << "," << layer->textureRepeat.y << ")";
+
+        if (layerIndex > 0)
+        {
+            defines << ";BLEND_INDEX_" << layerIndex << " " << layer->blendIndex;
+            defines << ";BLEND_CHANNEL_" << layerIndex << " " << layer->blendChannel;
+        }
+    }
+
+    return defines.str();
+}
+
+void Terrain::bindMaterial(Material* material) const
+{
+    if (_layers.size() > 0) {
+        MaterialParameter* parameter = material->getParameter("u_surfaceLayerMaps");
+        parameter->setSamplerArray((const Texture**)&_samplers[0], (unsigned int)_samplers.size());
+    }
+    if (_normalMap) {
+        MaterialParameter* parameter = material->getParameter("u_normalMap");
+        parameter->setSampler(_normalMap);
+    }
+}
+
 Terrain::Layer::Layer() :
     textureIndex(-1), blendIndex(-1)
 {
@@ -439,6 +576,12 @@ static float normalizedHeightPacked(float r, float g, float b)
 
 void Terrain::generateNormalMap()
 {
+    if (!_heightfield.get())
+    {
+        GP_WARN("Can not generate the normal map of a streamed terrain.");
+        return;
+    }
+
     // Load the input heightmap
     int _resolutionX = _heightfield->getColumnCount();
     int _resolutionY = _heightfield->getRowCount();
@@ -614,23 +757,29 @@ std::string Terrain::getClassName() {
 void Terrain::onSerialize(Serializer* serializer) {
     serializer->writeInt("renderLayer", this->getRenderLayer(), 0);
     serializer->writeInt("lightMask", this->getLightMask(), 0);
+    serializer->writeInt("flags", _flags, FRUSTUM_CULLING | LEVEL_OF_DETAIL);
 
     serializer->writeInt("patchSize", _patchSize, -1);
     serializer->writeInt("detailLevels", _detailLevels, -1);
     serializer->writeFloat("skirtScale", _skirtScale, 0);
     serializer->writeVector("localScale", _localScale, Vector3::one());
 
-    serializer->writeInt("heightfield_row", _heightfield->getRowCount(), 0);
-    serializer->writeInt("heightfield_column", _heightfield->getColumnCount(), 0);
-    serializer->writeFloat("heightfield_min", _heightfield->getHeightMin(), 0);
-    serializer->writeFloat("heightfield_max", _heightfield->getHeightMax(), 0);
+    if (_tiledHeightfield.get()) {
+        serializer->writeString("tiled_heightfield_path", _tiledHeightfield->getPath().c_str(), "");
+    }
+    else {
+        serializer->writeInt("heightfield_row", _heightfield->getRowCount(), 0);
+        serializer->writeInt("heightfield_column", _heightfield->getColumnCount(), 0);
+        serializer->writeFloat("heightfield_min", _heightfield->getHeightMin(), 0);
+        serializer->writeFloat("heightfield_max", _heightfield->getHeightMax(), 0);
     
-    if (_heightfield->getPath().size() == 0) {
-        _heightfield->getPath() = "image/" + Resource::genId() + ".raw";
-        std::string file = AssetManager::getInstance()->getPath() + "/" + _heightfield->getPath();
-        _heightfield->save(file.c_str());
+        if (_heightfield->getPath().size() == 0) {
+            _heightfield->getPath() = "image/" + Resource::genId() + ".raw";
+            std::string file = AssetManager::getInstance()->getPath() + "/" + _heightfield->getPath();
+            _heightfield->save(file.c_str());
+        }
+        serializer->writeString("heightfield_path", _heightfield->getPath().c_str(), "");
     }
-    serializer->writeString("heightfield_path", _heightfield->getPath().c_str(), "");
 
     serializer->writeObject("normalMap", _normalMap);
 
@@ -650,22 +799,30 @@ void Terrain::onSerialize(Serializer* serializer) {
 void Terrain::onDeserialize(Serializer* serializer) {
     setRenderLayer((Drawable::RenderLayer)serializer->readInt("renderLayer", 0));
     setLightMask(serializer->readInt("lightMask", 0));
+    _flags = serializer->readInt("flags", FRUSTUM_CULLING | LEVEL_OF_DETAIL);
 
     _patchSize = serializer->readInt("patchSize", -1);
     _detailLevels = serializer->readInt("detailLevels", -1);
     _skirtScale = serializer->readFloat("skirtScale", 0);
     _localScale = serializer->readVector("localScale", Vector3::one());
 
-    int heightfield_row = serializer->readInt("heightfield_row", 0);
-    int heightfield_column = serializer->readInt("heightfield_column", 0);
-    float heightfield_min = serializer->readFloat("heightfield_min", 0);
-    float heightfield_max = serializer->readFloat("heightfield_max", 0);
-    std::string heightfield_path;
-    serializer->readString("heightfield_path", heightfield_path, "");
-    if (StringUtil::startsWith(heightfield_path, "image/")) {
-        heightfield_path = AssetManager::getInstance()->getPath() + "/" + heightfield_path;
+    std::string tiled_path;
+    serializer->readString("tiled_heightfield_path", tiled_path, "");
+    if (tiled_path.size()) {
+        _tiledHeightfield = TiledHeightField::create(tiled_path.c_str());
+    }
+    else {
+        int heightfield_row = serializer->readInt("heightfield_row", 0);
+        int heightfield_column = serializer->readInt("heightfield_column", 0);
+        float heightfield_min = serializer->readFloat("heightfield_min", 0);
+        float heightfield_max = serializer->readFloat("heightfield_max", 0);
+        std::string heightfield_path;
+        serializer->readString("heightfield_path", heightfield_path, "");
+        if (StringUtil::startsWith(heightfield_path, "image/")) {
+            heightfield_path = AssetManager::getInstance()->getPath() + "/" + heightfield_path;
+        }
+        _heightfield = HeightField::createFromRAW(heightfield_path.c_str(), heightfield_row, heightfield_column, heightfield_min, heightfield_max);
     }
-    _heightfield = HeightField::createFromRAW(heightfield_path.c_str(), heightfield_row, heightfield_column, heightfield_min, heightfield_max);
 
     auto normalMap = serializer->readObject("normalMap");
     if (normalMap.get()) {
@@ -5,14 +5,17 @@
 #include "scene/Drawable.h"
 #include "scene/Transform.h"
 #include "HeightField.h"
+#include "TiledHeightField.h"
 #include "material/Texture.h"
 #include "math/BoundingBox.h"
 #include "TerrainPatch.h"
+#include "TerrainQuadtree.h"
 
 namespace mgp
 {
 
 class TerrainPatch;
+class TerrainQuadtree;
 class TerrainAutoBindingResolver;
 
 /**
@@ -78,11 +81,19 @@ class TerrainAutoBindingResolver;
  * approaches. In practice, the skirts are often not noticeable at all unless the LOD variation
  * is very large and the terrain is excessively hilly on the edge of a LOD transition.
  *
+ * For very large heightfields, the QUADTREE flag renders the terrain with a TerrainQuadtree
+ * instead of patches. It uses hierarchical culling and continuous LOD with vertex morphing,
+ * which needs no skirts and has no popping.
+ *
+ * Heightfields too large for memory can be streamed from disk by creating the terrain from
+ * a TiledHeightField. Tiles are loaded asynchronously as the LOD selection needs them.
+ *
  * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-Terrain
  */
 class Terrain : public Drawable, public Transform::Listener, public Serializable
 {
     friend class TerrainPatch;
+    friend class TerrainQuadtree;
 public:
 
     /**
@@ -110,7 +121,15 @@ public:
          * "detailLevels" was not set to a value greater than 1 in the terrain
          * properties file at creation time.
          */
-        LEVEL_OF_DETAIL = 8
+        LEVEL_OF_DETAIL = 8,
+
+        /**
+         * Renders with a TerrainQuadtree instead of patches (off by default).
+         *
+         * The quadtree uses a single grid mesh instanced per node and samples the
+         * heights in the vertex shader. The patchSize is used as the grid size.
+         */
+        QUADTREE = 16
     };
 
     /**
@@ -142,6 +161,22 @@ public:
     static UPtr<Terrain> create(UPtr<HeightField> heightfield, const Vector3& scale = Vector3::one(), unsigned int patchSize = 32,
         unsigned int detailLevels = 3, float skirtScale = 0.01f, const char* normalMapPath = NULL);
 
+    /**
+     * Creates a terrain streamed from a tiled heightfield.
+     *
+     * The terrain is rendered with a TerrainQuadtree, using the tile size as the grid size.
+     * Patches, layer vertex generation and normal map generation are not available, since
+     * the heightfield is never fully loaded.
+     *
+     * @param heightfield The tiled heightfield.
+     * @param scale A scale to apply to the terrain along the X, Y and Z axes.
+     * @param normalMapPath Path to an object-space normal map to use for terrain lighting, instead of vertex normals.
+     *
+     * @return A new Terrain.
+     * @script{create}
+     */
+    static UPtr<Terrain> create(UPtr<TiledHeightField> heightfield, const Vector3& scale = Vector3::one(), const char* normalMapPath = NULL);
+
     /**
      * Determines if the specified terrain flag is currently set.
      */
@@ -168,6 +203,11 @@ public:
      */
     TerrainPatch* getPatch(unsigned int index) const;
 
+    /**
+     * Gets the quadtree used when the QUADTREE flag is set, it is created on demand.
+     */
+    TerrainQuadtree* getQuadtree();
+
     /**
      * Gets the local bounding box for this terrain.
      *
@@ -240,8 +280,22 @@ public:
 
     void update(float elapsedTime);
 
+    /**
+     * Intersects the ray with the heightfield, using its min/max pyramid instead of the patch triangles.
+     *
+     * Streamed terrains are not pickable.
+     *
+     * @see Drawable#doRaycast
+     */
+    bool doRaycast(RayQuery& query) override;
+
     HeightField* getHeightfield() { return _heightfield.get(); }
 
+    /**
+     * Gets the streamed heightfield, NULL if the terrain was created from a HeightField.
+     */
+    TiledHeightField* getTiledHeightfield() { return _tiledHeightfield.get(); }
+
     const Vector3& getLocalScale() {
         return _localScale;
     }
@@ -324,6 +378,16 @@ private:
     //BoundingBox getBoundingBox(bool worldSpace) const;
     int addSampler(Texture* texture);
 
+    /**
+     * Returns the shader defines of the layers, shared by the patch and quadtree materials.
+     */
+    std::string getShaderDefines() const;
+
+    /**
+     * Binds the layer samplers and the normal map to the material.
+     */
+    void bindMaterial(Material* material) const;
+
     struct Layer : public Serializable
     {
         Layer();
@@ -353,8 +417,10 @@ private:
 
     //std::string _materialPath;
     UPtr<HeightField> _heightfield;
+    UPtr<TiledHeightField> _tiledHeightfield;
     Vector3 _localScale;
     std::vector<TerrainPatch*> _patches;
+    TerrainQuadtree* _quadtree;
     Texture* _normalMap;
     unsigned int _flags;
     mutable Matrix _inverseWorldMatrix;
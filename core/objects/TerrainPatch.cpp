@@ -388,48 +388,16 @@ void TerrainPatch::initLOD(int dlevel)
 
 std::string TerrainPatch::passCreated(Material* pass)
 {
-    // Build preprocessor string to be passed to the terrain shader.
-    // NOTE: I make heavy use of preprocessor definitions, rather than passing in arrays and doing
-    // non-constant array access in the shader. This is due to the fact that non-constant array access
-    // in GLES is very slow on some hardware.
-    std::ostringstream defines;
-    defines << "NO_SPECULAR;";
-    defines << "LAYER_COUNT " << _terrain->_layers.size();
-    defines << ";SAMPLER_COUNT " << _terrain->_samplers.size();
+    std::string defines = _terrain->getShaderDefines();
 
     if (_terrain->isFlagSet(Terrain::DEBUG_PATCHES))
     {
-        defines << ";DEBUG_PATCHES";
+        defines += ";DEBUG_PATCHES";
         pass->getParameter("u_row")->setFloat(_row);
         pass->getParameter("u_column")->setFloat(_column);
     }
 
-    if (_terrain->_normalMap)
-        defines << ";NORMAL_MAP";
-
-    // Append texture and blend index constants to preprocessor definition.
-    // We need to do this since older versions of GLSL only allow sampler arrays
-    // to be indexed using constant expressions (otherwise we could simply pass an
-    // array of indices to use for sampler lookup).
-    //
-    // Rebuild layer lists while we're at it.
-    //
-    int layerIndex = 0;
-    for (auto itr = _terrain->_layers.begin(); itr != _terrain->_layers.end(); ++itr, ++layerIndex)
-    {
-        Terrain::Layer* layer = *itr;
-
-        defines << ";TEXTURE_INDEX_" << layerIndex << " " << layer->textureIndex;
-        defines << ";TEXTURE_REPEAT_" << layerIndex << " vec2(" << layer->textureRepeat.x << "," << layer->textureRepeat.y << ")";
-
-        if (layerIndex > 0)
-        {
-            defines << ";BLEND_INDEX_" << layerIndex << " " << layer->blendIndex;
-            defines << ";BLEND_CHANNEL_" << layerIndex << " " << layer->blendChannel;
-        }
-    }
-
-    return defines.str();
+    return defines;
 }
 
 bool TerrainPatch::updateLevelMaterial(int level) {
@@ -443,14 +411,7 @@ bool TerrainPatch::updateLevelMaterial(int level) {
 
     //material->setNodeBinding(_terrain->_node);
 
-    if (_terrain->_layers.size() > 0) {
-        MaterialParameter* parameter = material->getParameter("u_surfaceLayerMaps");
-        parameter->setSamplerArray((const Texture**)&_terrain->_samplers[0], (unsigned int)_terrain->_samplers.size());
-    }
-    if (_terrain && _terrain->_normalMap) {
-        MaterialParameter* parameter = material->getParameter("u_normalMap");
-        parameter->setSampler(_terrain->_normalMap);
-    }
+    _terrain->bindMaterial(material.get());
     //TODO u_normalMatrix
 
     //material->getParameter("u_specularExponent")->setFloat(1.0);
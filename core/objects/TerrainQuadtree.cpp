@@ -0,0 +1,538 @@
+#include "base/Base.h"
+#include "TerrainQuadtree.h"
+#include "Terrain.h"
+#include "TiledHeightField.h"
+#include "scene/Mesh.h"
+#include "scene/Scene.h"
+#include "scene/Renderer.h"
+#include "material/MaterialParameter.h"
+
+#include <float.h>
+
+namespace mgp
+{
+
+// Instance data layout, stored as a mat4 per node:
+//   [0] origin x, [1] origin z, [2] height field samples per grid cell, [3] LOD level
+//   [4] morph start distance, [5] morph end distance
+//   [6] [7] atlas position of the node tile, when streaming
+#define QUADTREE_INSTANCE_SIZE 16
+
+// Morph range used when LOD is disabled, far enough to never morph.
+#define QUADTREE_NO_MORPH_DISTANCE 1e30f
+
+// Max number of views with their own instance buffer, such as the main view and the shadow pass.
+#define QUADTREE_INSTANCE_BUFFER_COUNT 4
+
+TerrainQuadtree::TerrainQuadtree(Terrain* terrain, unsigned int gridSize) :
+    _terrain(terrain), _tiles(terrain->_tiledHeightfield.get()), _gridSize(gridSize), _cols(0), _rows(0), _levelCount(0), _lodDistance(0), _morphRatio(0.3f),
+    _model(NULL), _heightMap(NULL), _materialDirty(true), _instanceCount(0), _instanceDrawCount(0)
+{
+    // Grid vertices are indexed with 16 bits.
+    if (_gridSize > 255)
+    {
+        GP_WARN("Terrain quadtree grid size %d exceeds the limit of 255.", _gridSize);
+        _gridSize = 255;
+    }
+    if (_gridSize < 2)
+        _gridSize = 2;
+    // Morphing moves odd vertices onto their even neighbours.
+    _gridSize &= ~1u;
+
+    build();
+    createMesh();
+}
+
+TerrainQuadtree::~TerrainQuadtree()
+{
+    SAFE_RELEASE(_model);
+    SAFE_RELEASE(_heightMap);
+    for (InstanceBuffer& buffer : _instanceBuffers)
+        Renderer::cur()->deleteBuffer(buffer.vbo);
+    _instanceBuffers.clear();
+}
+
+void TerrainQuadtree::setLodDistance(float distance)
+{
+    _lodDistance = distance;
+    build();
+}
+
+float TerrainQuadtree::getLodDistance() const
+{
+    return _lodDistance;
+}
+
+void TerrainQuadtree::setMorphRatio(float ratio)
+{
+    _morphRatio = MATH_CLAMP(ratio, 0.01f, 1.0f);
+}
+
+float TerrainQuadtree::getMorphRatio() const
+{
+    return _morphRatio;
+}
+
+unsigned int TerrainQuadtree::getLevelCount() const
+{
+    return _levelCount;
+}
+
+unsigned int TerrainQuadtree::getNodeCount() const
+{
+    return _nodes.size();
+}
+
+unsigned int TerrainQuadtree::getSelectedCount() const
+{
+    return _instanceCount;
+}
+
+void TerrainQuadtree::build()
+{
+    if (_tiles)
+    {
+        // Streamed nodes are the tiles of the pyramid, no node is built up front.
+        _gridSize = _tiles->getTileSize();
+        _cols = _tiles->getColumnCount();
+        _rows = _tiles->getRowCount();
+    }
+    else
+    {
+        _cols = _terrain->getHeightfield()->getColumnCount();
+        _rows = _terrain->getHeightfield()->getRowCount();
+    }
+    unsigned int extent = std::max(_cols, _rows) - 1;
+
+    // Leaf nodes map one grid cell to one height field sample.
+    _levelCount = 1;
+    unsigned int rootSize = _gridSize;
+    while (rootSize < extent)
+    {
+        rootSize *= 2;
+        ++_levelCount;
+    }
+
+    const Vector3& scale = _terrain->_localScale;
+    float range = _lodDistance;
+    if (range <= 0)
+        range = _gridSize * std::max(scale.x, scale.z) * 2.0f;
+    _ranges.resize(_levelCount);
+    for (unsigned int i = 0; i < _levelCount; ++i)
+    {
+        _ranges[i] = range;
+        range *= 2.0f;
+    }
+
+    _nodes.clear();
+    if (!_tiles)
+        buildNode(0, 0, rootSize, _levelCount - 1);
+}
+
+int TerrainQuadtree::buildNode(unsigned int x, unsigned int z, unsigned int size, int level)
+{
+    HeightField* heightfield = _terrain->getHeightfield();
+    unsigned int width = _cols;
+    unsigned int height = _rows;
+
+    int index = _nodes.size();
+    _nodes.push_back(QuadNode());
+
+    float minHeight = FLT_MAX;
+    float maxHeight = -FLT_MAX;
+    int children[4] = { -1, -1, -1, -1 };
+    if (level == 0)
+    {
+        const float* heights = heightfield->getArray();
+        unsigned int x2 = std::min(x + size, width - 1);
+        unsigned int z2 = std::min(z + size, height - 1);
+        for (unsigned int j = z; j <= z2; ++j)
+        {
+            const float* row = heights + j * width;
+            for (unsigned int i = x; i <= x2; ++i)
+            {
+                float h = row[i];
+                if (h < minHeight)
+                    minHeight = h;
+                if (h > maxHeight)
+                    maxHeight = h;
+            }
+        }
+    }
+    else
+    {
+        unsigned int half = size / 2;
+        for (int i = 0; i < 4; ++i)
+        {
+            unsigned int cx = x + (i & 1) * half;
+            unsigned int cz = z + (i >> 1) * half;
+            if (cx >= width - 1 || cz >= height - 1)
+                continue;
+
+            children[i] = buildNode(cx, cz, half, level - 1);
+            minHeight = std::min(minHeight, _nodes[children[i]].minHeight);
+            maxHeight = std::max(maxHeight, _nodes[children[i]].maxHeight);
+        }
+    }
+
+    QuadNode& node = _nodes[index];
+    node.x = x;
+    node.z = z;
+    node.size = size;
+    node.minHeight = minHeight;
+    node.maxHeight = maxHeight;
+    computeBounds(x, z, size, minHeight, maxHeight, &node.bounds);
+    for (int i = 0; i < 4; ++i)
+        node.children[i] = children[i];
+
+    return index;
+}
+
+void TerrainQuadtree::computeBounds(unsigned int x, unsigned int z, unsigned int size, float minHeight, float maxHeight, BoundingBox* dst) const
+{
+    // Compute local bounds the same way as the TerrainPatch vertices.
+    const Vector3& scale = _terrain->_localScale;
+    float halfWidth = (_cols - 1) * 0.5f;
+    float halfHeight = (_rows - 1) * 0.5f;
+    float x2 = (float)std::min(x + size, _cols - 1);
+    float z2 = (float)std::min(z + size, _rows - 1);
+    dst->set((x - halfWidth) * scale.x, minHeight * scale.y, (z - halfHeight) * scale.z,
+        (x2 - halfWidth) * scale.x, maxHeight * scale.y, (z2 - halfHeight) * scale.z);
+}
+
+void TerrainQuadtree::createMesh()
+{
+    // A flat grid with integer vertex positions in [0, gridSize], the vertex shader
+    // places it on the node and displaces it with the height map.
+    unsigned int side = _gridSize + 1;
+    unsigned int vertexCount = side * side;
+    float* vertices = new float[vertexCount * 3];
+    float* v = vertices;
+    for (unsigned int z = 0; z < side; ++z)
+    {
+        for (unsigned int x = 0; x < side; ++x)
+        {
+            v[0] = (float)x;
+            v[1] = 0;
+            v[2] = (float)z;
+            v += 3;
+        }
+    }
+
+    unsigned int indexCount = _gridSize * _gridSize * 6;
+    unsigned short* indices = new unsigned short[indexCount];
+    unsigned short* i = indices;
+    for (unsigned int z = 0; z < _gridSize; ++z)
+    {
+        for (unsigned int x = 0; x < _gridSize; ++x)
+        {
+            unsigned short i1 = z * side + x;
+            unsigned short i2 = i1 + side;
+
+            // Flip the diagonal every other cell so that the triangles are
+            // symmetric around the odd vertices that get morphed away.
+            if ((x + z) % 2 == 0)
+            {
+                *i++ = i1; *i++ = i2; *i++ = i2 + 1;
+                *i++ = i1; *i++ = i2 + 1; *i++ = i1 + 1;
+            }
+            else
+            {
+                *i++ = i1; *i++ = i2; *i++ = i1 + 1;
+                *i++ = i1 + 1; *i++ = i2; *i++ = i2 + 1;
+            }
+        }
+    }
+
+    VertexFormat::Element elements[] = { VertexFormat::Element(VertexFormat::POSITION, 3) };
+    UPtr<Mesh> mesh = Mesh::createMesh(VertexFormat(elements, 1), vertexCount);
+    mesh->getVertexBuffer()->setData((char*)vertices, vertexCount * 3 * sizeof(float));
+    mesh->setIndex(Mesh::TRIANGLES, indexCount);
+    mesh->getIndexBuffer()->setData((char*)indices, indexCount * sizeof(unsigned short));
+
+    // The grid is placed in the vertex shader, so use the bounds of the whole terrain.
+    const BoundingBox& bounds = _terrain->getBoundingBox();
+    Vector3 center = bounds.getCenter();
+    mesh->setBoundingBox(bounds);
+    mesh->setBoundingSphere(BoundingSphere(center, center.distance(bounds.max)));
+
+    SAFE_DELETE_ARRAY(vertices);
+    SAFE_DELETE_ARRAY(indices);
+
+    SAFE_RELEASE(_model);
+    UPtr<Model> model = Model::create(std::move(mesh));
+    model->setNode(_terrain->_node);
+    model->setLightMask(_terrain->getLightMask());
+    _model = model.take();
+    _materialDirty = true;
+}
+
+void TerrainQuadtree::resetMesh()
+{
+    build();
+    createMesh();
+    SAFE_RELEASE(_heightMap);
+}
+
+void TerrainQuadtree::setMaterialDirty()
+{
+    _materialDirty = true;
+}
+
+void TerrainQuadtree::updateNodeBindings()
+{
+    if (_model)
+        _model->setNode(_terrain->_node);
+}
+
+bool TerrainQuadtree::updateMaterial()
+{
+    if (_tiles)
+    {
+        // Uploads the tiles loaded since the last frame.
+        Texture* atlas = _tiles->getAtlas();
+        if (_heightMap != atlas)
+        {
+            SAFE_RELEASE(_heightMap);
+            _heightMap = atlas;
+            _heightMap->addRef();
+            _materialDirty = true;
+        }
+    }
+    else if (!_heightMap)
+    {
+        HeightField* heightfield = _terrain->getHeightfield();
+        _heightMap = Texture::create(Image::R32F, heightfield->getColumnCount(), heightfield->getRowCount(),
+            (const unsigned char*)heightfield->getArray(), false).take();
+        _heightMap->setFilterMode(Texture::NEAREST, Texture::NEAREST);
+        _heightMap->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+        _materialDirty = true;
+    }
+
+    if (!_materialDirty)
+        return true;
+    _materialDirty = false;
+
+    UPtr<Material> material = Material::create("res/shaders/terrain_cdlod.vert", "res/shaders/terrain.frag");
+    GP_ASSERT(material.get());
+    std::string defines = _terrain->getShaderDefines();
+    defines += ";CDLOD";
+    if (_tiles)
+        defines += ";STREAMING";
+    if (_terrain->isFlagSet(Terrain::DEBUG_PATCHES))
+        defines += ";DEBUG_PATCHES";
+    material->setShaderDefines(defines);
+    _terrain->bindMaterial(material.get());
+
+    material->getParameter("u_heightMap")->setSampler(_heightMap);
+    material->getParameter("u_heightMapSize")->setVector2(Vector2(_cols, _rows));
+    material->getParameter("u_terrainScale")->setVector3(_terrain->_localScale);
+    if (_tiles)
+        material->getParameter("u_tileSize")->setFloat(_gridSize);
+
+    _model->setMaterial(std::move(material));
+    return true;
+}
+
+unsigned int TerrainQuadtree::draw(RenderInfo* view)
+{
+    Camera* camera = view->camera;
+    if (!camera || (_nodes.empty() && !_tiles))
+        return 0;
+
+    if (!updateMaterial())
+        return 0;
+
+    // LOD is selected from the scene camera so that other passes (e.g. shadow maps)
+    // render the same geometry, culling uses the camera of the current pass.
+    Node* terrainNode = _terrain->_node;
+    Scene* scene = terrainNode ? terrainNode->getScene() : NULL;
+    Camera* lodCamera = scene && scene->getActiveCamera() ? scene->getActiveCamera() : camera;
+    if (!lodCamera->getNode())
+        return 0;
+
+    Matrix worldMatrix;
+    if (terrainNode)
+        worldMatrix = terrainNode->getWorldMatrix();
+    Matrix inverseWorld;
+    worldMatrix.invert(&inverseWorld);
+    _cameraPosition = lodCamera->getNode()->getTranslationWorld();
+    inverseWorld.transformPoint(&_cameraPosition);
+
+    bool lod = _terrain->isFlagSet(Terrain::LEVEL_OF_DETAIL);
+    _instanceData.clear();
+    _instanceCount = 0;
+    if (_tiles)
+    {
+        if (!selectTile(_levelCount - 1, 0, 0, worldMatrix, camera->getFrustum(), lod))
+            _tiles->request(_levelCount - 1, 0, 0);
+    }
+    else
+    {
+        selectNode(0, _levelCount - 1, worldMatrix, camera->getFrustum(), lod);
+    }
+    if (_instanceCount == 0)
+        return 0;
+
+    BufferHandle instanceVbo = getInstanceBuffer(view);
+    Renderer::cur()->setBufferData(instanceVbo, 0, 0, (const char*)_instanceData.data(), _instanceData.size() * sizeof(float), 1);
+
+    _model->getMaterial()->getParameter("u_cameraPosition")->setVector3(_cameraPosition);
+
+    size_t pos = view->_drawList.size();
+    _model->draw(view);
+    for (; pos < view->_drawList.size(); ++pos)
+    {
+        DrawCall& drawCall = view->_drawList[pos];
+        drawCall._instanceVbo = instanceVbo;
+        drawCall._instanceCount = _instanceCount;
+    }
+    return _instanceCount;
+}
+
+BufferHandle TerrainQuadtree::getInstanceBuffer(RenderInfo* view)
+{
+    ++_instanceDrawCount;
+    InstanceBuffer* found = NULL;
+    for (InstanceBuffer& buffer : _instanceBuffers)
+    {
+        if (buffer.view == view)
+        {
+            found = &buffer;
+            break;
+        }
+    }
+    if (!found && _instanceBuffers.size() < QUADTREE_INSTANCE_BUFFER_COUNT)
+    {
+        InstanceBuffer buffer = { view, Renderer::cur()->createBuffer(0), 0 };
+        _instanceBuffers.push_back(buffer);
+        found = &_instanceBuffers.back();
+    }
+    if (!found)
+    {
+        // A view no longer drawn, such as the pass of a removed light
+        found = &_instanceBuffers[0];
+        for (InstanceBuffer& buffer : _instanceBuffers)
+        {
+            if (buffer.lastUse < found->lastUse)
+                found = &buffer;
+        }
+        found->view = view;
+    }
+    found->lastUse = _instanceDrawCount;
+    return found->vbo;
+}
+
+void TerrainQuadtree::selectNode(int index, int level, const Matrix& worldMatrix, const Frustum& frustum, bool lod)
+{
+    const QuadNode& node = _nodes[index];
+
+    if (_terrain->isFlagSet(Terrain::FRUSTUM_CULLING))
+    {
+        BoundingBox worldBounds(node.bounds);
+        worldBounds.transform(worldMatrix);
+        if (!frustum.intersects(worldBounds))
+            return;
+    }
+
+    // Draw the node as a whole if it is out of the range of the finer level. Children
+    // out of their own range are drawn at their level, but fully morphed to this one.
+    if (level == 0 || (lod && !node.bounds.intersects(BoundingSphere(_cameraPosition, _ranges[level - 1]))))
+    {
+        addInstance(node.x, node.z, node.size, level, -1);
+        return;
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        if (node.children[i] != -1)
+            selectNode(node.children[i], level - 1, worldMatrix, frustum, lod);
+    }
+}
+
+bool TerrainQuadtree::selectTile(int level, unsigned int x, unsigned int z, const Matrix& worldMatrix, const Frustum& frustum, bool lod)
+{
+    const TiledHeightField::Tile* tile = _tiles->getTile(level, x, z);
+    if (!tile)
+        return false;
+
+    unsigned int size = _gridSize << level;
+    BoundingBox bounds;
+    computeBounds(x * size, z * size, size, tile->minHeight, tile->maxHeight, &bounds);
+
+    if (_terrain->isFlagSet(Terrain::FRUSTUM_CULLING))
+    {
+        BoundingBox worldBounds(bounds);
+        worldBounds.transform(worldMatrix);
+        if (!frustum.intersects(worldBounds))
+            return true;
+    }
+
+    if (level == 0 || (lod && !bounds.intersects(BoundingSphere(_cameraPosition, _ranges[level - 1]))))
+    {
+        addInstance(x * size, z * size, size, level, tile->slot);
+        return true;
+    }
+
+    // Only refine once all the children are resident, requesting the missing ones.
+    // Until then the node is drawn at its own level.
+    unsigned int countX = _tiles->getTileCountX(level - 1);
+    unsigned int countZ = _tiles->getTileCountZ(level - 1);
+    bool ready = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        unsigned int cx = x * 2 + (i & 1);
+        unsigned int cz = z * 2 + (i >> 1);
+        if (cx < countX && cz < countZ && !_tiles->getTile(level - 1, cx, cz))
+        {
+            _tiles->request(level - 1, cx, cz);
+            ready = false;
+        }
+    }
+    if (!ready)
+    {
+        addInstance(x * size, z * size, size, level, tile->slot);
+        return true;
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        unsigned int cx = x * 2 + (i & 1);
+        unsigned int cz = z * 2 + (i >> 1);
+        if (cx < countX && cz < countZ)
+            selectTile(level - 1, cx, cz, worldMatrix, frustum, lod);
+    }
+    return true;
+}
+
+void TerrainQuadtree::addInstance(unsigned int x, unsigned int z, unsigned int size, int level, int slot)
+{
+    float rangeEnd = _ranges[level];
+    float rangeStart = level > 0 ? _ranges[level - 1] : 0;
+    float morphStart = rangeEnd - (rangeEnd - rangeStart) * _morphRatio;
+    if (!_terrain->isFlagSet(Terrain::LEVEL_OF_DETAIL))
+    {
+        morphStart = QUADTREE_NO_MORPH_DISTANCE;
+        rangeEnd = QUADTREE_NO_MORPH_DISTANCE * 2;
+    }
+
+    size_t pos = _instanceData.size();
+    _instanceData.resize(pos + QUADTREE_INSTANCE_SIZE, 0.0f);
+    float* data = _instanceData.data() + pos;
+    data[0] = (float)x;
+    data[1] = (float)z;
+    data[2] = (float)size / _gridSize;
+    data[3] = (float)level;
+    data[4] = morphStart;
+    data[5] = rangeEnd;
+    if (slot != -1)
+    {
+        unsigned int ox, oy;
+        _tiles->getSlotOrigin(slot, &ox, &oy);
+        data[6] = (float)ox;
+        data[7] = (float)oy;
+    }
+    ++_instanceCount;
+}
+
+}
@@ -0,0 +1,157 @@
+#ifndef TERRAINQUADTREE_H_
+#define TERRAINQUADTREE_H_
+
+#include "scene/Model.h"
+#include "scene/Camera.h"
+#include "math/BoundingBox.h"
+#include "material/Texture.h"
+#include "TiledHeightField.h"
+
+namespace mgp
+{
+
+class Terrain;
+
+/**
+ * Renders a Terrain using a quadtree with continuous distance-based LOD (CDLOD).
+ *
+ * A single grid mesh is shared by all quadtree nodes and drawn instanced, once per
+ * selected node. Heights are sampled from a heightmap texture in the vertex shader,
+ * and vertices are morphed towards the next coarser grid as they approach the end of
+ * their LOD range, so there are no cracks or popping between levels.
+ *
+ * Nodes store the min/max height of their area, which allows hierarchical frustum
+ * culling. Selection only visits the nodes near the visible ones, so the CPU cost does
+ * not grow with the size of the HeightField.
+ *
+ * When the terrain is created from a TiledHeightField, nodes are the tiles of the
+ * pyramid and heights come from its atlas. A node is only refined once the tiles of
+ * its children are resident, and the missing ones are requested, so the LOD selection
+ * drives the streaming.
+ *
+ * Enabled with the Terrain::QUADTREE flag.
+ */
+class TerrainQuadtree
+{
+    friend class Terrain;
+public:
+
+    /**
+     * Sets the view distance of the finest LOD level, in terrain local units.
+     * Each coarser level covers twice the distance of the previous one.
+     *
+     * A value of zero uses a default distance based on the grid size.
+     */
+    void setLodDistance(float distance);
+
+    /**
+     * Gets the view distance of the finest LOD level.
+     */
+    float getLodDistance() const;
+
+    /**
+     * Sets the part of each LOD range used to morph to the next level (0..1, default 0.3).
+     */
+    void setMorphRatio(float ratio);
+
+    /**
+     * Gets the part of each LOD range used to morph to the next level.
+     */
+    float getMorphRatio() const;
+
+    /**
+     * Gets the number of LOD levels of the quadtree.
+     */
+    unsigned int getLevelCount() const;
+
+    /**
+     * Gets the total number of quadtree nodes.
+     */
+    unsigned int getNodeCount() const;
+
+    /**
+     * Gets the number of nodes drawn by the last call to draw.
+     */
+    unsigned int getSelectedCount() const;
+
+private:
+
+    struct QuadNode
+    {
+        unsigned int x;         // Origin column in the height field.
+        unsigned int z;         // Origin row in the height field.
+        unsigned int size;      // Size in height field samples.
+        float minHeight;        // Min height field value.
+        float maxHeight;        // Max height field value.
+        BoundingBox bounds;     // Local bounds, scaled by the terrain local scale.
+        int children[4];        // Child node indices, -1 if none.
+    };
+
+    TerrainQuadtree(Terrain* terrain, unsigned int gridSize);
+
+    TerrainQuadtree(const TerrainQuadtree&);
+
+    TerrainQuadtree& operator=(const TerrainQuadtree&);
+
+    ~TerrainQuadtree();
+
+    void build();
+
+    int buildNode(unsigned int x, unsigned int z, unsigned int size, int level);
+
+    void computeBounds(unsigned int x, unsigned int z, unsigned int size, float minHeight, float maxHeight, BoundingBox* dst) const;
+
+    void createMesh();
+
+    void resetMesh();
+
+    void setMaterialDirty();
+
+    bool updateMaterial();
+
+    void updateNodeBindings();
+
+    unsigned int draw(RenderInfo* view);
+
+    void selectNode(int index, int level, const Matrix& worldMatrix, const Frustum& frustum, bool lod);
+
+    bool selectTile(int level, unsigned int x, unsigned int z, const Matrix& worldMatrix, const Frustum& frustum, bool lod);
+
+    void addInstance(unsigned int x, unsigned int z, unsigned int size, int level, int slot);
+
+    BufferHandle getInstanceBuffer(RenderInfo* view);
+
+    /**
+     * The instances selected for a view. The draw calls of a pass refer to the buffer
+     * until the pass is rendered, so each view writes its own.
+     */
+    struct InstanceBuffer
+    {
+        RenderInfo* view;
+        BufferHandle vbo;
+        unsigned int lastUse;
+    };
+
+    Terrain* _terrain;
+    TiledHeightField* _tiles;           // Streamed height field, NULL if not streaming.
+    unsigned int _gridSize;             // Number of grid cells per node side.
+    unsigned int _cols;                 // Height field size.
+    unsigned int _rows;
+    unsigned int _levelCount;
+    float _lodDistance;
+    float _morphRatio;
+    std::vector<QuadNode> _nodes;       // Nodes in depth first order, the root is the first one.
+    std::vector<float> _ranges;         // View distance of each level.
+    Vector3 _cameraPosition;            // LOD camera position in terrain local space.
+    Model* _model;                      // Shared grid model.
+    Texture* _heightMap;
+    bool _materialDirty;
+    std::vector<float> _instanceData;   // Per node data of the selected nodes, 16 floats each.
+    unsigned int _instanceCount;
+    std::vector<InstanceBuffer> _instanceBuffers;
+    unsigned int _instanceDrawCount;    // Number of draws, the least recently drawn view gives its buffer to a new one.
+};
+
+}
+
+#endif
@@ -11,22 +11,102 @@
 
 #include "3rd/stb_image_write.h"
 
+#include <climits>
+#include <algorithm>
+
 using namespace mgp;
 
-TextureAtlas::TextureAtlas(Image::Format format, int w, int h) : texture(NULL), lastX(0), curY(0), maxY(0), isFull(false), data(NULL) {
+TextureAtlas::TextureAtlas(Image::Format format, int w, int h) : texture(NULL), usedArea(0), border(0), dirty(false), uploadOnAdd(true), data(NULL) {
     
     texture = Texture::create(format, w, h, data).take();
 
     int pixelSize = Image::getFormatBPP(texture->getFormat());
     unsigned char* data = (unsigned char*)calloc(1, w * h * pixelSize);
     this->data = data;
+
+    clear();
 }
 
 TextureAtlas::~TextureAtlas() {
     SAFE_RELEASE(texture);
+    free(data);
     data = NULL;
 }
 
+void TextureAtlas::clear() {
+    skyline.clear();
+    SkylineNode node = { 0, 0, (int)texture->getWidth() };
+    skyline.push_back(node);
+    usedArea = 0;
+}
+
+int TextureAtlas::fitSkyline(size_t index, int w, int h) const {
+    int x = skyline[index].x;
+    if (x + w > (int)texture->getWidth()) {
+        return -1;
+    }
+
+    //the highest node under the image
+    int y = skyline[index].y;
+    int widthLeft = w;
+    for (size_t i = index; widthLeft > 0; ++i) {
+        if (i >= skyline.size()) return -1;
+        if (skyline[i].y > y) y = skyline[i].y;
+        if (y + h > (int)texture->getHeight()) return -1;
+        widthLeft -= skyline[i].width;
+    }
+    return y;
+}
+
+bool TextureAtlas::allocate(int w, int h, int* x, int* y) {
+    //bottom-left: lowest top edge first, then the narrowest node
+    int bestIndex = -1;
+    int bestY = 0;
+    int bestBottom = INT_MAX;
+    int bestWidth = INT_MAX;
+    for (size_t i = 0; i < skyline.size(); ++i) {
+        int fy = fitSkyline(i, w, h);
+        if (fy < 0) continue;
+        if (fy + h < bestBottom || (fy + h == bestBottom && skyline[i].width < bestWidth)) {
+            bestIndex = i;
+            bestY = fy;
+            bestBottom = fy + h;
+            bestWidth = skyline[i].width;
+        }
+    }
+    if (bestIndex == -1) {
+        return false;
+    }
+
+    SkylineNode node = { skyline[bestIndex].x, bestY + h, w };
+    skyline.insert(skyline.begin() + bestIndex, node);
+
+    //shrink the nodes covered by the new one
+    for (size_t i = bestIndex + 1; i < skyline.size(); ) {
+        const SkylineNode& prev = skyline[i - 1];
+        int overlap = prev.x + prev.width - skyline[i].x;
+        if (overlap <= 0) break;
+        skyline[i].x += overlap;
+        skyline[i].width -= overlap;
+        if (skyline[i].width > 0) break;
+        skyline.erase(skyline.begin() + i);
+    }
+
+    //merge the nodes at the same height
+    for (size_t i = 0; i + 1 < skyline.size(); ) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    *x = node.x;
+    *y = bestY;
+    return true;
+}
 
 bool TextureAtlas::addImage(Image* image, Rectangle& rect) {
     if (texture->getFormat() == Image::RGBA) {
@@ -36,53 +116,47 @@ bool TextureAtlas::addImage(Image* image, Rectangle& rect) {
 }
 
 bool TextureAtlas::addImageData(int imgW, int imgH, const unsigned char* imgData, Rectangle& rect) {
-    TextureAtlas* ft = this;
-    if (ft->isFull) {
-        return false;
-    }
     int textureWidth = texture->getWidth();
     int textureHeight = texture->getHeight();
-
-    if (ft->lastX + imgW + 1 >= textureWidth) {
-        ft->lastX = 0;
-        ft->curY = ft->maxY;
-    }
-    if (ft->curY + imgH + 1 >= textureHeight) {
-        ft->isFull = true;
+    int pixelSize = Image::getFormatBPP(texture->getFormat());
+    if (pixelSize != 1 && pixelSize != 3 && pixelSize != 4) {
         return false;
     }
 
-    int pixelSize = Image::getFormatBPP(texture->getFormat());
+    //one pixel gap on the top left, or the border on each side
+    int pad = border > 0 ? border * 2 : 1;
+    int x, y;
+    if (!allocate(imgW + pad, imgH + pad, &x, &y)) {
+        return false;
+    }
+    x += pad - border;
+    y += pad - border;
 
     //copy sub image
-    int x = this->lastX + 1;
-    int y = this->curY + 1;
     if (pixelSize == 1) {
         copyImageData<1>(this->data, textureWidth, textureHeight, x, y, imgData, imgW, imgH);
     }
     else if (pixelSize == 3) {
         copyImageData<3>(this->data, textureWidth, textureHeight, x, y, imgData, imgW, imgH);
     }
-    else if (pixelSize == 4) {
-        copyImageData<4>(this->data, textureWidth, textureHeight, x, y, imgData, imgW, imgH);
-    }
     else {
-        return false;
+        copyImageData<4>(this->data, textureWidth, textureHeight, x, y, imgData, imgW, imgH);
     }
-
-    if (this->maxY < y + imgH) {
-        this->maxY = y + imgH;
+    if (border > 0) {
+        extrudeBorder(x, y, imgW, imgH);
     }
-    this->lastX = x + imgW;
+    usedArea += (imgW + pad) * (imgH + pad);
 
     rect.x = x;
     rect.y = y;
     rect.width = imgW;
     rect.height = imgH;
-    this->rects.push_back(rect);
 
     //upload image data
-    this->texture->setData(this->data, true);
+    dirty = true;
+    if (uploadOnAdd) {
+        update();
+    }
 
     //if (pixelSize == 1) {
     //    char buffer[128];
@@ -92,6 +166,90 @@ bool TextureAtlas::addImageData(int imgW, int imgH, const unsigned char* imgData
     return true;
 }
 
+bool TextureAtlas::addAtlasImage(TextureAtlas* src, const Rectangle& srcRect, Rectangle& rect) {
+    GP_ASSERT(src->texture->getFormat() == texture->getFormat());
+    int pixelSize = Image::getFormatBPP(texture->getFormat());
+    int imgW = srcRect.width;
+    int imgH = srcRect.height;
+    int srcRowSize = src->texture->getWidth() * pixelSize;
+
+    std::vector<unsigned char> imgData(imgW * imgH * pixelSize);
+    for (int i = 0; i < imgH; ++i) {
+        memcpy(&imgData[i * imgW * pixelSize], src->data + ((int)srcRect.y + i) * srcRowSize + (int)srcRect.x * pixelSize, imgW * pixelSize);
+    }
+    return addImageData(imgW, imgH, imgData.data(), rect);
+}
+
+void TextureAtlas::extrudeBorder(int x, int y, int imgW, int imgH) {
+    int textureWidth = texture->getWidth();
+    int pixelSize = Image::getFormatBPP(texture->getFormat());
+    int rowSize = textureWidth * pixelSize;
+
+    //repeat the first and last pixels of each row
+    for (int i = 0; i < imgH; ++i) {
+        unsigned char* row = data + (y + i) * rowSize;
+        for (int b = 1; b <= border; ++b) {
+            memcpy(row + (x - b) * pixelSize, row + x * pixelSize, pixelSize);
+            memcpy(row + (x + imgW - 1 + b) * pixelSize, row + (x + imgW - 1) * pixelSize, pixelSize);
+        }
+    }
+
+    //then the first and last rows, with their corners
+    int spanSize = (imgW + border * 2) * pixelSize;
+    unsigned char* first = data + y * rowSize + (x - border) * pixelSize;
+    unsigned char* last = data + (y + imgH - 1) * rowSize + (x - border) * pixelSize;
+    for (int b = 1; b <= border; ++b) {
+        memcpy(first - b * rowSize, first, spanSize);
+        memcpy(last + b * rowSize, last, spanSize);
+    }
+}
+
+bool TextureAtlas::repack(const std::vector<Rectangle*>& rects) {
+    int pixelSize = Image::getFormatBPP(texture->getFormat());
+    int rowSize = texture->getWidth() * pixelSize;
+    size_t dataSize = rowSize * texture->getHeight();
+    std::vector<unsigned char> old(data, data + dataSize);
+
+    std::vector<Rectangle*> sorted(rects);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Rectangle* a, const Rectangle* b) {
+        return a->height > b->height;
+    });
+
+    bool upload = uploadOnAdd;
+    uploadOnAdd = false;
+    clear();
+    memset(data, 0, dataSize);
+
+    bool rc = true;
+    std::vector<unsigned char> imgData;
+    for (Rectangle* rect : sorted) {
+        if (rect->isEmpty()) continue;
+        int imgW = rect->width;
+        int imgH = rect->height;
+        imgData.resize(imgW * imgH * pixelSize);
+        for (int i = 0; i < imgH; ++i) {
+            memcpy(&imgData[i * imgW * pixelSize], &old[((int)rect->y + i) * rowSize + (int)rect->x * pixelSize], imgW * pixelSize);
+        }
+        if (!addImageData(imgW, imgH, imgData.data(), *rect)) {
+            *rect = Rectangle::empty();
+            rc = false;
+        }
+    }
+
+    dirty = true;
+    uploadOnAdd = upload;
+    if (uploadOnAdd) {
+        update();
+    }
+    return rc;
+}
+
+void TextureAtlas::update() {
+    if (!dirty) return;
+    this->texture->setData(this->data, true);
+    dirty = false;
+}
+
 bool TextureAtlas::addImageUri(const std::string& file, Rectangle& rect) {
     UPtr<Image> img = Image::create(file.c_str(), false);
     if (!img.get()) return false;
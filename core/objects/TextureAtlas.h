@@ -20,27 +20,94 @@ namespace mgp
 {
 class SpriteBatch;
 
+/**
+ * Packs images into a single texture.
+ *
+ * Uses a skyline bottom-left packer, which wastes much less space than rows when the
+ * image heights vary. Images keep a one pixel gap to avoid bleeding when filtered, or a
+ * border of their edge pixels repeated when setBorder is used, which also keeps the
+ * lower mip levels and the bilinear samples at the edges from bleeding.
+ */
 class TextureAtlas : public Refable {
+    struct SkylineNode {
+        int x;
+        int y;
+        int width;
+    };
+
     Texture* texture;
 
-    int lastX;
-    int curY;
-    int maxY;
-    bool isFull;
+    std::vector<SkylineNode> skyline;
+    int usedArea;
+    int border;
+    bool dirty;
+    bool uploadOnAdd;
 
-    std::vector<Rectangle> rects;
     unsigned char* data;
 
 public:
     TextureAtlas(Image::Format format, int w, int h);
     ~TextureAtlas();
 
+    /**
+     * Adds an image.
+     *
+     * @return false if there is no room left for the image.
+     */
     bool addImageData(int imgW, int imgH, const unsigned char* imgData, Rectangle& rect);
     bool addImage(Image* image, Rectangle& rect);
     bool addImageUri(const std::string& file, Rectangle& rect);
 
+    /**
+     * Adds an image copied from another atlas of the same format.
+     */
+    bool addAtlasImage(TextureAtlas* src, const Rectangle& srcRect, Rectangle& rect);
+
+    /**
+     * Packs the given images again, tallest first, to reclaim the space of the removed ones.
+     *
+     * The rectangles are updated to the new locations, images that do not fit anymore
+     * are set to an empty rectangle.
+     *
+     * @return false if some images did not fit.
+     */
+    bool repack(const std::vector<Rectangle*>& rects);
+
+    /**
+     * Removes all the images.
+     */
+    void clear();
+
+    /**
+     * Sets whether the texture is uploaded after each added image (default true).
+     *
+     * When false, call update() once all the images of a frame are added.
+     */
+    void setUploadOnAdd(bool upload) { uploadOnAdd = upload; }
+
+    /**
+     * Sets the number of pixels repeated around the edges of the images added next (default 0).
+     *
+     * With no border, images are separated by a one pixel gap.
+     */
+    void setBorder(int pixels) { border = pixels; }
+
+    /**
+     * Uploads the texture if images were added since the last upload.
+     */
+    void update();
+
+    /**
+     * Gets the area used by the images, in pixels.
+     */
+    int getUsedArea() const { return usedArea; }
+
     Texture* getTexture() { return texture; }
 private:
+    int fitSkyline(size_t index, int w, int h) const;
+    bool allocate(int w, int h, int* x, int* y);
+    void extrudeBorder(int x, int y, int imgW, int imgH);
+
     template<int pixelSize>
     void copyImageData(unsigned char* dst, int dstW, int dstH, int x, int y, const unsigned char* src, int imgW, int imgH) {
         for (int i = 0; i < imgH; ++i) {
@@ -0,0 +1,433 @@
+#include "base/Base.h"
+#include "TiledHeightField.h"
+#include "HeightField.h"
+#include "base/FileSystem.h"
+#include "base/ThreadPool.h"
+#include "math/Math.h"
+
+#include <float.h>
+
+namespace mgp
+{
+
+#define TILED_HEIGHTFIELD_MAGIC 0x4D475448
+#define TILED_HEIGHTFIELD_VERSION 1
+#define TILED_HEIGHTFIELD_HEADER "tiles.hf"
+
+// Max texture size of the atlas.
+#define TILED_HEIGHTFIELD_MAX_ATLAS_SIZE 8192
+
+// Frames a tile must stay unused before it can be evicted.
+#define TILED_HEIGHTFIELD_EVICT_FRAMES 2
+
+/**
+ * Loads one tile on a thread of the pool.
+ */
+class TileLoadTask : public Task
+{
+public:
+    TiledHeightField* _heightfield;
+    TiledHeightField::LoadedTile* _tile;
+
+    TileLoadTask(TiledHeightField* heightfield, TiledHeightField::LoadedTile* tile) : _heightfield(heightfield), _tile(tile)
+    {
+    }
+
+    void run() override
+    {
+        _heightfield->load(_tile);
+    }
+
+    void done() override
+    {
+        Task::done();
+        if (_tile)
+        {
+            _heightfield->onLoaded(_tile);
+            _tile = NULL;
+        }
+    }
+};
+
+TiledHeightField::TiledHeightField() :
+    _cols(0), _rows(0), _tileSize(0), _levelCount(0), _heightMin(0), _heightMax(1),
+    _frame(0), _maxPendingCount(16), _maxUploadCount(16),
+    _slotCount(0), _slotsPerRow(0), _atlasWidth(0), _atlasHeight(0), _atlas(NULL),
+    _threadPool(NULL)
+{
+}
+
+TiledHeightField::~TiledHeightField()
+{
+    if (_threadPool)
+    {
+        // Waits for the running tasks, canceled ones are still passed to onLoaded.
+        _threadPool->stop();
+        SAFE_DELETE(_threadPool);
+    }
+    for (LoadedTile* tile : _loaded)
+    {
+        SAFE_DELETE(tile);
+    }
+    _loaded.clear();
+    SAFE_RELEASE(_atlas);
+}
+
+uint64_t TiledHeightField::makeKey(int level, unsigned int x, unsigned int z)
+{
+    return ((uint64_t)level << 56) | ((uint64_t)x << 28) | (uint64_t)z;
+}
+
+std::string TiledHeightField::getTilePath(const std::string& dir, int level, unsigned int x, unsigned int z)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/%d_%u_%u.r16", level, x, z);
+    return dir + name;
+}
+
+bool TiledHeightField::build(HeightField* heightfield, const char* dir, unsigned int tileSize)
+{
+    GP_ASSERT(heightfield);
+    GP_ASSERT(dir);
+    GP_ASSERT(tileSize >= 2);
+
+    // The quadtree grid needs an even size with 16-bit indices.
+    tileSize = std::min(std::max(tileSize, 2u), 254u) & ~1u;
+
+    unsigned int cols = heightfield->getColumnCount();
+    unsigned int rows = heightfield->getRowCount();
+    float heightMin = heightfield->getHeightMin();
+    float heightMax = heightfield->getHeightMax();
+    const float* heights = heightfield->getArray();
+
+    // Same level count as the TerrainQuadtree, the top level is a single tile.
+    unsigned int levelCount = 1;
+    unsigned int extent = std::max(cols, rows) - 1;
+    for (unsigned int size = tileSize; size < extent; size *= 2)
+        ++levelCount;
+
+    std::string header = std::string(dir) + "/" + TILED_HEIGHTFIELD_HEADER;
+    UPtr<Stream> stream = FileSystem::open(header.c_str(), FileSystem::WRITE);
+    if (!stream.get())
+    {
+        GP_WARN("Failed to write tiled heightfield: %s.", header.c_str());
+        return false;
+    }
+    stream->writeUInt32(TILED_HEIGHTFIELD_MAGIC);
+    stream->writeUInt32(TILED_HEIGHTFIELD_VERSION);
+    stream->writeUInt32(cols);
+    stream->writeUInt32(rows);
+    stream->writeUInt32(tileSize);
+    stream->writeUInt32(levelCount);
+    stream->writeFloat(heightMin);
+    stream->writeFloat(heightMax);
+    stream->close();
+
+    unsigned int side = tileSize + 1;
+    std::vector<unsigned char> bytes(side * side * 2);
+    float scale = heightMax > heightMin ? 65535.0f / (heightMax - heightMin) : 0;
+    for (unsigned int level = 0; level < levelCount; ++level)
+    {
+        unsigned int step = 1 << level;
+        unsigned int span = tileSize * step;
+        unsigned int countX = (cols - 1 + span - 1) / span;
+        unsigned int countZ = (rows - 1 + span - 1) / span;
+        for (unsigned int tz = 0; tz < countZ; ++tz)
+        {
+            for (unsigned int tx = 0; tx < countX; ++tx)
+            {
+                // Samples past the edge repeat the last row or column.
+                unsigned char* b = bytes.data();
+                for (unsigned int j = 0; j < side; ++j)
+                {
+                    unsigned int z = std::min(tz * span + j * step, rows - 1);
+                    for (unsigned int i = 0; i < side; ++i)
+                    {
+                        unsigned int x = std::min(tx * span + i * step, cols - 1);
+                        float value = (heights[z * cols + x] - heightMin) * scale;
+                        uint16_t ivalue = (uint16_t)MATH_CLAMP(value + 0.5f, 0.0f, 65535.0f);
+                        *b++ = ivalue & 0xFF;
+                        *b++ = ivalue >> 8;
+                    }
+                }
+
+                std::string path = getTilePath(dir, level, tx, tz);
+                UPtr<Stream> tile = FileSystem::open(path.c_str(), FileSystem::WRITE);
+                if (!tile.get())
+                {
+                    GP_WARN("Failed to write heightfield tile: %s.", path.c_str());
+                    return false;
+                }
+                tile->write((const char*)bytes.data(), bytes.size());
+                tile->close();
+            }
+        }
+    }
+    return true;
+}
+
+UPtr<TiledHeightField> TiledHeightField::create(const char* dir, size_t memoryBudget, int threadCount)
+{
+    GP_ASSERT(dir);
+
+    std::string header = std::string(dir) + "/" + TILED_HEIGHTFIELD_HEADER;
+    UPtr<Stream> stream = FileSystem::open(header.c_str());
+    if (!stream.get())
+    {
+        GP_WARN("Failed to open tiled heightfield: %s.", header.c_str());
+        return UPtr<TiledHeightField>(NULL);
+    }
+    if (stream->readUInt32() != TILED_HEIGHTFIELD_MAGIC || stream->readUInt32() != TILED_HEIGHTFIELD_VERSION)
+    {
+        GP_WARN("Invalid tiled heightfield: %s.", header.c_str());
+        return UPtr<TiledHeightField>(NULL);
+    }
+
+    TiledHeightField* heightfield = new TiledHeightField();
+    heightfield->_path = dir;
+    heightfield->_cols = stream->readUInt32();
+    heightfield->_rows = stream->readUInt32();
+    heightfield->_tileSize = stream->readUInt32();
+    heightfield->_levelCount = stream->readUInt32();
+    heightfield->_heightMin = stream->readFloat();
+    heightfield->_heightMax = stream->readFloat();
+    stream->close();
+
+    // Size the atlas from the budget, keeping it within the max texture size.
+    unsigned int side = heightfield->_tileSize + 1;
+    size_t tileBytes = side * side * sizeof(float);
+    unsigned int maxSlotsPerRow = TILED_HEIGHTFIELD_MAX_ATLAS_SIZE / side;
+    unsigned int slotCount = (unsigned int)std::max(memoryBudget / tileBytes, (size_t)4);
+    slotCount = std::min(slotCount, maxSlotsPerRow * maxSlotsPerRow);
+    unsigned int slotsPerRow = (unsigned int)ceil(sqrt((double)slotCount));
+    unsigned int slotRows = (slotCount + slotsPerRow - 1) / slotsPerRow;
+
+    heightfield->_slotCount = slotCount;
+    heightfield->_slotsPerRow = slotsPerRow;
+    heightfield->_atlasWidth = slotsPerRow * side;
+    heightfield->_atlasHeight = slotRows * side;
+    heightfield->_freeSlots.reserve(slotCount);
+    for (int i = (int)slotCount - 1; i >= 0; --i)
+        heightfield->_freeSlots.push_back(i);
+
+    heightfield->_threadPool = new ThreadPool(std::max(threadCount, 1));
+    heightfield->_threadPool->start();
+
+    return UPtr<TiledHeightField>(heightfield);
+}
+
+unsigned int TiledHeightField::getTileCountX(int level) const
+{
+    unsigned int span = _tileSize << level;
+    return (_cols - 1 + span - 1) / span;
+}
+
+unsigned int TiledHeightField::getTileCountZ(int level) const
+{
+    unsigned int span = _tileSize << level;
+    return (_rows - 1 + span - 1) / span;
+}
+
+const TiledHeightField::Tile* TiledHeightField::getTile(int level, unsigned int x, unsigned int z)
+{
+    auto it = _tiles.find(makeKey(level, x, z));
+    if (it == _tiles.end())
+        return NULL;
+    it->second.lastUsedFrame = _frame;
+    return &it->second;
+}
+
+bool TiledHeightField::request(int level, unsigned int x, unsigned int z)
+{
+    uint64_t key = makeKey(level, x, z);
+    if (_tiles.find(key) != _tiles.end() || _pending.find(key) != _pending.end())
+        return true;
+    if (_pending.size() >= _maxPendingCount)
+        return false;
+
+    LoadedTile* tile = new LoadedTile();
+    tile->level = level;
+    tile->x = x;
+    tile->z = z;
+    tile->ok = false;
+    tile->minHeight = _heightMin;
+    tile->maxHeight = _heightMax;
+    _pending.insert(key);
+    _threadPool->addTask(ThreadPool::TaskPtr(new TileLoadTask(this, tile)));
+    return true;
+}
+
+void TiledHeightField::load(LoadedTile* tile) const
+{
+    std::string path = getTilePath(_path, tile->level, tile->x, tile->z);
+    int fileSize = 0;
+    unsigned char* bytes = (unsigned char*)FileSystem::readAll(path.c_str(), &fileSize);
+    unsigned int side = _tileSize + 1;
+    if (bytes == NULL || fileSize != (int)(side * side * 2))
+    {
+        GP_WARN("Failed to read heightfield tile: %s.", path.c_str());
+        SAFE_DELETE_ARRAY(bytes);
+        return;
+    }
+
+    float scale = (_heightMax - _heightMin) / 65535.0f;
+    float minHeight = FLT_MAX;
+    float maxHeight = -FLT_MAX;
+    tile->data.resize(side * side);
+    for (unsigned int i = 0, n = side * side; i < n; ++i)
+    {
+        float h = _heightMin + (bytes[i * 2] | (int)bytes[i * 2 + 1] << 8) * scale;
+        tile->data[i] = h;
+        if (h < minHeight)
+            minHeight = h;
+        if (h > maxHeight)
+            maxHeight = h;
+    }
+    SAFE_DELETE_ARRAY(bytes);
+
+    tile->minHeight = minHeight;
+    tile->maxHeight = maxHeight;
+    tile->ok = true;
+}
+
+void TiledHeightField::onLoaded(LoadedTile* tile)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _loaded.push_back(tile);
+}
+
+int TiledHeightField::allocSlot()
+{
+    if (_freeSlots.size())
+    {
+        int slot = _freeSlots.back();
+        _freeSlots.pop_back();
+        return slot;
+    }
+
+    // Evict the least recently used tile that was not drawn in the last frames.
+    auto lru = _tiles.end();
+    for (auto it = _tiles.begin(); it != _tiles.end(); ++it)
+    {
+        if (it->second.lastUsedFrame + TILED_HEIGHTFIELD_EVICT_FRAMES > _frame)
+            continue;
+        if (lru == _tiles.end() || it->second.lastUsedFrame < lru->second.lastUsedFrame)
+            lru = it;
+    }
+    if (lru == _tiles.end())
+        return -1;
+
+    int slot = lru->second.slot;
+    _tiles.erase(lru);
+    return slot;
+}
+
+void TiledHeightField::update()
+{
+    ++_frame;
+
+    std::vector<LoadedTile*> loaded;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_loaded.empty())
+            return;
+        size_t count = std::min((size_t)_maxUploadCount, _loaded.size());
+        loaded.assign(_loaded.begin(), _loaded.begin() + count);
+        _loaded.erase(_loaded.begin(), _loaded.begin() + count);
+    }
+
+    for (LoadedTile* tile : loaded)
+    {
+        uint64_t key = makeKey(tile->level, tile->x, tile->z);
+        _pending.erase(key);
+
+        int slot = tile->ok ? allocSlot() : -1;
+        if (slot == -1)
+        {
+            // Failed or out of memory budget, it will be requested again if still needed.
+            if (tile->ok)
+                GP_WARN("Tiled heightfield memory budget is too small for the visible tiles.");
+            SAFE_DELETE(tile);
+            continue;
+        }
+
+        Tile& resident = _tiles[key];
+        resident.level = tile->level;
+        resident.x = tile->x;
+        resident.z = tile->z;
+        resident.minHeight = tile->minHeight;
+        resident.maxHeight = tile->maxHeight;
+        resident.slot = slot;
+        resident.lastUsedFrame = _frame;
+        resident.data.swap(tile->data);
+        _uploads.push_back(key);
+
+        SAFE_DELETE(tile);
+    }
+}
+
+float TiledHeightField::getHeight(float column, float row) const
+{
+    column = MATH_CLAMP(column, 0.0f, (float)(_cols - 1));
+    row = MATH_CLAMP(row, 0.0f, (float)(_rows - 1));
+
+    for (unsigned int level = 0; level < _levelCount; ++level)
+    {
+        unsigned int step = 1 << level;
+        unsigned int span = _tileSize * step;
+        unsigned int tx = std::min((unsigned int)column / span, getTileCountX(level) - 1);
+        unsigned int tz = std::min((unsigned int)row / span, getTileCountZ(level) - 1);
+        auto it = _tiles.find(makeKey(level, tx, tz));
+        if (it == _tiles.end())
+            continue;
+
+        // Bilinear sample in the tile.
+        float u = (column - tx * span) / step;
+        float v = (row - tz * span) / step;
+        unsigned int x1 = std::min((unsigned int)u, _tileSize - 1);
+        unsigned int z1 = std::min((unsigned int)v, _tileSize - 1);
+        float fx = u - x1;
+        float fz = v - z1;
+
+        unsigned int side = _tileSize + 1;
+        const float* p = &it->second.data[z1 * side + x1];
+        float h1 = p[0] * (1 - fx) + p[1] * fx;
+        float h2 = p[side] * (1 - fx) + p[side + 1] * fx;
+        return h1 * (1 - fz) + h2 * fz;
+    }
+    return _heightMin;
+}
+
+Texture* TiledHeightField::getAtlas()
+{
+    if (!_atlas)
+    {
+        // Left uninitialized, a slot is only sampled once its tile is uploaded.
+        _atlas = Texture::create(Image::R32F, _atlasWidth, _atlasHeight, NULL, false).take();
+        _atlas->setFilterMode(Texture::NEAREST, Texture::NEAREST);
+        _atlas->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    }
+
+    unsigned int side = _tileSize + 1;
+    for (uint64_t key : _uploads)
+    {
+        // Skip the tiles evicted before being drawn.
+        auto it = _tiles.find(key);
+        if (it == _tiles.end())
+            continue;
+        unsigned int ox, oy;
+        getSlotOrigin(it->second.slot, &ox, &oy);
+        _atlas->setSubData(ox, oy, side, side, (const unsigned char*)it->second.data.data());
+    }
+    _uploads.clear();
+    return _atlas;
+}
+
+void TiledHeightField::getSlotOrigin(unsigned int slot, unsigned int* x, unsigned int* y) const
+{
+    unsigned int side = _tileSize + 1;
+    *x = (slot % _slotsPerRow) * side;
+    *y = (slot / _slotsPerRow) * side;
+}
+
+}
@@ -0,0 +1,226 @@
+#ifndef TILEDHEIGHTFIELD_H_
+#define TILEDHEIGHTFIELD_H_
+
+#include "base/Ref.h"
+#include "base/Ptr.h"
+#include "material/Texture.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace mgp
+{
+
+class HeightField;
+class ThreadPool;
+
+/**
+ * Defines a height field stored on disk as a pyramid of tiles, which is streamed in
+ * asynchronously around the camera.
+ *
+ * Level 0 is the full resolution, each level above takes every other sample of the level
+ * below. Every tile has (tileSize+1)^2 samples so that neighbouring tiles share their edges.
+ * Tiles are stored as 16-bit RAW files next to a small header file, use build() to create
+ * them from a HeightField.
+ *
+ * Resident tiles live in a fixed size atlas texture, sized from the memory budget. When the
+ * atlas is full, the least recently used tiles are evicted, so the memory stays the same
+ * regardless of the size of the height field. Each tile keeps its samples for getHeight(),
+ * only the slots of new tiles are uploaded.
+ *
+ * Used by a Terrain created from it, which renders with a TerrainQuadtree and requests the
+ * tiles needed by the LOD selection.
+ */
+class TiledHeightField : public Refable
+{
+    friend class TileLoadTask;
+public:
+
+    /**
+     * A resident tile.
+     */
+    struct Tile
+    {
+        int level;
+        unsigned int x;
+        unsigned int z;
+        float minHeight;
+        float maxHeight;
+        unsigned int slot;          // Slot in the atlas.
+        uint64_t lastUsedFrame;     // Frame the tile was last used for rendering.
+        std::vector<float> data;    // (tileSize+1)^2 samples, row by row.
+    };
+
+    /**
+     * Writes the tile pyramid of a height field.
+     *
+     * @param heightfield The source height field.
+     * @param dir The directory to write to, it must exist.
+     * @param tileSize The number of samples per tile side, minus one. Should match the terrain patch size.
+     *
+     * @return true if all the files were written.
+     */
+    static bool build(HeightField* heightfield, const char* dir, unsigned int tileSize = 32);
+
+    /**
+     * Opens a tile pyramid written by build().
+     *
+     * No tile is loaded by this call.
+     *
+     * @param dir The directory of the tiles.
+     * @param memoryBudget The memory used for the resident tiles, in bytes.
+     * @param threadCount The number of loading threads.
+     */
+    static UPtr<TiledHeightField> create(const char* dir, size_t memoryBudget = 16 * 1024 * 1024, int threadCount = 2);
+
+    unsigned int getColumnCount() const { return _cols; }
+
+    unsigned int getRowCount() const { return _rows; }
+
+    unsigned int getTileSize() const { return _tileSize; }
+
+    unsigned int getLevelCount() const { return _levelCount; }
+
+    float getHeightMin() const { return _heightMin; }
+
+    float getHeightMax() const { return _heightMax; }
+
+    const std::string& getPath() const { return _path; }
+
+    /**
+     * Gets the number of tiles along X at the given level.
+     */
+    unsigned int getTileCountX(int level) const;
+
+    /**
+     * Gets the number of tiles along Z at the given level.
+     */
+    unsigned int getTileCountZ(int level) const;
+
+    /**
+     * Gets a resident tile and marks it as used in the current frame.
+     *
+     * @return The tile, or NULL if it is not loaded.
+     */
+    const Tile* getTile(int level, unsigned int x, unsigned int z);
+
+    /**
+     * Requests a tile to be loaded, if it is neither resident nor already requested.
+     *
+     * Requests beyond the max pending count are ignored, they will be made again
+     * in a later frame. Callers should request coarse and near tiles first.
+     *
+     * @return true if the tile is resident or pending.
+     */
+    bool request(int level, unsigned int x, unsigned int z);
+
+    /**
+     * Starts a new frame and moves the loaded tiles into the atlas.
+     */
+    void update();
+
+    /**
+     * Gets the height at the given sample position from the finest resident tile.
+     *
+     * @return The height, or the min height if no tile covering the position is resident.
+     */
+    float getHeight(float column, float row) const;
+
+    /**
+     * Gets the atlas texture of the resident tiles, uploading the changes since the last call.
+     *
+     * Must be called on the render thread.
+     */
+    Texture* getAtlas();
+
+    /**
+     * Gets the texel position of an atlas slot.
+     */
+    void getSlotOrigin(unsigned int slot, unsigned int* x, unsigned int* y) const;
+
+    /**
+     * Sets the max number of tiles being loaded at the same time.
+     */
+    void setMaxPendingCount(unsigned int count) { _maxPendingCount = count; }
+
+    /**
+     * Sets the max number of loaded tiles moved into the atlas per frame.
+     */
+    void setMaxUploadCount(unsigned int count) { _maxUploadCount = count; }
+
+    unsigned int getSlotCount() const { return _slotCount; }
+
+    unsigned int getResidentCount() const { return _tiles.size(); }
+
+    unsigned int getPendingCount() const { return _pending.size(); }
+
+    /**
+     * Gets the memory used by the resident tiles, in bytes.
+     */
+    size_t getMemorySize() const { return (size_t)_atlasWidth * _atlasHeight * sizeof(float); }
+
+private:
+
+    struct LoadedTile
+    {
+        int level;
+        unsigned int x;
+        unsigned int z;
+        bool ok;
+        float minHeight;
+        float maxHeight;
+        std::vector<float> data;
+    };
+
+    TiledHeightField();
+
+    TiledHeightField(const TiledHeightField&);
+
+    TiledHeightField& operator=(const TiledHeightField&);
+
+    ~TiledHeightField();
+
+    static uint64_t makeKey(int level, unsigned int x, unsigned int z);
+
+    static std::string getTilePath(const std::string& dir, int level, unsigned int x, unsigned int z);
+
+    /**
+     * Loads a tile, called on a loading thread.
+     */
+    void load(LoadedTile* tile) const;
+
+    void onLoaded(LoadedTile* tile);
+
+    int allocSlot();
+
+    std::string _path;
+    unsigned int _cols;
+    unsigned int _rows;
+    unsigned int _tileSize;
+    unsigned int _levelCount;
+    float _heightMin;
+    float _heightMax;
+
+    std::unordered_map<uint64_t, Tile> _tiles;      // Resident tiles.
+    std::unordered_set<uint64_t> _pending;          // Requested tiles.
+    std::vector<int> _freeSlots;
+    uint64_t _frame;
+    unsigned int _maxPendingCount;
+    unsigned int _maxUploadCount;
+
+    unsigned int _slotCount;
+    unsigned int _slotsPerRow;
+    unsigned int _atlasWidth;
+    unsigned int _atlasHeight;
+    Texture* _atlas;
+    std::vector<uint64_t> _uploads;                 // Resident tiles not yet in the atlas texture.
+
+    ThreadPool* _threadPool;
+    std::mutex _mutex;
+    std::vector<LoadedTile*> _loaded;                // Tiles loaded by the threads, guarded by _mutex.
+};
+
+}
+
+#endif
@@ -1,7 +1,10 @@
 #include "AssetManager.h"
 #include "../base/Stream.h"
 #include "../base/FileSystem.h"
+#include "../base/MappedFile.h"
+#include "../base/MappedStream.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
 #include "../material/Material.h"
 #include "MeshSkin.h"
 #include "../base/SerializerJson.h"
@@ -9,9 +12,42 @@
 #include "material/Texture.h"
 #include "material/Image.h"
 #include "base/StringUtil.h"
+#include "base/ThreadPool.h"
+
+// Number of worker threads decoding the asynchronous requests.
+#define ASSET_THREAD_COUNT 2
+
+// Default time in milliseconds update() spends uploading resources per frame.
+#define ASSET_UPLOAD_TIME_BUDGET 2
 
 using namespace mgp;
 
+namespace mgp
+{
+/**
+ * Decodes one asynchronous request on a thread of the pool.
+ */
+class AssetLoadTask : public Task
+{
+public:
+    AssetManager* _manager;
+    SPtr<AssetRequest> _request;
+
+    AssetLoadTask(AssetManager* manager, AssetRequest* request) : _manager(manager)
+    {
+        _request = request;
+    }
+
+    void run() override
+    {
+        _manager->runRequest(_request.get());
+    }
+};
+}
+
+// The asynchronous request decoding on this thread, collects the resources its decode loads.
+static thread_local AssetRequest* __currentRequest = NULL;
+
 AssetManager *AssetManager_instance = NULL;
 
 AssetManager *AssetManager::getInstance() {
@@ -29,12 +65,35 @@ void AssetManager::releaseInstance() {
   }
 }
 
-AssetManager::AssetManager() {
+AssetManager::AssetManager() : _threadPool(NULL), _uploadTimeBudget(ASSET_UPLOAD_TIME_BUDGET), _optimizeMeshes(false) {
     setPath("res/assets");
 }
 
 AssetManager::~AssetManager() {
+    if (_threadPool) {
+        _threadPool->stop();
+        SAFE_DELETE(_threadPool);
+    }
+    for (AssetRequest* request : _decoded) {
+        request->release();
+    }
+    _decoded.clear();
+    for (int i=0; i<rt_count; ++i) {
+        for (auto it = _requests[i].begin(); it != _requests[i].end(); ++it) {
+            it->second->release();
+        }
+        _requests[i].clear();
+    }
+}
+
+void AssetManager::beginFrame() {
+    if (AssetManager_instance) {
+        AssetManager_instance->update();
+    }
+}
 
+void AssetManager::setUploadTimeBudget(MillisTime millis) {
+    _uploadTimeBudget = millis;
 }
 
 void AssetManager::setPath(const std::string& path) {
@@ -80,51 +139,217 @@ void AssetManager::remove(const std::string &name, ResType type) {
   }
 }
 
+Resource* AssetManager::getCached(const std::string &name, ResType type) {
+    auto itr = this->resourceMap[type].find(name);
+    if (itr != this->resourceMap[type].end()) {
+        Resource* res = itr->second;
+        if (Image* texture = dynamic_cast<Image*>(res)) {
+            if (!texture->getData()) {
+                res->release();
+                this->resourceMap[type].erase(itr);
+                return NULL;
+            }
+        }
+        res->addRef();
+        return res;
+    }
+    return NULL;
+}
+
+AssetRequest* AssetManager::addRequest(const std::string &name, ResType type, bool cache, bool async) {
+    AssetRequest* request = new AssetRequest(name, type, cache, async);
+    if (cache) {
+        request->addRef();
+        _requests[type][name] = request;
+    }
+    return request;
+}
+
 UPtr<Resource> AssetManager::load(const std::string &name, ResType type, bool cache) {
     if (name.size() == 0) return UPtr<Resource>(NULL);
 
-    std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+    SPtr<AssetRequest> request;
+    {
+        std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+        if (cache) {
+            Resource* res = getCached(name, type);
+            if (res) {
+                addUpload(res);
+                return UPtr<Resource>(res);
+            }
+            auto itr = _requests[type].find(name);
+            if (itr != _requests[type].end()) {
+                request = itr->second;
+            }
+        }
+        if (request.isNull()) {
+            request = SPtr<AssetRequest>(addRequest(name, type, cache, false));
+        }
+    }
 
-    if (cache) {
-        auto itr = this->resourceMap[type].find(name);
-        if (itr != this->resourceMap[type].end()) {
-            Resource* res = itr->second;
-            bool ok = true;
-            if (Image* texture = dynamic_cast<Image*>(res)) {
-                if (!texture->getData()) {
-                    res->release();
-                    this->resourceMap->erase(itr);
-                    ok = false;
-                }
+    //decode out of the lock, waits for the thread decoding the same resource
+    wait(request.get());
+    UPtr<Resource> res = request->getResource();
+    addUpload(res.get());
+    return res;
+}
+
+SPtr<AssetRequest> AssetManager::loadAsync(const std::string &name, ResType type, bool cache) {
+    SPtr<AssetRequest> request;
+    {
+        std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+        if (cache) {
+            Resource* res = getCached(name, type);
+            if (res) {
+                request = SPtr<AssetRequest>(new AssetRequest(name, type, cache, true));
+                request->_resource = res;
+                request->_state = AssetRequest::DONE;
+                return request;
             }
-            if (ok) {
-                res->addRef();
-                return UPtr<Resource>(res);
+            auto itr = _requests[type].find(name);
+            if (itr != _requests[type].end()) {
+                request = itr->second;
+                return request;
             }
         }
+        request = SPtr<AssetRequest>(addRequest(name, type, cache, true));
     }
 
+#ifdef __EMSCRIPTEN__
+    //no worker threads, decode now and upload at the next frame
+    runRequest(request.get());
+#else
+    if (!_threadPool) {
+        _threadPool = new ThreadPool(ASSET_THREAD_COUNT);
+        _threadPool->start();
+    }
+    _threadPool->addTask(ThreadPool::TaskPtr(new AssetLoadTask(this, request.get())));
+#endif
+    return request;
+}
+
+void AssetManager::runRequest(AssetRequest* request) {
+    {
+        std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+        if (request->_state != AssetRequest::PENDING) return;
+        request->_state = AssetRequest::LOADING;
+    }
+
+    AssetRequest* parent = __currentRequest;
+    if (request->_async) {
+        __currentRequest = request;
+    }
+    Resource* res = decode(request->_name, request->_type);
+    __currentRequest = parent;
+
+    std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+    request->_resource = res;
+    if (request->_cache) {
+        if (res) {
+            Resource*& cached = this->resourceMap[request->_type][request->_name];
+            if (cached) {
+                cached->release();
+            }
+            res->addRef();
+            cached = res;
+        }
+        auto itr = _requests[request->_type].find(request->_name);
+        if (itr != _requests[request->_type].end() && itr->second == request) {
+            _requests[request->_type].erase(itr);
+            request->release();
+        }
+    }
+    if (request->_async) {
+        request->_state = AssetRequest::DECODED;
+        request->addRef();
+        _decoded.push_back(request);
+    }
+    else {
+        request->_state = AssetRequest::DONE;
+    }
+    _decodedCondition.notify_all();
+}
+
+void AssetManager::wait(AssetRequest* request) {
+    //a queued request is decoded by the waiting thread, workers waiting for queued requests would never wake up
+    runRequest(request);
+
+    std::unique_lock<std::recursive_mutex> lock(_mutex);
+    _decodedCondition.wait(lock, [request]() { return request->_state >= AssetRequest::DECODED; });
+}
+
+void AssetManager::addUpload(Resource* res) {
+    if (res && __currentRequest) {
+        res->addRef();
+        __currentRequest->_uploads.push_back(res);
+    }
+}
+
+void AssetManager::upload(Resource* res) {
+    if (Mesh* mesh = dynamic_cast<Mesh*>(res)) {
+        mesh->upload();
+    }
+    else if (Texture* texture = dynamic_cast<Texture*>(res)) {
+        texture->upload();
+    }
+}
+
+void AssetManager::update() {
+    MillisTime begin = System::millisTicks();
+    while (true) {
+        AssetRequest* request;
+        {
+            std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+            if (_decoded.empty()) break;
+            request = _decoded.front();
+            _decoded.pop_front();
+        }
+
+        for (Resource* res : request->_uploads) {
+            upload(res);
+            res->release();
+        }
+        request->_uploads.clear();
+        if (request->_resource) {
+            upload(request->_resource);
+        }
+
+        {
+            std::lock_guard<std::recursive_mutex> lock_guard(_mutex);
+            request->_state = AssetRequest::DONE;
+        }
+        request->release();
+
+        if (System::millisTicks() - begin >= _uploadTimeBudget) break;
+    }
+}
+
+Resource* AssetManager::decode(const std::string &name, ResType type) {
     Resource* res = NULL;
     switch (type) {
         case rt_mesh: {
             std::string file = path + "/mesh/" + name + ".mesh";
-            UPtr<Stream> s = FileSystem::open(file.c_str());
+            //the vertex and index data points into the mapped file
+            UPtr<MappedFile> mapping = FileSystem::map(file.c_str());
+            if (mapping.isNull()) break;
+            MappedStream s(mapping.get());
             Mesh *mesh = Mesh::create(VertexFormat(NULL, 0)).take();
-            mesh->read(s.get());
             mesh->setId(name);
-            s->close();
-            //delete s;
+            if (!mesh->read(&s, mapping.get())) {
+                SAFE_RELEASE(mesh);
+                break;
+            }
             res = mesh;
             break;
         }
         case rt_skin: {
             std::string file = path + "/skin/" + name + ".skin";
-            UPtr<Stream> s = FileSystem::open(file.c_str());
+            UPtr<MappedFile> mapping = FileSystem::map(file.c_str());
+            if (mapping.isNull()) break;
+            MappedStream s(mapping.get());
             MeshSkin* mesh = new MeshSkin();
-            mesh->read(s.get());
+            mesh->read(&s);
             mesh->setId(name);
-            s->close();
-            //delete s;
             res = mesh;
             break;
         }
@@ -139,12 +364,12 @@ UPtr<Resource> AssetManager::load(const std::string &name, ResType type, bool ca
         }
         case rt_animation: {
             std::string file = path + "/anim/" + name + ".anim";
-            UPtr<Stream> s = FileSystem::open(file.c_str());
+            UPtr<MappedFile> mapping = FileSystem::map(file.c_str());
+            if (mapping.isNull()) break;
+            MappedStream s(mapping.get());
             Animation* mesh = new Animation("");
-            mesh->read(s.get());
+            mesh->read(&s);
             mesh->setId(name);
-            s->close();
-            //delete s;
             res = mesh;
             break;
         }
@@ -158,11 +383,11 @@ UPtr<Resource> AssetManager::load(const std::string &name, ResType type, bool ca
             break;
         }
     }
-    if (cache && res) {
-        res->addRef();
-        this->resourceMap[type][name] = res;
-    }
-    return UPtr<Resource>(res);
+    return res;
+}
+
+void AssetManager::setOptimizeMeshes(bool optimize) {
+    _optimizeMeshes = optimize;
 }
 
 void AssetManager::save(Resource* res) {
@@ -180,15 +405,20 @@ void AssetManager::save(Resource* res) {
     if (_saved[name]) return;
 
     if (Mesh* mesh = dynamic_cast<Mesh*>(res)) {
+        MeshOptimizer::Statistics stats;
+        if (_optimizeMeshes && MeshOptimizer::optimize(mesh, &stats)) {
+            GP_DEBUG("optimized mesh %s: vertices %u -> %u, index bytes %u -> %u, ACMR %.3f -> %.3f", name.c_str(),
+                stats.vertexCountBefore, stats.vertexCountAfter, stats.indexBytesBefore, stats.indexBytesAfter, stats.acmrBefore, stats.acmrAfter);
+        }
         std::string file = path + "/mesh/" + name + ".mesh";
-        UPtr<Stream> s = FileSystem::open(file.c_str(), FileSystem::WRITE);
+        UPtr<Stream> s = FileSystem::open(file.c_str(), FileSystem::WRITE | FileSystem::BUFFERED);
         mesh->write(s.get());
         s->close();
         //delete s;
     }
     else if (MeshSkin* mesh = dynamic_cast<MeshSkin*>(res)) {
         std::string file = path + "/skin/" + name + ".skin";
-        UPtr<Stream> s = FileSystem::open(file.c_str(), FileSystem::WRITE);
+        UPtr<Stream> s = FileSystem::open(file.c_str(), FileSystem::WRITE | FileSystem::BUFFERED);
         mesh->write(s.get());
         s->close();
         //delete s;
@@ -201,7 +431,7 @@ void AssetManager::save(Resource* res) {
     }
     else if (Animation* mesh = dynamic_cast<Animation*>(res)) {
         std::string file = path + "/anim/" + name + ".anim";
-        UPtr<Stream> s = FileSystem::open(file.c_str(), FileSystem::WRITE);
+        UPtr<Stream> s = FileSystem::open(file.c_str(), FileSystem::WRITE | FileSystem::BUFFERED);
         mesh->write(s.get());
         s->close();
         //delete s;
@@ -219,3 +449,40 @@ void AssetManager::save(Resource* res) {
     _saved[name] = 1;
 }
 
+
+AssetRequest::AssetRequest(const std::string& name, AssetManager::ResType type, bool cache, bool async) :
+    _name(name), _type(type), _cache(cache), _async(async), _state(PENDING), _resource(NULL) {
+}
+
+AssetRequest::~AssetRequest() {
+    for (Resource* res : _uploads) {
+        res->release();
+    }
+    _uploads.clear();
+    SAFE_RELEASE(_resource);
+}
+
+const std::string& AssetRequest::getName() const {
+    return _name;
+}
+
+bool AssetRequest::isDone() {
+    std::lock_guard<std::recursive_mutex> lock_guard(AssetManager::getInstance()->_mutex);
+    return _state == DONE;
+}
+
+bool AssetRequest::isFailed() {
+    std::lock_guard<std::recursive_mutex> lock_guard(AssetManager::getInstance()->_mutex);
+    return _state >= DECODED && !_resource;
+}
+
+UPtr<Resource> AssetRequest::getResource() {
+    std::lock_guard<std::recursive_mutex> lock_guard(AssetManager::getInstance()->_mutex);
+    if (_state < DECODED || !_resource) return UPtr<Resource>(NULL);
+    _resource->addRef();
+    return UPtr<Resource>(_resource);
+}
+
+void AssetRequest::wait() {
+    AssetManager::getInstance()->wait(this);
+}
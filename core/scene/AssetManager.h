@@ -5,12 +5,27 @@
 #include "base/Ref.h"
 #include "base/Ptr.h"
 #include <mutex>
+#include <deque>
+#include <condition_variable>
 #include "base/Resource.h"
 
 namespace mgp
 {
+class AssetRequest;
+class ThreadPool;
+
+/**
+ * Loads and caches the resources saved in the asset directory.
+ *
+ * load() blocks the caller, loadAsync() reads and decodes the resource on a worker thread
+ * and returns at once. The decoded resources are uploaded to the GPU by update() on the
+ * render thread, within a time budget per frame. Loads of the same cached resource in
+ * flight at the same time share one request.
+ */
 class AssetManager
 {
+    friend class AssetRequest;
+    friend class AssetLoadTask;
 public:
     enum ResType {
         rt_texture,
@@ -26,6 +41,12 @@ private:
     std::recursive_mutex _mutex;
     std::string path;
     std::map<std::string, int> _saved;
+    std::map<std::string, AssetRequest*> _requests[rt_count];   // Requests in flight, by name.
+    std::deque<AssetRequest*> _decoded;                         // Asynchronous requests waiting for the upload.
+    std::condition_variable_any _decodedCondition;
+    ThreadPool* _threadPool;
+    MillisTime _uploadTimeBudget;
+    bool _optimizeMeshes;
 public:
     static AssetManager *getInstance();
     static void releaseInstance();
@@ -46,9 +67,120 @@ public:
 
     UPtr<Resource> load(const std::string &name, ResType type, bool cache = true);
 
+    /**
+     * Loads a resource on a worker thread.
+     *
+     * @param name The name of the resource.
+     * @param type The type of the resource.
+     * @param cache True to cache the resource, the request of a resource already loading is then returned.
+     *
+     * @return The request, done when the resource is decoded and uploaded.
+     */
+    SPtr<AssetRequest> loadAsync(const std::string &name, ResType type, bool cache = true);
+
+    /**
+     * Uploads the decoded resources of the asynchronous requests, until the time budget is spent.
+     *
+     * Must be called on the render thread, once per frame.
+     */
+    void update();
+
+    /**
+     * Updates the instance if it was created, called by the application at the beginning of each frame.
+     */
+    static void beginFrame();
+
+    /**
+     * Sets the time update() may spend uploading resources per frame, at least one resource is uploaded.
+     *
+     * @param millis The time in milliseconds.
+     */
+    void setUploadTimeBudget(MillisTime millis);
+
     void remove(const std::string &name, ResType type);
 
+    /**
+     * Sets whether save() optimizes the meshes with MeshOptimizer before writing them, false by default.
+     */
+    void setOptimizeMeshes(bool optimize);
+
     void save(Resource*res);
+
+private:
+    Resource* getCached(const std::string &name, ResType type);
+    AssetRequest* addRequest(const std::string &name, ResType type, bool cache, bool async);
+    void runRequest(AssetRequest* request);
+    void wait(AssetRequest* request);
+    Resource* decode(const std::string &name, ResType type);
+    void addUpload(Resource* res);
+    void upload(Resource* res);
+};
+
+/**
+ * Defines a resource loading asynchronously, returned by AssetManager::loadAsync().
+ */
+class AssetRequest : public Refable
+{
+    friend class AssetManager;
+public:
+
+    ~AssetRequest();
+
+    /**
+     * Gets the name of the requested resource.
+     */
+    const std::string& getName() const;
+
+    /**
+     * Returns true if the resource is decoded and uploaded, or failed to load.
+     */
+    bool isDone();
+
+    /**
+     * Returns true if the resource is decoded and failed to load.
+     */
+    bool isFailed();
+
+    /**
+     * Gets the resource, NULL until it is decoded or if it failed to load.
+     *
+     * A resource decoded but not uploaded yet can be used, its first draw uploads it then.
+     */
+    UPtr<Resource> getResource();
+
+    template<typename T>
+    UPtr<T> getResource() {
+        return getResource().dynamicCastTo<T>();
+    }
+
+    /**
+     * Blocks until the resource is decoded, decoding it on the calling thread if no worker started it.
+     */
+    void wait();
+
+private:
+
+    enum State
+    {
+        PENDING,
+        LOADING,
+        DECODED,
+        DONE
+    };
+
+    AssetRequest(const std::string& name, AssetManager::ResType type, bool cache, bool async);
+
+    AssetRequest(const AssetRequest& copy);
+
+    AssetRequest& operator=(const AssetRequest&);
+
+    std::string _name;
+    AssetManager::ResType _type;
+    bool _cache;
+    bool _async;
+    State _state;
+    Resource* _resource;
+    std::vector<Resource*> _uploads;    // Resources loaded by the decode, uploaded with the resource.
 };
 }
 #endif // ASSETMANAGER_H
@@ -10,7 +10,8 @@ void RenderInfo::draw(DrawCall* drawCall) {
 }
 
 Drawable::Drawable()
-    : _renderLayer(RenderLayer::Qpaque), _lightMask(0), _visiable(true), _pickMask(1), _highlightType(HighlightType::Silhouette)
+    : _renderLayer(RenderLayer::Qpaque), _lightMask(0), _visiable(true), _pickMask(1), _highlightType(HighlightType::Silhouette),
+    _lastVisibleTime(-1), _screenSize(0)
 {
 }
 
@@ -91,6 +92,12 @@ double Drawable::getDistance(Vector3& cameraPosition) const {
     return distance;
 }
 
+void Drawable::setVisibleFeedback(double time, float screenSize) {
+    if (time == _lastVisibleTime && screenSize < _screenSize) return;
+    _lastVisibleTime = time;
+    _screenSize = screenSize;
+}
+
 DelayUpdater::DelayUpdater(): maxUpdateDelay(500), viewDirtyTime(0) {
 
 }
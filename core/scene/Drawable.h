@@ -158,6 +158,25 @@ public:
 
     virtual double getDistance(Vector3& cameraPosition) const;
 
+    /**
+     * Records the result of the last culling pass that found this drawable visible.
+     * Several passes in the same frame keep the largest screen size.
+     *
+     * @param time The game time of the culling pass.
+     * @param screenSize The projected bounding radius relative to half the viewport height.
+     */
+    void setVisibleFeedback(double time, float screenSize);
+
+    /**
+     * Gets the game time this drawable was last found visible. Negative if never.
+     */
+    double getLastVisibleTime() const { return _lastVisibleTime; }
+
+    /**
+     * Gets the screen size recorded by the last culling pass.
+     */
+    float getScreenSize() const { return _screenSize; }
+
     /**
      * Clones the drawable and returns a new drawable.
      *
@@ -189,6 +208,10 @@ protected:
     int _pickMask;
 
     HighlightType _highlightType;
+
+    double _lastVisibleTime;
+
+    float _screenSize;
 };
 
 class DelayUpdater {
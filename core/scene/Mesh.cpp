@@ -8,15 +8,19 @@
 #include <float.h>
 #include "math/LineSegment.h"
 
+// First byte of the mesh files with aligned data, older files start with the vertex element count.
+#define MESH_FILE_MARKER 0xFF
+#define MESH_FILE_VERSION 2
+
+// Alignment of the vertex and index data in the mesh files, so that the mapped data is aligned.
+#define MESH_DATA_ALIGNMENT 16
+
 namespace mgp
 {
 RenderBuffer::RenderBuffer() {
 }
 RenderBuffer::~RenderBuffer() {
-    if (_data) {
-        free(_data);
-        _data = NULL;
-    }
+    releaseData();
     if (this->_bufferHandle)
     {
         Renderer::cur()->deleteBuffer(_bufferHandle);
@@ -26,6 +30,17 @@ RenderBuffer::~RenderBuffer() {
 
 void RenderBuffer::setCapacity(int capacity) {
     if (capacity != -1 && _dataCapacity != capacity) {
+        if (_mapping.get()) {
+            //copy out of the mapped file
+            char* vertexData = (char*)malloc(capacity);
+            memcpy(vertexData, _data, std::min(_dataSize, capacity));
+            _mapping.clear();
+            _data = vertexData;
+            _dataCapacity = capacity;
+            _pointerDirty = true;
+            _contentDirty = true;
+            return;
+        }
         _dataCapacity = capacity;
         char* vertexData = (char*)realloc(_data, _dataCapacity);
         if (vertexData != _data) {
@@ -46,12 +61,16 @@ void RenderBuffer::resize(int size) {
 }
 
 void RenderBuffer::setData(char* data, int size, bool copy) {
+    if (_mapping.get()) {
+        _mapping.clear();
+        _data = NULL;
+    }
     if (copy) {
         if (!_data) _data = (char*)malloc(size);
         memcpy(_data, data, size);
     }
     else {
-        if (!_data) free(_data);
+        if (_data && _data != data) free(_data);
         _data = data;
     }
     _dataSize = size;
@@ -60,6 +79,28 @@ void RenderBuffer::setData(char* data, int size, bool copy) {
     _pointerDirty = true;
 }
 
+void RenderBuffer::setMappedData(MappedFile* mapping, char* data, int size) {
+    releaseData();
+    _mapping = mapping;
+    _data = data;
+    _dataSize = size;
+    _dataCapacity = size;
+    _contentDirty = true;
+    _pointerDirty = true;
+}
+
+void RenderBuffer::releaseData() {
+    if (_mapping.get()) {
+        _mapping.clear();
+    }
+    else if (_data) {
+        free(_data);
+    }
+    _data = NULL;
+    _dataSize = 0;
+    _dataCapacity = 0;
+}
+
 void RenderBuffer::updateData(char* src, int dst_offset, int size) {
     GP_ASSERT(size + dst_offset <= _dataCapacity);
     memcpy(_data + dst_offset, src, size);
@@ -241,7 +282,22 @@ void Mesh::setBoundingSphere(const BoundingSphere& sphere)
     _boundingSphere = sphere;
 }
 
+static void writePadding(Stream* file, long int end) {
+    static const char zeros[MESH_DATA_ALIGNMENT] = { 0 };
+    long int size = end - file->position();
+    if (size > 0) {
+        file->write(zeros, size);
+    }
+}
+
+static uint32_t alignDataOffset(uint32_t offset) {
+    return (offset + MESH_DATA_ALIGNMENT - 1) / MESH_DATA_ALIGNMENT * MESH_DATA_ALIGNMENT;
+}
+
 void Mesh::write(Stream* file) {
+    long int base = file->position();
+    file->writeUInt8(MESH_FILE_MARKER);
+    file->writeUInt8(MESH_FILE_VERSION);
     
     // vertex formats
     file->writeUInt8((unsigned int)_vertexFormat.getElementCount());
@@ -249,6 +305,7 @@ void Mesh::write(Stream* file) {
     {
         const VertexFormat::Element& element = _vertexFormat.getElement(i);
         element.write(file);
+        file->writeUInt8(element.normalized);
     }
 
     //file->writeStr(_url);
@@ -258,12 +315,10 @@ void Mesh::write(Stream* file) {
     // vertices
     file->writeUInt32(_vertexCount);
     file->writeUInt32(_vertexBuffer->_dataSize);
-    file->write((const char*)_vertexBuffer->_data, _vertexBuffer->_dataSize);
 
-    // write indices buffer
+    // indices
     file->writeUInt16(_indexFormat);
     file->writeUInt32(_indexBuffer->_dataSize);
-    file->write(_indexBuffer->_data, _indexBuffer->_dataSize);
 
     // parts
     file->writeUInt8(_primitiveType);
@@ -273,27 +328,55 @@ void Mesh::write(Stream* file) {
     getBoundingSphere();
 
     // Write bounds
-    file->writeFloat(_boundingBox.min.x);
-    file->writeFloat(_boundingBox.min.y);
-    file->writeFloat(_boundingBox.min.z);
-
-    file->writeFloat(_boundingBox.max.x);
-    file->writeFloat(_boundingBox.max.y);
-    file->writeFloat(_boundingBox.max.z);
-
-    file->writeFloat(_boundingSphere.center.x);
-    file->writeFloat(_boundingSphere.center.y);
-    file->writeFloat(_boundingSphere.center.z);
-    file->writeFloat(_boundingSphere.radius);
+    float bounds[10] = {
+        (float)_boundingBox.min.x, (float)_boundingBox.min.y, (float)_boundingBox.min.z,
+        (float)_boundingBox.max.x, (float)_boundingBox.max.y, (float)_boundingBox.max.z,
+        (float)_boundingSphere.center.x, (float)_boundingSphere.center.y, (float)_boundingSphere.center.z,
+        (float)_boundingSphere.radius
+    };
+    file->writeFloatArray(bounds, 10);
+
+    // data offsets from the start of the mesh, followed by the aligned data
+    uint32_t vertexOffset = alignDataOffset(file->position() - base + 8);
+    uint32_t indexOffset = alignDataOffset(vertexOffset + _vertexBuffer->_dataSize);
+    file->writeUInt32(vertexOffset);
+    file->writeUInt32(indexOffset);
+
+    writePadding(file, base + vertexOffset);
+    file->write((const char*)_vertexBuffer->_data, _vertexBuffer->_dataSize);
+    writePadding(file, base + indexOffset);
+    file->write(_indexBuffer->_data, _indexBuffer->_dataSize);
+}
 
+static bool readBufferData(Stream* file, RenderBuffer* buffer, int size) {
+    char* data = (char*)malloc(size);
+    if (size && file->read(data, size) != size) {
+        free(data);
+        return false;
+    }
+    buffer->setData(data, size, false);
+    return true;
 }
 
 bool Mesh::read(Stream* file) {
+    return read(file, NULL);
+}
+
+bool Mesh::read(Stream* file, MappedFile* mapping) {
+    long int base = file->position();
+    int version = 0;
     int elemCount = file->readUInt8();
+    if (elemCount == MESH_FILE_MARKER) {
+        version = file->readUInt8();
+        elemCount = file->readUInt8();
+    }
     std::vector<VertexFormat::Element> elems;
     elems.resize(elemCount);
     for (int i = 0; i < elemCount; ++i) {
         elems[i].read(file);
+        if (version >= 2) {
+            elems[i].normalized = file->readUInt8() != 0;
+        }
     }
 
     VertexFormat format(&elems[0], elemCount);
@@ -306,41 +389,61 @@ bool Mesh::read(Stream* file) {
 
     mesh->_vertexCount = file->readUInt32();
     int bufSize = file->readUInt32();
-    void *vertexData = malloc(bufSize);
-    file->read((char*)vertexData, bufSize);
-    mesh->_vertexBuffer->setData((char*)vertexData, bufSize, false);
+    if (version == 0 && !readBufferData(file, mesh->_vertexBuffer.get(), bufSize)) {
+        return false;
+    }
 
     //mesh->_vertexDataDirty = true;
 
     mesh->_indexFormat = (IndexFormat)file->readUInt16();
     int ibufsize = file->readUInt32();
-    void* indexData = malloc(ibufsize);
-    file->read((char*)indexData, ibufsize);
-    mesh->_indexBuffer->setData((char*)indexData, ibufsize, false);
+    if (version == 0 && !readBufferData(file, mesh->_indexBuffer.get(), ibufsize)) {
+        return false;
+    }
 
     _primitiveType = (Mesh::PrimitiveType)file->readUInt8();
     _bufferOffset = file->readUInt32();
     _indexCount = file->readUInt32();
 
-    mesh->_boundingBox.min.x = file->readFloat();
-    mesh->_boundingBox.min.y = file->readFloat();
-    mesh->_boundingBox.min.z = file->readFloat();
-    mesh->_boundingBox.max.x = file->readFloat();
-    mesh->_boundingBox.max.y = file->readFloat();
-    mesh->_boundingBox.max.z = file->readFloat();
+    //bounding box and sphere
+    float bounds[10];
+    if (file->readFloatArray(bounds, 10) != 10) {
+        return false;
+    }
+    mesh->_boundingBox.set(bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]);
+    mesh->_boundingSphere.center.set(bounds[6], bounds[7], bounds[8]);
+    mesh->_boundingSphere.radius = bounds[9];
 
-    mesh->_boundingSphere.center.x = file->readFloat();
-    mesh->_boundingSphere.center.y = file->readFloat();
-    mesh->_boundingSphere.center.z = file->readFloat();
-    mesh->_boundingSphere.radius = file->readFloat();
+    if (version == 0) {
+        return true;
+    }
 
-    return true;
+    uint32_t vertexOffset = file->readUInt32();
+    uint32_t indexOffset = file->readUInt32();
+    long int end = base + indexOffset + ibufsize;
+    if (mapping) {
+        if (end > (long int)mapping->getSize()) {
+            GP_ERROR("Mesh data past the end of the file: %s", getId().c_str());
+            return false;
+        }
+        mesh->_vertexBuffer->setMappedData(mapping, mapping->getData() + base + vertexOffset, bufSize);
+        mesh->_indexBuffer->setMappedData(mapping, mapping->getData() + base + indexOffset, ibufsize);
+        file->seek(end);
+        return true;
+    }
+
+    file->seek(base + vertexOffset);
+    if (!readBufferData(file, mesh->_vertexBuffer.get(), bufSize)) {
+        return false;
+    }
+    file->seek(base + indexOffset);
+    return readBufferData(file, mesh->_indexBuffer.get(), ibufsize);
 }
 
 
 void Mesh::computeBounds()
 {
-    if (_vertexCount == 0) return;
+    if (_vertexCount == 0 || !_vertexBuffer->_data) return;
     // If we have a Model with a MeshSkin associated with it,
     // compute the bounds from the skin - otherwise compute
     // it from the local mesh data.
@@ -362,7 +465,7 @@ void Mesh::computeBounds()
 
     for (int i = 0; i < _vertexCount; ++i)
     {
-        float *p = (float*)((char*)_vertexBuffer->_data + (i * positionElement->stride) + positionElement->offset);
+        float p[4]; positionElement->decode((char*)_vertexBuffer->_data + i * positionElement->stride, p);
         float x = p[0];
         float y = p[1];
         float z = p[2];
@@ -389,7 +492,7 @@ void Mesh::computeBounds()
     // distance between the center point and each vertex position
     for (int i = 0; i < _vertexCount; ++i)
     {
-        float* p = (float*)((char*)_vertexBuffer->_data + (i * positionElement->stride) + positionElement->offset);
+        float p[4]; positionElement->decode((char*)_vertexBuffer->_data + i * positionElement->stride, p);
         float x = p[0];
         float y = p[1];
         float z = p[2];
@@ -405,15 +508,8 @@ void Mesh::computeBounds()
     _boundingSphere.radius = sqrt(_boundingSphere.radius);
 }
 
-unsigned int Mesh::draw(RenderInfo* view, Drawable* drawable, Material* _material)
+void Mesh::upload()
 {
-    Mesh* _mesh = this;
-    GP_ASSERT(_mesh);
-
-    if (!_visiable) {
-        return 0;
-    }
-
     if (_vertexBuffer->_bufferHandle == 0) {
         _vertexBuffer->_bufferHandle = Renderer::cur()->createBuffer(0);
     }
@@ -428,12 +524,29 @@ unsigned int Mesh::draw(RenderInfo* view, Drawable* drawable, Material* _materia
             _indexBuffer->_bufferHandle = Renderer::cur()->createBuffer(1);
         }
         if (_indexBuffer->_contentDirty) {
-            GP_ASSERT(_indexBuffer->_dataSize >= _mesh->_indexCount * getIndexSize());
+            GP_ASSERT(_indexBuffer->_dataSize >= _indexCount * getIndexSize());
             Renderer::cur()->setBufferData(_indexBuffer->_bufferHandle, 1, 0, (const char*)_indexBuffer->_data, _indexBuffer->_dataSize, _dynamic);
             _indexBuffer->_contentDirty = false;
         }
     }
 
+    if (!_keepMemory && !_dynamic) {
+        _vertexBuffer->releaseData();
+        _indexBuffer->releaseData();
+    }
+}
+
+unsigned int Mesh::draw(RenderInfo* view, Drawable* drawable, Material* _material)
+{
+    Mesh* _mesh = this;
+    GP_ASSERT(_mesh);
+
+    if (!_visiable) {
+        return 0;
+    }
+
+    upload();
+
     Mesh* mesh = _mesh;
     if (!mesh->_vertexAttributeArray.get()) {
         BufferHandle indexBufferObject = 0;
@@ -524,6 +637,8 @@ unsigned int Mesh::draw(RenderInfo* view, Drawable* drawable, Material* _materia
 
 bool Mesh::doRaycast(RayQuery& query) {
     bool res = false;
+    //the data was released after upload
+    if (!_vertexBuffer->_data) return false;
 
     if (!_isIndexed) {
         int minTriangle = -1;
@@ -538,9 +653,9 @@ bool Mesh::doRaycast(RayQuery& query) {
             Vector3 b;
             Vector3 c;
             for (int j = 0; j < count; j += 3) {
-                float* af = (float*)(verteix + (positionElement->stride * j) + positionElement->offset);
-                float* bf = (float*)(verteix + (positionElement->stride * (j+1)) + positionElement->offset);
-                float* cf = (float*)(verteix + (positionElement->stride * (j+2)) + positionElement->offset);
+                float af[4]; positionElement->decode(verteix + positionElement->stride * j, af);
+                float bf[4]; positionElement->decode(verteix + positionElement->stride * (j+1), bf);
+                float cf[4]; positionElement->decode(verteix + positionElement->stride * (j+2), cf);
                 //float to double
                 a.x = af[0]; a.y = af[1]; a.z = af[2];
                 b.x = bf[0]; b.y = bf[1]; b.z = bf[2];
@@ -563,9 +678,9 @@ bool Mesh::doRaycast(RayQuery& query) {
             Vector3 b;
             Vector3 c;
             for (int j = 0; j+2 < count; j += 1) {
-                float* af = (float*)(verteix + (positionElement->stride * j) + positionElement->offset);
-                float* bf = (float*)(verteix + (positionElement->stride * (j + 1)) + positionElement->offset);
-                float* cf = (float*)(verteix + (positionElement->stride * (j + 2)) + positionElement->offset);
+                float af[4]; positionElement->decode(verteix + positionElement->stride * j, af);
+                float bf[4]; positionElement->decode(verteix + positionElement->stride * (j + 1), bf);
+                float cf[4]; positionElement->decode(verteix + positionElement->stride * (j + 2), cf);
                 //float to double
                 a.x = af[0]; a.y = af[1]; a.z = af[2];
                 b.x = bf[0]; b.y = bf[1]; b.z = bf[2];
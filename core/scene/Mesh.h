@@ -4,6 +4,7 @@
 #include "base/Ref.h"
 #include "base/Ptr.h"
 #include "base/Stream.h"
+#include "base/MappedFile.h"
 #include "VertexFormat.h"
 #include "math/Vector3.h"
 #include "math/BoundingBox.h"
@@ -32,6 +33,7 @@ struct RenderBuffer : public Refable {
     unsigned int _dataCapacity = 0;
     bool _contentDirty = false;
     bool _pointerDirty = false;
+    SPtr<MappedFile> _mapping;      // The mapped file _data points into, NULL if _data is allocated.
 
     RenderBuffer();
     ~RenderBuffer();
@@ -39,6 +41,18 @@ struct RenderBuffer : public Refable {
     void setCapacity(int capacity);
     void resize(int size);
     void setData(char* data, int size, bool copy = true);
+
+    /**
+     * Points the data into a mapped file, without copying it.
+     *
+     * The data is copied when the capacity changes.
+     */
+    void setMappedData(MappedFile* mapping, char* data, int size);
+
+    /**
+     * Frees or unmaps the data, the uploaded buffer is kept.
+     */
+    void releaseData();
     void updateData(char* src, int dst_offset, int size);
     int addData(char* data, int size);
 
@@ -56,6 +70,7 @@ class Mesh : public Resource
     friend class MeshFactory;
     friend class PhysicsController;
     friend class MeshBatch;
+    friend class MeshOptimizer;
 public:
 
     /**
@@ -270,8 +285,24 @@ public:
     void write(Stream* file);
     bool read(Stream* file);
 
+    /**
+     * Reads the mesh.
+     *
+     * @param file The stream to read from.
+     * @param mapping The mapped file the stream reads, the vertex and index data then points into it
+     *        instead of being copied. NULL to read the data from the stream.
+     */
+    bool read(Stream* file, MappedFile* mapping);
+
     unsigned int draw(RenderInfo* view, Drawable* drawable, Material* _material);
 
+    /**
+     * Uploads the vertex and index data changed since the last upload, done by draw() otherwise.
+     *
+     * Must be called on the render thread.
+     */
+    void upload();
+
     /**
     * Return the intersection point distance to ray origin.
     * 
@@ -310,6 +341,14 @@ public:
     bool isVisiable() { return _visiable; }
     void setVisiable(bool b) { _visiable = b; }
 
+    /**
+     * Sets whether the vertex and index data is kept in memory after it is uploaded, true by default.
+     *
+     * The data of dynamic meshes is always kept. Raycasts need the data.
+     */
+    void setKeepMemory(bool keep) { _keepMemory = keep; }
+    bool isKeepMemory() { return _keepMemory; }
+
     void setVertexBuffer(SPtr<RenderBuffer> b) { _vertexBuffer = b; }
     void setIndexBuffer(SPtr<RenderBuffer> b) { _indexBuffer = b; }
 public:
@@ -341,6 +380,7 @@ protected:
     VertexFormat _vertexFormat;
     PrimitiveType _primitiveType = TRIANGLES;
     bool _dynamic = false;
+    bool _keepMemory = true;
 
     //vertices
     SPtr<RenderBuffer> _vertexBuffer;
@@ -384,9 +424,9 @@ template<typename T> bool Mesh::raycastPart(RayQuery& query, int _bufferOffset,
             T ia = indices[j];
             T ib = indices[j + 1];
             T ic = indices[j + 2];
-            float* af = (float*)(verteix + (positionElement->stride * ia) + positionElement->offset);
-            float* bf = (float*)(verteix + (positionElement->stride * ib) + positionElement->offset);
-            float* cf = (float*)(verteix + (positionElement->stride * ic) + positionElement->offset);
+            float af[4]; positionElement->decode(verteix + positionElement->stride * ia, af);
+            float bf[4]; positionElement->decode(verteix + positionElement->stride * ib, bf);
+            float cf[4]; positionElement->decode(verteix + positionElement->stride * ic, cf);
             //float to double
             a.x = af[0]; a.y = af[1]; a.z = af[2];
             b.x = bf[0]; b.y = bf[1]; b.z = bf[2];
@@ -412,9 +452,9 @@ template<typename T> bool Mesh::raycastPart(RayQuery& query, int _bufferOffset,
             T ia = indices[0];
             T ib = indices[j];
             T ic = indices[j + 1];
-            float* af = (float*)(verteix + (positionElement->stride * ia) + positionElement->offset);
-            float* bf = (float*)(verteix + (positionElement->stride * ib) + positionElement->offset);
-            float* cf = (float*)(verteix + (positionElement->stride * ic) + positionElement->offset);
+            float af[4]; positionElement->decode(verteix + positionElement->stride * ia, af);
+            float bf[4]; positionElement->decode(verteix + positionElement->stride * ib, bf);
+            float cf[4]; positionElement->decode(verteix + positionElement->stride * ic, cf);
             //float to double
             a.x = af[0]; a.y = af[1]; a.z = af[2];
             b.x = bf[0]; b.y = bf[1]; b.z = bf[2];
@@ -440,9 +480,9 @@ template<typename T> bool Mesh::raycastPart(RayQuery& query, int _bufferOffset,
             T ia = indices[j];
             T ib = indices[j + 1];
             T ic = indices[j + 2];
-            float* af = (float*)(verteix + (positionElement->stride * ia) + positionElement->offset);
-            float* bf = (float*)(verteix + (positionElement->stride * ib) + positionElement->offset);
-            float* cf = (float*)(verteix + (positionElement->stride * ic) + positionElement->offset);
+            float af[4]; positionElement->decode(verteix + positionElement->stride * ia, af);
+            float bf[4]; positionElement->decode(verteix + positionElement->stride * ib, bf);
+            float cf[4]; positionElement->decode(verteix + positionElement->stride * ic, cf);
             //float to double
             a.x = af[0]; a.y = af[1]; a.z = af[2];
             b.x = bf[0]; b.y = bf[1]; b.z = bf[2];
@@ -470,8 +510,8 @@ template<typename T> bool Mesh::raycastPart(RayQuery& query, int _bufferOffset,
             ia = indices[j];
             ib = indices[j + 1];
 
-            float* af = (float*)(verteix + (positionElement->stride * ia) + positionElement->offset);
-            float* bf = (float*)(verteix + (positionElement->stride * ib) + positionElement->offset);
+            float af[4]; positionElement->decode(verteix + positionElement->stride * ia, af);
+            float bf[4]; positionElement->decode(verteix + positionElement->stride * ib, bf);
             //float to double
             a.x = af[0]; a.y = af[1]; a.z = af[2];
             b.x = bf[0]; b.y = bf[1]; b.z = bf[2];
@@ -495,7 +535,7 @@ template<typename T> bool Mesh::raycastPart(RayQuery& query, int _bufferOffset,
         {
             ia = indices[j];
 
-            float* af = (float*)(verteix + (positionElement->stride * ia) + positionElement->offset);
+            float af[4]; positionElement->decode(verteix + positionElement->stride * ia, af);
             //float to double
             a.x = af[0]; a.y = af[1]; a.z = af[2];
             double disSq = query.ray.distanceSqToPoint(a);
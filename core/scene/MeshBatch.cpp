@@ -193,7 +193,7 @@ bool MeshBatch::getBatchVertices(int i, std::vector<float>& vertices) {
     uint32_t nindex = 0;
     for (int j = offset; j < end; ++j) {
         uint32_t ia = indices[j];
-        float* p = (float*)(verteix + (positionElement->stride * ia) + positionElement->offset);
+        float p[4]; positionElement->decode(verteix + positionElement->stride * ia, p);
         float x = p[0];
         float y = p[1];
         float z = p[2];
@@ -1,4 +1,5 @@
 #include "MeshFactory.h"
+#include "MeshOptimizer.h"
 
 using namespace mgp;
 
@@ -366,6 +367,8 @@ UPtr<Mesh> MeshFactory::createTorus(int radial_resolution, int tubular_resolutio
     mesh->setIndex(Mesh::TRIANGLES, indexCount);
     mesh->getIndexBuffer()->setData((char*)indices.data(), indices.size() * sizeof(uint16_t));
 
+    MeshOptimizer::optimize(mesh.get());
+    MeshOptimizer::compressVertices(mesh.get());
     return mesh;
 }
 
@@ -500,6 +503,8 @@ UPtr<Mesh> MeshFactory::createSpherical(int subdivision) {
     mesh->getIndexBuffer()->setData((char*)indices.data(), indices.size()*sizeof(uint16_t));
 
     SAFE_DELETE_ARRAY(_vertices);
+    MeshOptimizer::optimize(mesh.get());
+    MeshOptimizer::compressVertices(mesh.get());
     return mesh;
 }
 
@@ -572,6 +577,8 @@ UPtr<Mesh> MeshFactory::createCone(float radius, float height) {
     mesh->setIndex(Mesh::TRIANGLES, indexCount);
     mesh->getIndexBuffer()->setData((char*)indices.data(), indices.size() * sizeof(uint16_t));
 
+    MeshOptimizer::optimize(mesh.get());
+    MeshOptimizer::compressVertices(mesh.get());
     return mesh;
 }
 
@@ -652,6 +659,8 @@ UPtr<Mesh> MeshFactory::createCylinder(float radius, float height) {
     mesh->setIndex(Mesh::TRIANGLES, indexCount);
     mesh->getIndexBuffer()->setData((char*)indices.data(), indices.size() * sizeof(uint16_t));
 
+    MeshOptimizer::optimize(mesh.get());
+    MeshOptimizer::compressVertices(mesh.get());
     return mesh;
 }
 
@@ -0,0 +1,635 @@
+#include "base/Base.h"
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Size of the LRU cache modeled by the vertex cache optimization.
+#define VERTEX_CACHE_SIZE 32
+
+// Size of the FIFO cache simulated to measure the triangle orders.
+#define FIFO_CACHE_SIZE 16
+
+// Largest texture coordinate kept in half floats. Below 2 a half float step is at most 1/1024 of a
+// texture repeat, it doubles with each power of two above, which visibly shifts tiled coordinates.
+#define HALF_TEXCOORD_RANGE 2.0f
+
+namespace mgp
+{
+
+//////////////////////////////////////////////////////////////////////////
+// vertex cache
+
+static float vertexScore(int cachePosition, unsigned int liveTriangles)
+{
+    if (liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle score less, not to emit triangles sharing an edge with it in a strip.
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - float(cachePosition - 3) / float(VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Vertices with few triangles left score more, to finish them and not leave lone triangles.
+    score += 2.0f / sqrtf(float(liveTriangles));
+    return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* destination, const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount)
+{
+    unsigned int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of each vertex, the live ones first.
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int i = 0; i < indexCount; ++i)
+        liveTriangles[indices[i]]++;
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount, 0);
+    unsigned int offset = 0;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v] = offset;
+        offset += liveTriangles[v];
+    }
+
+    std::vector<unsigned int> adjacency(indexCount);
+    std::vector<unsigned int> fill(adjacencyOffsets);
+    for (unsigned int i = 0; i < indexCount; ++i)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        vertexScores[v] = vertexScore(-1, liveTriangles[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    int bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (unsigned int t = 0; t < triangleCount; ++t)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > bestScore)
+        {
+            bestScore = triangleScores[t];
+            bestTriangle = (int)t;
+        }
+    }
+
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> newCache;
+    cache.reserve(VERTEX_CACHE_SIZE + 3);
+    newCache.reserve(VERTEX_CACHE_SIZE + 3);
+    unsigned int cursor = 0;
+
+    for (unsigned int output = 0; output < triangleCount; ++output)
+    {
+        // No triangle around the cache, take the next one in the input order.
+        if (bestTriangle < 0)
+        {
+            while (emitted[cursor])
+                ++cursor;
+            bestTriangle = (int)cursor;
+        }
+
+        unsigned int t = (unsigned int)bestTriangle;
+        const unsigned int* tri = indices + t * 3;
+        destination[output * 3 + 0] = tri[0];
+        destination[output * 3 + 1] = tri[1];
+        destination[output * 3 + 2] = tri[2];
+        emitted[t] = true;
+
+        // Removes the triangle from the live ones of its vertices.
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = tri[k];
+            unsigned int* list = &adjacency[adjacencyOffsets[v]];
+            unsigned int count = liveTriangles[v];
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                if (list[i] == t)
+                {
+                    std::swap(list[i], list[count - 1]);
+                    liveTriangles[v]--;
+                    break;
+                }
+            }
+        }
+
+        // The vertices of the triangle move to the front of the cache.
+        newCache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::find(newCache.begin(), newCache.end(), tri[k]) == newCache.end())
+                newCache.push_back(tri[k]);
+        }
+        for (unsigned int v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache.push_back(v);
+        }
+
+        // Updates the scores of the vertices which moved, in the cache or out of it.
+        for (unsigned int i = 0; i < newCache.size(); ++i)
+        {
+            unsigned int v = newCache[i];
+            cachePositions[v] = i < VERTEX_CACHE_SIZE ? (int)i : -1;
+            float score = vertexScore(cachePositions[v], liveTriangles[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+            for (unsigned int j = 0; j < liveTriangles[v]; ++j)
+                triangleScores[list[j]] += delta;
+        }
+        if (newCache.size() > VERTEX_CACHE_SIZE)
+            newCache.resize(VERTEX_CACHE_SIZE);
+        cache.swap(newCache);
+
+        // The next triangle is the best one using a vertex of the cache.
+        bestTriangle = -1;
+        bestScore = -1.0f;
+        for (unsigned int v : cache)
+        {
+            const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+            for (unsigned int j = 0; j < liveTriangles[v]; ++j)
+            {
+                if (triangleScores[list[j]] > bestScore)
+                {
+                    bestScore = triangleScores[list[j]];
+                    bestTriangle = (int)list[j];
+                }
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FIFO cache simulation
+
+struct FifoCache
+{
+    std::vector<unsigned int> timestamps;
+    unsigned int timestamp;
+    unsigned int size;
+
+    FifoCache(unsigned int vertexCount, unsigned int cacheSize) : timestamps(vertexCount, 0), timestamp(cacheSize + 1), size(cacheSize)
+    {
+    }
+
+    void reset()
+    {
+        timestamp += size + 1;
+    }
+
+    unsigned int update(const unsigned int* tri)
+    {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (timestamp - timestamps[tri[k]] > size)
+            {
+                timestamps[tri[k]] = timestamp++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+};
+
+float MeshOptimizer::computeACMR(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+    unsigned int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return 0;
+
+    FifoCache cache(vertexCount, cacheSize);
+    unsigned int misses = 0;
+    for (unsigned int t = 0; t < triangleCount; ++t)
+        misses += cache.update(indices + t * 3);
+    return float(misses) / float(triangleCount);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// overdraw
+
+void MeshOptimizer::optimizeOverdraw(unsigned int* destination, const unsigned int* indices, unsigned int indexCount,
+    const char* positions, unsigned int vertexCount, unsigned int stride, float threshold)
+{
+    unsigned int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Hard boundaries where the cache misses all the vertices of a triangle, a new patch starts there.
+    std::vector<unsigned int> hardClusters;
+    FifoCache cache(vertexCount, FIFO_CACHE_SIZE);
+    for (unsigned int t = 0; t < triangleCount; ++t)
+    {
+        if (cache.update(indices + t * 3) == 3 || t == 0)
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries in the patches, where splitting keeps the cache efficiency within the threshold.
+    std::vector<unsigned int> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+    {
+        unsigned int start = hardClusters[c];
+        unsigned int end = hardClusters[c + 1];
+
+        cache.reset();
+        unsigned int misses = 0;
+        for (unsigned int t = start; t < end; ++t)
+            misses += cache.update(indices + t * 3);
+        float clusterThreshold = threshold * float(misses) / float(end - start);
+
+        cache.reset();
+        clusters.push_back(start);
+        unsigned int clusterStart = start;
+        unsigned int running = 0;
+        for (unsigned int t = start; t + 1 < end; ++t)
+        {
+            running += cache.update(indices + t * 3);
+            if (float(running) / float(t - clusterStart + 1) <= clusterThreshold)
+            {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                running = 0;
+                cache.reset();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Centroid of the mesh.
+    double meshCentroid[3] = { 0, 0, 0 };
+    for (unsigned int i = 0; i < indexCount; ++i)
+    {
+        const float* p = (const float*)(positions + indices[i] * stride);
+        meshCentroid[0] += p[0];
+        meshCentroid[1] += p[1];
+        meshCentroid[2] += p[2];
+    }
+    for (int k = 0; k < 3; ++k)
+        meshCentroid[k] /= indexCount;
+
+    // Clusters facing away from the center are drawn first, they are likely to occlude the others.
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float centroid[3] = { 0, 0, 0 };
+        float normal[3] = { 0, 0, 0 };
+        float area = 0;
+        for (unsigned int t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const float* p0 = (const float*)(positions + indices[t * 3 + 0] * stride);
+            const float* p1 = (const float*)(positions + indices[t * 3 + 1] * stride);
+            const float* p2 = (const float*)(positions + indices[t * 3 + 2] * stride);
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * a;
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+
+        float inverseArea = area == 0 ? 0 : 1.0f / area;
+        float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float inverseNormalLength = normalLength == 0 ? 0 : 1.0f / normalLength;
+        float key = 0;
+        for (int k = 0; k < 3; ++k)
+            key += (centroid[k] * inverseArea - (float)meshCentroid[k]) * normal[k] * inverseNormalLength;
+        sortKeys[c] = key;
+    }
+
+    std::vector<unsigned int> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = (unsigned int)c;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    unsigned int output = 0;
+    for (unsigned int c : order)
+    {
+        for (unsigned int t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            destination[output++] = indices[t * 3 + 0];
+            destination[output++] = indices[t * 3 + 1];
+            destination[output++] = indices[t * 3 + 2];
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// vertex fetch and welding
+
+unsigned int MeshOptimizer::optimizeVertexFetch(unsigned int* remap, const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount)
+{
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        remap[v] = ~0u;
+
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < indexCount; ++i)
+    {
+        if (remap[indices[i]] == ~0u)
+            remap[indices[i]] = next++;
+    }
+    return next;
+}
+
+static unsigned int hashVertex(const char* vertex, unsigned int size)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (unsigned int i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)vertex[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+unsigned int MeshOptimizer::weldVertices(unsigned int* remap, const char* vertices, unsigned int vertexCount, unsigned int vertexSize)
+{
+    unsigned int tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize *= 2;
+    std::vector<unsigned int> table(tableSize, ~0u);
+
+    unsigned int unique = 0;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const char* vertex = vertices + v * vertexSize;
+        unsigned int slot = hashVertex(vertex, vertexSize) & (tableSize - 1);
+        // Linear probing until the vertex or an empty slot.
+        while (table[slot] != ~0u && memcmp(vertices + table[slot] * vertexSize, vertex, vertexSize) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == ~0u)
+        {
+            table[slot] = v;
+            ++unique;
+        }
+        remap[v] = table[slot];
+    }
+    return unique;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void MeshOptimizer::Statistics::add(const Statistics& other)
+{
+    unsigned int triangles = triangleCount + other.triangleCount;
+    if (triangles)
+    {
+        acmrBefore = (acmrBefore * triangleCount + other.acmrBefore * other.triangleCount) / triangles;
+        acmrAfter = (acmrAfter * triangleCount + other.acmrAfter * other.triangleCount) / triangles;
+    }
+    if (vertexCountBefore + other.vertexCountBefore)
+        atvrBefore = (atvrBefore * vertexCountBefore + other.atvrBefore * other.vertexCountBefore) / (vertexCountBefore + other.vertexCountBefore);
+    if (vertexCountAfter + other.vertexCountAfter)
+        atvrAfter = (atvrAfter * vertexCountAfter + other.atvrAfter * other.vertexCountAfter) / (vertexCountAfter + other.vertexCountAfter);
+
+    triangleCount = triangles;
+    vertexCountBefore += other.vertexCountBefore;
+    vertexCountAfter += other.vertexCountAfter;
+    indexBytesBefore += other.indexBytesBefore;
+    indexBytesAfter += other.indexBytesAfter;
+    vertexBytesBefore += other.vertexBytesBefore;
+    vertexBytesAfter += other.vertexBytesAfter;
+}
+
+bool MeshOptimizer::optimize(Mesh* mesh, Statistics* stats)
+{
+    if (mesh->_primitiveType != Mesh::TRIANGLES || mesh->_dynamic)
+        return false;
+
+    RenderBuffer* vertexBuffer = mesh->_vertexBuffer.get();
+    RenderBuffer* indexBuffer = mesh->_indexBuffer.get();
+    unsigned int vertexSize = mesh->_vertexFormat.getVertexSize();
+    unsigned int vertexCount = mesh->_vertexCount;
+    if (!vertexBuffer->_data || vertexSize == 0 || vertexCount == 0 || (unsigned int)vertexBuffer->_dataSize < vertexCount * vertexSize)
+        return false;
+
+    // The parts created with createMeshPart() index the same buffers.
+    if (vertexBuffer->getRefCount() > 1 || indexBuffer->getRefCount() > 1)
+        return false;
+
+    std::vector<unsigned int> indices;
+    if (mesh->_isIndexed)
+    {
+        if (!indexBuffer->_data || mesh->_bufferOffset + mesh->_indexCount * mesh->getIndexSize() > (unsigned int)indexBuffer->_dataSize)
+            return false;
+        indices.resize(mesh->_indexCount);
+        const char* data = indexBuffer->_data + mesh->_bufferOffset;
+        for (int i = 0; i < mesh->_indexCount; ++i)
+        {
+            indices[i] = mesh->_indexFormat == Mesh::INDEX16 ? ((const uint16_t*)data)[i] : ((const uint32_t*)data)[i];
+            if (indices[i] >= vertexCount)
+                return false;
+        }
+    }
+    else
+    {
+        indices.resize(vertexCount);
+        for (unsigned int i = 0; i < vertexCount; ++i)
+            indices[i] = i;
+    }
+    unsigned int indexCount = (unsigned int)indices.size();
+    if (indexCount == 0 || indexCount % 3 != 0)
+        return false;
+
+    if (stats)
+    {
+        stats->triangleCount = indexCount / 3;
+        stats->vertexCountBefore = vertexCount;
+        stats->indexBytesBefore = mesh->_isIndexed ? indexCount * mesh->getIndexSize() : 0;
+        stats->acmrBefore = computeACMR(indices.data(), indexCount, vertexCount);
+        stats->atvrBefore = stats->acmrBefore * (indexCount / 3) / vertexCount;
+    }
+
+    // Welding points the indices to the first of the equal vertices, the others become unused.
+    std::vector<unsigned int> remap(vertexCount);
+    weldVertices(remap.data(), vertexBuffer->_data, vertexCount, vertexSize);
+    for (unsigned int i = 0; i < indexCount; ++i)
+        indices[i] = remap[indices[i]];
+
+    std::vector<unsigned int> optimized(indexCount);
+    optimizeVertexCache(optimized.data(), indices.data(), indexCount, vertexCount);
+
+    const VertexFormat::Element* position = mesh->_vertexFormat.getPositionElement();
+    if (position && position->dataType == VertexFormat::FLOAT32 && position->size >= 3)
+    {
+        optimizeOverdraw(indices.data(), optimized.data(), indexCount, vertexBuffer->_data + position->offset, vertexCount, vertexSize);
+    }
+    else if (position && position->size >= 3)
+    {
+        std::vector<float> positions(vertexCount * 4);
+        for (unsigned int v = 0; v < vertexCount; ++v)
+            position->decode(vertexBuffer->_data + v * vertexSize, &positions[v * 4]);
+        optimizeOverdraw(indices.data(), optimized.data(), indexCount, (const char*)positions.data(), vertexCount, 4 * sizeof(float));
+    }
+    else
+    {
+        indices.swap(optimized);
+    }
+
+    unsigned int newVertexCount = optimizeVertexFetch(remap.data(), indices.data(), indexCount, vertexCount);
+    char* vertices = (char*)malloc(newVertexCount * vertexSize);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] != ~0u)
+            memcpy(vertices + remap[v] * vertexSize, vertexBuffer->_data + v * vertexSize, vertexSize);
+    }
+    for (unsigned int i = 0; i < indexCount; ++i)
+        indices[i] = remap[indices[i]];
+
+    Mesh::IndexFormat indexFormat = newVertexCount <= 0xFFFF ? Mesh::INDEX16 : Mesh::INDEX32;
+    unsigned int indexSize = indexFormat == Mesh::INDEX16 ? 2 : 4;
+    char* indexData = (char*)malloc(indexCount * indexSize);
+    for (unsigned int i = 0; i < indexCount; ++i)
+    {
+        if (indexFormat == Mesh::INDEX16)
+            ((uint16_t*)indexData)[i] = (uint16_t)indices[i];
+        else
+            ((uint32_t*)indexData)[i] = indices[i];
+    }
+
+    if (stats)
+    {
+        stats->vertexBytesBefore = vertexCount * vertexSize;
+        stats->vertexBytesAfter = newVertexCount * vertexSize;
+    }
+
+    vertexBuffer->setData(vertices, newVertexCount * vertexSize, false);
+    indexBuffer->setData(indexData, indexCount * indexSize, false);
+    mesh->_vertexCount = newVertexCount;
+    mesh->_indexFormat = indexFormat;
+    mesh->setIndex(Mesh::TRIANGLES, indexCount, 0);
+
+    if (stats)
+    {
+        stats->vertexCountAfter = newVertexCount;
+        stats->indexBytesAfter = indexCount * indexSize;
+        stats->acmrAfter = computeACMR(indices.data(), indexCount, newVertexCount);
+        stats->atvrAfter = stats->acmrAfter * (indexCount / 3) / newVertexCount;
+    }
+    return true;
+}
+
+static bool isInRange(const VertexFormat::Element& element, const char* vertices, unsigned int vertexCount, unsigned int vertexSize, float min, float max)
+{
+    float values[4];
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        element.decode(vertices + v * vertexSize, values);
+        for (unsigned int i = 0; i < element.size; ++i)
+        {
+            if (!(values[i] >= min && values[i] <= max))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool MeshOptimizer::compressVertices(Mesh* mesh, Statistics* stats)
+{
+    if (mesh->_dynamic)
+        return false;
+
+    RenderBuffer* vertexBuffer = mesh->_vertexBuffer.get();
+    const VertexFormat& format = mesh->_vertexFormat;
+    unsigned int vertexSize = format.getVertexSize();
+    unsigned int vertexCount = mesh->_vertexCount;
+    if (!vertexBuffer->_data || vertexSize == 0 || vertexCount == 0 || (unsigned int)vertexBuffer->_dataSize < vertexCount * vertexSize)
+        return false;
+    if (vertexBuffer->getRefCount() > 1)
+        return false;
+
+    std::vector<VertexFormat::Element> elements;
+    bool changed = false;
+    for (unsigned int i = 0; i < format.getElementCount(); ++i)
+    {
+        VertexFormat::Element element = format.getElement(i);
+        // only interleaved vertices are repacked
+        if ((unsigned int)element.stride != vertexSize)
+            return false;
+        element.offset = -1;
+        element.stride = -1;
+        if (element.dataType != VertexFormat::FLOAT32)
+        {
+            elements.push_back(element);
+            continue;
+        }
+
+        const VertexFormat::Element& source = format.getElement(i);
+        if ((element.usage == VertexFormat::NORMAL || element.usage == VertexFormat::TANGENT) && element.size >= 3 &&
+            isInRange(source, vertexBuffer->_data, vertexCount, vertexSize, -1.0f, 1.0f))
+        {
+            element.dataType = VertexFormat::INT_2_10_10_10;
+            element.size = 4;
+            element.normalized = true;
+            changed = true;
+        }
+        else if (element.usage >= VertexFormat::TEXCOORD0 && element.usage <= VertexFormat::TEXCOORD7 &&
+            isInRange(source, vertexBuffer->_data, vertexCount, vertexSize, -HALF_TEXCOORD_RANGE, HALF_TEXCOORD_RANGE))
+        {
+            element.dataType = VertexFormat::HALF_FLOAT;
+            changed = true;
+        }
+        else if (element.usage == VertexFormat::COLOR && isInRange(source, vertexBuffer->_data, vertexCount, vertexSize, 0.0f, 1.0f))
+        {
+            element.dataType = VertexFormat::UINT8;
+            element.normalized = true;
+            changed = true;
+        }
+        elements.push_back(element);
+    }
+    if (!changed)
+        return false;
+
+    VertexFormat compressed(elements.data(), (unsigned int)elements.size());
+    unsigned int compressedSize = compressed.getVertexSize();
+    char* vertices = (char*)calloc(vertexCount, compressedSize);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const char* src = vertexBuffer->_data + v * vertexSize;
+        char* dst = vertices + v * compressedSize;
+        for (unsigned int i = 0; i < compressed.getElementCount(); ++i)
+        {
+            // the w of packed normals is 0
+            float values[4] = { 0, 0, 0, 0 };
+            format.getElement(i).decode(src, values);
+            compressed.getElement(i).encode(dst, values);
+        }
+    }
+
+    if (stats)
+    {
+        // keeps the size before a previous optimize()
+        if (stats->vertexBytesBefore == 0)
+            stats->vertexBytesBefore = vertexCount * vertexSize;
+        stats->vertexBytesAfter = vertexCount * compressedSize;
+    }
+
+    vertexBuffer->setData(vertices, vertexCount * compressedSize, false);
+    mesh->_vertexFormat = compressed;
+    mesh->setVertexFormatDirty();
+    return true;
+}
+
+}
@@ -0,0 +1,123 @@
+#ifndef MESHOPTIMIZER_H_
+#define MESHOPTIMIZER_H_
+
+#include "Mesh.h"
+
+namespace mgp
+{
+
+/**
+ * Defines the optimizations of the triangle lists of meshes for rendering.
+ *
+ * Duplicate vertices are welded, triangles are reordered for the post-transform vertex cache,
+ * and then in clusters to draw the outer surfaces first and reduce overdraw. The vertices are
+ * reordered in the order the triangles fetch them, and 32-bit indices are narrowed to 16-bit
+ * when the vertex count allows.
+ *
+ * Meshes are optimized before they are uploaded, at import time or when they are saved.
+ * Their vertex attributes may also be compressed to the compact data types of VertexFormat.
+ */
+class MeshOptimizer
+{
+public:
+
+    /**
+     * The statistics of an optimization.
+     */
+    struct Statistics
+    {
+        unsigned int triangleCount = 0;
+        unsigned int vertexCountBefore = 0;
+        unsigned int vertexCountAfter = 0;
+        unsigned int indexBytesBefore = 0;
+        unsigned int indexBytesAfter = 0;
+
+        /**
+         * Average cache miss ratio, the number of transformed vertices per triangle, 0.5 at best and 3 at worst.
+         */
+        float acmrBefore = 0;
+        float acmrAfter = 0;
+
+        /**
+         * Average transformed vertex ratio, the number of transformed vertices per vertex, 1 at best.
+         */
+        float atvrBefore = 0;
+        float atvrAfter = 0;
+
+        unsigned int vertexBytesBefore = 0;
+        unsigned int vertexBytesAfter = 0;
+
+        /**
+         * Adds the statistics of another mesh, the ratios are averaged over the triangles and vertices.
+         */
+        void add(const Statistics& other);
+    };
+
+    /**
+     * Optimizes the triangles and vertices of a mesh in place.
+     *
+     * Only indexed or non indexed triangle lists with their vertex data in memory are optimized,
+     * dynamic meshes and meshes sharing their buffers with other parts are left as they are.
+     *
+     * @param mesh The mesh to optimize.
+     * @param stats The statistics to fill, may be NULL.
+     *
+     * @return True if the mesh was optimized.
+     */
+    static bool optimize(Mesh* mesh, Statistics* stats = NULL);
+
+    /**
+     * Compresses the float vertex attributes of a mesh in place.
+     *
+     * Normals and tangents are packed in 10-10-10-2 bits, texture coordinates within [-2, 2] become
+     * half floats and colors normalized bytes. Values out of the range of a compact type stay in floats,
+     * as do positions, skinning and morph target attributes.
+     *
+     * @param mesh The mesh to compress.
+     * @param stats The statistics to fill, may be NULL. The vertex bytes before of a previous optimize() are kept.
+     *
+     * @return True if the vertex format of the mesh changed.
+     */
+    static bool compressVertices(Mesh* mesh, Statistics* stats = NULL);
+
+    /**
+     * Finds the vertices with the same bytes.
+     *
+     * @param remap Receives for each vertex the index of the first vertex equal to it.
+     *
+     * @return The number of unique vertices.
+     */
+    static unsigned int weldVertices(unsigned int* remap, const char* vertices, unsigned int vertexCount, unsigned int vertexSize);
+
+    /**
+     * Reorders the triangles for the post-transform vertex cache, with the algorithm of Tom Forsyth.
+     */
+    static void optimizeVertexCache(unsigned int* destination, const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount);
+
+    /**
+     * Reorders clusters of triangles of a cache optimized list to draw the outer ones first.
+     *
+     * @param positions The vertex positions, 3 floats at each stride bytes.
+     * @param threshold How much the cache efficiency may degrade to split the clusters, 1.05 keeps it within 5%.
+     */
+    static void optimizeOverdraw(unsigned int* destination, const unsigned int* indices, unsigned int indexCount,
+        const char* positions, unsigned int vertexCount, unsigned int stride, float threshold = 1.05f);
+
+    /**
+     * Computes the order of the vertices in the order the triangles use them.
+     *
+     * @param remap Receives the new index of each vertex, or -1 for the unused vertices.
+     *
+     * @return The number of used vertices.
+     */
+    static unsigned int optimizeVertexFetch(unsigned int* remap, const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount);
+
+    /**
+     * Computes the average cache miss ratio of a triangle list, for a FIFO cache of the given size.
+     */
+    static float computeACMR(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize = 16);
+};
+
+}
+
+#endif
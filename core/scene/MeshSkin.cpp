@@ -10,12 +10,11 @@ namespace mgp
 
 void BoneJoint::write(Stream* file) {
     file->writeStr(this->_name);
-    file->write((char*)&_bindPose.m, sizeof(_bindPose.m));
+    file->writeDoubleArray(_bindPose.m, 16);
 }
 bool BoneJoint::read(Stream* file) {
     _name = file->readStr();
-    file->read(&_bindPose, sizeof(Matrix), 1);
-    return true;
+    return file->readDoubleArray(_bindPose.m, 16) == 16;
 }
 
 MeshSkin::MeshSkin()
@@ -104,6 +104,10 @@ public:
     virtual void draw(DrawCall* drawCall) = 0;
 public:
     virtual void updateTexture(Texture* texture) = 0;
+    /**
+    * Replaces a rectangle of level 0 of an uploaded 2D texture, data is tightly packed.
+    */
+    virtual void updateTextureRegion(Texture* texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height, const unsigned char* data) = 0;
     virtual void deleteTexture(Texture* texture) = 0;
     virtual void bindTextureSampler(Texture* texture) = 0;
 
@@ -39,24 +39,9 @@ void VertexFormat::update() {
         else {
             continue;
         }
-        int byteSize = 0;
-        switch (_elements[i].dataType) {
-        case FLOAT32:
-            byteSize = _elements[i].size * sizeof(float);
-            break;
-        case INT32:
-            byteSize = _elements[i].size * 4;
-            break;
-        case INT16:
-            byteSize = _elements[i].size * 2;
-            break;
-        case INT8:
-            byteSize = _elements[i].size * 1;
-            break;
-        default:
-            GP_ASSERT(0);
-        }
-        _vertexSize += byteSize;
+        int byteSize = _elements[i].getByteSize();
+        // keep the attributes 4 bytes aligned, as GPUs want them
+        _vertexSize += (byteSize + 3) & ~3;
     }
 
     for (unsigned int i = 0; i < _elements.size(); ++i)
@@ -138,7 +123,7 @@ VertexFormat::Element::Element(const std::string &name, unsigned int size) : usa
 
 bool VertexFormat::Element::operator == (const VertexFormat::Element& e) const
 {
-    return (size == e.size && usage == e.usage);
+    return (size == e.size && usage == e.usage && dataType == e.dataType && normalized == e.normalized);
 }
 
 bool VertexFormat::Element::operator != (const VertexFormat::Element& e) const
@@ -146,6 +131,224 @@ bool VertexFormat::Element::operator != (const VertexFormat::Element& e) const
     return !(*this == e);
 }
 
+unsigned int VertexFormat::Element::getByteSize() const
+{
+    switch (dataType) {
+    case FLOAT32:
+    case INT32:
+        return size * 4;
+    case INT16:
+    case UINT16:
+    case HALF_FLOAT:
+        return size * 2;
+    case INT8:
+    case UINT8:
+        return size;
+    case INT_2_10_10_10:
+    case UINT_2_10_10_10:
+        return 4;
+    default:
+        GP_ASSERT(0);
+        return 0;
+    }
+}
+
+bool VertexFormat::Element::isInteger() const
+{
+    switch (dataType) {
+    case INT8:
+    case UINT8:
+    case INT16:
+    case UINT16:
+    case INT32:
+        return !normalized;
+    default:
+        return false;
+    }
+}
+
+static float halfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+    float f;
+    if (exponent == 0) {
+        // zero and subnormals
+        f = mantissa * (1.0f / (1 << 24));
+        return sign ? -f : f;
+    }
+    uint32_t bits;
+    if (exponent == 31)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+static uint16_t floatToHalf(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7FFFFFFF;
+    if (absBits >= 0x7F800000)
+        return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0);
+    // too large values become infinity
+    if (absBits >= 0x477FF000)
+        return sign | 0x7C00;
+    // subnormals, rounded to nearest
+    if (absBits < 0x38800000) {
+        float a;
+        memcpy(&a, &absBits, 4);
+        return sign | (uint16_t)(a * (1 << 24) + 0.5f);
+    }
+    // round to nearest even
+    uint32_t rounded = absBits + 0xFFF + ((absBits >> 13) & 1);
+    return sign | (uint16_t)((rounded - 0x38000000) >> 13);
+}
+
+static float clampValue(float v, float min, float max)
+{
+    return v < min ? min : (v > max ? max : v);
+}
+
+void VertexFormat::Element::decode(const char* vertex, float* values) const
+{
+    const char* p = vertex + offset;
+    switch (dataType) {
+    case FLOAT32:
+        memcpy(values, p, size * 4);
+        break;
+    case HALF_FLOAT:
+        for (unsigned int i = 0; i < size; ++i) {
+            uint16_t h;
+            memcpy(&h, p + i * 2, 2);
+            values[i] = halfToFloat(h);
+        }
+        break;
+    case INT8:
+        for (unsigned int i = 0; i < size; ++i)
+            values[i] = normalized ? std::max(((const int8_t*)p)[i] / 127.0f, -1.0f) : ((const int8_t*)p)[i];
+        break;
+    case UINT8:
+        for (unsigned int i = 0; i < size; ++i)
+            values[i] = normalized ? ((const uint8_t*)p)[i] / 255.0f : ((const uint8_t*)p)[i];
+        break;
+    case INT16:
+        for (unsigned int i = 0; i < size; ++i) {
+            int16_t v;
+            memcpy(&v, p + i * 2, 2);
+            values[i] = normalized ? std::max(v / 32767.0f, -1.0f) : v;
+        }
+        break;
+    case UINT16:
+        for (unsigned int i = 0; i < size; ++i) {
+            uint16_t v;
+            memcpy(&v, p + i * 2, 2);
+            values[i] = normalized ? v / 65535.0f : v;
+        }
+        break;
+    case INT32:
+        for (unsigned int i = 0; i < size; ++i) {
+            int32_t v;
+            memcpy(&v, p + i * 4, 4);
+            values[i] = (float)v;
+        }
+        break;
+    case INT_2_10_10_10:
+    case UINT_2_10_10_10: {
+        uint32_t packed;
+        memcpy(&packed, p, 4);
+        bool isSigned = dataType == INT_2_10_10_10;
+        for (unsigned int i = 0; i < size && i < 4; ++i) {
+            int bits = i < 3 ? 10 : 2;
+            uint32_t field = (packed >> (i * 10)) & ((1u << bits) - 1);
+            float v;
+            if (isSigned) {
+                // sign extend the field
+                int32_t s = (int32_t)(field << (32 - bits)) >> (32 - bits);
+                v = normalized ? std::max(s / (float)((1 << (bits - 1)) - 1), -1.0f) : s;
+            }
+            else {
+                v = normalized ? field / (float)((1 << bits) - 1) : field;
+            }
+            values[i] = v;
+        }
+        break;
+    }
+    default:
+        GP_ASSERT(0);
+        break;
+    }
+}
+
+void VertexFormat::Element::encode(char* vertex, const float* values) const
+{
+    char* p = vertex + offset;
+    switch (dataType) {
+    case FLOAT32:
+        memcpy(p, values, size * 4);
+        break;
+    case HALF_FLOAT:
+        for (unsigned int i = 0; i < size; ++i) {
+            uint16_t h = floatToHalf(values[i]);
+            memcpy(p + i * 2, &h, 2);
+        }
+        break;
+    case INT8:
+        for (unsigned int i = 0; i < size; ++i)
+            ((int8_t*)p)[i] = (int8_t)(normalized ? roundf(clampValue(values[i], -1, 1) * 127.0f) : roundf(clampValue(values[i], -128, 127)));
+        break;
+    case UINT8:
+        for (unsigned int i = 0; i < size; ++i)
+            ((uint8_t*)p)[i] = (uint8_t)(normalized ? roundf(clampValue(values[i], 0, 1) * 255.0f) : roundf(clampValue(values[i], 0, 255)));
+        break;
+    case INT16:
+        for (unsigned int i = 0; i < size; ++i) {
+            int16_t v = (int16_t)(normalized ? roundf(clampValue(values[i], -1, 1) * 32767.0f) : roundf(clampValue(values[i], -32768, 32767)));
+            memcpy(p + i * 2, &v, 2);
+        }
+        break;
+    case UINT16:
+        for (unsigned int i = 0; i < size; ++i) {
+            uint16_t v = (uint16_t)(normalized ? roundf(clampValue(values[i], 0, 1) * 65535.0f) : roundf(clampValue(values[i], 0, 65535)));
+            memcpy(p + i * 2, &v, 2);
+        }
+        break;
+    case INT32:
+        for (unsigned int i = 0; i < size; ++i) {
+            int32_t v = (int32_t)roundf(values[i]);
+            memcpy(p + i * 4, &v, 4);
+        }
+        break;
+    case INT_2_10_10_10:
+    case UINT_2_10_10_10: {
+        uint32_t packed = 0;
+        bool isSigned = dataType == INT_2_10_10_10;
+        for (unsigned int i = 0; i < size && i < 4; ++i) {
+            int bits = i < 3 ? 10 : 2;
+            uint32_t mask = (1u << bits) - 1;
+            int32_t v;
+            if (isSigned) {
+                int32_t max = (1 << (bits - 1)) - 1;
+                v = normalized ? (int32_t)roundf(clampValue(values[i], -1, 1) * max) : (int32_t)roundf(clampValue(values[i], (float)(-max - 1), (float)max));
+            }
+            else {
+                v = normalized ? (int32_t)roundf(clampValue(values[i], 0, 1) * mask) : (int32_t)roundf(clampValue(values[i], 0, (float)mask));
+            }
+            packed |= ((uint32_t)v & mask) << (i * 10);
+        }
+        memcpy(p, &packed, 4);
+        break;
+    }
+    default:
+        GP_ASSERT(0);
+        break;
+    }
+}
+
 const char* VertexFormat::toString(Usage usage)
 {
     switch (usage)
@@ -190,7 +393,7 @@ void VertexFormat::Element::write(Stream* file) const  {
     file->writeUInt16(size);
     file->writeInt16(offset);
     file->writeInt16(stride);
-    file->writeInt16(dataType);
+    file->writeUInt16(dataType);
     file->writeStr(name);
 }
 bool VertexFormat::Element::read(Stream* file) {
@@ -198,7 +401,7 @@ bool VertexFormat::Element::read(Stream* file) {
     size = file->readUInt16();
     offset = file->readInt16();
     stride = file->readInt16();
-    dataType = (VertexFormat::DataType)file->readInt16();
+    dataType = (VertexFormat::DataType)file->readUInt16();
     name = file->readStr();
     return true;
 }
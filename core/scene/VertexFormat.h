@@ -58,18 +58,26 @@ public:
 
     enum DataType {
         INT8 = 0x1400,
+        UINT8 = 0x1401,
         INT16 = 0x1402,
+        UINT16 = 0x1403,
         INT32 = 0x1404,
         FLOAT32 = 0x1406,
+        HALF_FLOAT = 0x140B,
+        /**
+         * 4 values packed in 32 bits, 10 bits for x, y and z and 2 bits for w, for normals and tangents.
+         */
+        INT_2_10_10_10 = 0x8D9F,
+        UINT_2_10_10_10 = 0x8368,
     };
 
     /**
      * Defines a single element within a vertex format.
      *
-     * All vertex elements are assumed to be of type float, but can
-     * have a varying number of float values (1-4), which is represented
-     * by the size attribute. Additionally, vertex elements are assumed
-     * to be tightly packed.
+     * Vertex elements have a varying number of values (1-4), which is represented
+     * by the size attribute, stored as floats by default. Compact data types are
+     * read as floats by the shaders when they are half floats, packed or normalized,
+     * and as integers otherwise. The elements are packed with a 4 bytes alignment.
      */
     class Element
     {
@@ -104,6 +112,11 @@ public:
         */
         DataType dataType = FLOAT32;
 
+        /**
+        * integer data read as float in [0, 1] or [-1, 1], such as quantized normals and texcoords
+        */
+        bool normalized = false;
+
         /**
          * Constructor.
          */
@@ -137,6 +150,33 @@ public:
          */
         bool operator != (const Element& e) const;
 
+        /**
+         * Gets the size of the element in a vertex in bytes, without the alignment.
+         */
+        unsigned int getByteSize() const;
+
+        /**
+         * Returns true if the shaders read the element as integers, false if as floats.
+         */
+        bool isInteger() const;
+
+        /**
+         * Reads the values of the element in a vertex, converted to floats.
+         *
+         * @param vertex The vertex data.
+         * @param values Receives the size values, room for 4 is needed as the size is up to 4.
+         */
+        void decode(const char* vertex, float* values) const;
+
+        /**
+         * Writes the values of the element in a vertex, converted from floats.
+         * Normalized values are clamped to their range.
+         *
+         * @param vertex The vertex data.
+         * @param values The size values.
+         */
+        void encode(char* vertex, const float* values) const;
+
         void write(Stream* file) const;
         bool read(Stream* file);
     };
@@ -534,6 +534,8 @@ void Application::frame()
     Platform::cur()->fireTimeEvents();
 
     _renderer->beginFrame();
+    FontCache::beginFrame();
+    AssetManager::beginFrame();
     if (_state == Application::Runing)
     {
         GP_ASSERT(_animationController);
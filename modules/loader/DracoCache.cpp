@@ -48,6 +48,10 @@ DracoMesh* DracoCache::findOrCreateMesh(const cgltf_buffer_view* key) {
     return mesh;
 }
 
+void DracoCache::addMesh(const cgltf_buffer_view* key, DracoMesh* mesh) {
+    mCache[key].reset(mesh);
+}
+
 DracoMesh::DracoMesh(struct DracoMeshDetails* details) : mDetails(details) {}
 
 #if GLTFIO_DRACO_SUPPORTED
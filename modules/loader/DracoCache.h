@@ -38,6 +38,9 @@ class DracoMesh;
 class DracoCache {
 public:
     DracoMesh* findOrCreateMesh(const cgltf_buffer_view* key);
+
+    // Adds a mesh decoded beforehand, possibly on another thread. Takes ownership of the mesh.
+    void addMesh(const cgltf_buffer_view* key, DracoMesh* mesh);
 private:
     std::map<const cgltf_buffer_view*, std::unique_ptr<DracoMesh>> mCache;
 };
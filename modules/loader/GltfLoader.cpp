@@ -10,6 +10,8 @@
 #ifdef GLTFIO_DRACO_SUPPORTED
 	#include "DracoCache.h"
 #endif
+#include "MeshoptDecoder.h"
+#include "scene/MeshOptimizer.h"
 
 #define CGLTF_IMPLEMENTATION
 #include "cgltf.h"
@@ -19,15 +21,126 @@
 #include "material/Image.h"
 #include "base/StringUtil.h"
 
+#include "base/ThreadPool.h"
+
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <memory>
+
 
 using namespace mgp;
 
+/**
+ * The calls of a parallelFor, made by the pool tasks and the calling thread.
+ */
+struct ParallelForState {
+	const std::function<void(int)>* func;
+	int count;
+	std::atomic<int> next;
+	int finished;	// Guarded by mutex.
+	std::mutex mutex;
+	std::condition_variable finishedCond;
+
+	void run() {
+		int n = 0;
+		for (int i = next++; i < count; i = next++) {
+			(*func)(i);
+			++n;
+		}
+		if (n) {
+			std::lock_guard<std::mutex> guard(mutex);
+			finished += n;
+			if (finished == count) {
+				finishedCond.notify_all();
+			}
+		}
+	}
+};
+
+class ParallelForTask : public Task {
+	std::shared_ptr<ParallelForState> _state;
+public:
+	ParallelForTask(const std::shared_ptr<ParallelForState>& state) : _state(state) {}
+
+	void run() override {
+		_state->run();
+	}
+};
+
+/**
+ * Gets the worker threads shared by all the loads, they live until the process exits.
+ */
+static ThreadPool* getThreadPool() {
+	static ThreadPool* threadPool = NULL;
+	static std::once_flag once;
+	std::call_once(once, []() {
+		threadPool = new ThreadPool(std::max((int)std::thread::hardware_concurrency() - 1, 1));
+		threadPool->start();
+	});
+	return threadPool;
+}
+
+/**
+ * Calls func for each index in [0, count) on the worker threads, returns when all the calls are done.
+ */
+static void parallelFor(int count, const std::function<void(int)>& func) {
+	int threadCount = 1;
+#ifndef __EMSCRIPTEN__
+	threadCount = std::min(count, (int)std::thread::hardware_concurrency());
+#endif
+	if (threadCount <= 1) {
+		for (int i = 0; i < count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state(new ParallelForState());
+	state->func = &func;
+	state->count = count;
+	state->next = 0;
+	state->finished = 0;
+	ThreadPool* threadPool = getThreadPool();
+	for (int t = 1; t < threadCount; ++t) {
+		threadPool->addTask(ThreadPool::TaskPtr(new ParallelForTask(state)));
+	}
+
+	// The calling thread works too, so the calls finish even when the workers are busy with other loads.
+	state->run();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finishedCond.wait(lock, [&]() { return state->finished == count; });
+}
+
 #ifdef GLTFIO_DRACO_SUPPORTED
 
 using namespace filament_gltfio;
 
 static void decodeDracoMeshes(DracoCache* dracoCache, cgltf_data* _gltf_data) {
 
+	// Decode the compressed buffers in parallel, the primitives sharing one find it in the cache.
+	std::vector<const cgltf_buffer_view*> views;
+	for (int i = 0; i < _gltf_data->meshes_count; ++i) {
+		auto mesh = _gltf_data->meshes+i;
+		for (int j = 0; j < mesh->primitives_count; ++j) {
+			auto prim = mesh->primitives+j;
+			if (prim->has_draco_mesh_compression) {
+				views.push_back(prim->draco_mesh_compression.buffer_view);
+			}
+		}
+	}
+	std::sort(views.begin(), views.end());
+	views.erase(std::unique(views.begin(), views.end()), views.end());
+	std::vector<DracoMesh*> decoded(views.size());
+	parallelFor(views.size(), [&](int i) {
+		const cgltf_buffer_view* view = views[i];
+		decoded[i] = DracoMesh::decode(view->offset + (const uint8_t*)view->buffer->data, view->size);
+	});
+	for (size_t i = 0; i < views.size(); ++i) {
+		dracoCache->addMesh(views[i], decoded[i]);
+	}
+
 	// For a given primitive and attribute, find the corresponding accessor.
 	auto findAccessor = [](const cgltf_primitive* prim, cgltf_attribute_type type, cgltf_int idx) {
 		for (cgltf_size i = 0; i < prim->attributes_count; i++) {
@@ -103,6 +216,17 @@ class GltfLoaderImp {
 	std::string baseDir;
 	cgltf_data* _gltf_data;
 
+	// Textures decoded on the worker threads, indexed like the images of the gltf data.
+	std::vector<SPtr<Texture> > _textures;
+
+	// Meshes converted on the worker threads, indexed like the meshes of the gltf data.
+	struct ConvertedMesh {
+		std::vector<UPtr<Mesh> > meshes;	// One per primitive, or one shared by all the primitives.
+		bool shared = false;
+		MeshOptimizer::Statistics stats;
+	};
+	std::vector<ConvertedMesh> _meshes;
+
 public:
 	std::map<cgltf_skin*, SPtr<MeshSkin> > _skins;
 
@@ -118,6 +242,9 @@ public:
 #endif
 	}
 	int lighting = 0;
+	float animationCompression = 0;
+	bool optimizeMeshes = false;
+	bool compressVertices = false;
 	UPtr<Scene> load(const char* file) {
 #ifdef  _WIN32
 		std::string fileStr = Utf8ToGbk(file);
@@ -169,18 +296,66 @@ public:
 		return UPtr<Scene>(NULL);
 	}
 private:
-	UPtr<Texture> loadTexture(cgltf_texture* texture) {
-		if (texture->image->uri == NULL && texture->image->buffer_view) {
-			cgltf_buffer_view* buf = texture->image->buffer_view;
+	UPtr<Texture> decodeImage(cgltf_image* cimage) {
+		if (cimage->uri == NULL && cimage->buffer_view) {
+			cgltf_buffer_view* buf = cimage->buffer_view;
 			UPtr<Image> image = Image::createFromBuf((const char*)buf->buffer->data + buf->offset, buf->size, false);
-			UPtr<Texture> t = Texture::create(std::move(image), false);
-			//SAFE_RELEASE(image);
-			return t;
+			if (!image.get()) {
+				return UPtr<Texture>(NULL);
+			}
+			return Texture::create(std::move(image), false);
 		}
-		std::string uri = baseDir + texture->image->uri;
+		if (cimage->uri == NULL) {
+			return UPtr<Texture>(NULL);
+		}
+		std::string uri = baseDir + cimage->uri;
 		StringUtil::replace(uri, "%20", " ");
-		UPtr<Texture> t = Texture::create(uri.c_str(), true);
-		return t;
+		return Texture::create(uri.c_str(), true);
+	}
+
+	/**
+	 * Whether the image decodes to an Image without GL calls, which can be done on a worker thread.
+	 */
+	static bool isDecodedToImage(cgltf_image* cimage) {
+		if (cimage->uri == NULL) {
+			return true;
+		}
+		std::string ext = FileSystem::getExtension(cimage->uri);
+		return ext == ".PNG" || ext == ".JPG" || ext == ".HDR" || ext == ".JPEG" || ext == ".TGA";
+	}
+
+	/**
+	 * Decodes every image once, the textures sharing an image share the decoded texture.
+	 */
+	void decodeImages(cgltf_data* data) {
+		_textures.resize(data->images_count);
+		parallelFor(data->images_count, [&](int i) {
+			if (!isDecodedToImage(data->images + i)) {
+				return;
+			}
+			UPtr<Texture> texture = decodeImage(data->images + i);
+			_textures[i] = texture.get();
+		});
+
+		// Compressed textures (.ktx, .dds, .pvr) are uploaded when created, on the loading thread with the GL context.
+		for (size_t i = 0; i < data->images_count; ++i) {
+			if (isDecodedToImage(data->images + i)) {
+				continue;
+			}
+			UPtr<Texture> texture = decodeImage(data->images + i);
+			_textures[i] = texture.get();
+		}
+	}
+
+	UPtr<Texture> loadTexture(cgltf_texture* texture) {
+		if (!texture->image) {
+			return UPtr<Texture>(NULL);
+		}
+		Texture* t = _textures[texture->image - _gltf_data->images].get();
+		if (!t) {
+			return UPtr<Texture>(NULL);
+		}
+		return uniqueFromInstant(t);
 	}
 
 	UPtr<Material> loadPbrMaterial(cgltf_primitive* primitive, cgltf_material* cmaterial) {
@@ -425,6 +600,44 @@ private:
 		}
 	}
 
+	/**
+	 * Keeps the normalized byte and short attributes of KHR_mesh_quantization quantized on the GPU.
+	 */
+	void setQuantizedType(VertexFormat::Element& element, cgltf_accessor* accessor) {
+		if (!accessor->normalized || accessor->is_sparse || !accessor->buffer_view) {
+			return;
+		}
+		switch (element.usage) {
+		case VertexFormat::POSITION:
+		case VertexFormat::NORMAL:
+		case VertexFormat::TANGENT:
+		case VertexFormat::COLOR:
+		case VertexFormat::BLENDWEIGHTS:
+			break;
+		default:
+			if (element.usage < VertexFormat::TEXCOORD0 || element.usage > VertexFormat::TEXCOORD7) {
+				return;
+			}
+		}
+		switch (accessor->component_type) {
+		case cgltf_component_type_r_8:
+			element.dataType = VertexFormat::INT8;
+			break;
+		case cgltf_component_type_r_8u:
+			element.dataType = VertexFormat::UINT8;
+			break;
+		case cgltf_component_type_r_16:
+			element.dataType = VertexFormat::INT16;
+			break;
+		case cgltf_component_type_r_16u:
+			element.dataType = VertexFormat::UINT16;
+			break;
+		default:
+			return;
+		}
+		element.normalized = true;
+	}
+
 	UPtr<Mesh> loadMeshVertices(std::vector<cgltf_attribute*>& attrs, cgltf_primitive* primitive) {
 		int vertexCount = 0;
 		std::vector<cgltf_accessor*> accessors;
@@ -487,6 +700,7 @@ private:
 				//printf("unsupport attribute type: %s\n", name.c_str());
 				//continue;
 			}
+			setQuantizedType(element, accessor);
 			vertexElemets.push_back(element);
 			accessors.push_back(accessor);
 			if (vertexCount < attr->data->count) {
@@ -527,15 +741,24 @@ private:
 		UPtr<Mesh> mesh = Mesh::createMesh(format, vertexCount, Mesh::INDEX32);
 		int vertexSize = format.getVertexSize();
 		int bufsize = vertexSize * vertexCount;
-		char* data = (char*)malloc(bufsize);
-
-		for (int i = 0; i < vertexCount; ++i) {
-			int offset = 0;
-			for (int j = 0; j < vertexElemets.size(); ++j) {
-				cgltf_accessor* accessor = accessors[j];
-				float* out = (float*)(data + (vertexSize * i) + offset);
+		char* data = (char*)calloc(bufsize, 1);
+
+		for (int j = 0; j < vertexElemets.size(); ++j) {
+			cgltf_accessor* accessor = accessors[j];
+			const VertexFormat::Element& element = format.getElement(j);
+			if (element.dataType != VertexFormat::FLOAT32) {
+				// quantized values are copied as they are
+				const uint8_t* src = cgltf_buffer_view_data(accessor->buffer_view) + accessor->offset;
+				size_t elementSize = cgltf_calc_size(accessor->type, accessor->component_type);
+				int count = std::min((int)accessor->count, vertexCount);
+				for (int i = 0; i < count; ++i) {
+					memcpy(data + (vertexSize * i) + element.offset, src + accessor->stride * i, elementSize);
+				}
+				continue;
+			}
+			for (int i = 0; i < vertexCount; ++i) {
+				float* out = (float*)(data + (vertexSize * i) + element.offset);
 				cgltf_accessor_read_float(accessor, i, out, cgltf_num_components(accessor->type));
-				offset += vertexElemets[j].size * sizeof(float);
 			}
 		}
 
@@ -543,7 +766,7 @@ private:
 		return mesh;
 	}
 
-	void loadPrimitiveToModel(cgltf_primitive* primitive, Model* model) {
+	UPtr<Mesh> convertPrimitive(cgltf_primitive* primitive) {
 		//int vertexCount = 0;
 		std::vector<cgltf_attribute*> attrs;
 		attrs.resize(primitive->attributes_count);
@@ -553,13 +776,14 @@ private:
 		}
 
 		UPtr<Mesh> mesh = loadMeshVertices(attrs, primitive);
-		Mesh* mesh_ = mesh.get();
 		loadPrimitiveIndex(primitive, mesh.get());
-		model->addMesh(std::move(mesh));
-		setMeshMaterial(primitive, model, mesh_);
+		return mesh;
 	}
 
-	Model* loadMesh(cgltf_mesh *cmesh, Node* node) {
+	/**
+	 * Converts the vertex and index data of a mesh, without touching the scene, so runs on a worker thread.
+	 */
+	void convertMesh(cgltf_mesh *cmesh, ConvertedMesh& converted) {
 
 		bool sharedVertexBuf = true;
 		std::vector<cgltf_attribute*> attrs;
@@ -591,12 +815,66 @@ private:
 
 	label1:
 
+		converted.shared = sharedVertexBuf;
 		if (!sharedVertexBuf) {
-			UPtr<Model> model(new Model());
 			for (int i = 0; i < cmesh->primitives_count; ++i) {
 				cgltf_primitive* primitive = cmesh->primitives + i;
-				loadPrimitiveToModel(primitive, model.get());
+				UPtr<Mesh> mesh = convertPrimitive(primitive);
+				MeshOptimizer::Statistics stats;
+				bool changed = optimizeMeshes && MeshOptimizer::optimize(mesh.get(), &stats);
+				if (compressVertices && MeshOptimizer::compressVertices(mesh.get(), &stats)) {
+					changed = true;
+				}
+				if (changed) {
+					converted.stats.add(stats);
+				}
+				converted.meshes.push_back(std::move(mesh));
 			}
+		}
+		else {
+			UPtr<Mesh> mesh = loadMeshVertices(attrs, NULL);
+			MeshOptimizer::Statistics stats;
+			if (compressVertices && MeshOptimizer::compressVertices(mesh.get(), &stats)) {
+				converted.stats.add(stats);
+			}
+			for (int i = 0; i < cmesh->primitives_count; ++i) {
+				cgltf_primitive* primitive = cmesh->primitives + i;
+				loadPrimitiveIndex(primitive, mesh.get());
+			}
+			converted.meshes.push_back(std::move(mesh));
+		}
+	}
+
+	void convertMeshes(cgltf_data* data) {
+		_meshes.resize(data->meshes_count);
+		parallelFor(data->meshes_count, [&](int i) {
+			convertMesh(data->meshes + i, _meshes[i]);
+		});
+
+		if (optimizeMeshes || compressVertices) {
+			MeshOptimizer::Statistics stats;
+			for (ConvertedMesh& converted : _meshes) {
+				stats.add(converted.stats);
+			}
+			GP_DEBUG("optimized %u triangles: vertices %u -> %u, vertex bytes %u -> %u, index bytes %u -> %u, ACMR %.3f -> %.3f",
+				stats.triangleCount, stats.vertexCountBefore, stats.vertexCountAfter,
+				stats.vertexBytesBefore, stats.vertexBytesAfter,
+				stats.indexBytesBefore, stats.indexBytesAfter, stats.acmrBefore, stats.acmrAfter);
+		}
+	}
+
+	Model* loadMesh(cgltf_mesh *cmesh, Node* node) {
+		ConvertedMesh& converted = _meshes[cmesh - _gltf_data->meshes];
+
+		if (!converted.shared) {
+			UPtr<Model> model(new Model());
+			for (size_t i = 0; i < converted.meshes.size(); ++i) {
+				cgltf_primitive* primitive = cmesh->primitives + i;
+				Mesh* mesh = converted.meshes[i].get();
+				model->addMesh(std::move(converted.meshes[i]));
+				setMeshMaterial(primitive, model.get(), mesh);
+			}
+			converted.meshes.clear();
 			if (lighting) {
 				model->setLightMask(1);
 			}
@@ -608,15 +886,11 @@ private:
 			return res;
 		}
 		else {
-			UPtr<Mesh> mesh = loadMeshVertices(attrs, NULL);
-			UPtr<Model> model = Model::create(std::move(mesh));
+			UPtr<Model> model = Model::create(std::move(converted.meshes[0]));
+			converted.meshes.clear();
 			for (int i = 0; i < cmesh->weights_count; ++i) {
 				node->getWeights().push_back(cmesh->weights[i]);
 			}
-			for (int i = 0; i < cmesh->primitives_count; ++i) {
-				cgltf_primitive* primitive = cmesh->primitives + i;
-				loadPrimitiveIndex(primitive, mesh.get());
-			}
 			Model* res = model.get();
 			node->addComponent(std::move(model));
 
@@ -678,8 +952,9 @@ private:
 			cgltf_animation_channel* cchannel = canimation->channels+i;
 			cgltf_animation_sampler* csampler = cchannel->sampler;
 
-			AnimationTarget* target = nodeMap[cchannel->target_node];
-			if (!target) continue;
+			auto found = nodeMap.find(cchannel->target_node);
+			if (found == nodeMap.end() || !found->second) continue;
+			AnimationTarget* target = found->second;
 
 			unsigned int propertyId = -1;
 			switch (cchannel->target_path)
@@ -857,6 +1132,17 @@ private:
 
 	UPtr<Scene> loadScene(cgltf_data* data) {
 
+		std::atomic<bool> meshoptFailed(false);
+		parallelFor(data->buffer_views_count, [&](int i) {
+			if (!MeshoptDecoder::decode(data->buffer_views + i)) {
+				meshoptFailed = true;
+			}
+		});
+		if (meshoptFailed) {
+			GP_WARN("EXT_meshopt_compression decode failed");
+			return UPtr<Scene>(NULL);
+		}
+
 		for (cgltf_size i = 0; i < data->extensions_required_count; i++) {
 			if (!strcmp(data->extensions_required[i], "KHR_draco_mesh_compression")) {
 				#ifdef GLTFIO_DRACO_SUPPORTED
@@ -876,6 +1162,9 @@ private:
 		cgltf_scene *cscene = data->scenes;
 		UPtr<Scene> scene = Scene::create(cscene->name);
 
+		decodeImages(data);
+		convertMeshes(data);
+
 		for (int i = 0; i < data->skins_count; ++i) {
 			cgltf_skin* skin = data->skins + i;
 			for (int j = 0; j < skin->joints_count; ++j) {
@@ -911,10 +1200,18 @@ private:
 			}
 		}
 
+		std::vector<Animation*> animations;
 		for (int i = 0; i < data->animations_count; ++i) {
 			cgltf_animation* ca = data->animations + i;
 			UPtr<Animation> a = loadAnimation(ca);
+			a->findLodDrawables(scene->getRootNode());
 			scene->getAnimations().push_back(a.get());
+			animations.push_back(a.get());
+		}
+		if (animationCompression > 0) {
+			parallelFor(animations.size(), [&](int i) {
+				animations[i]->compress(animationCompression);
+			});
 		}
 
 		return scene;
@@ -934,11 +1231,17 @@ std::vector<SPtr<MeshSkin> > GltfLoader::loadSkins(const std::string& file) {
 UPtr<Scene> GltfLoader::load(const std::string& file) {
 	GltfLoaderImp imp;
 	imp.lighting = lighting;
+	imp.animationCompression = animationCompression;
+	imp.optimizeMeshes = optimizeMeshes;
+	imp.compressVertices = compressVertices;
 	return imp.load(file.c_str());
 }
 
 UPtr<Scene> GltfLoader::loadFromBuf(const char* file_data, size_t file_size) {
 	GltfLoaderImp imp;
 	imp.lighting = lighting;
+	imp.animationCompression = animationCompression;
+	imp.optimizeMeshes = optimizeMeshes;
+	imp.compressVertices = compressVertices;
 	return imp.loadFromBuf(file_data, file_size);
 }
@@ -30,6 +30,15 @@ public:
 	//LightingType: Pbr | NoSpecular | Ldr
 	int lighting = 0;
 
+	//compress animation keyframes with the error tolerance. 0 for no compression
+	float animationCompression = 0;
+
+	//weld the vertices and reorder the triangles and vertices of the meshes for the GPU
+	bool optimizeMeshes = false;
+
+	//store the normals, tangents, texture coordinates and colors of the meshes in compact types
+	bool compressVertices = false;
+
 	UPtr<Scene> load(const std::string &file);
 	UPtr<Scene> loadFromBuf(const char* file_data, size_t file_size);
 	std::vector<SPtr<MeshSkin> > loadSkins(const std::string& file);
@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2023, chunquedong
+ *
+ * This file is part of MGP project
+ * Licensed under the GNU LESSER GENERAL PUBLIC LICENSE
+ *
+ */
+#include "MeshoptDecoder.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Header bytes of the codecs, the low 4 bits are the version.
+#define VERTEX_HEADER 0xa0
+#define INDEX_HEADER 0xe0
+#define SEQUENCE_HEADER 0xd0
+
+// Byte groups of the vertex codec.
+#define BYTE_GROUP_SIZE 16
+#define BYTE_GROUP_DECODE_LIMIT 24
+#define VERTEX_BLOCK_SIZE_BYTES 8192
+#define VERTEX_BLOCK_MAX_SIZE 256
+#define VERTEX_TAIL_MIN_SIZE 32
+
+namespace mgp
+{
+
+static unsigned int decodeVByte(const unsigned char*& data)
+{
+    unsigned char lead = *data++;
+    if (lead < 128)
+        return lead;
+
+    // Up to 4 more bytes of 7 bits.
+    unsigned int result = lead & 127;
+    unsigned int shift = 7;
+    for (int i = 0; i < 4; ++i)
+    {
+        unsigned char group = *data++;
+        result |= unsigned(group & 127) << shift;
+        shift += 7;
+        if (group < 128)
+            break;
+    }
+    return result;
+}
+
+static unsigned int decodeIndex(const unsigned char*& data, unsigned int last)
+{
+    unsigned int v = decodeVByte(data);
+    unsigned int d = (v >> 1) ^ -int(v & 1);
+    return last + d;
+}
+
+static void writeIndex(void* destination, size_t offset, size_t indexSize, unsigned int index)
+{
+    if (indexSize == 2)
+        static_cast<unsigned short*>(destination)[offset] = (unsigned short)index;
+    else
+        static_cast<unsigned int*>(destination)[offset] = index;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// vertex codec
+
+static const unsigned char* decodeBytesGroup(const unsigned char* data, unsigned char* buffer, int bitslog2)
+{
+    switch (bitslog2)
+    {
+    case 0:
+        memset(buffer, 0, BYTE_GROUP_SIZE);
+        return data;
+    case 1:
+    case 2:
+    {
+        // Values are packed from the high bits, the all ones value means the byte follows the group.
+        int bits = 1 << bitslog2;
+        int sentinel = (1 << bits) - 1;
+        const unsigned char* extra = data + bits * BYTE_GROUP_SIZE / 8;
+        for (int i = 0; i < BYTE_GROUP_SIZE; ++i)
+        {
+            int shift = 8 - bits - (i * bits) % 8;
+            int enc = (data[i * bits / 8] >> shift) & sentinel;
+            buffer[i] = enc == sentinel ? *extra++ : (unsigned char)enc;
+        }
+        return extra;
+    }
+    default:
+        memcpy(buffer, data, BYTE_GROUP_SIZE);
+        return data + BYTE_GROUP_SIZE;
+    }
+}
+
+static const unsigned char* decodeBytes(const unsigned char* data, const unsigned char* dataEnd, unsigned char* buffer, size_t bufferSize)
+{
+    size_t groupCount = bufferSize / BYTE_GROUP_SIZE;
+    size_t headerSize = (groupCount + 3) / 4;
+    if (size_t(dataEnd - data) < headerSize)
+        return NULL;
+
+    const unsigned char* header = data;
+    data += headerSize;
+    for (size_t i = 0; i < groupCount; ++i)
+    {
+        // A group takes at most 24 bytes, the tail keeps the reads in the buffer.
+        if (size_t(dataEnd - data) < BYTE_GROUP_DECODE_LIMIT)
+            return NULL;
+        int bitslog2 = (header[i / 4] >> ((i % 4) * 2)) & 3;
+        data = decodeBytesGroup(data, buffer + i * BYTE_GROUP_SIZE, bitslog2);
+    }
+    return data;
+}
+
+static const unsigned char* decodeVertexBlock(const unsigned char* data, const unsigned char* dataEnd, unsigned char* vertexData,
+    size_t vertexCount, size_t vertexSize, unsigned char lastVertex[256])
+{
+    unsigned char buffer[VERTEX_BLOCK_MAX_SIZE];
+    size_t vertexCountAligned = (vertexCount + BYTE_GROUP_SIZE - 1) & ~size_t(BYTE_GROUP_SIZE - 1);
+
+    for (size_t k = 0; k < vertexSize; ++k)
+    {
+        data = decodeBytes(data, dataEnd, buffer, vertexCountAligned);
+        if (!data)
+            return NULL;
+
+        // Bytes are zigzag encoded deltas from the previous vertex.
+        unsigned char p = lastVertex[k];
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            unsigned char v = (unsigned char)(-(buffer[i] & 1) ^ (buffer[i] >> 1)) + p;
+            vertexData[i * vertexSize + k] = v;
+            p = v;
+        }
+    }
+
+    memcpy(lastVertex, vertexData + vertexSize * (vertexCount - 1), vertexSize);
+    return data;
+}
+
+bool MeshoptDecoder::decodeVertexBuffer(void* destination, size_t count, size_t size, const unsigned char* buffer, size_t bufferSize)
+{
+    if (size == 0 || size > 256 || size % 4 != 0)
+        return false;
+    if (bufferSize < 1 || buffer[0] != VERTEX_HEADER)
+        return false;
+
+    const unsigned char* data = buffer + 1;
+    const unsigned char* dataEnd = buffer + bufferSize;
+
+    // The first vertex is stored at the end of the stream, padded to the minimum tail size.
+    size_t tailSize = size < VERTEX_TAIL_MIN_SIZE ? VERTEX_TAIL_MIN_SIZE : size;
+    if (size_t(dataEnd - data) < tailSize)
+        return false;
+    unsigned char lastVertex[256];
+    memcpy(lastVertex, dataEnd - size, size);
+
+    size_t blockSize = (VERTEX_BLOCK_SIZE_BYTES / size) & ~size_t(BYTE_GROUP_SIZE - 1);
+    if (blockSize > VERTEX_BLOCK_MAX_SIZE)
+        blockSize = VERTEX_BLOCK_MAX_SIZE;
+
+    unsigned char* vertexData = static_cast<unsigned char*>(destination);
+    for (size_t offset = 0; offset < count; offset += blockSize)
+    {
+        size_t blockCount = count - offset < blockSize ? count - offset : blockSize;
+        data = decodeVertexBlock(data, dataEnd, vertexData + offset * size, blockCount, size, lastVertex);
+        if (!data)
+            return false;
+    }
+
+    return size_t(dataEnd - data) == tailSize;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// index codec
+
+struct IndexFifo
+{
+    unsigned int edges[16][2];
+    unsigned int vertices[16];
+    size_t edgeOffset;
+    size_t vertexOffset;
+
+    IndexFifo() : edgeOffset(0), vertexOffset(0)
+    {
+        memset(edges, -1, sizeof(edges));
+        memset(vertices, -1, sizeof(vertices));
+    }
+
+    void pushEdge(unsigned int a, unsigned int b)
+    {
+        edges[edgeOffset][0] = a;
+        edges[edgeOffset][1] = b;
+        edgeOffset = (edgeOffset + 1) & 15;
+    }
+
+    void pushVertex(unsigned int v, bool cond = true)
+    {
+        vertices[vertexOffset] = v;
+        vertexOffset = (vertexOffset + cond) & 15;
+    }
+};
+
+bool MeshoptDecoder::decodeIndexBuffer(void* destination, size_t count, size_t indexSize, const unsigned char* buffer, size_t bufferSize)
+{
+    if (count % 3 != 0 || (indexSize != 2 && indexSize != 4))
+        return false;
+    // Header, one code per triangle, and the 16 bytes table of the auxiliary codes.
+    if (bufferSize < 1 + count / 3 + 16)
+        return false;
+    if ((buffer[0] & 0xf0) != INDEX_HEADER)
+        return false;
+    int version = buffer[0] & 0x0f;
+    if (version > 1)
+        return false;
+
+    IndexFifo fifo;
+    unsigned int next = 0;
+    unsigned int last = 0;
+    // Version 1 encodes the indices next to the last free one in the codes 13 and 14.
+    int fecmax = version >= 1 ? 13 : 15;
+
+    const unsigned char* code = buffer + 1;
+    const unsigned char* data = code + count / 3;
+    const unsigned char* dataSafeEnd = buffer + bufferSize - 16;
+    const unsigned char* codeauxTable = dataSafeEnd;
+
+    for (size_t i = 0; i < count; i += 3)
+    {
+        // A triangle reads at most 16 bytes of data.
+        if (data > dataSafeEnd)
+            return false;
+
+        unsigned char codetri = *code++;
+        unsigned int a, b, c;
+
+        if (codetri < 0xf0)
+        {
+            // Reuses an edge of a recent triangle.
+            int fe = codetri >> 4;
+            a = fifo.edges[(fifo.edgeOffset - 1 - fe) & 15][0];
+            b = fifo.edges[(fifo.edgeOffset - 1 - fe) & 15][1];
+
+            int fec = codetri & 15;
+            if (fec < fecmax)
+            {
+                unsigned int cf = fifo.vertices[(fifo.vertexOffset - 1 - fec) & 15];
+                c = fec == 0 ? next : cf;
+                next += fec == 0;
+                fifo.pushVertex(c, fec == 0);
+            }
+            else
+            {
+                // 13 and 14 decode to last - 1 and last + 1.
+                c = last = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+                fifo.pushVertex(c);
+            }
+
+            fifo.pushEdge(c, b);
+            fifo.pushEdge(a, c);
+        }
+        else if (codetri < 0xfe)
+        {
+            // A new triangle with the vertices from the auxiliary table.
+            unsigned char codeaux = codeauxTable[codetri & 15];
+            int feb = codeaux >> 4;
+            int fec = codeaux & 15;
+
+            a = next++;
+
+            unsigned int bf = fifo.vertices[(fifo.vertexOffset - feb) & 15];
+            b = feb == 0 ? next : bf;
+            next += feb == 0;
+
+            unsigned int cf = fifo.vertices[(fifo.vertexOffset - fec) & 15];
+            c = fec == 0 ? next : cf;
+            next += fec == 0;
+
+            fifo.pushVertex(a);
+            fifo.pushVertex(b, feb == 0);
+            fifo.pushVertex(c, fec == 0);
+
+            fifo.pushEdge(b, a);
+            fifo.pushEdge(c, b);
+            fifo.pushEdge(a, c);
+        }
+        else
+        {
+            // A new triangle with the vertices coded in the data.
+            unsigned char codeaux = *data++;
+            int fea = codetri == 0xfe ? 0 : 15;
+            int feb = codeaux >> 4;
+            int fec = codeaux & 15;
+
+            a = fea == 0 ? next++ : 0;
+            b = feb == 0 ? next++ : fifo.vertices[(fifo.vertexOffset - feb) & 15];
+            c = fec == 0 ? next++ : fifo.vertices[(fifo.vertexOffset - fec) & 15];
+
+            // The free indices are deltas from the last one.
+            if (fea == 15)
+                last = a = decodeIndex(data, last);
+            if (feb == 15)
+                last = b = decodeIndex(data, last);
+            if (fec == 15)
+                last = c = decodeIndex(data, last);
+
+            fifo.pushVertex(a);
+            fifo.pushVertex(b, feb == 0 || feb == 15);
+            fifo.pushVertex(c, fec == 0 || fec == 15);
+
+            fifo.pushEdge(b, a);
+            fifo.pushEdge(c, b);
+            fifo.pushEdge(a, c);
+        }
+
+        writeIndex(destination, i + 0, indexSize, a);
+        writeIndex(destination, i + 1, indexSize, b);
+        writeIndex(destination, i + 2, indexSize, c);
+    }
+
+    return data == dataSafeEnd;
+}
+
+bool MeshoptDecoder::decodeIndexSequence(void* destination, size_t count, size_t indexSize, const unsigned char* buffer, size_t bufferSize)
+{
+    if (indexSize != 2 && indexSize != 4)
+        return false;
+    // Header, at least one byte per index, and a 4 bytes tail.
+    if (bufferSize < 1 + count + 4)
+        return false;
+    if ((buffer[0] & 0xf0) != SEQUENCE_HEADER || (buffer[0] & 0x0f) > 1)
+        return false;
+
+    const unsigned char* data = buffer + 1;
+    const unsigned char* dataSafeEnd = buffer + bufferSize - 4;
+
+    // Each index is a delta from one of two baselines.
+    unsigned int last[2] = { 0, 0 };
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (data >= dataSafeEnd)
+            return false;
+
+        unsigned int v = decodeVByte(data);
+        unsigned int current = v & 1;
+        v >>= 1;
+        unsigned int d = (v >> 1) ^ -int(v & 1);
+        unsigned int index = last[current] + d;
+        last[current] = index;
+
+        writeIndex(destination, i, indexSize, index);
+    }
+
+    return data == dataSafeEnd;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// filters
+
+template <typename T>
+static void decodeFilterOct(T* data, size_t count)
+{
+    const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // z is reconstructed from x and y, the fourth component is kept.
+        float x = float(data[i * 4 + 0]);
+        float y = float(data[i * 4 + 1]);
+        float z = float(data[i * 4 + 2]) - fabsf(x) - fabsf(y);
+
+        float t = z >= 0.f ? 0.f : z;
+        x += x >= 0.f ? t : -t;
+        y += y >= 0.f ? t : -t;
+
+        float l = sqrtf(x * x + y * y + z * z);
+        float s = max / l;
+
+        data[i * 4 + 0] = T(int(x * s + (x >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + 1] = T(int(y * s + (y >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + 2] = T(int(z * s + (z >= 0.f ? 0.5f : -0.5f)));
+    }
+}
+
+static void decodeFilterQuat(short* data, size_t count)
+{
+    const float scale = 1.f / sqrtf(2.f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // The scale is in the high bits of the fourth component, the index of the dropped one in the low bits.
+        int sf = data[i * 4 + 3] | 3;
+        float ss = scale / float(sf);
+
+        float x = float(data[i * 4 + 0]) * ss;
+        float y = float(data[i * 4 + 1]) * ss;
+        float z = float(data[i * 4 + 2]) * ss;
+
+        float ww = 1.f - x * x - y * y - z * z;
+        float w = sqrtf(ww >= 0.f ? ww : 0.f);
+
+        int xf = int(x * 32767.f + (x >= 0.f ? 0.5f : -0.5f));
+        int yf = int(y * 32767.f + (y >= 0.f ? 0.5f : -0.5f));
+        int zf = int(z * 32767.f + (z >= 0.f ? 0.5f : -0.5f));
+        int wf = int(w * 32767.f + 0.5f);
+
+        int qc = data[i * 4 + 3] & 3;
+        data[i * 4 + ((qc + 1) & 3)] = short(xf);
+        data[i * 4 + ((qc + 2) & 3)] = short(yf);
+        data[i * 4 + ((qc + 3) & 3)] = short(zf);
+        data[i * 4 + ((qc + 0) & 3)] = short(wf);
+    }
+}
+
+static void decodeFilterExp(unsigned int* data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        // 24 bits mantissa and 8 bits exponent.
+        unsigned int v = data[i];
+        int m = int(v << 8) >> 8;
+        int e = int(v) >> 24;
+
+        union { float f; unsigned int ui; } u;
+        u.ui = unsigned(e + 127) << 23;
+        u.f = u.f * float(m);
+        data[i] = u.ui;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool MeshoptDecoder::decode(cgltf_buffer_view* view)
+{
+    if (!view->has_meshopt_compression || view->data)
+        return true;
+
+    const cgltf_meshopt_compression* mc = &view->meshopt_compression;
+    if (!mc->buffer || !mc->buffer->data)
+        return false;
+    const unsigned char* source = (const unsigned char*)mc->buffer->data + mc->offset;
+
+    void* result = malloc(mc->count * mc->stride);
+    if (!result)
+        return false;
+
+    bool ok = false;
+    switch (mc->mode)
+    {
+    case cgltf_meshopt_compression_mode_attributes:
+        ok = decodeVertexBuffer(result, mc->count, mc->stride, source, mc->size);
+        break;
+    case cgltf_meshopt_compression_mode_triangles:
+        ok = decodeIndexBuffer(result, mc->count, mc->stride, source, mc->size);
+        break;
+    case cgltf_meshopt_compression_mode_indices:
+        ok = decodeIndexSequence(result, mc->count, mc->stride, source, mc->size);
+        break;
+    default:
+        break;
+    }
+
+    if (ok)
+    {
+        switch (mc->filter)
+        {
+        case cgltf_meshopt_compression_filter_octahedral:
+            if (mc->stride == 4)
+                decodeFilterOct((signed char*)result, mc->count);
+            else
+                decodeFilterOct((short*)result, mc->count);
+            break;
+        case cgltf_meshopt_compression_filter_quaternion:
+            decodeFilterQuat((short*)result, mc->count);
+            break;
+        case cgltf_meshopt_compression_filter_exponential:
+            decodeFilterExp((unsigned int*)result, mc->count * mc->stride / 4);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!ok)
+    {
+        free(result);
+        return false;
+    }
+
+    // cgltf reads the view from here and frees it with the data.
+    view->data = result;
+    return true;
+}
+
+}
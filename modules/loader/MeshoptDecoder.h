@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2023, chunquedong
+ *
+ * This file is part of MGP project
+ * Licensed under the GNU LESSER GENERAL PUBLIC LICENSE
+ *
+ */
+#ifndef MESHOPTDECODER_H_
+#define MESHOPTDECODER_H_
+
+#include "cgltf.h"
+
+namespace mgp
+{
+
+/**
+ * Decodes the buffer views compressed with the EXT_meshopt_compression extension.
+ *
+ * The bitstreams are the ones of meshoptimizer: the vertex codec for attributes, the
+ * index codec for triangle lists and the index sequence codec for other indices,
+ * followed by the octahedral, quaternion and exponential filters.
+ */
+class MeshoptDecoder
+{
+public:
+
+    /**
+     * Decodes a compressed buffer view, does nothing if the view is not compressed.
+     * The decoded data is stored in the view and freed by cgltf_free().
+     *
+     * @return false if the view could not be decoded.
+     */
+    static bool decode(cgltf_buffer_view* view);
+
+    /**
+     * Decodes count vertices of the given size from a vertex codec stream.
+     */
+    static bool decodeVertexBuffer(void* destination, size_t count, size_t size, const unsigned char* buffer, size_t bufferSize);
+
+    /**
+     * Decodes count indices of 2 or 4 bytes from an index codec stream, count is a multiple of 3.
+     */
+    static bool decodeIndexBuffer(void* destination, size_t count, size_t indexSize, const unsigned char* buffer, size_t bufferSize);
+
+    /**
+     * Decodes count indices of 2 or 4 bytes from an index sequence codec stream.
+     */
+    static bool decodeIndexSequence(void* destination, size_t count, size_t indexSize, const unsigned char* buffer, size_t bufferSize);
+};
+
+}
+
+#endif
@@ -674,6 +674,22 @@ void GLRenderer::updateTexture(Texture* texture) {
     }
 }
 
+void GLRenderer::updateTextureRegion(Texture* texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height, const unsigned char* data) {
+    Image::Format format = texture->getFormat();
+    GP_ASSERT(texture->getType() == Texture::TEXTURE_2D);
+    GP_ASSERT(texture->_handle);
+
+    GLenum texelType = getFormatDataType(format);
+    GP_ASSERT(texelType != 0);
+
+    GLenum ioFormat = getIOFormat(format);
+    GP_ASSERT(ioFormat != 0);
+
+    GL_ASSERT(glBindTexture(GL_TEXTURE_2D, texture->_handle));
+    GL_ASSERT(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GL_ASSERT(glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, ioFormat, texelType, data));
+}
+
 void GLRenderer::deleteTexture(Texture* texture) {
     if (texture->_handle)
     {
@@ -1173,13 +1189,13 @@ void GLRenderer::bindVertexAttributeObj(VertexAttributeObject* vertextAttribute)
             else
             {
                 void* pointer = attribute.pointer;
-                if (attribute.type != GL_FLOAT) {
+                if (attribute.integer) {
                     //(GLuint index, GLint size, GLenum type, GLsizei stride, const void*pointer)
                     GL_ASSERT(glVertexAttribIPointer(attribute.location, (GLint)attribute.size, attribute.type, (GLsizei)attribute.stride, pointer));
                 }
                 else {
                     //(	GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
-                    GL_ASSERT(glVertexAttribPointer(attribute.location, (GLint)attribute.size, attribute.type, GL_FALSE, (GLsizei)attribute.stride, pointer));
+                    GL_ASSERT(glVertexAttribPointer(attribute.location, (GLint)attribute.size, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, (GLsizei)attribute.stride, pointer));
                 }
                 GL_ASSERT(glEnableVertexAttribArray(attribute.location));
             }
@@ -53,6 +53,7 @@ public:
 	void updateState(StateBlock* state, int force = 1) override;
 
 	void updateTexture(Texture* texture) override;
+	void updateTextureRegion(Texture* texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height, const unsigned char* data) override;
 	void deleteTexture(Texture* texture) override;
 	void bindTextureSampler(Texture* texture) override;
 
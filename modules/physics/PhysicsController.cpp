@@ -1135,12 +1135,11 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
         return NULL;
     }
     int vertexStride = vertexPosition->stride;
-    int vertexOffset = vertexPosition->offset;
     for (unsigned int i = 0; i < vertexCount; i++)
     {
-        v.set(*((float*)&vertexData[i * vertexStride + 0 * sizeof(float) + vertexOffset]),
-              *((float*)&vertexData[i * vertexStride + 1 * sizeof(float) + vertexOffset]),
-              *((float*)&vertexData[i * vertexStride + 2 * sizeof(float) + vertexOffset]));
+        float p[4];
+        vertexPosition->decode(vertexData + i * vertexStride, p);
+        v.set(p[0], p[1], p[2]);
         v *= m;
 
         shapeMeshData->vertexData[i * 3] = v.x;
@@ -8,6 +8,7 @@
 #include "RenderDataManager.h"
 //#include "objects/CubeMap.h"
 #include "base/StringUtil.h"
+#include "platform/Toolkit.h"
 
 #include <algorithm>
 #include <float.h>
@@ -19,13 +20,39 @@ RenderDataManager::RenderDataManager(): _viewFrustumCulling(true), _useInstanced
 
 }
 
-void RenderDataManager::fill(Scene* scene, Camera *camera, Rectangle *viewport, bool viewFrustumCulling) {
+void RenderDataManager::beginFill(Camera *camera, Rectangle *viewport, bool viewFrustumCulling) {
     _camera = camera;
     _viewFrustumCulling = viewFrustumCulling;
     _renderInfo.camera = camera;
     _renderInfo.viewport = *viewport;
-    
+    _fillTime = Toolkit::cur()->getGameTime();
+    _cameraPosition = _camera->getNode()->getTranslationWorld();
+
     clear();
+}
+
+void RenderDataManager::markVisible(Drawable* drawable) {
+    // Feed the culling result back to the drawable, used by animation LOD.
+    float screenSize = 1.0f;
+    Node* node = drawable->getNode();
+    if (node) {
+        const BoundingSphere& sphere = node->getBoundingSphere();
+        if (_camera->getCameraType() == Camera::PERSPECTIVE) {
+            double distance = sphere.center.distance(_cameraPosition);
+            if (distance > sphere.radius) {
+                double tanHalfFov = tan(MATH_DEG_TO_RAD(_camera->getFieldOfView()) * 0.5);
+                screenSize = sphere.radius / (distance * tanHalfFov);
+            }
+        }
+        else if (_camera->getZoomY() > 0) {
+            screenSize = sphere.radius / (_camera->getZoomY() * 0.5);
+        }
+    }
+    drawable->setVisibleFeedback(_fillTime, screenSize);
+}
+
+void RenderDataManager::fill(Scene* scene, Camera *camera, Rectangle *viewport, bool viewFrustumCulling) {
+    beginFill(camera, viewport, viewFrustumCulling);
     
     // Visit all the nodes in the scene for drawing
     scene->visit(this, &RenderDataManager::buildRenderQueues);
@@ -62,7 +89,7 @@ void RenderDataManager::endFill() {
     filterInstanced();
 
     //init _distanceToCamera
-    Vector3 cameraPosition = _camera->getNode()->getTranslationWorld();
+    Vector3 cameraPosition = _cameraPosition;
     for (auto it = _renderQueues.begin(); it != _renderQueues.end(); ++it)
     {
         auto& queue = it->second;
@@ -151,11 +178,7 @@ void RenderDataManager::addInstanced(DrawCall* drawCall) {
 }
 
 void RenderDataManager::fillDrawables(std::vector<Drawable*>& drawables, Camera *camera, Rectangle *viewport, bool viewFrustumCulling) {
-    _camera = camera;
-    _viewFrustumCulling = viewFrustumCulling;
-    _renderInfo.camera = camera;
-    _renderInfo.viewport = *viewport;
-    clear();
+    beginFill(camera, viewport, viewFrustumCulling);
     
     // Visit all the nodes in the scene for drawing
     for (Drawable* drawable : drawables) {
@@ -168,6 +191,7 @@ void RenderDataManager::fillDrawables(std::vector<Drawable*>& drawables, Camera
                 }
             }
 
+            if (_visibilityFeedback) markVisible(drawable);
             drawable->draw(&_renderInfo);
         }
     }
@@ -186,6 +210,7 @@ bool RenderDataManager::buildRenderQueues(Node* node) {
             }
         }
 
+        if (_visibilityFeedback) markVisible(drawable);
         drawable->draw(&_renderInfo);
     }
     Light *light = node->getLight();
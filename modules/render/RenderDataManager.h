@@ -36,6 +36,9 @@ class RenderDataManager {
     bool _viewFrustumCulling;
     bool _useInstanced;
     Camera *_camera = NULL;
+    double _fillTime = 0;
+    Vector3 _cameraPosition;
+    bool _visibilityFeedback = true;    // Whether the filled drawables are marked visible, only for the main camera.
 
     struct InstanceKey {
         void* mesh;
@@ -61,10 +64,17 @@ public:
     
     void fill(Scene* scene, Camera *camera, Rectangle *viewport, bool viewFrustumCulling = true);
     void fillDrawables(std::vector<Drawable*>& drawables, Camera *camera, Rectangle *viewport, bool viewFrustumCulling = true);
+    /**
+     * Sets whether the drawables filled are marked visible to the camera, used by animation LOD.
+     * Disabled for the passes not seen by the camera, such as the shadow pass.
+     */
+    void setVisibilityFeedback(bool enabled) { _visibilityFeedback = enabled; }
     void sort();
     void getRenderData(RenderData* view, int layer);
 protected:
     bool buildRenderQueues(Node* node);
+    void beginFill(Camera *camera, Rectangle *viewport, bool viewFrustumCulling);
+    void markVisible(Drawable* drawable);
     void addInstanced(DrawCall* drawCall);
     void setInstanced(Instanced* instance_, std::vector<DrawCall*>& list);
     void addToQueue(DrawCall* drawCall);
@@ -125,6 +125,8 @@ void Shadow::draw(Scene* scene, Renderer* renderer, Matrix& lightView, Matrix& l
     //view._renderer = renderer;
 
     RenderDataManager renderQueue;
+    // Seen by the light only, the animation LOD follows the main camera
+    renderQueue.setVisibilityFeedback(false);
     renderQueue.fill(scene, _camera, &viewport);
 
     view._overridedMaterial = _material;
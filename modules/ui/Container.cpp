@@ -479,7 +479,7 @@ void Container::updateChildBounds() {
                 }
             }
             else {
-                ctrl->measureSize();
+                ctrl->measure();
                 ctrl->_localBounds = ctrl->_measureBounds;
             }
         }
@@ -506,7 +506,7 @@ void Container::updateChildBounds() {
         if (ctrl->isVisible())
         {
             if (ctrl->getAutoSizeW() == AUTO_PERCENT_LEFT || ctrl->getAutoSizeH() == AUTO_PERCENT_LEFT) {
-                ctrl->measureSize();
+                ctrl->measure();
             }
             ctrl->_localBounds = ctrl->_measureBounds;
             ctrl->applyAlignment();
@@ -526,7 +526,7 @@ void Container::measureSize() {
 
             if (ctrl->isVisible())
             {
-                ctrl->measureSize();
+                ctrl->measure();
             }
         }
 
@@ -554,7 +554,7 @@ void Container::measureSize() {
 
             if (ctrl->isVisible())
             {
-                ctrl->measureSize();
+                ctrl->measure();
             }
         }
 
@@ -677,6 +677,7 @@ void Control::setMargin(float top, float right, float bottom, float left)
     _margin.bottom = bottom;
     _margin.left = left;
     _margin.right = right;
+    setDirty(DIRTY_BOUNDS);
 }
 
 const Margin& Control::getMargin() const
@@ -694,6 +695,7 @@ void Control::setPadding(float top, float right, float bottom, float left)
     _padding.bottom = bottom;
     _padding.left = left;
     _padding.right = right;
+    setDirty(DIRTY_BOUNDS);
 }
 
 const Padding& Control::getPadding() const
@@ -927,8 +929,11 @@ void Control::controlEvent(Control::Listener::EventType evt)
 void Control::setDirty(int bits, bool recursive)
 {
     _dirtyBits |= bits;
+    if (bits & DIRTY_BOUNDS)
+        _measureValid = false;
+    requestRedraw();
     if ((bits & DIRTY_BOUNDS) && _parent) {
-        if (!_parent->isDirty(DIRTY_BOUNDS)) {
+        if (!_parent->isDirty(DIRTY_BOUNDS) || _parent->_measureValid) {
             _parent->setDirty(DIRTY_BOUNDS, false);
         }
     }
@@ -967,9 +972,13 @@ void Control::update(float elapsedTime)
 
     // Since opacity is pre-multiplied, we compute it every frame so that we don't need to
     // dirty the entire hierarchy any time a state changes (which could affect opacity).
-    _opacity = getStyle()->getOpacity();
+    float opacity = getStyle()->getOpacity();
     if (_parent)
-        _opacity *= _parent->_opacity;
+        opacity *= _parent->_opacity;
+    if (opacity != _opacity) {
+        _opacity = opacity;
+        requestRedraw();
+    }
 }
 
 void Control::updateState(State state)
@@ -997,12 +1006,21 @@ void Control::updateLayout(const Vector2& offset)
     _dirtyBits &= ~DIRTY_BOUNDS;
 
     if (dirtyBounds && !_parent) {
-        this->measureSize();
+        this->measure();
         _localBounds = _measureBounds;
     }
 
+    Rectangle viewportBounds = _viewportBounds;
+    Rectangle viewportClipBounds = _viewportClipBounds;
     updateAbsoluteBounds(offset);
 
+    // Children are sized from the content area, they only need to be laid out again if it was resized.
+    // If it did not move either, they are still in place.
+    if (_viewportBounds.width != viewportBounds.width || _viewportBounds.height != viewportBounds.height)
+        dirtyBounds = true;
+    else if (!dirtyBounds && _viewportBounds == viewportBounds && _viewportClipBounds == viewportClipBounds)
+        return;
+
     layoutChildren(dirtyBounds);
 }
 
@@ -1016,6 +1034,12 @@ void Control::requestLayout(bool recursive) {
     setDirty(DIRTY_BOUNDS, recursive);
 }
 
+void Control::requestRedraw() {
+    Form* form = getTopLevelForm();
+    if (form)
+        form->redraw();
+}
+
 void Control::setToolTip(const char* tip) {
     _toolTip = tip;
 }
@@ -1024,35 +1048,57 @@ void Control::setToolTip(const char* tip) {
 
 // }
 
-void Control::measureSize() {
+bool Control::MeasureSpec::operator==(const MeasureSpec& spec) const {
+    return parentBounds.width == spec.parentBounds.width && parentBounds.height == spec.parentBounds.height &&
+        leftWidth == spec.leftWidth && leftHeight == spec.leftHeight &&
+        leftWidthWeight == spec.leftWidthWeight && leftHeightWeight == spec.leftHeightWeight;
+}
 
-    float leftWidth = 0;
-    float leftHeight = 0;
-    float _leftWidthWeight = 1;
-    float _leftHeightWeight = 1;
-    Rectangle parentAbsoluteBounds;
+void Control::getMeasureSpec(MeasureSpec* spec) const {
     if (_parent) {
-        parentAbsoluteBounds = _parent->_viewportBounds;
-        leftWidth = _parent->_leftWidth;
-        leftHeight = _parent->_leftHeight;
-        _leftWidthWeight = _parent->_leftWidthWeight;
-        _leftHeightWeight = _parent->_leftHeightWeight;
-        if (parentAbsoluteBounds.width == 0 && parentAbsoluteBounds.height == 0) {
-            parentAbsoluteBounds.width = _parent->_measureBounds.width - _parent->getPadding().left - _parent->getPadding().right;
-            parentAbsoluteBounds.height = _parent->_measureBounds.height - _parent->getPadding().top - _parent->getPadding().bottom;
+        spec->parentBounds = _parent->_viewportBounds;
+        spec->leftWidth = _parent->_leftWidth;
+        spec->leftHeight = _parent->_leftHeight;
+        spec->leftWidthWeight = _parent->_leftWidthWeight;
+        spec->leftHeightWeight = _parent->_leftHeightWeight;
+        if (spec->parentBounds.width == 0 && spec->parentBounds.height == 0) {
+            spec->parentBounds.width = _parent->_measureBounds.width - _parent->getPadding().left - _parent->getPadding().right;
+            spec->parentBounds.height = _parent->_measureBounds.height - _parent->getPadding().top - _parent->getPadding().bottom;
         }
     }
     else {
         Renderer* game = Renderer::cur();
-        leftWidth = game->getDpWidth();
-        leftHeight = game->getDpHeight();
-        parentAbsoluteBounds = Rectangle(0, 0, leftWidth, leftHeight);
-        _leftWidthWeight = _desiredBounds.width;
-        _leftHeightWeight = _desiredBounds.height;
+        spec->leftWidth = game->getDpWidth();
+        spec->leftHeight = game->getDpHeight();
+        spec->parentBounds = Rectangle(0, 0, spec->leftWidth, spec->leftHeight);
+        spec->leftWidthWeight = _desiredBounds.width;
+        spec->leftHeightWeight = _desiredBounds.height;
     }
 
-    if (_leftWidthWeight == 0) _leftWidthWeight = 1;
-    if (_leftHeightWeight == 0) _leftHeightWeight = 1;
+    if (spec->leftWidthWeight == 0) spec->leftWidthWeight = 1;
+    if (spec->leftHeightWeight == 0) spec->leftHeightWeight = 1;
+}
+
+void Control::measure() {
+    MeasureSpec spec;
+    getMeasureSpec(&spec);
+    if (_measureValid && spec == _measureSpec)
+        return;
+
+    measureSize();
+    _measureSpec = spec;
+    _measureValid = true;
+}
+
+void Control::measureSize() {
+
+    MeasureSpec spec;
+    getMeasureSpec(&spec);
+    const Rectangle& parentAbsoluteBounds = spec.parentBounds;
+    float leftWidth = spec.leftWidth;
+    float leftHeight = spec.leftHeight;
+    float _leftWidthWeight = spec.leftWidthWeight;
+    float _leftHeightWeight = spec.leftHeightWeight;
 
     if (_autoSizeW == AUTO_PERCENT_PARENT)
         _measureBounds.width = _desiredBounds.width * parentAbsoluteBounds.width - (_margin.right + _margin.left);
@@ -886,6 +886,13 @@ public:
     */
     void requestLayout(bool recursive = false);
 
+    /**
+     * Tells the form that the control looks different, when its retained draw calls are enabled.
+     *
+     * Called by the setters that do not change the layout.
+     */
+    void requestRedraw();
+
     void setToolTip(const char* tip);
 protected:
     /**
@@ -952,8 +959,32 @@ protected:
      */
     virtual void updateState(State state);
 
+    /**
+     * Constraints a control is measured with, given by its parent.
+     */
+    struct MeasureSpec
+    {
+        Rectangle parentBounds;     // Content area of the parent.
+        float leftWidth;            // Space left by the siblings, for AUTO_PERCENT_LEFT.
+        float leftHeight;
+        float leftWidthWeight;
+        float leftHeightWeight;
+
+        bool operator==(const MeasureSpec& spec) const;
+    };
+
+    void getMeasureSpec(MeasureSpec* spec) const;
+
     virtual void measureSize();
 
+    /**
+     * Measures the control, unless it was already measured with the same constraints and
+     * its bounds were not dirtied since.
+     *
+     * Parents call this instead of measureSize(), so a subtree is measured once per layout.
+     */
+    void measure();
+
     void applyAlignment();
 
     /**
@@ -1186,6 +1217,12 @@ public:
      */
     Rectangle _measureBounds;
 
+    /**
+     * Constraints of the last measure, used if _measureValid is true.
+     */
+    MeasureSpec _measureSpec;
+    bool _measureValid = false;
+
     /**
      * Local bounds, relative to parent container's clipping window, and desired size.
      */
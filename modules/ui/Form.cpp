@@ -10,6 +10,7 @@
 #include "scene/Renderer.h"
 #include "ScrollContainer.h"
 #include "FormManager.h"
+#include "objects/MultiSpriteBatch.h"
 
 // Scroll speed when using a joystick.
 static const float GAMEPAD_SCROLL_SPEED = 600.0f;
@@ -22,6 +23,12 @@ static const float GAMEPAD_FOCUS_REPEAT_DELAY = 300.0f;
 #define FORM_VSH "res/shaders/sprite.vert"
 #define FORM_FSH "res/shaders/sprite.frag"
 
+// Average number of controls in a hit test grid cell
+#define FORM_HIT_CELL_SIZE 8
+
+// Max number of hit test grid cells per side
+#define FORM_HIT_MAX_GRID_SIZE 64
+
 namespace mgp
 {
 
@@ -40,6 +47,7 @@ Form::~Form()
     }
 
     //SAFE_RELEASE(_root);
+    SAFE_DELETE(_spriteBatch);
 
     // Remove this Form from the global list.
     /*std::vector<Form*>::iterator it = std::find(FormManager::cur()->__forms.begin(), FormManager::cur()->__forms.end(), this);
@@ -98,6 +106,7 @@ UPtr<Form> Form::create(const char* url)
     }
 
     form->_batched = formProperties->getBool("batchingEnabled", true);
+    form->_retained = formProperties->getBool("retainedEnabled", false);
 
     // Initialize the form and all of its child controls
     form->initialize(style, formProperties);
@@ -185,6 +194,10 @@ void Form::update(float elapsedTime)
 
     _root->update(elapsedTime);
 
+    // Any bounds change dirties the root, the hit test grid is rebuilt at the next input event
+    if (_root->isDirty(Control::DIRTY_BOUNDS))
+        _hitDirty = true;
+
     // Do a two-pass bounds update:
     //  1. First pass updates leaf controls
     //  2. Second pass updates parent controls that depend on child sizes
@@ -232,11 +245,28 @@ int Form::flushBatch(RenderInfo* view) {
     // Flush all batches that were queued during drawing and then empty the batch list
     if (_batched)
     {
-        unsigned int batchCount = _batches.size();
-        for (unsigned int i = 0; i < batchCount; ++i)
+        if (!_spriteBatch)
+        {
+            _spriteBatch = MultiSpriteBatch::create().take();
+        }
+
+        // Merge the batches in z order, only the ones that can't be merged break the draw call
+        unsigned int drawCalls = 0;
+        _spriteBatch->setProjectionMatrix(_projectionMatrix);
+        _spriteBatch->start(view);
+        for (unsigned int i = 0, batchCount = _batches.size(); i < batchCount; ++i)
+        {
+            if (_batches[i]->finishInto(_spriteBatch))
+                continue;
+            _spriteBatch->flush();
             _batches[i]->finish(view);
+            ++drawCalls;
+        }
+        _spriteBatch->finish();
+        _replayable = drawCalls == 0;
+        drawCalls += _spriteBatch->getDrawCallCount();
         _batches.clear();
-        return batchCount;
+        return drawCalls;
     }
     return 0;
 }
@@ -272,7 +302,25 @@ unsigned int Form::draw(RenderInfo* view)
         int h = Renderer::cur()->getDpHeight();
         //printf("Form projectionMatrix:%d,%d,%f\n", w, h, Toolkit::cur()->getScreenScale());
         Matrix::createOrthographicOffCenter(0, w, h, 0, 0, 1, &_projectionMatrix);
+
+        if (w != _retainedWidth || h != _retainedHeight)
+        {
+            _retainedWidth = w;
+            _retainedHeight = h;
+            _redraw = true;
+        }
+    }
+
+    // Nothing changed since the last frame, draw the same geometry without visiting the controls
+    if (_retained && _batched && _replayable && !_redraw && _fontVersion == FontCache::getVersion() &&
+        _themeVersion == Theme::getVersion())
+    {
+        _spriteBatch->setProjectionMatrix(_projectionMatrix);
+        return _spriteBatch->replay(view);
     }
+    _redraw = false;
+    _fontVersion = FontCache::getVersion();
+    _themeVersion = Theme::getVersion();
 
     // Draw the form
     unsigned int drawCalls = _root->draw(this, _root->_absoluteClipBounds, view);
@@ -299,6 +347,23 @@ bool Form::isBatchingEnabled() const
 void Form::setBatchingEnabled(bool enabled)
 {
     _batched = enabled;
+    _replayable = false;
+}
+
+bool Form::isRetainedEnabled() const
+{
+    return _retained;
+}
+
+void Form::setRetainedEnabled(bool enabled)
+{
+    _retained = enabled;
+    _redraw = true;
+}
+
+void Form::redraw()
+{
+    _redraw = true;
 }
 
 
@@ -342,7 +407,7 @@ Control* Form::findInputControl(int* x, int* y, bool focus, unsigned int contact
         return NULL;
 
     // Search for an input control within this form
-    Control* ctrl = form->_root->findInputControl(formX, formY, focus, contactIndex);
+    Control* ctrl = hitTest(formX, formY, focus);
     if (ctrl)
     {
         *x = formX;
@@ -359,6 +424,80 @@ Control* Form::findInputControl(int* x, int* y, bool focus, unsigned int contact
 }
 
 
+void Form::addHitControls(Control* control)
+{
+    if (!control->_visible)
+        return;
+
+    // Same order as Container::findInputControl, the last children are on top of the first ones
+    if (Container* container = dynamic_cast<Container*>(control))
+    {
+        const std::vector<Control*>& controls = container->getControls();
+        for (int i = (int)controls.size() - 1; i >= 0; --i)
+            addHitControls(controls[i]);
+    }
+
+    if (control->_absoluteClipBounds.width > 0 && control->_absoluteClipBounds.height > 0)
+        _hitControls.push_back(control);
+}
+
+void Form::updateHitTest()
+{
+    _hitDirty = false;
+    _hitControls.clear();
+    addHitControls(_root.get());
+
+    // About FORM_HIT_CELL_SIZE controls per cell
+    _hitBounds = _root->_absoluteClipBounds;
+    int size = (int)ceil(sqrt(_hitControls.size() / (float)FORM_HIT_CELL_SIZE));
+    _hitColumns = _hitRows = MATH_CLAMP(size, 1, FORM_HIT_MAX_GRID_SIZE);
+
+    _hitCells.resize(_hitColumns * _hitRows);
+    for (std::vector<int>& cell : _hitCells)
+        cell.clear();
+
+    float cellWidth = _hitBounds.width / _hitColumns;
+    float cellHeight = _hitBounds.height / _hitRows;
+    for (int i = 0, count = _hitControls.size(); i < count; ++i)
+    {
+        const Rectangle& bounds = _hitControls[i]->_absoluteClipBounds;
+        int x0 = MATH_CLAMP((int)((bounds.x - _hitBounds.x) / cellWidth), 0, _hitColumns - 1);
+        int x1 = MATH_CLAMP((int)((bounds.right() - _hitBounds.x) / cellWidth), 0, _hitColumns - 1);
+        int y0 = MATH_CLAMP((int)((bounds.y - _hitBounds.y) / cellHeight), 0, _hitRows - 1);
+        int y1 = MATH_CLAMP((int)((bounds.bottom() - _hitBounds.y) / cellHeight), 0, _hitRows - 1);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+                _hitCells[y * _hitColumns + x].push_back(i);
+        }
+    }
+}
+
+Control* Form::hitTest(int x, int y, bool focus)
+{
+    // A control removed or hidden since the last update dirties the root, and may already be released
+    if (_hitDirty || _root->isDirty(Control::DIRTY_BOUNDS))
+        updateHitTest();
+
+    if (!_hitBounds.contains(x, y) || _hitBounds.width <= 0 || _hitBounds.height <= 0)
+        return NULL;
+
+    int column = MATH_CLAMP((int)((x - _hitBounds.x) * _hitColumns / _hitBounds.width), 0, _hitColumns - 1);
+    int row = MATH_CLAMP((int)((y - _hitBounds.y) * _hitRows / _hitBounds.height), 0, _hitRows - 1);
+
+    // Controls are in hit order, the first one accepting the point is the top most
+    for (int i : _hitCells[row * _hitColumns + column])
+    {
+        Control* control = _hitControls[i];
+        if (control->_consumeInputEvents && (!focus || control->canFocus()) &&
+            control->_absoluteClipBounds.contains(x, y) && control->isEnabledInHierarchy())
+        {
+            return control;
+        }
+    }
+    return NULL;
+}
+
 SPtr<Control> Form::handlePointerPress(int* x, int* y, bool pressed, unsigned int contactIndex, bool* consumed)
 {
     if (contactIndex >= MotionEvent::MAX_TOUCH_POINTS)
@@ -507,6 +646,8 @@ SPtr<Control> Form::handlePointerMove(int* x, int* y, unsigned int contactIndex,
 
 void Form::verifyRemovedControlState(Control* control)
 {
+    _hitDirty = true;
+
     if (__focusControl.get() == control)
     {
         __focusControl = NULL;
@@ -633,6 +774,10 @@ bool Form::pointerEventInternal(bool mouse, int evt, int x, int y, int wheelDelt
 
     if (ctrl.get())
     {
+        // Controls may change what they draw without being dirty
+        if (evt != MotionEvent::mouseMove && evt != MotionEvent::touchMove)
+            redraw();
+
         // Handle setting focus for all press events
         if (pressEvent)
         {
@@ -719,7 +864,10 @@ bool Form::keyEventInternal(Keyboard::KeyEvent evt, int key)
         if (ctrl->isEnabled() && ctrl->isVisible())
         {
             if (ctrl->keyEvent(evt, key))
+            {
+                redraw();
                 return true;
+            }
         }
 
         ctrl = ctrl->getParent();
@@ -19,6 +19,7 @@ class FormManager;
 class ModalLayer;
 class Container;
 class BatchableLayer;
+class MultiSpriteBatch;
 class Style;
 
 /**
@@ -121,6 +122,33 @@ public:
      */
     void setBatchingEnabled(bool enabled);
 
+    /**
+     * Determines whether the draw calls of this form are kept from frame to frame.
+     *
+     * @return True if retained drawing is enabled for this form, false otherwise.
+     */
+    bool isRetainedEnabled() const;
+
+    /**
+     * Turns retained drawing on or off for this form.
+     *
+     * When enabled, the merged draw calls of the last frame are drawn again as long as no
+     * control changed, so a static form costs almost nothing per frame. Controls request a
+     * redraw when they are dirty or when their setters change what they draw. Requires batching,
+     * and is off by default.
+     *
+     * @param enabled True to enable retained drawing, false otherwise (default).
+     */
+    void setRetainedEnabled(bool enabled);
+
+    /**
+     * Draws the controls again on the next frame, instead of the retained draw calls.
+     *
+     * Called by controls that changed, and by application code that changes what a control
+     * draws without going through its setters.
+     */
+    void redraw();
+
 
     Container* getRoot();
     Container* getContent();
@@ -191,6 +219,9 @@ private:
 
 
     Control* findInputControl(int* x, int* y, bool focus, unsigned int contactIndex, bool* consumed);
+    Control* hitTest(int x, int y, bool focus);
+    void updateHitTest();
+    void addHitControls(Control* control);
     SPtr<Control> handlePointerPress(int* x, int* y, bool pressed, unsigned int contactIndex, bool* consumed);
     SPtr<Control> handlePointerRelease(int* x, int* y, bool pressed, unsigned int contactIndex, bool* consumed);
     bool bubblingTouch(SPtr<Control> ctrl, int formX, int formY, bool mouse, unsigned int contactIndex, int wheelDelta, int evt);
@@ -200,8 +231,23 @@ private:
 private:
     Matrix _projectionMatrix;           // Projection matrix to be set on SpriteBatch objects when rendering the form
     std::vector<BatchableLayer*> _batches;
+    MultiSpriteBatch* _spriteBatch = NULL; // Merges the batches when flushing them
     UPtr<Container> _root;
     bool _batched;
+    bool _retained = false;
+    bool _redraw = true;                // Whether the controls must be drawn again.
+    bool _replayable = false;           // Whether every batch was merged into _spriteBatch last frame.
+    unsigned int _fontVersion = 0;      // FontCache version of the retained draw calls.
+    unsigned int _themeVersion = 0;     // Theme atlas version of the retained draw calls.
+    int _retainedWidth = 0;             // Viewport size of the retained draw calls, when drawn in 2D.
+    int _retainedHeight = 0;
+
+    std::vector<Control*> _hitControls;         // Visible controls in hit test order, the top most first.
+    std::vector<std::vector<int> > _hitCells;   // Uniform grid over the form, the _hitControls overlapping each cell.
+    Rectangle _hitBounds;                       // Area covered by the grid.
+    int _hitColumns = 0;
+    int _hitRows = 0;
+    bool _hitDirty = true;                      // Whether the controls were laid out since the grid was built.
 
     SPtr<Control> __focusControl;
     SPtr<Control> __activeControl[MotionEvent::MAX_TOUCH_POINTS];
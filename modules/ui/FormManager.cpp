@@ -74,8 +74,8 @@ void FormManager::resizeEventInternal(unsigned int width, unsigned int height)
         Form* form = __forms[i];
         if (form)
         {
-            // Dirty the form
-            form->getRoot()->requestLayout(true);
+            // Dirty the form, the controls sized from the screen are measured again
+            form->getRoot()->requestLayout();
         }
     }
 }
@@ -67,9 +67,13 @@ void Icon::onDeserialize(Serializer* serializer) {
 
 void Icon::setImagePath(const char* path)
 {
-    _image = getTheme()->getImageFullName(path);
-    GP_ASSERT(_image);
+    _loadedImage = getTheme()->loadImage(path);
+    _image = _loadedImage.get();
     _imagePath = path;
+    if (isWrapContentSize())
+        setDirty(DIRTY_BOUNDS);
+    else
+        requestRedraw();
 }
 
 const char* Icon::getImagePath() {
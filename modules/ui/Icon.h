@@ -71,6 +71,7 @@ protected:
 protected:
     std::string _imagePath;
     ThemeImage* _image = NULL;
+    SPtr<ThemeImage> _loadedImage;      // Image loaded from _imagePath, keeps it in the theme atlas.
 };
 
 class LoadingView : public Icon {
@@ -4,6 +4,9 @@
 namespace mgp
 {
 
+// Max size of the images drawn from the theme atlas, larger ones get their own texture.
+#define IMAGEVIEW_ATLAS_MAX_SIZE 256
+
 ImageView::ImageView() :
     _srcRegion(Rectangle::empty()), _dstRegion(Rectangle::empty()), _batch(NULL),
     _tw(0.0f), _th(0.0f), _uvs(Vector4(0,0,1,1))
@@ -48,14 +51,24 @@ void ImageView::setImage(const char* path)
 {
     _imagePath = path;
     SAFE_DELETE(_batch);
-    UPtr<Texture> texture = Texture::create(path, false);
-    _batch = SpriteBatch::create(texture.get()).take();
-    _tw = 1.0f / texture->getWidth();
-    _th = 1.0f / texture->getHeight();
-    //texture->release();
+
+    // Small images are drawn from the theme atlas, so they batch with the other controls.
+    UPtr<Image> decoded;
+    _image = getTheme()->loadImage(path, IMAGEVIEW_ATLAS_MAX_SIZE, &decoded);
+    if (!_image.get())
+    {
+        // Reuse the image decoded by the theme, files it cannot decode are loaded by the texture.
+        UPtr<Texture> texture = decoded.get() ? Texture::create(path, std::move(decoded), false) : Texture::create(path, false);
+        _batch = SpriteBatch::create(texture.get()).take();
+        _tw = 1.0f / texture->getWidth();
+        _th = 1.0f / texture->getHeight();
+        //texture->release();
+    }
 
     if (isWrapContentSize())
         setDirty(DIRTY_BOUNDS);
+    else
+        requestRedraw();
 }
 
 void ImageView::setRegionSrc(float x, float y, float width, float height)
@@ -66,6 +79,7 @@ void ImageView::setRegionSrc(float x, float y, float width, float height)
     _uvs.z = (x + width) * _tw;
     _uvs.y = (y * _th);
     _uvs.w = ((y + height) * _th);
+    requestRedraw();
 }
 
 void ImageView::setRegionSrc(const Rectangle& region)
@@ -81,6 +95,7 @@ const Rectangle& ImageView::getRegionSrc() const
 void ImageView::setRegionDst(float x, float y, float width, float height)
 {
     _dstRegion.set(x, y, width, height);
+    requestRedraw();
 }
 
 void ImageView::setRegionDst(const Rectangle& region)
@@ -95,34 +110,59 @@ const Rectangle& ImageView::getRegionDst() const
 
 unsigned int ImageView::drawImages(Form* form, const Rectangle& clip, RenderInfo* view)
 {
-    if (!_batch)
+    SpriteBatch* batch = _image.get() ? getStyle()->getTheme()->getSpriteBatch() : _batch;
+    if (!batch)
         return 0;
 
-    startBatch(form, _batch);
+    Vector4 uvs = _uvs;
+    if (_image.get())
+    {
+        // The region moves when the atlas is repacked.
+        const Rectangle& region = _image->getRegion();
+        Rectangle src = _srcRegion.isEmpty() ? Rectangle(0, 0, region.width, region.height) : _srcRegion;
+        float tw = 1.0f / batch->getSampler()->getWidth();
+        float th = 1.0f / batch->getSampler()->getHeight();
+        uvs.set((region.x + src.x) * tw, (region.y + src.y) * th,
+            (region.x + src.x + src.width) * tw, (region.y + src.y + src.height) * th);
+    }
+
+    startBatch(form, batch);
 
     Vector4 color = Vector4::one();
     color.w *= _opacity;
 
     if (_dstRegion.isEmpty())
     {
-        _batch->draw(_viewportBounds.x, _viewportBounds.y, _viewportBounds.width, _viewportBounds.height,
-            _uvs.x, _uvs.y, _uvs.z, _uvs.w, color, &_viewportClipBounds);
+        batch->draw(_viewportBounds.x, _viewportBounds.y, _viewportBounds.width, _viewportBounds.height,
+            uvs.x, uvs.y, uvs.z, uvs.w, color, &_viewportClipBounds);
     }
     else
     {
-        _batch->draw(_viewportBounds.x + _dstRegion.x, _viewportBounds.y + _dstRegion.y,
+        batch->draw(_viewportBounds.x + _dstRegion.x, _viewportBounds.y + _dstRegion.y,
             _dstRegion.width, _dstRegion.height,
-            _uvs.x, _uvs.y, _uvs.z, _uvs.w, color, &_viewportClipBounds);
+            uvs.x, uvs.y, uvs.z, uvs.w, color, &_viewportClipBounds);
     }
 
-    finishBatch(form, _batch, view);
+    finishBatch(form, batch, view);
 
     return 1;
 }
 
 void ImageView::measureSize()
 {
-    if (_batch)
+    if (_image.get())
+    {
+        if (_autoSizeW == AUTO_WRAP_CONTENT)
+        {
+            setMeasureContentWidth(_image->getRegion().width);
+        }
+
+        if (_autoSizeH == AUTO_WRAP_CONTENT)
+        {
+            setMeasureContentHeight(_image->getRegion().height);
+        }
+    }
+    else if (_batch)
     {
         if (_autoSizeW == AUTO_WRAP_CONTENT)
         {
@@ -131,7 +171,7 @@ void ImageView::measureSize()
 
         if (_autoSizeH == AUTO_WRAP_CONTENT)
         {
-            setMeasureContentHeight(_batch->getSampler()->getWidth());
+            setMeasureContentHeight(_batch->getSampler()->getHeight());
         }
     }
 
@@ -114,6 +114,8 @@ private:
     // Destination region.
     Rectangle _dstRegion;
     SpriteBatch* _batch;
+    // Image in the theme atlas, _batch is only used for the images too large for it.
+    SPtr<ThemeImage> _image;
 
     // One over texture width and height, for use when calculating UVs from a new source region.
     float _tw;
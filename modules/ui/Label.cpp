@@ -49,6 +49,7 @@ void Label::setText(const char* text, bool fireEvent)
             setDirty(DIRTY_BOUNDS);
         else {
             updateFontLayout();
+            requestRedraw();
         }
     }
 }
@@ -73,13 +74,22 @@ void Label::updateFontLayout() {
     fontLayout.update(_font, getStyle()->getFontSize(), text.c_str(), text.size(), wrapWidth);
 }
 
+void Label::measureText(unsigned int* widthOut, unsigned int* heightOut)
+{
+    fontLayout.measureText(widthOut, heightOut);
+}
+
 void Label::update(float elapsedTime)
 {
     Control::update(elapsedTime);
 
     // Update text opacity each frame since opacity is updated in Control::update.
-    _textColor = getStyle()->getTextColor();
-    _textColor.w *= _opacity;
+    Vector4 textColor = getStyle()->getTextColor();
+    textColor.w *= _opacity;
+    if (textColor != _textColor) {
+        _textColor = textColor;
+        requestRedraw();
+    }
 }
 
 void Label::updateState(State state)
@@ -100,7 +110,7 @@ void Label::measureSize()
         // This is a trade-off for functionality vs performance, but changing the size of UI controls on hover/focus/etc
         // is a pretty bad practice so we'll prioritize performance here.
         unsigned int w, h;
-        fontLayout.measureText(&w, &h);
+        measureText(&w, &h);
         if (h == 0) {
             h = getStyle()->getFontSize();
 #ifndef __EMSCRIPTEN__
@@ -31,7 +31,7 @@ public:
      *
      * @return The text displayed by this label.
      */
-    const char* getText();
+    virtual const char* getText();
 
     /**
      * Add a listener to be notified of specific events affecting
@@ -89,7 +89,12 @@ protected:
     virtual unsigned int drawText(Form* form, const Rectangle& clip, RenderInfo* view);
 
     virtual std::string& getDisplayedText();
-    void updateFontLayout();
+    virtual void updateFontLayout();
+
+    /**
+     * Measures the laid out text, used to wrap the content size.
+     */
+    virtual void measureText(unsigned int* widthOut, unsigned int* heightOut);
 
     /**
      * The text displayed by this label.
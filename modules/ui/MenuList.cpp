@@ -13,6 +13,7 @@ MenuList::MenuList()
     _className = "MenuList";
     //setHeight(0.8, true);
     setWidth(250);
+    setItemSource(this);
 }
 
 MenuList::~MenuList()
@@ -38,18 +39,12 @@ void MenuList::onDeserialize(Serializer* serializer) {
         _items.push_back(value);
     }
     serializer->finishColloction();
+    reloadItems();
 }
 
 void MenuList::controlEvent(Control* control, EventType evt) {
     if (evt == Control::Listener::CLICK) {
-        int index = -1;
-        for (int i = 0; i < getControlCount(); ++i) {
-            Control* c = getControl(i);
-            if (control == c) {
-                index = i;
-                break;
-            }
-        }
+        int index = getItemIndex(control);
 
         _selectIndex = index;
         if (index != -1) {
@@ -62,15 +57,24 @@ void MenuList::controlEvent(Control* control, EventType evt) {
 
 void MenuList::initItems(std::vector<std::string>& items) {
     _items = items;
-    for (std::string& name : items) {
-        UPtr<Button> label = Control::create<Button>((this->_id + "_items").c_str());
-        label->setPadding(4);
-        label->setStyleName("MenuItem");
-        label->setText(name.c_str());
-        label->setWidth(1, Control::AUTO_PERCENT_PARENT);
-        label->addListener(this, Control::Listener::CLICK);
-        this->addControl(std::move(label));
-    }
+    reloadItems();
+}
+
+int MenuList::getItemCount() {
+    return _items.size();
+}
+
+UPtr<Control> MenuList::createCell() {
+    UPtr<Button> label = Control::create<Button>((this->_id + "_items").c_str());
+    label->setPadding(4);
+    label->setStyleName("MenuItem");
+    label->setWidth(1, Control::AUTO_PERCENT_PARENT);
+    label->addListener(this, Control::Listener::CLICK);
+    return label;
+}
+
+void MenuList::bindCell(Control* cell, int index) {
+    static_cast<Button*>(cell)->setText(_items[index].c_str());
 }
 
 void MenuList::measureSize() {
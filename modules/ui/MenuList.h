@@ -10,7 +10,7 @@
 namespace mgp
 {
 
-class MenuList : public ScrollContainer, public Control::Listener {
+class MenuList : public ScrollContainer, public Control::Listener, public ScrollContainer::ItemSource {
     friend class Control;
     std::vector<std::string> _items;
     int _selectIndex = -1;
@@ -27,6 +27,12 @@ protected:
     void controlEvent(Control* control, EventType evt) override;
 
     void measureSize() override;
+
+    int getItemCount() override;
+
+    UPtr<Control> createCell() override;
+
+    void bindCell(Control* cell, int index) override;
 public:
     int getSelectIndex() { return _selectIndex; }
     void initItems(std::vector<std::string>& items);
@@ -41,6 +41,7 @@ void ProgressBar::setValue(float value, bool fireEvent)
     if (value != _value)
     {
         _value = value;
+        requestRedraw();
         if (fireEvent) notifyListeners(Control::Listener::VALUE_CHANGED);
     }
 }
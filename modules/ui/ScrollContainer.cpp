@@ -31,6 +31,8 @@ static const float SCROLL_THRESHOLD = 10.0f;
 static const long SCROLLBAR_FADE_TIME = 1500L;
 // If the DPad or joystick is held down, this is the initial delay in milliseconds between focus change events.
 static const float FOCUS_CHANGE_REPEAT_DELAY = 300.0f;
+// Number of rows bound above and below the ones in view, when virtualized.
+static const int SCROLL_ITEM_MARGIN = 4;
 
 
 ScrollContainer::ScrollContainer()
@@ -45,7 +47,8 @@ ScrollContainer::ScrollContainer()
     _scrollingMouseVertically(false), _scrollingMouseHorizontally(false),
     _scrollBarOpacityClip(NULL),
     _lastFrameTime(0), _totalWidth(0), _totalHeight(0),
-    _initializedWithScroll(false), _scrollWheelRequiresFocus(false)
+    _initializedWithScroll(false), _scrollWheelRequiresFocus(false),
+    _itemSource(NULL), _itemHeight(0), _measuredItemHeight(0), _itemsDirty(false)
 {
     _className = "ScrollContainer";
     _consumeInputEvents = true;
@@ -161,6 +164,165 @@ void ScrollContainer::setScrollWheelRequiresFocus(bool required)
     _scrollWheelRequiresFocus = required;
 }
 
+void ScrollContainer::setItemSource(ItemSource* source, float itemHeight)
+{
+    clear();
+    _cells.clear();
+    _cellItems.clear();
+    _itemSource = source;
+    _itemHeight = itemHeight;
+    _measuredItemHeight = 0;
+    _itemsDirty = true;
+    setDirty(DIRTY_BOUNDS);
+}
+
+ScrollContainer::ItemSource* ScrollContainer::getItemSource() const
+{
+    return _itemSource;
+}
+
+void ScrollContainer::reloadItems()
+{
+    _itemsDirty = true;
+    setDirty(DIRTY_BOUNDS);
+}
+
+int ScrollContainer::getItemIndex(Control* control) const
+{
+    while (control && control->getParent() != this)
+        control = control->getParent();
+    for (size_t i = 0, count = _cells.size(); i < count; ++i)
+    {
+        if (_cells[i] == control)
+            return _cellItems[i];
+    }
+    return -1;
+}
+
+void ScrollContainer::scrollToItem(int index)
+{
+    float itemHeight = getItemHeight();
+    float y = index * itemHeight;
+    Vector2 scrollPosition = _scrollPosition;
+    if (y < -scrollPosition.y)
+        scrollPosition.y = -y;
+    else if (y + itemHeight > -scrollPosition.y + _viewportBounds.height)
+        scrollPosition.y = -(y + itemHeight - _viewportBounds.height);
+    if (scrollPosition != _scrollPosition)
+        setScrollPosition(scrollPosition);
+}
+
+float ScrollContainer::getItemHeight()
+{
+    if (!_itemSource)
+        return 0;
+    if (_itemHeight > 0)
+        return _itemHeight;
+
+    if (_measuredItemHeight <= 0 && _itemSource->getItemCount() > 0)
+    {
+        // Measure the first row, the others have the same height
+        int cell = _cells.size() ? 0 : addCell();
+        _cellItems[cell] = 0;
+        _itemSource->bindCell(_cells[cell], 0);
+        _cells[cell]->measure();
+        _measuredItemHeight = _cells[cell]->getMeasureBufferedHeight();
+    }
+    return _measuredItemHeight;
+}
+
+int ScrollContainer::addCell()
+{
+    UPtr<Control> cell = _itemSource->createCell();
+    GP_ASSERT(cell.get());
+    _cells.push_back(cell.get());
+    _cellItems.push_back(-1);
+    addControl(std::move(cell));
+    return _cells.size() - 1;
+}
+
+void ScrollContainer::updateItems()
+{
+    int count = _itemSource->getItemCount();
+    float itemHeight = getItemHeight();
+
+    // Rows in view
+    int first = 0;
+    int last = 0;
+    if (count > 0 && itemHeight > 0)
+    {
+        first = std::max((int)(-_scrollPosition.y / itemHeight) - SCROLL_ITEM_MARGIN, 0);
+        last = std::min((int)ceil((-_scrollPosition.y + _viewportBounds.height) / itemHeight) + SCROLL_ITEM_MARGIN, count);
+        last = std::max(last, first);
+    }
+
+    // Free the cells of the rows scrolled out
+    std::vector<bool> bound(last - first, false);
+    std::vector<int> freeCells;
+    for (int i = (int)_cells.size() - 1; i >= 0; --i)
+    {
+        int item = _cellItems[i];
+        if (!_itemsDirty && item >= first && item < last)
+        {
+            bound[item - first] = true;
+        }
+        else
+        {
+            _cellItems[i] = -1;
+            freeCells.push_back(i);
+        }
+    }
+    _itemsDirty = false;
+
+    // And bind them to the rows scrolled in
+    for (int item = first; item < last; ++item)
+    {
+        if (bound[item - first])
+            continue;
+
+        int cell;
+        if (freeCells.size())
+        {
+            cell = freeCells.back();
+            freeCells.pop_back();
+        }
+        else
+        {
+            cell = addCell();
+        }
+        _cellItems[cell] = item;
+        _cells[cell]->setVisible(true);
+        _itemSource->bindCell(_cells[cell], item);
+    }
+
+    for (int cell : freeCells)
+    {
+        _cells[cell]->setVisible(false);
+    }
+
+    // Stack the rows, the layout only sees the cells
+    updateChildBounds();
+    for (size_t i = 0, cellCount = _cells.size(); i < cellCount; ++i)
+    {
+        if (_cellItems[i] != -1)
+        {
+            Control* cell = _cells[i];
+            cell->_localBounds.y = _cellItems[i] * itemHeight + cell->_margin.top;
+        }
+    }
+}
+
+void ScrollContainer::measureSize()
+{
+    Container::measureSize();
+
+    // The cells only cover the rows in view
+    if (_itemSource && _autoSizeH == AUTO_WRAP_CONTENT)
+    {
+        setMeasureContentHeight(_itemSource->getItemCount() * getItemHeight());
+    }
+}
+
 
 void ScrollContainer::updateState(Control::State state)
 {
@@ -205,11 +367,18 @@ void ScrollContainer::updateAbsoluteBounds(const Vector2& offset)
 void ScrollContainer::layoutChildren(bool dirtyBounds)
 {
     if (dirtyBounds) {
-        updateChildBounds();
+        if (_itemSource) {
+            // The scroll position decides which rows are bound
+            updateScroll();
+            updateItems();
+        }
+        else {
+            updateChildBounds();
 
-        // Update scroll position and scrollbars after updating absolute bounds since
-        // computation relies on up-to-date absolute bounds information.
-        updateScroll();
+            // Update scroll position and scrollbars after updating absolute bounds since
+            // computation relies on up-to-date absolute bounds information.
+            updateScroll();
+        }
     }
 
     for (size_t i = 0, count = _controls.size(); i < count; ++i)
@@ -421,6 +590,12 @@ void ScrollContainer::updateScroll()
         }
     }
 
+    // Only the rows in view have a cell
+    if (_itemSource)
+    {
+        _totalHeight = _itemSource->getItemCount() * getItemHeight();
+    }
+
     float vWidth = getTheme()->getImage("verticalScrollBar")->getRegion().width;
     float hHeight = getTheme()->getImage("horizontalScrollBar")->getRegion().height;
     float clipWidth = _absoluteBounds.width - containerPadding.left - containerPadding.right;
@@ -899,6 +1074,7 @@ void ScrollContainer::setAnimationPropertyValue(int propertyId, AnimationValue*
     {
     case ANIMATE_SCROLLBAR_OPACITY:
         _scrollBarOpacity = Curve::lerp(blendWeight, _opacity, value->getFloat(0));
+        requestRedraw();
         break;
     default:
         Control::setAnimationPropertyValue(propertyId, value, blendWeight);
@@ -36,6 +36,39 @@ public:
         SCROLL_BOTH = SCROLL_HORIZONTAL | SCROLL_VERTICAL
     };
 
+    /**
+     * Provides the rows of a virtualized container.
+     *
+     * Only the rows in view, plus a few above and below, have a cell control. The cells of
+     * the rows scrolled out are bound to the rows scrolled in, so the cost does not depend
+     * on the number of rows.
+     *
+     * @see setItemSource
+     */
+    class ItemSource
+    {
+    public:
+        virtual ~ItemSource() { }
+
+        /**
+         * Gets the number of rows.
+         */
+        virtual int getItemCount() = 0;
+
+        /**
+         * Creates a cell control, shown at a row with bindCell. All cells have the same height.
+         */
+        virtual UPtr<Control> createCell() = 0;
+
+        /**
+         * Shows a row in a cell, called when the cell is scrolled in or the rows were reloaded.
+         *
+         * @param cell A cell created by createCell.
+         * @param index The row index.
+         */
+        virtual void bindCell(Control* cell, int index) = 0;
+    };
+
     /**
      * @see Control::updateAbsoluteBounds
      */
@@ -128,6 +161,41 @@ public:
      */
     void setScrollWheelRequiresFocus(bool required);
 
+    /**
+     * Makes this container a virtualized list of rows, stacked vertically.
+     *
+     * The children are then the cells created by the source, and should not be added or
+     * removed directly.
+     *
+     * @param source The rows, NULL to turn virtualization off. Not owned, must outlive the container.
+     * @param itemHeight The height of a row, zero to measure the first cell.
+     */
+    void setItemSource(ItemSource* source, float itemHeight = 0);
+
+    /**
+     * Gets the source of the rows, NULL if not virtualized.
+     */
+    ItemSource* getItemSource() const;
+
+    /**
+     * Binds the cells in view again, after the rows of the source changed.
+     */
+    void reloadItems();
+
+    /**
+     * Gets the row shown by a cell.
+     *
+     * @param control A cell or a control inside a cell.
+     *
+     * @return The row index, -1 if the control is not in a bound cell.
+     */
+    int getItemIndex(Control* control) const;
+
+    /**
+     * Scrolls the least needed to bring a row in view.
+     */
+    void scrollToItem(int index);
+
     /**
      * @see AnimationTarget::getAnimationPropertyComponentCount
      */
@@ -169,6 +237,11 @@ protected:
      */
     void updateState(Control::State state) override;
 
+    /**
+     * @see Control::measureSize
+     */
+    void measureSize() override;
+
 
     /**
      * Updates the bounds for this container's child controls.
@@ -345,6 +418,15 @@ private:
     // Starts scrolling at the given horizontal and vertical speeds.
     void startScrolling(float x, float y, bool resetTime = true);
 
+    // Gets the height of a row, measures the first cell if it was not given.
+    float getItemHeight();
+
+    // Adds a new cell to the pool.
+    int addCell();
+
+    // Binds the rows in view to cells and positions them.
+    void updateItems();
+
 
     AnimationClip* _scrollBarOpacityClip;
 
@@ -356,6 +438,13 @@ private:
 
     bool _initializedWithScroll;
     bool _scrollWheelRequiresFocus;
+
+    ItemSource* _itemSource;
+    float _itemHeight;                  // Height of a row, zero to measure the first cell.
+    float _measuredItemHeight;
+    std::vector<Control*> _cells;       // Cell pool, in the order they were created.
+    std::vector<int> _cellItems;        // Row shown by each cell, -1 if unused.
+    bool _itemsDirty;                   // Whether the cells must be bound again.
 };
 
 class Button;
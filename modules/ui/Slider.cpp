@@ -56,6 +56,7 @@ void Slider::onDeserialize(Serializer* serializer) {
 void Slider::setMin(float min)
 {
     _min = min;
+    requestRedraw();
 }
 
 float Slider::getMin() const
@@ -66,6 +67,7 @@ float Slider::getMin() const
 void Slider::setMax(float max)
 {
     _max = max;
+    requestRedraw();
 }
 
 float Slider::getMax() const
@@ -95,6 +97,7 @@ void Slider::setValue(float value, bool fireEvent)
     if (value != _value)
     {
         _value = value;
+        requestRedraw();
         if (fireEvent) notifyListeners(Control::Listener::VALUE_CHANGED);
     }
 
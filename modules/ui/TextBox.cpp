@@ -61,13 +61,16 @@ int TextBox::enumParse(const std::string& enumName, const std::string& str)
 }
 
 void TextBox::onSerialize(Serializer* serializer) {
+    getText();
     Label::onSerialize(serializer);
     serializer->writeEnum("inputMode", "mgp::TextBox::InputMode", _inputMode, TEXT);
 }
 
 void TextBox::onDeserialize(Serializer* serializer) {
     Label::onDeserialize(serializer);
-    _inputMode = (InputMode)serializer->readEnum("inputMode", "mgp::TextBox::InputMode", TEXT);
+    setInputMode((InputMode)serializer->readEnum("inputMode", "mgp::TextBox::InputMode", TEXT));
+    _document.setText(_text.c_str(), (int)_text.size());
+    _textDirty = false;
 }
 
 void TextBox::addListener(Control::Listener* listener, Listener::EventType eventFlags)
@@ -93,8 +96,9 @@ unsigned int TextBox::getCaretLocation() const
 void TextBox::setCaretLocation(unsigned int index)
 {
     _caretLocation = index;
-    if (_caretLocation > _text.length())
-        _caretLocation = (unsigned int)_text.length();
+    if (_caretLocation > _document.getLength())
+        _caretLocation = _document.getLength();
+    requestRedraw();
 }
 
 bool TextBox::touchEvent(MotionEvent::MotionType evt, int x, int y, unsigned int contactIndex)
@@ -120,7 +124,7 @@ bool TextBox::touchEvent(MotionEvent::MotionType evt, int x, int y, unsigned int
     return Label::touchEvent(evt, x, y, contactIndex);
 }
 
-static bool isWhitespace(char c)
+static bool isWhitespace(wchar_t c)
 {
     switch (c)
     {
@@ -135,7 +139,7 @@ static bool isWhitespace(char c)
     }
 }
 
-static unsigned int findNextWord(const std::string& text, unsigned int from, bool backwards)
+static unsigned int findNextWord(const TextDocument& text, unsigned int from, bool backwards)
 {
     int pos = (int)from;
     if (backwards)
@@ -143,24 +147,24 @@ static unsigned int findNextWord(const std::string& text, unsigned int from, boo
         if (pos > 0)
         {
             // Moving backwards: skip all consecutive whitespace characters
-            while (pos > 0 && isWhitespace(text.at(pos-1)))
+            while (pos > 0 && isWhitespace(text.charAt(pos-1)))
                 --pos;
             // Now search back to the first whitespace character
-            while (pos > 0 && !isWhitespace(text.at(pos-1)))
+            while (pos > 0 && !isWhitespace(text.charAt(pos-1)))
                 --pos;
         }
     }
     else
     {
-        const int len = (const int)text.length();
+        const int len = (const int)text.getLength();
         if (pos < len)
         {
             // Moving forward: skip all consecutive non-whitespace characters
             ++pos;
-            while (pos < len && !isWhitespace(text.at(pos)))
+            while (pos < len && !isWhitespace(text.charAt(pos)))
                 ++pos;
             // Now search for the first non-whitespace character
-            while (pos < len && isWhitespace(text.at(pos)))
+            while (pos < len && isWhitespace(text.charAt(pos)))
                 ++pos;
         }
     }
@@ -196,25 +200,24 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                 }
                 case Keyboard::KEY_END:
                 {
-                    _caretLocation = _text.length();
+                    _caretLocation = _document.getLength();
                     break;
                 }
                 case Keyboard::KEY_DELETE:
                 {
-                    if (_caretLocation < _text.length())
+                    if (_caretLocation < _document.getLength())
                     {
                         int newCaretLocation;
                         if (_ctrlPressed)
                         {
-                            newCaretLocation = findNextWord(getDisplayedText(), _caretLocation, false);
+                            newCaretLocation = findNextWord(_document, _caretLocation, false);
                         }
                         else
                         {
                             newCaretLocation = _caretLocation + 1;
                         }
-                        _text.erase(_caretLocation, newCaretLocation - _caretLocation);
-                        notifyListeners(Control::Listener::TEXT_CHANGED);
-                        updateFontLayout();
+                        _document.erase(_caretLocation, newCaretLocation - _caretLocation);
+                        textChanged();
                     }
                     break;
                 }
@@ -229,7 +232,7 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                     {
                         if (_ctrlPressed)
                         {
-                            _caretLocation = findNextWord(getDisplayedText(), _caretLocation, true);
+                            _caretLocation = findNextWord(_document, _caretLocation, true);
                         }
                         else
                         {
@@ -240,11 +243,11 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                 }
                 case Keyboard::KEY_RIGHT_ARROW:
                 {
-                    if (_caretLocation < _text.length())
+                    if (_caretLocation < _document.getLength())
                     {
                         if (_ctrlPressed)
                         {
-                            _caretLocation = findNextWord(getDisplayedText(), _caretLocation, false);
+                            _caretLocation = findNextWord(_document, _caretLocation, false);
                         }
                         else
                         {
@@ -254,13 +257,16 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                     break;
                 }
                 case Keyboard::KEY_UP_ARROW:
-                {
-                    // TODO: Support multiline
-                    break;
-                }
                 case Keyboard::KEY_DOWN_ARROW:
                 {
-                    // TODO: Support multiline
+                    if (multiLine)
+                    {
+                        // To the middle of the previous or next row.
+                        FontLayout::Justify align = getStyle()->getTextAlignment();
+                        Vector2 point = _document.positionAtIndex(_caretLocation, _textBounds, align);
+                        point.y += _document.getLineHeight() * (key == Keyboard::KEY_UP_ARROW ? -0.5f : 1.5f);
+                        _caretLocation = _document.indexAtPosition(point, _textBounds, align);
+                    }
                     break;
                 }
                 case Keyboard::KEY_BACKSPACE:
@@ -270,16 +276,15 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                         int newCaretLocation;
                         if (_ctrlPressed)
                         {
-                            newCaretLocation = findNextWord(getDisplayedText(), _caretLocation, true);
+                            newCaretLocation = findNextWord(_document, _caretLocation, true);
                         }
                         else
                         {
                             newCaretLocation = _caretLocation - 1;
                         }
-                        _text.erase(newCaretLocation, _caretLocation - newCaretLocation);
+                        _document.erase(newCaretLocation, _caretLocation - newCaretLocation);
                         _caretLocation = newCaretLocation;
-                        notifyListeners(Control::Listener::TEXT_CHANGED);
-                        updateFontLayout();
+                        textChanged();
                     }
                     break;
                 }
@@ -292,8 +297,17 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
             switch (key)
             {
                 case Keyboard::KEY_RETURN:
-                    // TODO: Support multi-line
-                    notifyListeners(Control::Listener::ACTIVATED);
+                    if (multiLine)
+                    {
+                        wchar_t lineBreak = L'\n';
+                        _document.insert(_caretLocation, &lineBreak, 1);
+                        ++_caretLocation;
+                        textChanged();
+                    }
+                    else
+                    {
+                        notifyListeners(Control::Listener::ACTIVATED);
+                    }
                     break;
                 case Keyboard::KEY_ESCAPE:
                     break;
@@ -312,14 +326,10 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                     // Insert character into string, only if our font supports this character
                     if (_font && _font->isCharacterSupported(key))
                     {
-                        if (_caretLocation <= _text.length())
-                        {
-                            _text.insert(_caretLocation, 1, (char)key);
-                            ++_caretLocation;
-                        }
-
-                        notifyListeners(Control::Listener::TEXT_CHANGED);
-                        updateFontLayout();
+                        wchar_t c = (wchar_t)key;
+                        _document.insert(_caretLocation, &c, 1);
+                        ++_caretLocation;
+                        textChanged();
                     }
                     break;
                 }
@@ -357,7 +367,7 @@ void TextBox::controlEvent(Control::Listener::EventType evt)
     {
     case Control::Listener::FOCUS_GAINED: {
 #ifdef __EMSCRIPTEN__
-        editTextCreate(_inputMode, _text.c_str(), this, "editTextOnTextChange");
+        editTextCreate(_inputMode, getText(), this, "editTextOnTextChange");
 
         int fontSize = getStyle()->getFontSize();
         editTextUpdate(_absoluteBounds.x + getPadding().left, _absoluteBounds.y + getPadding().top,
@@ -429,20 +439,14 @@ unsigned int TextBox::drawImages(Form* form, const Rectangle& clip, RenderInfo*
 
 unsigned int TextBox::drawText(Form* form, const Rectangle& clip, RenderInfo* view)
 {
-    if (_text.size() <= 0)
+    if (_document.getLength() == 0)
         return 0;
 
-    // Draw the text.
+    // Draw the text, only the rows in the clip are drawn.
     if (_font)
     {
-        //Control::State state = getState();
-        //unsigned int fontSize = getStyle()->getFontSize();
-
-        //SpriteBatch* batch = _font->getSpriteBatch(fontSize);
         startBatch(form, _font, 2);
-        //_font->start();
-        fontLayout.drawText(_textBounds, _textColor, getStyle()->getTextAlignment(), &_viewportClipBounds);
-        //_font->finish();
+        _document.drawText(_textBounds, _textColor, getStyle()->getTextAlignment(), &_viewportClipBounds);
         finishBatch(form, _font, view);
 
         return 1;
@@ -453,43 +457,81 @@ unsigned int TextBox::drawText(Form* form, const Rectangle& clip, RenderInfo* vi
 
 void TextBox::setText(char const *text, bool fireEvent)
 {
-    Label::setText(text);
-    if (_caretLocation > _text.length())
+    if (!text)
+        text = "";
+    if (_textDirty || _text.compare(text) != 0)
     {
-        _caretLocation = _text.length();
+        _text = text;
+        _textDirty = false;
+        _document.setText(_text.c_str(), (int)_text.size());
+        if (_caretLocation > _document.getLength())
+        {
+            _caretLocation = _document.getLength();
+        }
+        if (isWrapContentSize())
+            setDirty(DIRTY_BOUNDS);
+        else
+            requestRedraw();
     }
     if (fireEvent) notifyListeners(Control::Listener::TEXT_CHANGED);
 }
 
-void TextBox::setCaretLocation(int x, int y)
+const char* TextBox::getText()
 {
-    Control::State state = getState();
-
-    Vector2 point(x - (_textBounds.x - _absoluteBounds.x), y - (_textBounds.y - _absoluteBounds.y));
-
-    int index = fontLayout.indexAtPosition(point);
-    if (index != -1)
+    if (_textDirty)
     {
-        _caretLocation = index;
+        _document.getText(_text);
+        _textDirty = false;
     }
+    return _text.c_str();
+}
+
+void TextBox::textChanged()
+{
+    _textDirty = true;
+    if (isWrapContentSize())
+        setDirty(DIRTY_BOUNDS);
     else
-    {
-        _caretLocation = _text.length();
+        requestRedraw();
+    notifyListeners(Control::Listener::TEXT_CHANGED);
+}
+
+void TextBox::updateFontLayout()
+{
+    if (!_font) return;
+    int wrapWidth = -1;
+    if (multiLine) {
+        wrapWidth = _measureBounds.width - getPadding().left - getPadding().right;
     }
+    _document.setLayout(_font, getStyle()->getFontSize(), wrapWidth);
+}
+
+void TextBox::measureText(unsigned int* widthOut, unsigned int* heightOut)
+{
+    _document.measureText(widthOut, heightOut);
+}
+
+void TextBox::setCaretLocation(int x, int y)
+{
+    Vector2 point(x + _absoluteBounds.x, y + _absoluteBounds.y);
+    _caretLocation = _document.indexAtPosition(point, _textBounds, getStyle()->getTextAlignment());
+    requestRedraw();
 }
 
 void TextBox::getCaretLocation(Vector2* p)
 {
     GP_ASSERT(p);
 
-    *p = fontLayout.positionAtIndex(_caretLocation);
-    p->x += (_textBounds.x - _absoluteBounds.x);
-    p->y += (_textBounds.y - _absoluteBounds.y);
+    *p = _document.positionAtIndex(_caretLocation, _textBounds, getStyle()->getTextAlignment());
+    p->x -= _absoluteBounds.x;
+    p->y -= _absoluteBounds.y;
 }
 
 void TextBox::setPasswordChar(char character)
 {
     _passwordChar = character;
+    _document.setPasswordChar(_inputMode == PASSWORD ? _passwordChar : 0);
+    requestRedraw();
 }
 
 char TextBox::getPasswordChar() const
@@ -500,6 +542,8 @@ char TextBox::getPasswordChar() const
 void TextBox::setInputMode(InputMode inputMode)
 {
     _inputMode = inputMode;
+    _document.setPasswordChar(_inputMode == PASSWORD ? _passwordChar : 0);
+    requestRedraw();
 }
 
 TextBox::InputMode TextBox::getInputMode() const
@@ -535,11 +579,12 @@ std::string& TextBox::getDisplayedText()
 {
     switch (_inputMode) {
         case PASSWORD:
-            _displayedText.insert((size_t)0, _text.length(), _passwordChar);
+            _displayedText.assign(_document.getLength(), _passwordChar);
             break;
 
         case TEXT:
         default:
+            getText();
             return _text;
             break;
     }
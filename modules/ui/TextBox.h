@@ -3,6 +3,7 @@
 
 #include <string>
 #include "Label.h"
+#include "TextDocument.h"
 
 namespace mgp
 {
@@ -15,6 +16,10 @@ namespace mgp
  * On mobile device you can tap or click within the text box to
  * bring up the virtual keyboard.
  *
+ * The text is kept in a TextDocument, edits only lay out the lines they touch and
+ * only the visible rows are drawn, so large multiline texts stay editable. The caret
+ * location is an index in characters.
+ *
  * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-UI_Forms
  */
 class TextBox : public Label
@@ -94,6 +99,11 @@ public:
      */
     void setText(char const *text, bool fireEvent = true) override;
 
+    /**
+     * Gets the text being edited, encoded again after the edits.
+     */
+    const char* getText() override;
+
     static std::string enumToString(const std::string& enumName, int value);
     static int enumParse(const std::string& enumName, const std::string& str);
 protected:
@@ -177,6 +187,16 @@ protected:
      */
     std::string& getDisplayedText();
 
+    /**
+     * @see Label::updateFontLayout
+     */
+    void updateFontLayout() override;
+
+    /**
+     * @see Label::measureText
+     */
+    void measureText(unsigned int* widthOut, unsigned int* heightOut) override;
+
     /**
      * The current location of the TextBox's caret.
      */
@@ -222,8 +242,14 @@ protected:
      */
     bool _shiftPressed = false;
 
+    /**
+     * The edited text, Label::_text is only encoded from it on request.
+     */
+    TextDocument _document;
+
 private:
     std::string _displayedText;
+    bool _textDirty = false;        // True if _text is older than _document.
 
     /**
      * Constructor.
@@ -233,6 +259,8 @@ private:
     void setCaretLocation(int x, int y);
 
     void getCaretLocation(Vector2* p);
+
+    void textChanged();
 };
 
 }
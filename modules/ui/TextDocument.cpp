@@ -0,0 +1,565 @@
+#include "base/Base.h"
+#include "TextDocument.h"
+
+#include <algorithm>
+
+extern "C" {
+#include "3rd/utf8.h"
+}
+
+namespace mgp
+{
+
+void TextDocument::CountTree::build(const std::vector<unsigned int>& counts)
+{
+    // Linear construction, each node adds itself to its parent.
+    _nodes.assign(counts.size() + 1, 0);
+    for (size_t i = 1; i < _nodes.size(); ++i)
+    {
+        _nodes[i] += counts[i - 1];
+        size_t parent = i + (i & (~i + 1));
+        if (parent < _nodes.size())
+            _nodes[parent] += _nodes[i];
+    }
+}
+
+void TextDocument::CountTree::add(unsigned int i, int delta)
+{
+    for (size_t n = i + 1; n < _nodes.size(); n += (n & (~n + 1)))
+    {
+        _nodes[n] += delta;
+    }
+}
+
+unsigned int TextDocument::CountTree::sum(unsigned int i) const
+{
+    unsigned int s = 0;
+    for (size_t n = i; n > 0; n -= (n & (~n + 1)))
+    {
+        s += _nodes[n];
+    }
+    return s;
+}
+
+unsigned int TextDocument::CountTree::find(unsigned int value) const
+{
+    // Greatest i with sum(i) <= value.
+    size_t step = 1;
+    while (step * 2 < _nodes.size())
+        step *= 2;
+
+    size_t pos = 0;
+    for (; step > 0; step /= 2)
+    {
+        if (pos + step < _nodes.size() && _nodes[pos + step] <= value)
+        {
+            pos += step;
+            value -= _nodes[pos];
+        }
+    }
+    return (unsigned int)pos;
+}
+
+unsigned int TextDocument::CountTree::total() const
+{
+    return _nodes.empty() ? 0 : sum((unsigned int)_nodes.size() - 1);
+}
+
+TextDocument::TextDocument() : _font(NULL), _fontSize(0), _wrapWidth(-1), _lineHeight(0), _passwordChar(0),
+    _laidOut(false), _maxWidth(0), _maxWidthDirty(false)
+{
+    _lines.resize(1);
+    buildTrees();
+}
+
+TextDocument::~TextDocument()
+{
+}
+
+void TextDocument::setText(const char* text, int textLen)
+{
+    if (!text)
+        text = "";
+    if (textLen < 0)
+        textLen = (int)strlen(text);
+
+    _lines.clear();
+    _lines.resize(1);
+
+    char* s = (char*)text;
+    const char* end = text + textLen;
+    while (s < end)
+    {
+        wchar_t c = (wchar_t)getu8c(&s, NULL);
+        if (c == 0 || s > end)
+            break;
+
+        if (c == '\n')
+            _lines.resize(_lines.size() + 1);
+        else
+            _lines.back().text.push_back(c);
+    }
+
+    _laidOut = false;
+    buildTrees();
+}
+
+void TextDocument::getText(std::string& text) const
+{
+    text.clear();
+    text.reserve(getLength());
+    for (size_t i = 0; i < _lines.size(); ++i)
+    {
+        if (i > 0)
+            text.push_back('\n');
+
+        const std::wstring& line = _lines[i].text;
+        for (wchar_t c : line)
+        {
+            char buffer[8];
+            char* p = buffer;
+            size_t left = sizeof(buffer);
+            if (putu8c((ucs4_t)c, &p, &left) >= 0)
+                text.append(buffer, p - buffer);
+        }
+    }
+}
+
+unsigned int TextDocument::getLength() const
+{
+    // Each line counts its line break, the last line has none.
+    return _charTree.total() - 1;
+}
+
+unsigned int TextDocument::getLineCount() const
+{
+    return (unsigned int)_lines.size();
+}
+
+wchar_t TextDocument::charAt(unsigned int index) const
+{
+    if (index >= getLength())
+        return 0;
+
+    unsigned int line = getLineAt(index);
+    unsigned int column = index - getLineStart(line);
+    const std::wstring& text = _lines[line].text;
+    return column < text.size() ? text[column] : L'\n';
+}
+
+unsigned int TextDocument::getLineAt(unsigned int index) const
+{
+    unsigned int line = _charTree.find(index);
+    return line < _lines.size() ? line : (unsigned int)_lines.size() - 1;
+}
+
+unsigned int TextDocument::getLineStart(unsigned int line) const
+{
+    return _charTree.sum(line);
+}
+
+void TextDocument::insert(unsigned int index, const wchar_t* text, unsigned int textLen)
+{
+    if (!text || textLen == 0)
+        return;
+
+    index = std::min(index, getLength());
+    unsigned int l = getLineAt(index);
+    unsigned int column = index - getLineStart(l);
+
+    const wchar_t* end = text + textLen;
+    const wchar_t* lineBreak = std::find(text, end, L'\n');
+    if (lineBreak == end)
+    {
+        _lines[l].text.insert(column, text, textLen);
+        _charTree.add(l, textLen);
+        lineChanged(l);
+        return;
+    }
+
+    // Split the line, the inserted lines go in between.
+    std::wstring tail = _lines[l].text.substr(column);
+    _lines[l].text.erase(column);
+    _lines[l].text.append(text, lineBreak);
+
+    std::vector<Line> added;
+    const wchar_t* p = lineBreak + 1;
+    while (true)
+    {
+        const wchar_t* next = std::find(p, end, L'\n');
+        added.resize(added.size() + 1);
+        added.back().text.assign(p, next);
+        if (next == end)
+            break;
+        p = next + 1;
+    }
+    added.back().text.append(tail);
+
+    _lines.insert(_lines.begin() + l + 1, added.begin(), added.end());
+    linesChanged(l, (unsigned int)added.size() + 1);
+}
+
+void TextDocument::erase(unsigned int index, unsigned int len)
+{
+    unsigned int length = getLength();
+    if (index >= length || len == 0)
+        return;
+    len = std::min(len, length - index);
+
+    unsigned int first = getLineAt(index);
+    unsigned int firstColumn = index - getLineStart(first);
+    unsigned int last = getLineAt(index + len);
+    unsigned int lastColumn = index + len - getLineStart(last);
+
+    if (first == last)
+    {
+        _lines[first].text.erase(firstColumn, lastColumn - firstColumn);
+        _charTree.add(first, -(int)len);
+        lineChanged(first);
+        return;
+    }
+
+    // Join the first and last lines, the lines in between are removed.
+    _lines[first].text.erase(firstColumn);
+    _lines[first].text.append(_lines[last].text, lastColumn, std::wstring::npos);
+    _lines.erase(_lines.begin() + first + 1, _lines.begin() + last + 1);
+    linesChanged(first, 1);
+}
+
+void TextDocument::setLayout(Font* font, unsigned int fontSize, int wrapWidth)
+{
+    if (wrapWidth <= 0)
+        wrapWidth = -1;
+
+    if (_font == font && _fontSize == fontSize && _wrapWidth == wrapWidth)
+        return;
+
+    _font = font;
+    _fontSize = fontSize;
+    _wrapWidth = wrapWidth;
+    _lineHeight = font ? font->getLineHeight(fontSize) : 0;
+
+    for (Line& line : _lines)
+    {
+        line.rows.clear();
+    }
+    _laidOut = false;
+}
+
+void TextDocument::setPasswordChar(wchar_t character)
+{
+    if (_passwordChar == character)
+        return;
+
+    _passwordChar = character;
+    for (Line& line : _lines)
+    {
+        line.rows.clear();
+    }
+    _laidOut = false;
+}
+
+unsigned int TextDocument::getLineHeight() const
+{
+    return _lineHeight;
+}
+
+bool TextDocument::isWrapping() const
+{
+    return _wrapWidth > 0;
+}
+
+const wchar_t* TextDocument::getDisplayedText(const Line& line, std::wstring& buffer) const
+{
+    if (_passwordChar == 0)
+        return line.text.data();
+
+    buffer.assign(line.text.size(), _passwordChar);
+    return buffer.data();
+}
+
+unsigned int TextDocument::getLineWidth(const Line& line) const
+{
+    unsigned int width = 0;
+    for (const Row& row : line.rows)
+    {
+        width = std::max(width, row.width);
+    }
+    return width;
+}
+
+int TextDocument::getRowLength(const Line& line, int row) const
+{
+    int end = row + 1 < (int)line.rows.size() ? line.rows[row + 1].pos : (int)line.text.size();
+    return end - line.rows[row].pos;
+}
+
+TextDocument::Line& TextDocument::getLine(unsigned int index)
+{
+    Line& line = _lines[index];
+    if (line.rows.empty())
+        layoutLine(line);
+    return line;
+}
+
+void TextDocument::layoutLine(Line& line)
+{
+    GP_ASSERT(_font);
+
+    std::wstring buffer;
+    const wchar_t* text = getDisplayedText(line, buffer);
+    int len = (int)line.text.size();
+
+    // Same wrapping as FontLayout, rows break at the last space that fits.
+    line.rows.clear();
+    int pos = 0;
+    do
+    {
+        int rowLen = len - pos;
+        if (isWrapping())
+        {
+            int fit = _font->indexAtCoord(text + pos, _fontSize, true, rowLen, _wrapWidth);
+            if (fit < rowLen)
+            {
+                int i = fit;
+                while (i > 0 && text[pos + i] != L' ')
+                    --i;
+                rowLen = std::max(i > 0 ? i : fit, 1);
+            }
+        }
+
+        Row row;
+        row.pos = pos;
+        row.width = 0;
+        if (rowLen > 0)
+        {
+            unsigned int height;
+            _font->measureText(text + pos, _fontSize, &row.width, &height, rowLen);
+        }
+        line.rows.push_back(row);
+        pos += rowLen;
+    } while (pos < len);
+}
+
+void TextDocument::layout()
+{
+    if (_laidOut || !_font)
+        return;
+
+    // Only the lines not laid out yet, the first layout of a document is the only full one.
+    for (Line& line : _lines)
+    {
+        if (line.rows.empty())
+            layoutLine(line);
+    }
+    _laidOut = true;
+    _maxWidthDirty = true;
+    buildTrees();
+}
+
+void TextDocument::lineChanged(unsigned int index)
+{
+    Line& line = _lines[index];
+    if (!_laidOut)
+    {
+        line.rows.clear();
+        return;
+    }
+
+    unsigned int rowCount = (unsigned int)line.rows.size();
+    unsigned int width = getLineWidth(line);
+    layoutLine(line);
+
+    if (isWrapping())
+        _rowTree.add(index, (int)line.rows.size() - (int)rowCount);
+
+    unsigned int newWidth = getLineWidth(line);
+    if (newWidth >= _maxWidth)
+        _maxWidth = newWidth;
+    else if (width == _maxWidth)
+        _maxWidthDirty = true;
+}
+
+void TextDocument::linesChanged(unsigned int first, unsigned int count)
+{
+    for (unsigned int i = first; i < first + count; ++i)
+    {
+        _lines[i].rows.clear();
+        if (_laidOut)
+            layoutLine(_lines[i]);
+    }
+    _maxWidthDirty = true;
+    buildTrees();
+}
+
+void TextDocument::buildTrees()
+{
+    std::vector<unsigned int> counts(_lines.size());
+    for (size_t i = 0; i < _lines.size(); ++i)
+    {
+        counts[i] = (unsigned int)_lines[i].text.size() + 1;
+    }
+    _charTree.build(counts);
+
+    if (_laidOut && isWrapping())
+    {
+        for (size_t i = 0; i < _lines.size(); ++i)
+        {
+            counts[i] = (unsigned int)_lines[i].rows.size();
+        }
+        _rowTree.build(counts);
+    }
+}
+
+unsigned int TextDocument::getRowCount() const
+{
+    return isWrapping() ? _rowTree.total() : (unsigned int)_lines.size();
+}
+
+void TextDocument::findRow(unsigned int row, unsigned int* line, unsigned int* rowInLine) const
+{
+    if (!isWrapping())
+    {
+        *line = row;
+        *rowInLine = 0;
+        return;
+    }
+
+    *line = std::min(_rowTree.find(row), (unsigned int)_lines.size() - 1);
+    *rowInLine = row - _rowTree.sum(*line);
+}
+
+float TextDocument::getTextY(const Rectangle& area, FontLayout::Justify align) const
+{
+    float height = (float)(_lineHeight * getRowCount());
+    if (align & FontLayout::ALIGN_VCENTER)
+        return area.y + (int)((area.height - height) / 2.0f);
+    else if (align & FontLayout::ALIGN_BOTTOM)
+        return area.y + (area.height - height);
+    return area.y;
+}
+
+float TextDocument::getRowX(const Row& row, const Rectangle& area, FontLayout::Justify align) const
+{
+    if (align & FontLayout::ALIGN_HCENTER)
+        return area.x + (int)((area.width - row.width) / 2.0f);
+    else if (align & FontLayout::ALIGN_RIGHT)
+        return area.x + (area.width - row.width);
+    return area.x;
+}
+
+void TextDocument::measureText(unsigned int* widthOut, unsigned int* heightOut)
+{
+    GP_ASSERT(widthOut);
+    GP_ASSERT(heightOut);
+
+    layout();
+    if (_maxWidthDirty)
+    {
+        _maxWidth = 0;
+        for (const Line& line : _lines)
+        {
+            _maxWidth = std::max(_maxWidth, getLineWidth(line));
+        }
+        _maxWidthDirty = false;
+    }
+
+    bool empty = _lines.size() == 1 && _lines[0].text.empty();
+    *widthOut = _maxWidth;
+    *heightOut = empty ? 0 : _lineHeight * getRowCount();
+}
+
+Vector2 TextDocument::positionAtIndex(unsigned int index, const Rectangle& area, FontLayout::Justify align)
+{
+    if (!_font)
+        return Vector2(area.x, area.y);
+    if (isWrapping())
+        layout();
+
+    index = std::min(index, getLength());
+    unsigned int l = getLineAt(index);
+    int column = (int)(index - getLineStart(l));
+    Line& line = getLine(l);
+
+    int r = (int)line.rows.size() - 1;
+    while (r > 0 && line.rows[r].pos > column)
+        --r;
+    const Row& row = line.rows[r];
+
+    unsigned int width = 0;
+    if (column > row.pos)
+    {
+        std::wstring buffer;
+        unsigned int height;
+        _font->measureText(getDisplayedText(line, buffer) + row.pos, _fontSize, &width, &height, column - row.pos);
+    }
+
+    unsigned int firstRow = isWrapping() ? _rowTree.sum(l) : l;
+    return Vector2(getRowX(row, area, align) + width, getTextY(area, align) + (firstRow + r) * _lineHeight);
+}
+
+unsigned int TextDocument::indexAtPosition(const Vector2& pos, const Rectangle& area, FontLayout::Justify align)
+{
+    if (!_font || _lineHeight == 0)
+        return 0;
+    if (isWrapping())
+        layout();
+
+    float y = pos.y - getTextY(area, align);
+    if (y < 0)
+        return 0;
+    unsigned int rowIndex = (unsigned int)(y / _lineHeight);
+    if (rowIndex >= getRowCount())
+        return getLength();
+
+    unsigned int l, r;
+    findRow(rowIndex, &l, &r);
+    Line& line = getLine(l);
+    const Row& row = line.rows[r];
+
+    std::wstring buffer;
+    int x = (int)(pos.x - getRowX(row, area, align));
+    int column = _font->indexAtCoord(getDisplayedText(line, buffer) + row.pos, _fontSize, true, getRowLength(line, r), x);
+    return getLineStart(l) + row.pos + column;
+}
+
+void TextDocument::drawText(const Rectangle& area, const Vector4& color, FontLayout::Justify align, const Rectangle* clip)
+{
+    if (!_font || _lineHeight == 0)
+        return;
+    if (isWrapping())
+        layout();
+
+    // Only the rows in the clip are drawn.
+    float top = getTextY(area, align);
+    float minY = clip ? std::max(clip->y, area.y) : area.y;
+    float maxY = clip ? std::min(clip->bottom(), area.bottom()) : area.bottom();
+    int rowCount = (int)getRowCount();
+    int first = std::max((int)((minY - top) / _lineHeight), 0);
+    int last = std::min((int)((maxY - top) / _lineHeight), rowCount - 1);
+    if (first > last)
+        return;
+
+    unsigned int l, r;
+    findRow(first, &l, &r);
+    std::wstring buffer;
+    for (int i = first; i <= last && l < _lines.size(); ++i)
+    {
+        Line& line = getLine(l);
+        const Row& row = line.rows[r];
+        int len = getRowLength(line, r);
+        if (len > 0)
+        {
+            _font->drawText(getDisplayedText(line, buffer) + row.pos, getRowX(row, area, align), top + i * _lineHeight,
+                color, _fontSize, len, clip);
+        }
+
+        if (++r >= line.rows.size())
+        {
+            ++l;
+            r = 0;
+        }
+    }
+}
+
+}
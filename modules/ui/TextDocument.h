@@ -0,0 +1,217 @@
+#ifndef TEXTDOCUMENT_H_
+#define TEXTDOCUMENT_H_
+
+#include <string>
+#include <vector>
+#include "base/Base.h"
+#include "objects/Font.h"
+#include "math/Rectangle.h"
+#include "math/Vector2.h"
+#include "math/Vector4.h"
+
+namespace mgp
+{
+
+/**
+ * Defines the editable text of a TextBox.
+ *
+ * The text is stored as a list of lines, so an edit only copies the line it changes.
+ * Each line caches its wrapped rows and their widths, and an edit only lays out the
+ * lines it touches again. The character and row counts of the lines are summed in
+ * indexed trees, which map an index or a position to its line in logarithmic time,
+ * and only the rows in the clip are drawn.
+ *
+ * Indices are in characters, a line break counts as one character.
+ */
+class TextDocument
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    TextDocument();
+
+    /**
+     * Destructor.
+     */
+    ~TextDocument();
+
+    /**
+     * Sets the text, replacing the current one.
+     *
+     * @param text The UTF-8 text.
+     * @param textLen The length of the text in bytes, -1 if it is null terminated.
+     */
+    void setText(const char* text, int textLen = -1);
+
+    /**
+     * Gets the text encoded in UTF-8.
+     *
+     * @param text Set to the text.
+     */
+    void getText(std::string& text) const;
+
+    /**
+     * Gets the number of characters of the text.
+     */
+    unsigned int getLength() const;
+
+    /**
+     * Gets the number of lines of the text, an empty text has one line.
+     */
+    unsigned int getLineCount() const;
+
+    /**
+     * Gets the character at the given index, 0 past the end of the text.
+     */
+    wchar_t charAt(unsigned int index) const;
+
+    /**
+     * Inserts characters at the given index.
+     *
+     * @param index The index to insert at, clamped to the length of the text.
+     * @param text The characters to insert.
+     * @param textLen The number of characters to insert.
+     */
+    void insert(unsigned int index, const wchar_t* text, unsigned int textLen);
+
+    /**
+     * Erases characters from the given index.
+     *
+     * @param index The index of the first character to erase.
+     * @param len The number of characters to erase.
+     */
+    void erase(unsigned int index, unsigned int len);
+
+    /**
+     * Gets the line holding the character at the given index.
+     */
+    unsigned int getLineAt(unsigned int index) const;
+
+    /**
+     * Gets the index of the first character of the given line.
+     */
+    unsigned int getLineStart(unsigned int line) const;
+
+    /**
+     * Sets the font used to lay out the text.
+     *
+     * The lines are laid out again when a parameter changes.
+     *
+     * @param font The font.
+     * @param fontSize The font size.
+     * @param wrapWidth The width the rows are wrapped at, -1 to not wrap.
+     */
+    void setLayout(Font* font, unsigned int fontSize, int wrapWidth);
+
+    /**
+     * Sets the character displayed in place of each character of the text, 0 to display the text.
+     */
+    void setPasswordChar(wchar_t character);
+
+    /**
+     * Gets the height of a row.
+     */
+    unsigned int getLineHeight() const;
+
+    /**
+     * Measures the laid out text.
+     *
+     * @param widthOut Set to the width of the widest row.
+     * @param heightOut Set to the height of all the rows.
+     */
+    void measureText(unsigned int* widthOut, unsigned int* heightOut);
+
+    /**
+     * Gets the position of the character at the given index, when drawn in the given area.
+     */
+    Vector2 positionAtIndex(unsigned int index, const Rectangle& area, FontLayout::Justify align);
+
+    /**
+     * Gets the index of the character at the given position, when drawn in the given area.
+     */
+    unsigned int indexAtPosition(const Vector2& pos, const Rectangle& area, FontLayout::Justify align);
+
+    /**
+     * Draws the rows of the text in the clip.
+     */
+    void drawText(const Rectangle& area, const Vector4& color, FontLayout::Justify align, const Rectangle* clip = NULL);
+
+private:
+
+    /**
+     * Sums of counts, as a Fenwick tree.
+     */
+    class CountTree
+    {
+    public:
+        void build(const std::vector<unsigned int>& counts);
+        void add(unsigned int i, int delta);
+        unsigned int sum(unsigned int i) const;
+        unsigned int find(unsigned int value) const;
+        unsigned int total() const;
+    private:
+        std::vector<unsigned int> _nodes;
+    };
+
+    struct Row
+    {
+        int pos;                    // Position in the line.
+        unsigned int width;
+    };
+
+    struct Line
+    {
+        std::wstring text;          // Text without the line break.
+        std::vector<Row> rows;      // Wrapped rows, laid out when not empty.
+    };
+
+    TextDocument(const TextDocument& copy);
+
+    TextDocument& operator=(const TextDocument&);
+
+    bool isWrapping() const;
+
+    const wchar_t* getDisplayedText(const Line& line, std::wstring& buffer) const;
+
+    unsigned int getLineWidth(const Line& line) const;
+
+    int getRowLength(const Line& line, int row) const;
+
+    Line& getLine(unsigned int index);
+
+    void layoutLine(Line& line);
+
+    void layout();
+
+    void lineChanged(unsigned int index);
+
+    void linesChanged(unsigned int first, unsigned int count);
+
+    void buildTrees();
+
+    unsigned int getRowCount() const;
+
+    void findRow(unsigned int row, unsigned int* line, unsigned int* rowInLine) const;
+
+    float getTextY(const Rectangle& area, FontLayout::Justify align) const;
+
+    float getRowX(const Row& row, const Rectangle& area, FontLayout::Justify align) const;
+
+    std::vector<Line> _lines;
+    CountTree _charTree;            // Characters of each line, with the line break.
+    CountTree _rowTree;             // Rows of each line, when wrapping.
+    Font* _font;
+    unsigned int _fontSize;
+    int _wrapWidth;
+    unsigned int _lineHeight;
+    wchar_t _passwordChar;
+    bool _laidOut;                  // True if all the lines are laid out, edits then lay out the lines they touch.
+    unsigned int _maxWidth;
+    bool _maxWidthDirty;
+};
+
+}
+
+#endif
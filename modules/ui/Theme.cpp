@@ -14,6 +14,13 @@ namespace mgp
 
 static std::vector<Theme*> __themeCache;
 static Theme* __defaultTheme = NULL;
+static unsigned int __themeVersion = 0;
+
+// Size of the theme atlas.
+#define THEME_ATLAS_SIZE 2048
+
+// Pixels repeated around the atlas images, so filtering does not bleed the neighbours in.
+#define THEME_IMAGE_BORDER 2
 
 Theme::Theme() : _texture(NULL), _spriteBatch(NULL)
 {
@@ -238,7 +245,7 @@ Style* readStyle(jc::Value* jcstyle, Style* parentStyle, SPtr<Theme> theme) {
                 border.right = jcbg->get("right")->as_float();
             }
 
-            BorderImage* bg = new BorderImage(image->getRegion(), border);
+            BorderImage* bg = new BorderImage(image, border);
             style->setBgImage(bg);
             bg->release();
         }
@@ -331,8 +338,9 @@ SPtr<Theme> Theme::create(const char* url)
     // Create a new theme.
     SPtr<Theme> theme(new Theme());
     theme->_url = url;
-    theme->_texture = new TextureAtlas(Image::RGBA, 1024*2, 1024*2);//Texture::create(textureFile.c_str(), false);
+    theme->_texture = new TextureAtlas(Image::RGBA, THEME_ATLAS_SIZE, THEME_ATLAS_SIZE);//Texture::create(textureFile.c_str(), false);
     GP_ASSERT(theme->_texture);
+    theme->_texture->setBorder(THEME_IMAGE_BORDER);
     Texture* texture = theme->_texture->getTexture();
     theme->_spriteBatch = SpriteBatch::create(texture).take();
     GP_ASSERT(theme->_spriteBatch);
@@ -403,17 +411,95 @@ SpriteBatch* Theme::getSpriteBatch() const
 ThemeImage* Theme::getImageFullName(const char* file) {
     auto it = _images.find(file);
     if (it != _images.end()) {
+        // The caller keeps the raw pointer without a reference, so the image is never evicted.
+        it->second->_dynamic = false;
         return it->second;
     }
 
     Rectangle rect;
-    bool rc = _texture->addImageUri(file, rect);
+    bool rc = addImage(file, 0, rect);
     GP_ASSERT(rc);
     ThemeImage* image = new ThemeImage(rect);
     _images[file] = image;
     return image;
 }
 
+SPtr<ThemeImage> Theme::loadImage(const char* file, int maxSize, UPtr<Image>* decoded)
+{
+    auto it = _images.find(file);
+    if (it != _images.end()) {
+        it->second->addRef();
+        return SPtr<ThemeImage>(it->second);
+    }
+
+    Rectangle rect;
+    if (!addImage(file, maxSize, rect, decoded)) {
+        return SPtr<ThemeImage>();
+    }
+    ThemeImage* image = new ThemeImage(rect);
+    image->_dynamic = true;
+    _images[file] = image;
+    image->addRef();
+    return SPtr<ThemeImage>(image);
+}
+
+bool Theme::addImage(const char* file, int maxSize, Rectangle& rect, UPtr<Image>* decoded)
+{
+    UPtr<Image> img = Image::create(file, false);
+    if (!img.get()) {
+        GP_WARN("Failed to load theme image: %s", file);
+        return false;
+    }
+    if (img->getFormat() != Image::RGBA ||
+        (maxSize > 0 && (img->getWidth() > maxSize || img->getHeight() > maxSize))) {
+        if (decoded) {
+            *decoded = std::move(img);
+        }
+        return false;
+    }
+
+    if (_texture->addImage(img.get(), rect)) {
+        return true;
+    }
+
+    // Full, make room by dropping the unused loaded images.
+    repack();
+    if (_texture->addImage(img.get(), rect)) {
+        return true;
+    }
+    GP_WARN("Theme atlas is full, image not added: %s", file);
+    if (decoded) {
+        *decoded = std::move(img);
+    }
+    return false;
+}
+
+void Theme::repack()
+{
+    std::vector<Rectangle*> rects;
+    for (auto it = _images.begin(); it != _images.end();) {
+        ThemeImage* image = it->second;
+        if (image->_dynamic && image->getRefCount() == 1) {
+            image->release();
+            it = _images.erase(it);
+        }
+        else {
+            rects.push_back(&image->_region);
+            ++it;
+        }
+    }
+
+    if (!_texture->repack(rects)) {
+        GP_WARN("Theme images do not fit in the atlas anymore.");
+    }
+    ++__themeVersion;
+}
+
+unsigned int Theme::getVersion()
+{
+    return __themeVersion;
+}
+
 ThemeImage* Theme::getImage(const char* id) {
     std::string file = "res/ui/";
     file += id;
@@ -431,8 +517,14 @@ BorderImage::BorderImage(const Rectangle& region, const Border& border) :
     setRegion(region);
 }
 
+BorderImage::BorderImage(ThemeImage* image, const Border& border) :
+    _region(image->getRegion()), _border(border), _image(image) {
+    image->addRef();
+    setRegion(_region);
+}
+
 BorderImage* BorderImage::clone() {
-    BorderImage* img = new BorderImage(_region, _border);
+    BorderImage* img = _image.get() ? new BorderImage(_image.get(), _border) : new BorderImage(_region, _border);
     return img;
 }
 
@@ -506,6 +598,12 @@ unsigned int BorderImage::draw(SpriteBatch* batch, const Rectangle& _absoluteBou
     unsigned int drawCalls = 0;
     BorderImage* _skin = this;
 
+    // Follow the image when the atlas was repacked.
+    if (_image.get() && _image->getRegion() != _region) {
+        _region = _image->getRegion();
+        setRegion(_region);
+    }
+
     float tw = 1.0 / batch->getSampler()->getWidth();
     float th = 1.0 / batch->getSampler()->getHeight();
 
@@ -72,10 +72,12 @@ typedef SideRegions Padding;
 * Class representing an image within the theme's texture atlas.
 * An image has a region and a blend color in addition to an ID.
 * UV coordinates are calculated from the region and can be retrieved.
+*
+* The region moves when the theme atlas is repacked, so it should be read when drawing.
 */
 class ThemeImage : public Refable
 {
-    //friend class Theme;
+    friend class Theme;
     //friend class Style;
 public:
 
@@ -90,6 +92,7 @@ public:
 
 private:
     Rectangle _region;
+    bool _dynamic = false;      // Loaded by loadImage, evicted from the atlas when no longer used.
 };
 
 /**
@@ -136,6 +139,11 @@ public:
     const Vector4 getUVs(SkinArea area, float tw, float th) const;
 
     BorderImage(const Rectangle& region, const Border& border);
+
+    /**
+    * Creates a skin following the region of a theme image, when the atlas is repacked.
+    */
+    BorderImage(ThemeImage* image, const Border& border);
     
     //~BorderImage();
 
@@ -159,6 +167,7 @@ private:
     Border _border;
     Vector4 _uvs[9];
     Rectangle _region;
+    SPtr<ThemeImage> _image;
 };
 
 /**
@@ -212,9 +221,33 @@ public:
     void setStyle(const char* id, Style* style);
 
 
+    /**
+     * Gets an image of the theme, loading it into the atlas if needed.
+     *
+     * The image is kept as long as the theme, an image of loadImage() is then no longer evicted.
+     */
     ThemeImage* getImage(const char* id);
     ThemeImage* getImageFullName(const char* file);
 
+    /**
+     * Loads an image into the theme atlas, to draw it with the theme sprite batch.
+     *
+     * Unlike the images of the theme, it is evicted when the atlas is full and no
+     * reference to it is left. The atlas is then repacked, which moves the regions.
+     *
+     * @param file The image file.
+     * @param maxSize The max width and height of the image, 0 for any size.
+     * @param decoded Receives the decoded image when it is not added, so the caller does not decode it again.
+     *
+     * @return The image, or NULL if it is not RGBA, too large or does not fit.
+     */
+    SPtr<ThemeImage> loadImage(const char* file, int maxSize = 0, UPtr<Image>* decoded = NULL);
+
+    /**
+     * Gets a version incremented each time an atlas of a theme is repacked.
+     */
+    static unsigned int getVersion();
+
     /**
      * Get the empty style.  Used when a control does not specify a style.
      * This is especially useful for containers that are being used only for
@@ -256,6 +289,10 @@ private:
 
     void clear();
 
+    bool addImage(const char* file, int maxSize, Rectangle& rect, UPtr<Image>* decoded = NULL);
+
+    void repack();
+
     /**
      * Hidden copy assignment operator.
      */
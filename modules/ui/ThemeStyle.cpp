@@ -41,7 +41,9 @@ Style::Style(const Style& copy) : _background(NULL), _font(NULL), _theme(NULL),
 
     if (copy._image)
     {
-        _image = new ThemeImage(copy._image->getRegion());
+        // Shared, so the region follows the atlas when it is repacked.
+        _image = copy._image;
+        _image->addRef();
     }
 
     _theme = copy._theme;
@@ -49,6 +49,7 @@ TreeView::TreeView()
     root = TreeItem::create(0, "name", {});
     root->expanded = true;
     setLayout(Layout::LAYOUT_VERTICAL);
+    setItemSource(this, 25);
     _className = "TreeView";
 }
 
@@ -65,38 +66,57 @@ void TreeView::onDeserialize(Serializer* serializer) {
     ScrollContainer::onDeserialize(serializer);
 }
 
-void TreeView::addItemLabel(TreeItem* item, int level) {
-    if (item->_contronl.isNull()) {
-        item->_contronl = Control::create<Container>("tree_item");
-        item->_contronl->setHeight(25);
-        item->_contronl->setWidth(1, AUTO_PERCENT_PARENT);
-        //item->_contronl->setLayout(Layout::LAYOUT_HORIZONTAL);
-
-        UPtr<Label> label = Control::create<Label>("treeItemLabel");
-        label->addListener(this, Control::Listener::CLICK);
-        //label->setWidth(1, true);
-        label->setWidth(1, Control::AUTO_PERCENT_PARENT);
-        label->setMargin(4);
-        item->_contronl->addControl(std::move(label));
-
-        UPtr<Icon> image = Control::create<Icon>("image");
-        image->overrideStyle()->setColor(Vector4::fromColor(0x000000ff));
-        image->setImagePath("res/ui/right.png");
-        image->setSize(18, 18);
-        image->setPadding(5,5,5,5);
-        image->setMargin(1);
-        image->addListener(this, Control::Listener::CLICK);
-        //image->setAlignment(Control::ALIGN_TOP_RIGHT);
-        item->_contronl->addControl(std::move(image));
-
-        if (_useCheckBox) {
-            UPtr<CheckBox> checkbox = Control::create<CheckBox>("tree_item_checkbox");
-            checkbox->setHeight(0.7, Control::AUTO_PERCENT_PARENT);
-            checkbox->addListener(this, Control::Listener::CLICK);
-            item->_contronl->addControl(std::move(checkbox));
+void TreeView::addRows(TreeItem* item, int level) {
+    _rows.push_back(item);
+    _rowLevels.push_back(level);
+    if (item->expanded) {
+        for (SPtr<TreeItem>& it : item->children) {
+            it.get()->_parent = item;
+            addRows(it.get(), level + 1);
         }
     }
-    Container* control = item->_contronl.get();
+}
+
+int TreeView::getItemCount() {
+    return _rows.size();
+}
+
+UPtr<Control> TreeView::createCell() {
+    UPtr<Container> cell = Control::create<Container>("tree_item");
+    cell->setHeight(25);
+    cell->setWidth(1, AUTO_PERCENT_PARENT);
+    //cell->setLayout(Layout::LAYOUT_HORIZONTAL);
+
+    UPtr<Label> label = Control::create<Label>("treeItemLabel");
+    label->addListener(this, Control::Listener::CLICK);
+    //label->setWidth(1, true);
+    label->setWidth(1, Control::AUTO_PERCENT_PARENT);
+    label->setMargin(4);
+    cell->addControl(std::move(label));
+
+    UPtr<Icon> image = Control::create<Icon>("image");
+    image->overrideStyle()->setColor(Vector4::fromColor(0x000000ff));
+    image->setImagePath("res/ui/right.png");
+    image->setSize(18, 18);
+    image->setPadding(5,5,5,5);
+    image->setMargin(1);
+    image->addListener(this, Control::Listener::CLICK);
+    //image->setAlignment(Control::ALIGN_TOP_RIGHT);
+    cell->addControl(std::move(image));
+
+    if (_useCheckBox) {
+        UPtr<CheckBox> checkbox = Control::create<CheckBox>("tree_item_checkbox");
+        checkbox->setHeight(0.7, Control::AUTO_PERCENT_PARENT);
+        checkbox->addListener(this, Control::Listener::CLICK);
+        cell->addControl(std::move(checkbox));
+    }
+    return cell;
+}
+
+void TreeView::bindCell(Control* cell, int index) {
+    TreeItem* item = _rows[index];
+    int level = _rowLevels[index];
+    Container* control = static_cast<Container*>(cell);
     Icon* icon = dynamic_cast<Icon*>(control->findControl("image"));
     if (item->expanded) {
         if (strcmp(icon->getImagePath(), "res/ui/down.png") != 0) {
@@ -118,6 +138,16 @@ void TreeView::addItemLabel(TreeItem* item, int level) {
     Label* label = dynamic_cast<Label*>(control->findControl("treeItemLabel"));
     label->setText(item->name.c_str());
 
+    // Cells are reused, reset the selection color
+    label->setStyleName("Label");
+    if (item == _selectItem) {
+        Vector4 color = label->getStyle()->getTextColor();
+        color.x *= 0.1;
+        color.y *= 3;
+        color.z *= 3;
+        label->overrideStyle()->setTextColor(color);
+    }
+
     float baseX = (level - 1) * 12;
     if (_useCheckBox) {
         baseX += 16;
@@ -129,53 +159,36 @@ void TreeView::addItemLabel(TreeItem* item, int level) {
         CheckBox* checkbox = dynamic_cast<CheckBox*>(control->findControl("tree_item_checkbox"));
         checkbox->setChecked(item->isChecked());
     }
-
-    this->addControl(uniqueFromInstant(control));
-    if (item->expanded) {
-        for (SPtr<TreeItem>& it : item->children) {
-            it.get()->_parent = item;
-            addItemLabel(it.get(), level + 1);
-        }
-    }
 }
 
 void TreeView::setCheckbox(bool v) {
     GP_ASSERT(root->children.size() == 0);
     _useCheckBox = v;
+    // Drop the cells created with the previous layout
+    setItemSource(this, 25);
 }
 
 void TreeView::update(float elapsedTime) {
     if (_isDirty) {
         _isDirty = false;
-        this->clear();
+        _rows.clear();
+        _rowLevels.clear();
         root->expanded = true;
         for (SPtr<TreeItem>& it : root->children) {
             it.get()->_parent = root.get();
-            addItemLabel(it.get(), 1);
+            addRows(it.get(), 1);
         }
-        requestLayout();
+        reloadItems();
     }
     ScrollContainer::update(elapsedTime);
 }
 
-TreeView::TreeItem* TreeView::findTreeItem(Control* control, TreeItem* item) {
-    if (item->_contronl.get() == control) {
-        return item;
-    }
-    if (item->_contronl.get()) {
-        for (int i = 0; i < item->_contronl->getControlCount(); ++i) {
-            if (item->_contronl->getControl(i) == control) {
-                return item;
-            }
-        }
-    }
-    if (item->expanded) {
-        for (SPtr<TreeItem>& it : item->children) {
-            TreeView::TreeItem* item = findTreeItem(control, it.get());
-            if (item != NULL) return item;
-        }
+TreeView::TreeItem* TreeView::findTreeItem(Control* control) {
+    int index = getItemIndex(control);
+    if (index == -1) {
+        return NULL;
     }
-    return NULL;
+    return _rows[index];
 }
 
 void TreeView::checkedChange(TreeItem* item) {
@@ -184,7 +197,10 @@ void TreeView::checkedChange(TreeItem* item) {
 
 void TreeView::controlEvent(Control* control, Control::Listener::EventType evt) {
     if (evt == Control::Listener::CLICK) {
-        TreeItem* item = findTreeItem(control, root.get());
+        TreeItem* item = findTreeItem(control);
+        if (!item) {
+            return;
+        }
 
         bool checkedChanged = false;
         if (CheckBox* checkbox = dynamic_cast<CheckBox*>(control)) {
@@ -196,7 +212,7 @@ void TreeView::controlEvent(Control* control, Control::Listener::EventType evt)
         setSelectItem(item);
 
         if (checkedChanged) {
-            _isDirty = true;
+            reloadItems();
             notifyListeners(Control::Listener::VALUE_CHANGED);
         }
 
@@ -214,26 +230,8 @@ void TreeView::controlEvent(Control* control, Control::Listener::EventType evt)
 
 void TreeView::setSelectItem(TreeItem* item) {
     if (item != _selectItem) {
-        if (_selectItem && _selectItem->_contronl.get()) {
-            Control* control = _selectItem->_contronl->findControl("treeItemLabel");
-            if (control) {
-                control->setStyleName("Label");
-            }
-        }
-
         _selectItem = item;
-        _isDirty = true;
+        reloadItems();
         notifyListeners(Control::Listener::SELECT_CHANGE);
-
-        if (_selectItem && _selectItem->_contronl.get()) {
-            Control* control = _selectItem->_contronl->findControl("treeItemLabel");
-            if (control) {
-                Vector4 color = control->getStyle()->getTextColor();
-                color.x *= 0.1;
-                color.y *= 3;
-                color.z *= 3;
-                control->overrideStyle()->setTextColor(color);
-            }
-        }
     }
 }
@@ -9,7 +9,7 @@
 namespace mgp
 {
 
-class TreeView : public ScrollContainer, public Control::Listener {
+class TreeView : public ScrollContainer, public Control::Listener, public ScrollContainer::ItemSource {
     friend class Control;
 public:
 
@@ -29,7 +29,6 @@ public:
         void addChild(SPtr<TreeItem>& c);
         TreeItem* getParent() { return _parent; }
     private:
-        UPtr<Container> _contronl;
         TreeItem* _parent = NULL;
     };
 
@@ -61,10 +60,19 @@ protected:
     void controlEvent(Control* control, EventType evt);
 
     virtual void checkedChange(TreeItem* item);
+
+    int getItemCount() override;
+
+    UPtr<Control> createCell() override;
+
+    void bindCell(Control* cell, int index) override;
 private:
-    void addItemLabel(TreeItem* item, int level);
+    void addRows(TreeItem* item, int level);
+
+    TreeItem* findTreeItem(Control* control);
 
-    TreeItem* findTreeItem(Control* control, TreeItem* item);
+    std::vector<TreeItem*> _rows;       // Items of the expanded nodes, in display order.
+    std::vector<int> _rowLevels;        // Depth of each row.
 };
 
 }
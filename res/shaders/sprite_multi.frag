@@ -0,0 +1,84 @@
+#ifdef GL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+#endif
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform sampler2D u_textures[SLOT_COUNT];
+
+uniform vec2 u_cutoff;
+uniform vec2 u_outline;
+
+///////////////////////////////////////////////////////////
+// Varyings
+in vec2 v_texCoord;
+in vec4 v_color;
+in vec2 v_slotMode;
+
+out vec4 FragColor;
+
+// Sampler arrays can only be indexed by constants on GLES.
+vec4 sampleSlot(float slot)
+{
+    vec4 c = vec4(0.0);
+    #if SLOT_COUNT > 0
+        if (slot < 0.5) c = texture(u_textures[0], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 1
+        else if (slot < 1.5) c = texture(u_textures[1], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 2
+        else if (slot < 2.5) c = texture(u_textures[2], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 3
+        else if (slot < 3.5) c = texture(u_textures[3], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 4
+        else if (slot < 4.5) c = texture(u_textures[4], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 5
+        else if (slot < 5.5) c = texture(u_textures[5], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 6
+        else if (slot < 6.5) c = texture(u_textures[6], v_texCoord);
+    #endif
+    #if SLOT_COUNT > 7
+        else c = texture(u_textures[7], v_texCoord);
+    #endif
+    return c;
+}
+
+void main()
+{
+    vec4 texel = sampleSlot(v_slotMode.x);
+    float mode = v_slotMode.y;
+
+    if (mode < 0.5)
+    {
+        // Image
+        FragColor = v_color * texel;
+    }
+    else
+    {
+        // Distance field glyph, same as font.frag
+        float distance = texel.r;
+        float alpha = smoothstep(u_cutoff.x-u_cutoff.y, u_cutoff.x+u_cutoff.y, distance);
+        if (mode < 1.5)
+        {
+            FragColor = v_color;
+            FragColor.a = alpha * v_color.a;
+        }
+        else
+        {
+            vec4 outlineCol;
+            outlineCol.a = smoothstep(u_outline.x-u_outline.y, u_outline.x+u_outline.y, distance);
+            outlineCol.rgb = vec3(1.0, 1.0, 1.0) - v_color.rgb;
+            FragColor.rgb = (outlineCol.rgb * outlineCol.a)*(1.0-alpha) + v_color.rgb * alpha;
+            FragColor.a = (alpha + outlineCol.a*(1.0-alpha)) * v_color.a;
+        }
+    }
+}
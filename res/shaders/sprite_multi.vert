@@ -0,0 +1,29 @@
+
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform mat4 u_projectionMatrix;
+
+///////////////////////////////////////////////////////////
+// Attributes
+in vec3 a_position;
+in vec2 a_texCoord;
+in vec4 a_color;
+
+// (texture slot, draw mode)
+in vec2 a_texCoord1;
+
+///////////////////////////////////////////////////////////
+// Varyings
+out vec2 v_texCoord;
+out vec4 v_color;
+out vec2 v_slotMode;
+
+
+void main()
+{
+    gl_Position = u_projectionMatrix * vec4(a_position, 1.0);
+    v_texCoord = a_texCoord;
+    v_color = a_color;
+    v_slotMode = a_texCoord1;
+}
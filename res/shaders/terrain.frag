@@ -11,11 +11,15 @@ precision mediump float;
 ///////////////////////////////////////////////////////////
 // Uniforms
 
-#if defined(DEBUG_PATCHES)
+#if defined(DEBUG_PATCHES) && !defined(CDLOD)
     uniform float u_row;
     uniform float u_column;
 #endif
 
+#if defined(LIGHTING) && defined(NORMAL_MAP) && defined(INSTANCED)
+    uniform mat4 u_inverseTransposeWorldViewMatrix;
+#endif
+
 #if (LAYER_COUNT > 0)
     uniform sampler2D u_surfaceLayerMaps[SAMPLER_COUNT];
 #endif
@@ -39,6 +43,9 @@ in vec2 v_texCoord0;
 #if (LAYER_COUNT > 2)
     in vec2 v_texCoordLayer2;
 #endif
+#if defined(DEBUG_PATCHES) && defined(CDLOD)
+    in float v_lodLevel;
+#endif
 
 out vec4 FragColor;
 
@@ -79,7 +86,11 @@ void main()
     #endif
 
     #if defined(DEBUG_PATCHES)
+        #if defined(CDLOD)
+        float tint = mod(v_lodLevel, 2.0);
+        #else
         float tint = mod(u_row + mod(u_column, 2.0), 2.0);
+        #endif
         _baseColor.rgb = _baseColor.rgb * 0.75 + vec3(1.0-tint, tint, 0) * 0.25;
     #endif
 
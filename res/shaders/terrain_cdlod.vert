@@ -0,0 +1,160 @@
+#include "_lighting_def.glsl"
+
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform mat4 u_projectionMatrix;
+uniform mat4 u_worldViewMatrix;
+
+#if defined(LIGHTING) && defined(INSTANCED)
+    uniform mat4 u_inverseTransposeWorldViewMatrix;
+#endif
+
+uniform sampler2D u_heightMap;
+uniform vec2 u_heightMapSize;
+uniform vec3 u_terrainScale;
+uniform vec3 u_cameraPosition;
+#if defined(STREAMING)
+    uniform float u_tileSize;
+#endif
+
+///////////////////////////////////////////////////////////
+// Attributes
+
+// Grid vertex in [0, gridSize]
+in vec3 a_position;
+
+// Per node data:
+// [0] = (origin x, origin z, samples per grid cell, LOD level)
+// [1] = (morph start, morph end, atlas x, atlas y)
+in mat4 a_instanceMatrix;
+
+///////////////////////////////////////////////////////////
+// Varyings
+
+out vec2 v_texCoord0;
+#if LAYER_COUNT > 0
+    out vec2 v_texCoordLayer0;
+#endif
+#if LAYER_COUNT > 1
+    out vec2 v_texCoordLayer1;
+#endif
+#if LAYER_COUNT > 2
+    out vec2 v_texCoordLayer2;
+#endif
+#if defined(DEBUG_PATCHES)
+    out float v_lodLevel;
+#endif
+
+#if defined(LIGHTING)
+    #include "_lighting.vert"
+#endif
+
+vec4 _node;
+
+#if defined(STREAMING)
+    vec2 _tileOrigin;
+
+    // The height map is the tile atlas, stay in the node tile.
+    float getTexel(ivec2 p)
+    {
+        p = clamp(p, ivec2(0, 0), ivec2(int(u_tileSize)));
+        return texelFetch(u_heightMap, ivec2(_tileOrigin) + p, 0).r;
+    }
+#else
+    float getTexel(ivec2 p)
+    {
+        p = clamp(p, ivec2(0, 0), ivec2(u_heightMapSize) - 1);
+        return texelFetch(u_heightMap, p, 0).r;
+    }
+#endif
+
+// Bilinear sample, float textures are not filterable on all hardware.
+float getHeight(vec2 p)
+{
+    #if defined(STREAMING)
+        // To tile samples.
+        p = (p - _node.xy) / _node.z;
+    #endif
+    vec2 i = floor(p);
+    vec2 f = p - i;
+    ivec2 t = ivec2(i);
+    float h00 = getTexel(t);
+    float h10 = getTexel(t + ivec2(1, 0));
+    float h01 = getTexel(t + ivec2(0, 1));
+    float h11 = getTexel(t + ivec2(1, 1));
+    return mix(mix(h00, h10, f.x), mix(h01, h11, f.x), f.y);
+}
+
+vec3 getLocalPosition(vec2 p, float h)
+{
+    vec2 halfSize = (u_heightMapSize - 1.0) * 0.5;
+    return vec3(p.x - halfSize.x, h, p.y - halfSize.y) * u_terrainScale;
+}
+
+void main()
+{
+    vec4 node = a_instanceMatrix[0];
+    vec4 morph = a_instanceMatrix[1];
+    _node = node;
+    #if defined(STREAMING)
+        _tileOrigin = morph.zw;
+    #endif
+    vec2 maxPos = u_heightMapSize - 1.0;
+
+    // Distance from the unmorphed vertex, neighbouring nodes agree on shared edges.
+    vec2 gridPos = a_position.xz;
+    vec2 pos = min(node.xy + gridPos * node.z, maxPos);
+    float cameraDistance = length(getLocalPosition(pos, getHeight(pos)) - u_cameraPosition);
+
+    // Morph odd vertices onto the coarser grid towards the end of the LOD range.
+    float morphK = clamp((cameraDistance - morph.x) / (morph.y - morph.x), 0.0, 1.0);
+    vec2 odd = fract(gridPos * 0.5) * 2.0;
+    gridPos -= odd * morphK;
+
+    // Clamp to the height field, nodes on the border may extend past it.
+    pos = min(node.xy + gridPos * node.z, maxPos);
+    float height = getHeight(pos);
+    vec3 localPosition = getLocalPosition(pos, height);
+
+    vec4 position = u_worldViewMatrix * vec4(localPosition, 1.0);
+    gl_Position = u_projectionMatrix * position;
+
+    #if defined(LIGHTING)
+
+        #if !defined(NORMAL_MAP)
+            // Central differences at the node resolution.
+            float d = node.z;
+            float hx = (getHeight(pos + vec2(d, 0.0)) - getHeight(pos - vec2(d, 0.0))) / (2.0 * d) * u_terrainScale.y;
+            float hz = (getHeight(pos + vec2(0.0, d)) - getHeight(pos - vec2(0.0, d))) / (2.0 * d) * u_terrainScale.y;
+            vec3 normal = vec3(-hx * u_terrainScale.z, u_terrainScale.x * u_terrainScale.z, -hz * u_terrainScale.x);
+            v_normalVector = normalize((u_inverseTransposeWorldViewMatrix * vec4(normal, 0.0)).xyz);
+        #endif
+
+        initLightDirection(position);
+
+    #endif
+
+    vec2 texCoord = vec2(pos.x / maxPos.x, 1.0 - pos.y / maxPos.y);
+
+    // Pass base texture coord
+    v_texCoord0 = texCoord;
+
+    //flip Y
+    v_texCoord0.y = 1.0 - v_texCoord0.y;
+
+    // Pass repeated texture coordinates for each layer
+    #if LAYER_COUNT > 0
+        v_texCoordLayer0 = texCoord * TEXTURE_REPEAT_0;
+    #endif
+    #if LAYER_COUNT > 1
+        v_texCoordLayer1 = texCoord * TEXTURE_REPEAT_1;
+    #endif
+    #if LAYER_COUNT > 2
+        v_texCoordLayer2 = texCoord * TEXTURE_REPEAT_2;
+    #endif
+
+    #if defined(DEBUG_PATCHES)
+        v_lodLevel = node.w;
+    #endif
+}
@@ -0,0 +1,138 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "Test.h"
+#include "scene/MeshOptimizer.h"
+
+using namespace mgp;
+
+#define GRID_SIZE 32
+
+/**
+ * A grid of quads of two triangles in the xy plane, in a shuffled order.
+ */
+static void makeGrid(std::vector<unsigned int>& indices, std::vector<float>& positions)
+{
+    const unsigned int side = GRID_SIZE + 1;
+    for (unsigned int y = 0; y < side; ++y)
+    {
+        for (unsigned int x = 0; x < side; ++x)
+        {
+            positions.push_back((float)x);
+            positions.push_back((float)y);
+            positions.push_back(0.0f);
+        }
+    }
+
+    std::vector<unsigned int> quads;
+    for (unsigned int i = 0; i < GRID_SIZE * GRID_SIZE; ++i)
+        quads.push_back(i);
+    unsigned int seed = 1;
+    for (size_t i = quads.size() - 1; i > 0; --i)
+    {
+        seed = seed * 1103515245 + 12345;
+        std::swap(quads[i], quads[(seed >> 16) % (i + 1)]);
+    }
+
+    for (unsigned int quad : quads)
+    {
+        unsigned int v = quad / GRID_SIZE * side + quad % GRID_SIZE;
+        const unsigned int triangles[] = { v, v + 1, v + side, v + 1, v + side + 1, v + side };
+        indices.insert(indices.end(), triangles, triangles + 6);
+    }
+}
+
+/**
+ * Returns the triangles of a list sorted, to compare two orders of the same triangles.
+ */
+static std::vector<std::vector<unsigned int> > sortedTriangles(const std::vector<unsigned int>& indices)
+{
+    std::vector<std::vector<unsigned int> > triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        std::vector<unsigned int> triangle(indices.begin() + i, indices.begin() + i + 3);
+        // The first vertex may change, the winding may not.
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST(meshOptimizerACMR)
+{
+    // Disjoint triangles miss every vertex, a repeated triangle only the first time.
+    const unsigned int disjoint[] = { 0, 1, 2, 3, 4, 5 };
+    CHECK(MeshOptimizer::computeACMR(disjoint, 6, 6) == 3.0f);
+    const unsigned int repeated[] = { 0, 1, 2, 2, 1, 0, 0, 1, 2 };
+    CHECK(MeshOptimizer::computeACMR(repeated, 9, 3) == 1.0f);
+
+    // A vertex out of the cache is missed again.
+    const unsigned int evicted[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+    CHECK(MeshOptimizer::computeACMR(evicted, 9, 6, 4) == 3.0f);
+    CHECK(MeshOptimizer::computeACMR(evicted, 9, 6, 6) == 2.0f);
+}
+
+TEST(meshOptimizerVertexCache)
+{
+    std::vector<unsigned int> indices;
+    std::vector<float> positions;
+    makeGrid(indices, positions);
+    unsigned int vertexCount = (unsigned int)positions.size() / 3;
+
+    std::vector<unsigned int> optimized(indices.size());
+    MeshOptimizer::optimizeVertexCache(optimized.data(), indices.data(), (unsigned int)indices.size(), vertexCount);
+    CHECK(sortedTriangles(optimized) == sortedTriangles(indices));
+
+    // A shuffled grid misses about 2 vertices per triangle, an ordered one below 1.
+    float before = MeshOptimizer::computeACMR(indices.data(), (unsigned int)indices.size(), vertexCount);
+    float after = MeshOptimizer::computeACMR(optimized.data(), (unsigned int)optimized.size(), vertexCount);
+    CHECK(before > 1.5f);
+    CHECK(after < 0.8f);
+}
+
+TEST(meshOptimizerOverdraw)
+{
+    std::vector<unsigned int> indices;
+    std::vector<float> positions;
+    makeGrid(indices, positions);
+    unsigned int vertexCount = (unsigned int)positions.size() / 3;
+    unsigned int indexCount = (unsigned int)indices.size();
+
+    std::vector<unsigned int> cacheOptimized(indexCount);
+    MeshOptimizer::optimizeVertexCache(cacheOptimized.data(), indices.data(), indexCount, vertexCount);
+    std::vector<unsigned int> optimized(indexCount);
+    MeshOptimizer::optimizeOverdraw(optimized.data(), cacheOptimized.data(), indexCount,
+        (const char*)positions.data(), vertexCount, 3 * sizeof(float), 1.05f);
+    CHECK(sortedTriangles(optimized) == sortedTriangles(indices));
+
+    // The clusters are split where the cache efficiency stays within the threshold.
+    float cacheACMR = MeshOptimizer::computeACMR(cacheOptimized.data(), indexCount, vertexCount);
+    float overdrawACMR = MeshOptimizer::computeACMR(optimized.data(), indexCount, vertexCount);
+    CHECK(overdrawACMR <= cacheACMR * 1.05f + 0.01f);
+}
+
+TEST(meshOptimizerVertexFetch)
+{
+    // Vertex 1 is not used.
+    const unsigned int indices[] = { 4, 2, 0, 0, 2, 3 };
+    unsigned int remap[5];
+    CHECK(MeshOptimizer::optimizeVertexFetch(remap, indices, 6, 5) == 4);
+    CHECK(remap[4] == 0 && remap[2] == 1 && remap[0] == 2 && remap[3] == 3);
+    CHECK(remap[1] == ~0u);
+}
+
+TEST(meshOptimizerWeld)
+{
+    const float vertices[][2] = {
+        { 0.0f, 1.0f },
+        { 1.0f, 0.0f },
+        { 0.0f, 1.0f },
+        { -0.0f, 1.0f },
+        { 1.0f, 0.0f },
+    };
+    unsigned int remap[5];
+    // -0 differs from 0 in its bytes.
+    CHECK(MeshOptimizer::weldVertices(remap, (const char*)vertices, 5, sizeof(vertices[0])) == 3);
+    CHECK(remap[0] == 0 && remap[1] == 1 && remap[2] == 0 && remap[3] == 3 && remap[4] == 1);
+}
@@ -0,0 +1,254 @@
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "Test.h"
+#include "loader/MeshoptDecoder.h"
+
+using namespace mgp;
+
+// The encoders below write the simplest valid streams of each codec, the decoder must
+// accept any choice of the encoder.
+
+static void writeVByte(std::vector<unsigned char>& out, unsigned int v)
+{
+    while (v >= 128)
+    {
+        out.push_back((unsigned char)((v & 127) | 128));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+static unsigned int zigzag(unsigned int d)
+{
+    return (d << 1) ^ (unsigned int)((int)d >> 31);
+}
+
+/**
+ * Vertex codec, every byte group stored raw.
+ */
+static std::vector<unsigned char> encodeVertexBuffer(const unsigned char* vertices, size_t count, size_t size)
+{
+    std::vector<unsigned char> out;
+    out.push_back(0xa0);
+
+    size_t blockSize = std::min((8192 / size) & ~size_t(15), size_t(256));
+    std::vector<unsigned char> last(vertices, vertices + size);
+    for (size_t offset = 0; offset < count; offset += blockSize)
+    {
+        size_t n = std::min(blockSize, count - offset);
+        size_t aligned = (n + 15) & ~size_t(15);
+        for (size_t k = 0; k < size; ++k)
+        {
+            out.insert(out.end(), (aligned / 16 + 3) / 4, (unsigned char)0xff);
+            unsigned char p = last[k];
+            for (size_t i = 0; i < aligned; ++i)
+            {
+                unsigned char v = i < n ? vertices[(offset + i) * size + k] : p;
+                unsigned char d = (unsigned char)(v - p);
+                out.push_back((unsigned char)((d << 1) ^ ((signed char)d >> 7)));
+                p = v;
+            }
+        }
+        memcpy(last.data(), vertices + (offset + n - 1) * size, size);
+    }
+
+    // The first vertex ends the tail.
+    size_t tailSize = std::max(size, size_t(32));
+    out.insert(out.end(), tailSize - size, (unsigned char)0);
+    out.insert(out.end(), vertices, vertices + size);
+    return out;
+}
+
+/**
+ * Index codec version 1, every vertex of every triangle coded as a delta in the data.
+ */
+static std::vector<unsigned char> encodeIndexBuffer(const unsigned int* indices, size_t count)
+{
+    std::vector<unsigned char> out;
+    out.push_back(0xe1);
+    out.insert(out.end(), count / 3, (unsigned char)0xff);
+    unsigned int last = 0;
+    for (size_t i = 0; i < count; i += 3)
+    {
+        out.push_back(0xff);
+        for (size_t j = 0; j < 3; ++j)
+        {
+            writeVByte(out, zigzag(indices[i + j] - last));
+            last = indices[i + j];
+        }
+    }
+    out.insert(out.end(), 16, (unsigned char)0);
+    return out;
+}
+
+/**
+ * Index sequence codec, every index a delta from the first baseline.
+ */
+static std::vector<unsigned char> encodeIndexSequence(const unsigned int* indices, size_t count)
+{
+    std::vector<unsigned char> out;
+    out.push_back(0xd1);
+    unsigned int last = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        writeVByte(out, zigzag(indices[i] - last) << 1);
+        last = indices[i];
+    }
+    out.insert(out.end(), 4, (unsigned char)0);
+    return out;
+}
+
+/**
+ * Decodes a stream the way the loader does, through a compressed buffer view.
+ */
+static bool decodeView(std::vector<unsigned char>& stream, size_t count, size_t stride,
+    cgltf_meshopt_compression_mode mode, cgltf_meshopt_compression_filter filter, std::vector<unsigned char>& result)
+{
+    cgltf_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.data = stream.data();
+    buffer.size = stream.size();
+
+    cgltf_buffer_view view;
+    memset(&view, 0, sizeof(view));
+    view.has_meshopt_compression = 1;
+    view.meshopt_compression.buffer = &buffer;
+    view.meshopt_compression.size = stream.size();
+    view.meshopt_compression.stride = stride;
+    view.meshopt_compression.count = count;
+    view.meshopt_compression.mode = mode;
+    view.meshopt_compression.filter = filter;
+
+    if (!MeshoptDecoder::decode(&view) || !view.data)
+        return false;
+    result.assign((unsigned char*)view.data, (unsigned char*)view.data + count * stride);
+    free(view.data);
+    return true;
+}
+
+TEST(meshoptVertexBuffer)
+{
+    // Spans two blocks of 256 vertices.
+    const size_t count = 300;
+    const size_t size = 16;
+    std::vector<unsigned char> vertices(count * size);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        vertices[i] = (unsigned char)(i % size < 8 ? seed >> 16 : i / size);
+    }
+
+    std::vector<unsigned char> stream = encodeVertexBuffer(vertices.data(), count, size);
+    std::vector<unsigned char> decoded(count * size);
+    CHECK(MeshoptDecoder::decodeVertexBuffer(decoded.data(), count, size, stream.data(), stream.size()));
+    CHECK(decoded == vertices);
+
+    // Truncated or wrongly sized streams are rejected.
+    CHECK(!MeshoptDecoder::decodeVertexBuffer(decoded.data(), count, size, stream.data(), stream.size() - 1));
+    CHECK(!MeshoptDecoder::decodeVertexBuffer(decoded.data(), count, 6, stream.data(), stream.size()));
+}
+
+TEST(meshoptIndexBuffer)
+{
+    const unsigned int indices[] = { 0, 1, 2, 2, 1, 3, 70000, 5, 3, 4, 70000, 0 };
+    const size_t count = sizeof(indices) / sizeof(indices[0]);
+    std::vector<unsigned char> stream = encodeIndexBuffer(indices, count);
+
+    unsigned int decoded[count];
+    CHECK(MeshoptDecoder::decodeIndexBuffer(decoded, count, 4, stream.data(), stream.size()));
+    CHECK(memcmp(decoded, indices, sizeof(indices)) == 0);
+
+    // 16 bits indices keep the low bits.
+    unsigned short decoded16[count];
+    CHECK(MeshoptDecoder::decodeIndexBuffer(decoded16, count, 2, stream.data(), stream.size()));
+    for (size_t i = 0; i < count; ++i)
+        CHECK(decoded16[i] == (unsigned short)indices[i]);
+
+    CHECK(!MeshoptDecoder::decodeIndexBuffer(decoded, count, 4, stream.data(), stream.size() - 1));
+}
+
+TEST(meshoptIndexBufferEdgeFifo)
+{
+    // A new triangle of three next vertices, then one reusing its edge (2, 1) with the next vertex.
+    const unsigned char stream[] = {
+        0xe1,
+        0xfe, 0x10,
+        0x00,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+    const unsigned short expected[] = { 0, 1, 2, 2, 1, 3 };
+    unsigned short decoded[6];
+    CHECK(MeshoptDecoder::decodeIndexBuffer(decoded, 6, 2, stream, sizeof(stream)));
+    CHECK(memcmp(decoded, expected, sizeof(expected)) == 0);
+}
+
+TEST(meshoptIndexSequence)
+{
+    const unsigned int indices[] = { 5, 4, 3, 100000, 0, 1, 2, 65535 };
+    const size_t count = sizeof(indices) / sizeof(indices[0]);
+    std::vector<unsigned char> stream = encodeIndexSequence(indices, count);
+
+    std::vector<unsigned char> decoded;
+    CHECK(decodeView(stream, count, 4, cgltf_meshopt_compression_mode_indices, cgltf_meshopt_compression_filter_none, decoded));
+    CHECK(decoded.size() == sizeof(indices) && memcmp(decoded.data(), indices, sizeof(indices)) == 0);
+}
+
+TEST(meshoptExponentialFilter)
+{
+    // Mantissa in the low 24 bits, exponent in the high 8 bits.
+    const float expected[] = { 1.5f, -0.25f, 0.0f, 1024.0f };
+    const unsigned int encoded[] = {
+        (unsigned int)(-1 & 0xff) << 24 | 3,
+        (unsigned int)(-2 & 0xff) << 24 | (unsigned int)(-1 & 0xffffff),
+        0,
+        10u << 24 | 1,
+    };
+    std::vector<unsigned char> stream = encodeVertexBuffer((const unsigned char*)encoded, 1, sizeof(encoded));
+
+    std::vector<unsigned char> decoded;
+    CHECK(decodeView(stream, 1, sizeof(encoded), cgltf_meshopt_compression_mode_attributes, cgltf_meshopt_compression_filter_exponential, decoded));
+    CHECK(decoded.size() == sizeof(expected) && memcmp(decoded.data(), expected, sizeof(expected)) == 0);
+}
+
+TEST(meshoptOctahedralFilter)
+{
+    // z is stored as the sum of |x| and |y| plus z, the lower hemisphere is folded over.
+    const signed char encoded[][4] = {
+        { 0, 0, 127, 1 },
+        { -127, 0, 127, 2 },
+        { 127, 127, 127, 3 },
+    };
+    const signed char expected[][4] = {
+        { 0, 0, 127, 1 },
+        { -127, 0, 0, 2 },
+        { 0, 0, -127, 3 },
+    };
+    std::vector<unsigned char> stream = encodeVertexBuffer((const unsigned char*)encoded, 3, 4);
+
+    std::vector<unsigned char> decoded;
+    CHECK(decodeView(stream, 3, 4, cgltf_meshopt_compression_mode_attributes, cgltf_meshopt_compression_filter_octahedral, decoded));
+    CHECK(decoded.size() == sizeof(expected) && memcmp(decoded.data(), expected, sizeof(expected)) == 0);
+}
+
+TEST(meshoptQuaternionFilter)
+{
+    // The identity and a quarter turn around z, w is dropped and reconstructed.
+    const short encoded[][4] = {
+        { 0, 0, 0, 32767 },
+        { 0, 0, 32767, 32767 },
+    };
+    const short expected[][4] = {
+        { 0, 0, 0, 32767 },
+        { 0, 0, 23170, 23170 },
+    };
+    std::vector<unsigned char> stream = encodeVertexBuffer((const unsigned char*)encoded, 2, 8);
+
+    std::vector<unsigned char> decoded;
+    CHECK(decodeView(stream, 2, 8, cgltf_meshopt_compression_mode_attributes, cgltf_meshopt_compression_filter_quaternion, decoded));
+    CHECK(decoded.size() == sizeof(expected));
+    const short* q = (const short*)decoded.data();
+    for (size_t i = 0; i < 8 && decoded.size() == sizeof(expected); ++i)
+        CHECK(abs(q[i] - expected[i / 4][i % 4]) <= 1);
+}
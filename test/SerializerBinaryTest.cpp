@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <string.h>
+#include "Test.h"
+#include "base/Base.h"
+#include "base/Ref.h"
+#include "base/Serializable.h"
+#include "base/SerializerBinary.h"
+#include "base/SerializerManager.h"
+#include "base/FileSystem.h"
+#include "base/Stream.h"
+#include "math/Vector2.h"
+#include "math/Vector3.h"
+#include "math/Vector4.h"
+#include "math/Matrix.h"
+
+using namespace mgp;
+
+#define SERIALIZER_TEST_PATH "SerializerBinaryTest.bin"
+
+/**
+ * An object with a property of each kind the serializer writes.
+ */
+class TestObject : public Serializable, public Refable
+{
+public:
+    bool flag = false;
+    int number = 0;
+    int mode = 0;
+    float scalar = 0.0f;
+    Vector2 uv;
+    Vector3 position;
+    Vector4 color;
+    Matrix matrix;
+    std::string name;
+    std::vector<int> ints;
+    std::vector<float> floats;
+    std::vector<double> doubles;
+    std::vector<unsigned char> bytes;
+    std::vector<float> weights;
+    std::vector<std::string> keys;
+    std::vector<int> values;
+    UPtr<TestObject> child;
+    std::vector<UPtr<TestObject> > children;
+
+    TestObject() : child(NULL) {}
+
+    static Serializable* createObject() { return new TestObject(); }
+
+    std::string getClassName() { return "test::TestObject"; }
+
+    void onSerialize(Serializer* serializer)
+    {
+        serializer->writeBool("flag", flag, false);
+        serializer->writeInt("number", number, 0);
+        serializer->writeEnum("mode", "test::Mode", mode, 0);
+        serializer->writeFloat("scalar", scalar, 0.0f);
+        serializer->writeVector("uv", uv, Vector2::zero());
+        serializer->writeVector("position", position, Vector3::zero());
+        serializer->writeColor("color", color, Vector4::zero());
+        serializer->writeMatrix("matrix", matrix, Matrix::identity());
+        serializer->writeString("name", name.c_str(), "");
+        serializer->writeIntArray("ints", ints.data(), ints.size());
+        serializer->writeFloatArray("floats", floats.data(), floats.size());
+        serializer->writeDFloatArray("doubles", doubles.data(), doubles.size());
+        serializer->writeByteArray("bytes", bytes.data(), bytes.size());
+
+        serializer->writeList("weights", weights.size());
+        for (size_t i = 0; i < weights.size(); ++i)
+            serializer->writeFloat(NULL, weights[i], 0.0f);
+        serializer->finishColloction();
+
+        serializer->writeMap("values", keys);
+        for (size_t i = 0; i < keys.size(); ++i)
+            serializer->writeInt(keys[i].c_str(), values[i], 0);
+        serializer->finishColloction();
+
+        serializer->writeObject("child", child.get());
+        serializer->writeList("children", children.size());
+        for (size_t i = 0; i < children.size(); ++i)
+            serializer->writeObject(NULL, children[i].get());
+        serializer->finishColloction();
+    }
+
+    void onDeserialize(Serializer* serializer)
+    {
+        // Read in another order than written.
+        TestObject* object = dynamic_cast<TestObject*>(serializer->readObject("child").take());
+        if (object)
+            child = UPtr<TestObject>(object);
+        size_t childCount = serializer->readList("children");
+        for (size_t i = 0; i < childCount; ++i)
+        {
+            object = dynamic_cast<TestObject*>(serializer->readObject(NULL).take());
+            if (object)
+                children.push_back(UPtr<TestObject>(object));
+        }
+        serializer->finishColloction();
+
+        serializer->readString("name", name, "");
+        matrix = serializer->readMatrix("matrix", Matrix::identity());
+        color = serializer->readColor("color", Vector4::zero());
+        position = serializer->readVector("position", Vector3::zero());
+        uv = serializer->readVector("uv", Vector2::zero());
+        scalar = serializer->readFloat("scalar", 0.0f);
+        mode = serializer->readEnum("mode", "test::Mode", 0);
+        number = serializer->readInt("number", 0);
+        flag = serializer->readBool("flag", false);
+
+        int* intData = NULL;
+        size_t count = serializer->readIntArray("ints", &intData);
+        ints.assign(intData, intData + count);
+        delete[] intData;
+
+        float* floatData = NULL;
+        count = serializer->readFloatArray("floats", &floatData);
+        floats.assign(floatData, floatData + count);
+        delete[] floatData;
+
+        double* doubleData = NULL;
+        count = serializer->readDFloatArray("doubles", &doubleData);
+        doubles.assign(doubleData, doubleData + count);
+        delete[] doubleData;
+
+        unsigned char* byteData = NULL;
+        count = serializer->readByteArray("bytes", &byteData);
+        bytes.assign(byteData, byteData + count);
+        delete[] byteData;
+
+        size_t weightCount = serializer->readList("weights");
+        for (size_t i = 0; i < weightCount; ++i)
+            weights.push_back(serializer->readFloat(NULL, 0.0f));
+        serializer->finishColloction();
+
+        serializer->readMap("values", keys);
+        for (size_t i = 0; i < keys.size(); ++i)
+            values.push_back(serializer->readInt(keys[i].c_str(), 0));
+        serializer->finishColloction();
+    }
+};
+
+/**
+ * A newer version of PartialObject, which writes all the properties of a TestObject.
+ */
+class NewerObject : public TestObject
+{
+public:
+    std::string getClassName() { return "test::PartialObject"; }
+};
+
+/**
+ * Reads a single property of a NewerObject, the reader skips the others, child objects included.
+ */
+class PartialObject : public Serializable, public Refable
+{
+public:
+    int number = 0;
+    std::string missing;
+
+    static Serializable* createObject() { return new PartialObject(); }
+
+    std::string getClassName() { return "test::PartialObject"; }
+
+    void onDeserialize(Serializer* serializer)
+    {
+        number = serializer->readInt("number", -1);
+        serializer->readString("missing", missing, "default");
+    }
+};
+
+static void writeObject(TestObject* object)
+{
+    UPtr<Serializer> writer = SerializerBinary::createWriter(SERIALIZER_TEST_PATH);
+    writer->writeObject(NULL, object);
+    writer->close();
+}
+
+static UPtr<Serializable> readObject()
+{
+    UPtr<Stream> stream = FileSystem::open(SERIALIZER_TEST_PATH);
+    UPtr<Serializer> reader = SerializerBinary::create(stream.get());
+    if (reader.isNull())
+        return UPtr<Serializable>(NULL);
+    stream.take();
+    return reader->readObject(NULL);
+}
+
+static void fillObject(TestObject* object)
+{
+    object->flag = true;
+    object->number = -123456;
+    object->mode = 3;
+    object->scalar = 1.0f / 3.0f;
+    object->uv.set(0.25f, -8.0f);
+    object->position.set(1.0f / 7.0f, 2e10f, -0.0001f);
+    object->color.set(0.0f, 0.2f, 128 / 255.0f, 1.0f);
+    for (int i = 0; i < 16; ++i)
+        object->matrix.m[i] = (float)i / 3.0f;
+    object->name = "root \xe4\xb8\xad";
+    for (int i = 0; i < 1000; ++i)
+    {
+        object->ints.push_back(i * i - 5000);
+        object->floats.push_back(i / 9.0f);
+        object->doubles.push_back(i / 11.0);
+    }
+    for (int i = 0; i < 37; ++i)
+        object->bytes.push_back((unsigned char)(i * 7));
+    object->weights.push_back(0.5f);
+    object->weights.push_back(-2.0f);
+    object->keys.push_back("first");
+    object->keys.push_back("second");
+    object->values.push_back(1);
+    object->values.push_back(2);
+
+    object->child = UPtr<TestObject>(new TestObject());
+    object->child->name = "child";
+    object->child->number = 7;
+    for (int i = 0; i < 3; ++i)
+    {
+        UPtr<TestObject> item(new TestObject());
+        item->number = i + 1;
+        item->ints.push_back(i);
+        object->children.push_back(std::move(item));
+    }
+}
+
+static void registerTypes()
+{
+    SerializerManager::getActivator()->registerType("test::TestObject", &TestObject::createObject);
+    SerializerManager::getActivator()->registerType("test::PartialObject", &PartialObject::createObject);
+}
+
+TEST(serializerBinaryRoundTrip)
+{
+    registerTypes();
+    UPtr<TestObject> object(new TestObject());
+    fillObject(object.get());
+    writeObject(object.get());
+
+    UPtr<TestObject> read = readObject().dynamicCastTo<TestObject>();
+    remove(SERIALIZER_TEST_PATH);
+    CHECK(!read.isNull());
+    if (read.isNull())
+        return;
+
+    CHECK(read->flag == object->flag);
+    CHECK(read->number == object->number);
+    CHECK(read->mode == object->mode);
+    CHECK(read->scalar == object->scalar);
+    CHECK(read->uv == object->uv);
+    CHECK(read->position == object->position);
+    // Colors keep 8 bits per channel.
+    CHECK(read->color.distance(object->color) < 0.5f / 255.0f);
+    CHECK(read->matrix == object->matrix);
+    CHECK(read->name == object->name);
+    CHECK(read->ints == object->ints);
+    CHECK(read->floats == object->floats);
+    CHECK(read->doubles == object->doubles);
+    CHECK(read->bytes == object->bytes);
+    CHECK(read->weights == object->weights);
+    CHECK(read->keys == object->keys);
+    CHECK(read->values == object->values);
+
+    CHECK(!read->child.isNull() && read->child->name == "child" && read->child->number == 7);
+    CHECK(read->children.size() == 3);
+    for (size_t i = 0; i < read->children.size(); ++i)
+    {
+        CHECK(!read->children[i].isNull());
+        if (read->children[i].isNull())
+            continue;
+        CHECK(read->children[i]->number == (int)i + 1);
+        CHECK(read->children[i]->ints.size() == 1 && read->children[i]->ints[0] == (int)i);
+        // Default values are not written and read back as the default.
+        CHECK(read->children[i]->name.empty() && !read->children[i]->flag);
+    }
+}
+
+TEST(serializerBinaryDefaults)
+{
+    registerTypes();
+    UPtr<TestObject> object(new TestObject());
+    writeObject(object.get());
+
+    UPtr<TestObject> read = readObject().dynamicCastTo<TestObject>();
+    remove(SERIALIZER_TEST_PATH);
+    CHECK(!read.isNull());
+    if (read.isNull())
+        return;
+    CHECK(read->matrix.isIdentity());
+    CHECK(read->ints.empty() && read->bytes.empty() && read->weights.empty() && read->keys.empty());
+    CHECK(read->child.isNull() && read->children.empty());
+}
+
+TEST(serializerBinarySkip)
+{
+    registerTypes();
+    UPtr<NewerObject> object(new NewerObject());
+    fillObject(object.get());
+    writeObject(object.get());
+
+    // The older version of the class reads a subset of the properties.
+    UPtr<PartialObject> read = readObject().dynamicCastTo<PartialObject>();
+    remove(SERIALIZER_TEST_PATH);
+    CHECK(!read.isNull());
+    if (read.isNull())
+        return;
+    CHECK(read->number == object->number);
+    CHECK(read->missing == "default");
+}
+
+TEST(serializerBinarySharedObject)
+{
+    registerTypes();
+    UPtr<TestObject> object(new TestObject());
+    UPtr<TestObject> shared(new TestObject());
+    shared->number = 42;
+
+    // The second reference is written as a reference to the first.
+    shared->addRef();
+    object->children.push_back(UPtr<TestObject>(shared.get()));
+    object->children.push_back(std::move(shared));
+    writeObject(object.get());
+
+    UPtr<TestObject> read = readObject().dynamicCastTo<TestObject>();
+    remove(SERIALIZER_TEST_PATH);
+    CHECK(!read.isNull());
+    if (read.isNull())
+        return;
+    CHECK(read->children.size() == 2);
+    if (read->children.size() != 2)
+        return;
+    CHECK(read->children[0].get() == read->children[1].get());
+    CHECK(read->children[0]->number == 42);
+    CHECK(read->children[0]->getRefCount() == 2);
+}
+
+TEST(serializerBinaryInvalid)
+{
+    // Not a binary file, the stream stays with the caller.
+    FILE* file = fopen(SERIALIZER_TEST_PATH, "wb");
+    fputs("{ \"number\": 1 }", file);
+    fclose(file);
+
+    UPtr<Stream> stream = FileSystem::open(SERIALIZER_TEST_PATH);
+    CHECK(!stream.isNull());
+    if (!stream.isNull())
+    {
+        UPtr<Serializer> reader = SerializerBinary::create(stream.get());
+        CHECK(reader.isNull());
+        stream->close();
+    }
+    remove(SERIALIZER_TEST_PATH);
+}
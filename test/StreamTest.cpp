@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <vector>
+#include "Test.h"
+#include "base/Buffer.h"
+#include "base/BufferedStream.h"
+#include "base/FileStream.h"
+
+using namespace mgp;
+
+#define STREAM_TEST_PATH "StreamTest.bin"
+
+/**
+ * Writes values of each size in the byte order of the buffer and reads them back.
+ */
+static void checkBuffer(Endian::Type endian)
+{
+    Buffer buffer((size_t)0);
+    buffer.endian = endian;
+    buffer.writeUInt32(0x01020304);
+    buffer.writeUInt16(0xa1b2);
+    const float floats[] = { 1.5f, -2.0f, 3.25f, 4.0f, 1e10f };
+    CHECK(buffer.writeFloatArray(floats, 5) == 5);
+    const double doubles[] = { 1.0 / 3.0, -7.0, 1e300 };
+    CHECK(buffer.writeDoubleArray(doubles, 3) == 3);
+    const uint16_t shorts[] = { 1, 0x1234, 0xffff };
+    CHECK(buffer.writeUInt16Array(shorts, 3) == 3);
+    buffer.writeStr("hello");
+    CHECK(buffer.position() == (long)buffer.length());
+
+    CHECK(buffer.seek(0, SEEK_SET));
+    CHECK(buffer.readUInt32() == 0x01020304);
+    CHECK(buffer.readUInt16() == 0xa1b2);
+    float floatsRead[5];
+    CHECK(buffer.readFloatArray(floatsRead, 5) == 5);
+    for (int i = 0; i < 5; ++i)
+        CHECK(floatsRead[i] == floats[i]);
+    double doublesRead[3];
+    CHECK(buffer.readDoubleArray(doublesRead, 3) == 3);
+    for (int i = 0; i < 3; ++i)
+        CHECK(doublesRead[i] == doubles[i]);
+    uint16_t shortsRead[3];
+    CHECK(buffer.readUInt16Array(shortsRead, 3) == 3);
+    for (int i = 0; i < 3; ++i)
+        CHECK(shortsRead[i] == shorts[i]);
+    CHECK(buffer.readStr() == "hello");
+    CHECK(buffer.eof());
+
+    // The string is 4 bytes of length and the characters.
+    CHECK(buffer.seek(-9, SEEK_END));
+    CHECK(buffer.readStr() == "hello");
+    CHECK(buffer.seek(-4, SEEK_CUR));
+    CHECK(buffer.readUInt8() == 'e');
+    CHECK(!buffer.seek(1, SEEK_END));
+
+    // Bulk reads stop at the end.
+    char all[100];
+    CHECK(buffer.seek(0));
+    CHECK(buffer.read(all, 1, sizeof(all)) == buffer.length());
+    CHECK(buffer.eof());
+}
+
+TEST(bufferLittleEndian)
+{
+    checkBuffer(Endian::Little);
+
+    Buffer buffer((size_t)0);
+    buffer.endian = Endian::Little;
+    buffer.writeUInt32(0x01020304);
+    CHECK(buffer.seek(0));
+    unsigned char* bytes = buffer.readDirect(4);
+    CHECK(bytes[0] == 4 && bytes[3] == 1);
+}
+
+TEST(bufferBigEndian)
+{
+    checkBuffer(Endian::Big);
+
+    Buffer buffer((size_t)0);
+    buffer.endian = Endian::Big;
+    const uint32_t ints[] = { 0x01020304, 0x05060708 };
+    CHECK(buffer.writeUInt32Array(ints, 2) == 2);
+    CHECK(buffer.seek(0));
+    unsigned char* bytes = buffer.readDirect(8);
+    CHECK(bytes[0] == 1 && bytes[3] == 4 && bytes[4] == 5 && bytes[7] == 8);
+}
+
+TEST(bufferedStream)
+{
+    // A small buffer, so that reads and writes go through refills and past the buffer.
+    const int count = 10000;
+    std::vector<float> floats(1000);
+    for (size_t i = 0; i < floats.size(); ++i)
+        floats[i] = i * 0.5f;
+    long end = 0;
+    {
+        BufferedStream stream(FileStream::create(STREAM_TEST_PATH, "wb").take(), 64);
+        for (int i = 0; i < count; ++i)
+            stream.writeUInt32(i);
+        CHECK(stream.writeFloatArray(floats.data(), floats.size()) == floats.size());
+        end = stream.position();
+        CHECK(end == count * 4 + 4000);
+
+        // Overwrite a value then append at the end.
+        CHECK(stream.seek(8));
+        stream.writeUInt32(777);
+        CHECK(stream.seek(0, SEEK_END));
+        stream.writeUInt8(9);
+        CHECK(stream.position() == end + 1);
+    }
+    {
+        BufferedStream stream(FileStream::create(STREAM_TEST_PATH, "rb").take(), 64);
+        CHECK(stream.length() == (size_t)end + 1);
+        bool same = true;
+        for (int i = 0; i < count; ++i)
+            same = same && stream.readUInt32() == (i == 2 ? 777u : (uint32_t)i);
+        CHECK(same);
+        std::vector<float> floatsRead(floats.size());
+        CHECK(stream.readFloatArray(floatsRead.data(), floatsRead.size()) == floatsRead.size());
+        CHECK(floatsRead == floats);
+        CHECK(stream.readUInt8() == 9);
+        CHECK(stream.eof());
+
+        CHECK(stream.seek(40));
+        CHECK(stream.readUInt32() == 10);
+        CHECK(stream.position() == 44);
+        CHECK(stream.seek(-8, SEEK_CUR));
+        CHECK(stream.readUInt32() == 9);
+        CHECK(stream.seek(count * 4 - 4));
+        CHECK(stream.readUInt32() == (uint32_t)count - 1);
+
+        char bytes[3];
+        CHECK(stream.seek(0));
+        CHECK(stream.read(bytes, 1, 3) == 3);
+        CHECK(stream.position() == 3);
+    }
+    remove(STREAM_TEST_PATH);
+}
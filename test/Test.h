@@ -0,0 +1,45 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <iostream>
+#include <vector>
+
+/**
+ * A test case, registered by the TEST macro and run by main().
+ */
+struct TestCase
+{
+    const char* name;
+    void (*func)();
+
+    static std::vector<TestCase>& all()
+    {
+        static std::vector<TestCase> cases;
+        return cases;
+    }
+
+    TestCase(const char* name, void (*func)()) : name(name), func(func)
+    {
+        all().push_back(*this);
+    }
+};
+
+/**
+ * Number of failed checks of the running test.
+ */
+extern int g_testFailures;
+
+#define TEST(name) \
+    static void name(); \
+    static TestCase name##_case(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::cout << "  " << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            ++g_testFailures; \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,179 @@
+#include <math.h>
+#include <string.h>
+#include "Test.h"
+#include "scene/VertexFormat.h"
+#include "base/Buffer.h"
+
+using namespace mgp;
+
+static VertexFormat::Element makeElement(VertexFormat::Usage usage, unsigned int size, VertexFormat::DataType dataType, bool normalized)
+{
+    VertexFormat::Element element(usage, size);
+    element.dataType = dataType;
+    element.normalized = normalized;
+    return element;
+}
+
+/**
+ * Encodes the values in a vertex and checks that they decode within the tolerance.
+ */
+static void checkRoundTrip(const VertexFormat::Element& element, const float* values, float tolerance)
+{
+    char vertex[64];
+    memset(vertex, 0xcd, sizeof(vertex));
+    element.encode(vertex, values);
+
+    float decoded[4];
+    element.decode(vertex, decoded);
+    for (unsigned int i = 0; i < element.size; ++i)
+        CHECK(fabsf(decoded[i] - values[i]) <= tolerance);
+
+    // Encoding the decoded values gives the same bytes.
+    char again[64];
+    memset(again, 0xcd, sizeof(again));
+    element.encode(again, decoded);
+    CHECK(memcmp(vertex + element.offset, again + element.offset, element.getByteSize()) == 0);
+}
+
+TEST(vertexFormatLayout)
+{
+    VertexFormat::Element elements[] = {
+        makeElement(VertexFormat::POSITION, 3, VertexFormat::FLOAT32, false),
+        makeElement(VertexFormat::NORMAL, 4, VertexFormat::INT_2_10_10_10, true),
+        makeElement(VertexFormat::TEXCOORD0, 2, VertexFormat::HALF_FLOAT, false),
+        makeElement(VertexFormat::COLOR, 3, VertexFormat::UINT8, true),
+        makeElement(VertexFormat::BLENDINDICES, 4, VertexFormat::UINT16, false),
+    };
+    VertexFormat format(elements, 5);
+
+    // Every element starts 4 bytes aligned.
+    CHECK(format.getElement(0).offset == 0);
+    CHECK(format.getElement(1).offset == 12);
+    CHECK(format.getElement(2).offset == 16);
+    CHECK(format.getElement(3).offset == 20);
+    CHECK(format.getElement(4).offset == 24);
+    CHECK(format.getVertexSize() == 32);
+    for (unsigned int i = 0; i < format.getElementCount(); ++i)
+        CHECK(format.getElement(i).stride == 32);
+
+    CHECK(format.getElement(4).isInteger());
+    CHECK(!format.getElement(3).isInteger());
+    CHECK(format.getPositionElement() == &format.getElement(0));
+}
+
+TEST(vertexFormatFloat)
+{
+    VertexFormat::Element element = makeElement(VertexFormat::POSITION, 4, VertexFormat::FLOAT32, false);
+    element.offset = 4;
+    const float values[] = { 1.0f / 3.0f, -1e20f, 0.0f, 7.5f };
+    checkRoundTrip(element, values, 0.0f);
+}
+
+TEST(vertexFormatHalfFloat)
+{
+    VertexFormat::Element element = makeElement(VertexFormat::TEXCOORD0, 4, VertexFormat::HALF_FLOAT, false);
+    element.offset = 0;
+
+    // Exactly representable values, the largest half and a subnormal.
+    const float exact[] = { 0.5f, -1.25f, 65504.0f, 1.0f / (1 << 24) };
+    checkRoundTrip(element, exact, 0.0f);
+
+    // Rounded to the 11 bits of precision in [-2, 2].
+    const float rounded[] = { 0.1f, -1.9f, 1.0f / 3.0f, 0.0001f };
+    checkRoundTrip(element, rounded, 1.0f / 1024.0f);
+
+    // Out of range values become infinity.
+    char vertex[8];
+    const float large[] = { 1e6f, -1e6f, 0, 0 };
+    element.encode(vertex, large);
+    float decoded[4];
+    element.decode(vertex, decoded);
+    CHECK(isinf(decoded[0]) && decoded[0] > 0);
+    CHECK(isinf(decoded[1]) && decoded[1] < 0);
+}
+
+TEST(vertexFormatNormalizedIntegers)
+{
+    VertexFormat::Element int8 = makeElement(VertexFormat::NORMAL, 3, VertexFormat::INT8, true);
+    int8.offset = 0;
+    const float normal[] = { -1.0f, 0.0f, 0.70710678f };
+    checkRoundTrip(int8, normal, 0.5f / 127.0f);
+
+    VertexFormat::Element uint8 = makeElement(VertexFormat::COLOR, 4, VertexFormat::UINT8, true);
+    uint8.offset = 0;
+    const float color[] = { 0.0f, 1.0f, 0.2f, 0.8f };
+    checkRoundTrip(uint8, color, 0.5f / 255.0f);
+
+    VertexFormat::Element int16 = makeElement(VertexFormat::TEXCOORD1, 2, VertexFormat::INT16, true);
+    int16.offset = 0;
+    const float uv[] = { -0.123f, 0.999f };
+    checkRoundTrip(int16, uv, 0.5f / 32767.0f);
+
+    VertexFormat::Element uint16 = makeElement(VertexFormat::TEXCOORD2, 2, VertexFormat::UINT16, true);
+    uint16.offset = 0;
+    const float uv2[] = { 0.0f, 0.75f };
+    checkRoundTrip(uint16, uv2, 0.5f / 65535.0f);
+
+    // Values out of range are clamped.
+    char vertex[8];
+    const float over[] = { 2.0f, -3.0f, 0.5f, 1.5f };
+    uint8.encode(vertex, over);
+    float decoded[4];
+    uint8.decode(vertex, decoded);
+    CHECK(decoded[0] == 1.0f && decoded[1] == 0.0f && decoded[3] == 1.0f);
+
+    // The lowest signed value decodes to -1 too.
+    vertex[0] = -128;
+    int8.decode(vertex, decoded);
+    CHECK(decoded[0] == -1.0f);
+}
+
+TEST(vertexFormatIntegers)
+{
+    VertexFormat::Element joints = makeElement(VertexFormat::BLENDINDICES, 4, VertexFormat::UINT16, false);
+    joints.offset = 0;
+    const float indices[] = { 0.0f, 1.0f, 255.0f, 65535.0f };
+    checkRoundTrip(joints, indices, 0.0f);
+
+    VertexFormat::Element int32 = makeElement(VertexFormat::CUSTEM, 2, VertexFormat::INT32, false);
+    int32.offset = 0;
+    const float ints[] = { -100000.0f, 123456.0f };
+    checkRoundTrip(int32, ints, 0.0f);
+}
+
+TEST(vertexFormatPacked)
+{
+    VertexFormat::Element tangent = makeElement(VertexFormat::TANGENT, 4, VertexFormat::INT_2_10_10_10, true);
+    tangent.offset = 0;
+    CHECK(tangent.getByteSize() == 4);
+
+    // w is the handedness, -1 or 1 in the 2 bits.
+    const float values[] = { 0.6f, -0.8f, 0.0f, -1.0f };
+    checkRoundTrip(tangent, values, 0.5f / 511.0f);
+    const float flipped[] = { -1.0f, 1.0f, 0.25f, 1.0f };
+    checkRoundTrip(tangent, flipped, 0.5f / 511.0f);
+
+    VertexFormat::Element color = makeElement(VertexFormat::COLOR, 4, VertexFormat::UINT_2_10_10_10, true);
+    color.offset = 0;
+    const float rgba[] = { 1.0f, 0.3f, 0.0f, 2.0f / 3.0f };
+    checkRoundTrip(color, rgba, 0.5f / 1023.0f);
+}
+
+TEST(vertexFormatElementStream)
+{
+    VertexFormat::Element element = makeElement(VertexFormat::TEXCOORD3, 2, VertexFormat::HALF_FLOAT, false);
+    element.name = "a_uv";
+    element.offset = 8;
+    element.stride = 24;
+
+    Buffer buffer((size_t)0);
+    element.write(&buffer);
+    CHECK(buffer.seek(0));
+
+    VertexFormat::Element read;
+    CHECK(read.read(&buffer));
+    CHECK(read == element);
+    CHECK(read.name == element.name);
+    CHECK(read.offset == element.offset && read.stride == element.stride);
+    CHECK(buffer.eof());
+}
@@ -0,0 +1,31 @@
+#include <string.h>
+#include "Test.h"
+
+int g_testFailures = 0;
+
+/**
+ * Runs the tests, or the ones whose name contains the argument.
+ *
+ * Usage: tests [filter]
+ */
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : NULL;
+    int failed = 0;
+    int count = 0;
+    for (const TestCase& test : TestCase::all())
+    {
+        if (filter && !strstr(test.name, filter))
+            continue;
+        g_testFailures = 0;
+        test.func();
+        ++count;
+        if (g_testFailures)
+        {
+            std::cout << "FAILED " << test.name << std::endl;
+            ++failed;
+        }
+    }
+    std::cout << (count - failed) << "/" << count << " tests passed" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+
+#include <iostream>
+#include <string.h>
+#include "base/FileSystem.h"
+#include "base/PackFile.h"
+
+using namespace mgp;
+
+/**
+ * Packs an asset directory in one file, mounted at runtime with FileSystem::mount().
+ *
+ * Usage: packer [-store] <directory> <pack>
+ */
+int main(int argc, char* argv[])
+{
+    bool compress = true;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-store") == 0)
+    {
+        compress = false;
+        ++arg;
+    }
+    if (argc - arg != 2)
+    {
+        std::cout << "usage: packer [-store] <directory> <pack>" << std::endl;
+        std::cout << "  -store  do not compress the entries" << std::endl;
+        return 1;
+    }
+
+    FileSystem::setResourcePath("");
+    if (!PackFile::build(argv[arg], argv[arg + 1], compress))
+    {
+        std::cout << "failed to write " << argv[arg + 1] << std::endl;
+        return 1;
+    }
+
+    UPtr<PackFile> pack = PackFile::open(argv[arg + 1]);
+    if (pack.isNull())
+    {
+        std::cout << "failed to read " << argv[arg + 1] << std::endl;
+        return 1;
+    }
+    std::cout << "packed " << pack->getEntryCount() << " files in " << argv[arg + 1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,394 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+#include "base/FileSystem.h"
+#include "base/Serializer.h"
+#include "base/SerializerBinary.h"
+#include "base/SerializerManager.h"
+#include "jparser.hpp"
+
+using namespace mgp;
+
+/**
+ * An object of a json scene, written or read through a serializer with the properties of its json.
+ *
+ * The classes of the scene do not need to be instantiated: their json gives the properties
+ * and their types, the same calls are made on the json and binary readers when timing them.
+ */
+class JsonObject : public Serializable, public Refable
+{
+public:
+    JsonObject(jc::Value* node) : _node(node) {}
+
+    std::string getClassName()
+    {
+        jc::Value* className = _node->get("class");
+        return className ? className->as_str() : "";
+    }
+
+    void onSerialize(Serializer* serializer);
+    void onDeserialize(Serializer* serializer);
+
+    static Serializable* create();
+
+    // the json of the next object read, the shared objects, the objects read and the sum of their values
+    static jc::Value* next;
+    static std::map<std::string, JsonObject*> xrefs;
+    static std::vector<Refable*> loaded;
+    static double checksum;
+
+private:
+    jc::Value* _node;
+};
+
+jc::Value* JsonObject::next = nullptr;
+std::map<std::string, JsonObject*> JsonObject::xrefs;
+std::vector<Refable*> JsonObject::loaded;
+double JsonObject::checksum = 0;
+
+Serializable* JsonObject::create()
+{
+    return new JsonObject(next);
+}
+
+static bool isNumber(jc::Value* value)
+{
+    return value->type() == jc::Type::Integer || value->type() == jc::Type::Float;
+}
+
+static bool isNumberArray(jc::Value* value, bool* isInteger)
+{
+    if (value->type() != jc::Type::Array || value->size() == 0)
+        return false;
+    *isInteger = true;
+    for (auto it = value->begin(); it != value->end(); ++it)
+    {
+        if (!isNumber(*it))
+            return false;
+        if ((*it)->type() == jc::Type::Float)
+            *isInteger = false;
+    }
+    return true;
+}
+
+static void writeValue(Serializer* serializer, const char* name, jc::Value* value)
+{
+    bool isInteger;
+    switch (value->type())
+    {
+    case jc::Type::Boolean:
+        serializer->writeBool(name, value->as_bool(), !value->as_bool());
+        break;
+    case jc::Type::Integer:
+        serializer->writeInt(name, value->as_int(), ~value->as_int());
+        break;
+    case jc::Type::Float:
+        serializer->writeFloat(name, value->as_float(), NAN);
+        break;
+    case jc::Type::String:
+        // colors, enums and base64 bytes stay strings, the binary reader parses them like the json one
+        serializer->writeString(name, value->as_str(), nullptr);
+        break;
+    case jc::Type::Array:
+        if (name && isNumberArray(value, &isInteger))
+        {
+            std::vector<double> numbers;
+            for (auto it = value->begin(); it != value->end(); ++it)
+                numbers.push_back((*it)->as_float());
+            if (isInteger)
+            {
+                std::vector<int> data(numbers.begin(), numbers.end());
+                serializer->writeIntArray(name, data.data(), data.size());
+            }
+            else
+            {
+                // Float is double, float arrays would round the vectors and matrices
+                serializer->writeDFloatArray(name, numbers.data(), numbers.size());
+            }
+        }
+        else if (name)
+        {
+            serializer->writeList(name, value->size());
+            for (auto it = value->begin(); it != value->end(); ++it)
+                writeValue(serializer, nullptr, *it);
+            serializer->finishColloction();
+        }
+        else
+        {
+            std::cout << "skipped a list in a list" << std::endl;
+        }
+        break;
+    case jc::Type::Object:
+        if (value->get("class"))
+        {
+            jc::Value* xref = value->get("xref");
+            if (xref && xref->as_str()[0] == '@')
+            {
+                // written before, the binary writer refers to it by its address
+                auto itr = JsonObject::xrefs.find(xref->as_str() + 1);
+                if (itr != JsonObject::xrefs.end())
+                    serializer->writeObject(name, itr->second);
+                else
+                    std::cout << "unresolved xref " << xref->as_str() << std::endl;
+                break;
+            }
+            JsonObject* object = new JsonObject(value);
+            if (xref)
+            {
+                // the reference of the table makes the writer share it
+                object->addRef();
+                JsonObject::xrefs[xref->as_str()] = object;
+            }
+            serializer->writeObject(name, object);
+            object->release();
+        }
+        else if (name)
+        {
+            std::vector<std::string> keys;
+            for (auto it = value->begin(); it != value->end(); ++it)
+                keys.push_back(((jc::JsonNode*)*it)->name);
+            serializer->writeMap(name, keys);
+            for (auto it = value->begin(); it != value->end(); ++it)
+                writeValue(serializer, ((jc::JsonNode*)*it)->name, *it);
+            serializer->finishColloction();
+        }
+        else
+        {
+            std::cout << "skipped a map in a list" << std::endl;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void readValue(Serializer* serializer, const char* name, jc::Value* value)
+{
+    bool isInteger;
+    switch (value->type())
+    {
+    case jc::Type::Boolean:
+        JsonObject::checksum += serializer->readBool(name, false);
+        break;
+    case jc::Type::Integer:
+        JsonObject::checksum += serializer->readInt(name, 0);
+        break;
+    case jc::Type::Float:
+        JsonObject::checksum += serializer->readFloat(name, 0);
+        break;
+    case jc::Type::String:
+    {
+        std::string str;
+        serializer->readString(name, str, "");
+        JsonObject::checksum += str.size();
+        break;
+    }
+    case jc::Type::Array:
+        if (name && isNumberArray(value, &isInteger))
+        {
+            size_t count;
+            if (isInteger)
+            {
+                int* data = nullptr;
+                count = serializer->readIntArray(name, &data);
+                for (size_t i = 0; i < count; ++i)
+                    JsonObject::checksum += data[i];
+                delete[] data;
+            }
+            else
+            {
+                double* data = nullptr;
+                count = serializer->readDFloatArray(name, &data);
+                for (size_t i = 0; i < count; ++i)
+                    JsonObject::checksum += data[i];
+                delete[] data;
+            }
+        }
+        else if (name)
+        {
+            size_t count = serializer->readList(name);
+            size_t i = 0;
+            for (auto it = value->begin(); it != value->end() && i < count; ++it, ++i)
+                readValue(serializer, nullptr, *it);
+            serializer->finishColloction();
+        }
+        break;
+    case jc::Type::Object:
+        if (value->get("class"))
+        {
+            JsonObject::next = value;
+            // kept until the end of the load for the objects referring to it
+            Serializable* object = serializer->readObject(name).take();
+            if (object)
+                JsonObject::loaded.push_back(dynamic_cast<Refable*>(object));
+            else
+                JsonObject::checksum += 1e9;
+        }
+        else if (name)
+        {
+            std::vector<std::string> keys;
+            serializer->readMap(name, keys);
+            for (auto it = value->begin(); it != value->end(); ++it)
+                readValue(serializer, ((jc::JsonNode*)*it)->name, *it);
+            serializer->finishColloction();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void JsonObject::onSerialize(Serializer* serializer)
+{
+    for (auto it = _node->begin(); it != _node->end(); ++it)
+    {
+        const char* name = ((jc::JsonNode*)*it)->name;
+        if (strcmp(name, "class") == 0 || strcmp(name, "xref") == 0 || strcmp(name, "version") == 0)
+            continue;
+        writeValue(serializer, name, *it);
+    }
+}
+
+void JsonObject::onDeserialize(Serializer* serializer)
+{
+    for (auto it = _node->begin(); it != _node->end(); ++it)
+    {
+        const char* name = ((jc::JsonNode*)*it)->name;
+        if (strcmp(name, "class") == 0 || strcmp(name, "xref") == 0 || strcmp(name, "version") == 0)
+            continue;
+        readValue(serializer, name, *it);
+    }
+}
+
+static void registerClasses(jc::Value* value)
+{
+    if (value->type() != jc::Type::Object && value->type() != jc::Type::Array)
+        return;
+    jc::Value* className = value->type() == jc::Type::Object ? value->get("class") : nullptr;
+    if (className)
+        SerializerManager::getActivator()->registerType(className->as_str(), JsonObject::create);
+    for (auto it = value->begin(); it != value->end(); ++it)
+        registerClasses(*it);
+}
+
+/**
+ * Loads a scene with the reader of its format and the calls of its json, returns the time in milliseconds.
+ */
+static double load(const char* path, jc::Value* root, double* checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+    UPtr<Serializer> reader = Serializer::createReader(path);
+    if (reader.isNull())
+    {
+        std::cout << "failed to read " << path << std::endl;
+        return -1;
+    }
+    JsonObject::checksum = 0;
+    JsonObject::next = root;
+    Serializable* scene = reader->readObject(nullptr).take();
+    if (scene)
+        JsonObject::loaded.push_back(dynamic_cast<Refable*>(scene));
+    reader->close();
+    for (Refable* object : JsonObject::loaded)
+        object->release();
+    JsonObject::loaded.clear();
+    *checksum = JsonObject::checksum;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Converts a json scene, or any json serialized object, to the binary format of SerializerBinary.
+ *
+ * With -bench both files are loaded a few times and the best load times are compared.
+ *
+ * Usage: sceneconv [-bench [runs]] <scene.json> <scene.bin>
+ */
+int main(int argc, char* argv[])
+{
+    int runs = 0;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-bench") == 0)
+    {
+        runs = 5;
+        ++arg;
+        if (argc - arg == 3)
+            runs = atoi(argv[arg++]);
+    }
+    if (argc - arg != 2)
+    {
+        std::cout << "usage: sceneconv [-bench [runs]] <scene.json> <scene.bin>" << std::endl;
+        std::cout << "  -bench  compare the load times of the json and binary files" << std::endl;
+        return 1;
+    }
+    const char* jsonPath = argv[arg];
+    const char* binaryPath = argv[arg + 1];
+
+    FileSystem::setResourcePath("");
+    int size = 0;
+    char* buffer = FileSystem::readAll(jsonPath, &size);
+    if (!buffer)
+    {
+        std::cout << "failed to read " << jsonPath << std::endl;
+        return 1;
+    }
+    jc::JsonAllocator allocator;
+    jc::JsonParser parser(&allocator);
+    jc::JsonNode* root = (jc::JsonNode*)parser.parse(buffer);
+    if (!root || root->type() != jc::Type::Object || !root->get("class"))
+    {
+        std::cout << "not a json serialized object " << jsonPath << std::endl;
+        SAFE_DELETE_ARRAY(buffer);
+        return 1;
+    }
+
+    int result = 0;
+    if (runs == 0)
+    {
+        UPtr<Serializer> writer = SerializerBinary::createWriter(binaryPath);
+        if (writer.isNull())
+        {
+            std::cout << "failed to write " << binaryPath << std::endl;
+            result = 1;
+        }
+        else
+        {
+            JsonObject* scene = new JsonObject(root);
+            writer->writeObject(nullptr, scene);
+            writer->close();
+            scene->release();
+            std::cout << "converted " << jsonPath << " to " << binaryPath << std::endl;
+        }
+        for (auto& xref : JsonObject::xrefs)
+            xref.second->release();
+        JsonObject::xrefs.clear();
+    }
+    else
+    {
+        registerClasses(root);
+        double jsonTime = 0, binaryTime = 0, jsonChecksum = 0, binaryChecksum = 0;
+        for (int i = 0; i < runs && result == 0; ++i)
+        {
+            double t = load(jsonPath, root, &jsonChecksum);
+            double b = load(binaryPath, root, &binaryChecksum);
+            if (t < 0 || b < 0)
+                result = 1;
+            jsonTime = (i == 0 || t < jsonTime) ? t : jsonTime;
+            binaryTime = (i == 0 || b < binaryTime) ? b : binaryTime;
+        }
+        if (result == 0)
+        {
+            std::cout << "json:   " << jsonTime << " ms" << std::endl;
+            std::cout << "binary: " << binaryTime << " ms (" << jsonTime / binaryTime << "x)" << std::endl;
+            // Same values summed in the same order, any difference is a value lost in the conversion
+            if (jsonChecksum != binaryChecksum)
+            {
+                std::cout << "the files read different values: " << std::setprecision(17) << jsonChecksum << " and " << binaryChecksum << std::endl;
+                result = 1;
+            }
+        }
+    }
+    SAFE_DELETE_ARRAY(buffer);
+    return result;
+}